@@ -15,6 +15,9 @@ public:
 	struct ObjectConstants {
 		XMFLOAT4X4 WorldViewProj = MathHelper::Identity4x4();
 		XMFLOAT4X4 TexTransform = MathHelper::Identity4x4();
+		// Quantized vertices only: position = PosOffset + PosScale * stored position.
+		XMFLOAT4 PosScale = { 1.0f, 1.0f, 1.0f, 0.0f };
+		XMFLOAT4 PosOffset = { 0.0f, 0.0f, 0.0f, 0.0f };
 	};
 
 	struct Vertex
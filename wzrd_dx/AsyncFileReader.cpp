@@ -0,0 +1,489 @@
+#include "AsyncFileReader.h"
+#include <algorithm>
+#include <atomic>
+#include <new>
+
+#ifdef _WIN32
+#include <windows.h>
+#include <malloc.h>
+#else
+#include <cerrno>
+#include <cstdlib>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+const std::intptr_t NoFile = -1;
+
+// Sector size assumed for unbuffered files when the OS does not report one.
+const std::uint32_t DefaultSectorSize = 4096;
+
+// The file calls the ThreadPool backend is built on. Error codes are Win32
+// codes on Windows and errno values elsewhere, 0 for success.
+#ifdef _WIN32
+
+const std::uint32_t ReadCancelled = ERROR_OPERATION_ABORTED;
+
+// Completion entries taken off the port per call.
+const ULONG PortBatchSize = 64;
+
+std::intptr_t FromHandle(HANDLE handle) {
+	return handle == INVALID_HANDLE_VALUE ? NoFile : (std::intptr_t)handle;
+}
+
+DWORD OpenFlags(bool unbuffered, bool overlapped) {
+	DWORD flags = FILE_ATTRIBUTE_NORMAL;
+	if (overlapped)
+		flags |= FILE_FLAG_OVERLAPPED;
+	if (unbuffered)
+		flags |= FILE_FLAG_NO_BUFFERING;
+	return flags;
+}
+
+bool QueryFileSize(std::intptr_t file, std::uint64_t& size) {
+	LARGE_INTEGER fileSize;
+	if (!GetFileSizeEx((HANDLE)file, &fileSize))
+		return false;
+	size = (std::uint64_t)fileSize.QuadPart;
+	return true;
+}
+
+// Unbuffered reads must be whole logical sectors; the drive may prefer larger.
+std::uint32_t QuerySectorSize(std::intptr_t file) {
+	FILE_STORAGE_INFO storage;
+	if (GetFileInformationByHandleEx((HANDLE)file, FileStorageInfo, &storage, sizeof(storage)))
+		return std::max<std::uint32_t>(storage.LogicalBytesPerSector, storage.PhysicalBytesPerSectorForPerformance);
+	return DefaultSectorSize;
+}
+
+// One blocking read at offset. A read that starts at or past the end of the
+// file reads nothing rather than failing.
+std::uint32_t ReadAt(std::intptr_t file, void* buffer, std::uint32_t size, std::uint64_t offset, std::uint32_t& bytesRead) {
+	OVERLAPPED overlapped = {};
+	overlapped.Offset = (DWORD)offset;
+	overlapped.OffsetHigh = (DWORD)(offset >> 32);
+
+	DWORD read = 0;
+	bytesRead = 0;
+	if (!ReadFile((HANDLE)file, buffer, size, &read, &overlapped))
+	{
+		DWORD error = GetLastError();
+		return error == ERROR_HANDLE_EOF ? 0 : error;
+	}
+	bytesRead = read;
+	return 0;
+}
+
+void CloseFile(std::intptr_t file) {
+	CloseHandle((HANDLE)file);
+}
+
+void* AlignedAlloc(std::size_t size, std::size_t alignment) {
+	return _aligned_malloc(size, alignment);
+}
+
+void AlignedFree(void* data) {
+	_aligned_free(data);
+}
+
+#else
+
+const std::uint32_t ReadCancelled = ECANCELED;
+
+std::intptr_t OpenForReading(const std::string& path, bool unbuffered) {
+	int fd = -1;
+#ifdef O_DIRECT
+	// Not every file system takes O_DIRECT; those read through the cache.
+	if (unbuffered)
+		fd = open(path.c_str(), O_RDONLY | O_CLOEXEC | O_DIRECT);
+#else
+	(void)unbuffered;
+#endif
+	if (fd < 0)
+		fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+	return fd < 0 ? NoFile : (std::intptr_t)fd;
+}
+
+bool QueryFileSize(std::intptr_t file, std::uint64_t& size) {
+	struct stat status;
+	if (fstat((int)file, &status) != 0)
+		return false;
+	size = (std::uint64_t)status.st_size;
+	return true;
+}
+
+std::uint32_t QuerySectorSize(std::intptr_t) {
+	return DefaultSectorSize;
+}
+
+// pread may return less than asked before the end of the file, so it is
+// repeated until the range is read or the file ends.
+std::uint32_t ReadAt(std::intptr_t file, void* buffer, std::uint32_t size, std::uint64_t offset, std::uint32_t& bytesRead) {
+	bytesRead = 0;
+	while (bytesRead < size)
+	{
+		ssize_t read = pread((int)file, (std::uint8_t*)buffer + bytesRead, size - bytesRead, (off_t)(offset + bytesRead));
+		if (read < 0)
+		{
+			if (errno == EINTR)
+				continue;
+			return (std::uint32_t)errno;
+		}
+		if (read == 0)
+			break;
+		bytesRead += (std::uint32_t)read;
+	}
+	return 0;
+}
+
+void CloseFile(std::intptr_t file) {
+	close((int)file);
+}
+
+void* AlignedAlloc(std::size_t size, std::size_t alignment) {
+	void* data = nullptr;
+	return posix_memalign(&data, std::max(alignment, sizeof(void*)), size) == 0 ? data : nullptr;
+}
+
+void AlignedFree(void* data) {
+	free(data);
+}
+
+#endif
+
+void SetResult(AsyncFileReader::ReadResult& result, std::uint32_t error, std::uint32_t bytesRead) {
+	result.BytesRead = bytesRead;
+	result.Error = 0;
+	if (error == 0)
+	{
+		result.Status = AsyncFileReader::ReadStatus::Done;
+	}
+	else if (error == ReadCancelled)
+	{
+		result.Status = AsyncFileReader::ReadStatus::Cancelled;
+	}
+	else
+	{
+		result.Status = AsyncFileReader::ReadStatus::Failed;
+		result.Error = error;
+	}
+}
+
+}
+
+AlignedBuffer::AlignedBuffer(std::size_t size, std::size_t alignment) :
+	m_data((std::uint8_t*)AlignedAlloc(std::max<std::size_t>(size, 1), alignment)),
+	m_size(size)
+{
+	if (!m_data)
+		throw std::bad_alloc();
+}
+
+void AlignedBuffer::Deleter::operator()(std::uint8_t* data) const {
+	AlignedFree(data);
+}
+
+struct AsyncFileReader::Operation {
+#ifdef _WIN32
+	// First member, so the OVERLAPPED a completion packet points at is the operation.
+	OVERLAPPED Overlapped = {};
+#endif
+	std::intptr_t File = NoFile;
+	ReadRequest Request;
+	ReadResult Result;
+	bool Submitted = false;
+	// Checked by a pool thread before it starts the read.
+	std::atomic<bool> CancelRequested{ false };
+};
+
+AsyncFileReader::AsyncFileReader(Backend backend, ThreadPool* pool) :
+	m_backend(backend),
+	m_pool(pool)
+{
+#ifdef _WIN32
+	if (m_backend == Backend::CompletionPort)
+	{
+		m_port = CreateIoCompletionPort(INVALID_HANDLE_VALUE, nullptr, 0, 0);
+		if (!m_port)
+			m_backend = Backend::ThreadPool;
+	}
+#else
+	m_backend = Backend::ThreadPool;
+#endif
+}
+
+AsyncFileReader::~AsyncFileReader() {
+	for (auto& operation : m_operations)
+		operation.second->Request.OnComplete = nullptr;
+	CancelAll();
+	WaitAll();
+
+	for (FileId file = 0; file < (FileId)m_files.size(); ++file)
+		Close(file);
+#ifdef _WIN32
+	if (m_port)
+		CloseHandle(m_port);
+#endif
+}
+
+#ifdef _WIN32
+
+AsyncFileReader::FileId AsyncFileReader::Open(const std::string& path, bool unbuffered) {
+	HANDLE handle = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+		OpenFlags(unbuffered, m_backend == Backend::CompletionPort), nullptr);
+	return Add(FromHandle(handle), unbuffered);
+}
+
+AsyncFileReader::FileId AsyncFileReader::Open(const std::wstring& path, bool unbuffered) {
+	HANDLE handle = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+		OpenFlags(unbuffered, m_backend == Backend::CompletionPort), nullptr);
+	return Add(FromHandle(handle), unbuffered);
+}
+
+#else
+
+AsyncFileReader::FileId AsyncFileReader::Open(const std::string& path, bool unbuffered) {
+	return Add(OpenForReading(path, unbuffered), unbuffered);
+}
+
+#endif
+
+AsyncFileReader::FileId AsyncFileReader::Add(std::intptr_t handle, bool unbuffered) {
+	if (handle == NoFile)
+		return InvalidFile;
+
+	File file;
+	file.Handle = handle;
+	if (!QueryFileSize(handle, file.Size))
+	{
+		CloseFile(handle);
+		return InvalidFile;
+	}
+	if (unbuffered)
+		file.SectorSize = QuerySectorSize(handle);
+
+#ifdef _WIN32
+	if (m_backend == Backend::CompletionPort)
+	{
+		if (CreateIoCompletionPort((HANDLE)handle, m_port, 0, 0) != m_port)
+		{
+			CloseFile(handle);
+			return InvalidFile;
+		}
+		// Completions are only ever collected from the port.
+		SetFileCompletionNotificationModes((HANDLE)handle, FILE_SKIP_SET_EVENT_ON_HANDLE);
+	}
+#endif
+
+	for (FileId id = 0; id < (FileId)m_files.size(); ++id)
+	{
+		if (m_files[id].Handle == NoFile)
+		{
+			m_files[id] = file;
+			return id;
+		}
+	}
+	m_files.push_back(file);
+	return (FileId)m_files.size() - 1;
+}
+
+void AsyncFileReader::Close(FileId file) {
+	if (m_files[file].Handle != NoFile)
+		CloseFile(m_files[file].Handle);
+	m_files[file] = File();
+}
+
+AsyncFileReader::ReadId AsyncFileReader::Queue(ReadRequest request) {
+	auto operation = std::make_unique<Operation>();
+	operation->File = m_files[request.File].Handle;
+	operation->Request = std::move(request);
+	operation->Result.Id = m_nextRead++;
+
+	ReadId id = operation->Result.Id;
+	m_queued.push_back(operation.get());
+	m_operations[id] = std::move(operation);
+	return id;
+}
+
+void AsyncFileReader::Submit() {
+	std::vector<Operation*> batch;
+	batch.swap(m_queued);
+	m_inFlight += (std::uint32_t)batch.size();
+
+	for (Operation* operation : batch)
+	{
+		operation->Submitted = true;
+#ifdef _WIN32
+		if (m_backend == Backend::CompletionPort)
+		{
+			IssueOnPort(operation);
+			continue;
+		}
+#endif
+		IssueOnPool(operation);
+	}
+}
+
+#ifdef _WIN32
+
+void AsyncFileReader::IssueOnPort(Operation* operation) {
+	operation->Overlapped.Offset = (DWORD)operation->Request.Offset;
+	operation->Overlapped.OffsetHigh = (DWORD)(operation->Request.Offset >> 32);
+
+	// A read that completes at once still posts its packet to the port.
+	if (ReadFile((HANDLE)operation->File, operation->Request.Buffer, operation->Request.Size, nullptr, &operation->Overlapped))
+		return;
+
+	DWORD error = GetLastError();
+	if (error == ERROR_IO_PENDING)
+		return;
+
+	// Refused outright, so no packet will come.
+	SetResult(operation->Result, error == ERROR_HANDLE_EOF ? 0 : error, 0);
+	Finished(operation);
+}
+
+#endif
+
+void AsyncFileReader::IssueOnPool(Operation* operation) {
+	auto read = [this, operation] {
+		std::uint32_t error = ReadCancelled;
+		std::uint32_t bytesRead = 0;
+		if (!operation->CancelRequested)
+			error = ReadAt(operation->File, operation->Request.Buffer, operation->Request.Size, operation->Request.Offset, bytesRead);
+
+		SetResult(operation->Result, error, bytesRead);
+		Finished(operation);
+	};
+
+	if (m_pool)
+		m_pool->Submit(read);
+	else
+		read();
+}
+
+void AsyncFileReader::Finished(Operation* operation) {
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_finished.push_back(operation);
+	m_readFinished.notify_all();
+}
+
+void AsyncFileReader::Cancel(ReadId read) {
+	auto found = m_operations.find(read);
+	if (found == m_operations.end())
+		return;
+	Operation* operation = found->second.get();
+
+	if (!operation->Submitted)
+	{
+		m_queued.erase(std::find(m_queued.begin(), m_queued.end(), operation));
+		operation->Submitted = true;
+		++m_inFlight;
+		SetResult(operation->Result, ReadCancelled, 0);
+		Finished(operation);
+		return;
+	}
+
+	// Fails harmlessly when the read has already completed.
+#ifdef _WIN32
+	if (m_backend == Backend::CompletionPort)
+	{
+		CancelIoEx((HANDLE)operation->File, &operation->Overlapped);
+		return;
+	}
+#endif
+	operation->CancelRequested = true;
+}
+
+void AsyncFileReader::CancelAll() {
+	for (auto& operation : m_operations)
+		Cancel(operation.first);
+}
+
+#ifdef _WIN32
+
+bool AsyncFileReader::DrainPort(std::uint32_t timeout) {
+	OVERLAPPED_ENTRY entries[PortBatchSize];
+	ULONG count = 0;
+	if (!GetQueuedCompletionStatusEx(m_port, entries, PortBatchSize, &count, timeout, FALSE))
+		return false;
+
+	for (ULONG i = 0; i < count; ++i)
+	{
+		auto operation = reinterpret_cast<Operation*>(entries[i].lpOverlapped);
+		DWORD bytesRead = 0;
+		DWORD error = ERROR_SUCCESS;
+		if (!GetOverlappedResult((HANDLE)operation->File, &operation->Overlapped, &bytesRead, FALSE))
+			error = GetLastError();
+
+		SetResult(operation->Result, error == ERROR_HANDLE_EOF ? 0 : error, bytesRead);
+		Finished(operation);
+	}
+	return count > 0;
+}
+
+#endif
+
+std::uint32_t AsyncFileReader::RunCallbacks() {
+	std::uint32_t count = 0;
+	for (;;)
+	{
+		Operation* finished;
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			if (m_finished.empty())
+				break;
+			finished = m_finished.front();
+			m_finished.pop_front();
+		}
+
+		// Released before the callback, which may queue further reads.
+		auto found = m_operations.find(finished->Result.Id);
+		std::unique_ptr<Operation> operation = std::move(found->second);
+		m_operations.erase(found);
+		--m_inFlight;
+		++count;
+
+		if (operation->Request.OnComplete)
+			operation->Request.OnComplete(operation->Result);
+	}
+	return count;
+}
+
+std::uint32_t AsyncFileReader::Poll() {
+#ifdef _WIN32
+	if (m_backend == Backend::CompletionPort)
+	{
+		while (m_inFlight > 0 && DrainPort(0))
+		{
+		}
+	}
+#endif
+	return RunCallbacks();
+}
+
+void AsyncFileReader::WaitAll() {
+	while (m_inFlight > 0)
+	{
+		if (RunCallbacks() > 0)
+			continue;
+
+		// Every read still in flight owes a packet to the port or a push from a
+		// pool thread.
+#ifdef _WIN32
+		if (m_backend == Backend::CompletionPort)
+		{
+			DrainPort(INFINITE);
+			continue;
+		}
+#endif
+		if (!m_pool || !m_pool->RunPendingTask())
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_readFinished.wait(lock, [&] { return !m_finished.empty(); });
+		}
+	}
+}
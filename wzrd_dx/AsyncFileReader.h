@@ -0,0 +1,155 @@
+#pragma once
+
+#include "ThreadPool.h"
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Heap block whose start is aligned for unbuffered reads.
+class AlignedBuffer {
+public:
+	AlignedBuffer() = default;
+	AlignedBuffer(std::size_t size, std::size_t alignment);
+
+	std::uint8_t* Data() const { return m_data.get(); }
+	std::size_t Size() const { return m_size; }
+
+private:
+	struct Deleter {
+		void operator()(std::uint8_t* data) const;
+	};
+
+	std::unique_ptr<std::uint8_t, Deleter> m_data;
+	std::size_t m_size = 0;
+};
+
+// Reads ranges of files into buffers owned by the caller without blocking it.
+// Reads are queued, handed to the OS together by Submit and finish in any order.
+// Their callbacks run on the thread that calls Poll or WaitAll, and a reader
+// belongs to that one thread.
+class AsyncFileReader {
+public:
+	enum class Backend {
+		// Overlapped reads that complete through an I/O completion port, so every
+		// submitted read is in flight at once. Windows only.
+		CompletionPort,
+		// Blocking positioned reads on pool threads: ReadFile on Windows, pread
+		// elsewhere. Used when the port cannot be created.
+		ThreadPool,
+	};
+
+	using FileId = std::uint32_t;
+	using ReadId = std::uint64_t;
+	static const FileId InvalidFile = 0xffffffff;
+
+	enum class ReadStatus {
+		Done,
+		Failed,
+		Cancelled,
+	};
+
+	struct ReadResult {
+		ReadId Id = 0;
+		ReadStatus Status = ReadStatus::Done;
+		// Fewer than requested at the end of the file.
+		std::uint32_t BytesRead = 0;
+		// Win32 error code of a failed read, errno elsewhere.
+		std::uint32_t Error = 0;
+	};
+
+	struct ReadRequest {
+		FileId File = InvalidFile;
+		std::uint64_t Offset = 0;
+		std::uint32_t Size = 0;
+		// Must stay valid until the callback has run.
+		void* Buffer = nullptr;
+		std::function<void(const ReadResult&)> OnComplete;
+	};
+
+	// The ThreadPool backend reads on pool, or on the calling thread inside
+	// Submit when pool is null.
+	explicit AsyncFileReader(Backend backend = Backend::CompletionPort, ThreadPool* pool = &ThreadPool::Default());
+	AsyncFileReader(const AsyncFileReader& rhs) = delete;
+	AsyncFileReader& operator=(const AsyncFileReader& rhs) = delete;
+	// Cancels what is still in flight and waits for it without running callbacks.
+	~AsyncFileReader();
+
+	Backend GetBackend() const { return m_backend; }
+
+	// Returns InvalidFile if the file cannot be opened. Unbuffered files bypass
+	// the system file cache where the file system allows it; their read offsets,
+	// sizes and buffer addresses must be multiples of SectorSize.
+	FileId Open(const std::string& path, bool unbuffered = false);
+#ifdef _WIN32
+	FileId Open(const std::wstring& path, bool unbuffered = false);
+#endif
+	// The file must have no reads in flight.
+	void Close(FileId file);
+	std::uint64_t FileSize(FileId file) const { return m_files[file].Size; }
+	std::uint32_t SectorSize(FileId file) const { return m_files[file].SectorSize; }
+
+	// Queues a read. Nothing reaches the OS until Submit.
+	ReadId Queue(ReadRequest request);
+	// Issues every queued read in one batch.
+	void Submit();
+
+	// A read cancelled before it finishes completes as Cancelled. Reads that have
+	// already finished are not affected.
+	void Cancel(ReadId read);
+	void CancelAll();
+
+	// Runs the callbacks of the reads that have finished and returns how many ran.
+	std::uint32_t Poll();
+	// Waits for every submitted read to finish and runs the callbacks.
+	void WaitAll();
+
+	// Reads submitted whose callbacks have not run yet.
+	std::uint32_t InFlight() const { return m_inFlight; }
+
+private:
+	struct File {
+		// File HANDLE, or file descriptor elsewhere. -1 when the slot is free.
+		std::intptr_t Handle = -1;
+		std::uint64_t Size = 0;
+		std::uint32_t SectorSize = 1;
+	};
+
+	struct Operation;
+
+	// Takes ownership of an open file and fills in its slot.
+	FileId Add(std::intptr_t handle, bool unbuffered);
+	void IssueOnPool(Operation* operation);
+	void Finished(Operation* operation);
+	std::uint32_t RunCallbacks();
+#ifdef _WIN32
+	void IssueOnPort(Operation* operation);
+	// Moves reads that completed on the port to m_finished, waiting up to timeout
+	// ms for the first. Returns false if none did.
+	bool DrainPort(std::uint32_t timeout);
+#endif
+
+	Backend m_backend;
+	ThreadPool* m_pool;
+#ifdef _WIN32
+	// I/O completion port HANDLE.
+	void* m_port = nullptr;
+#endif
+
+	std::vector<File> m_files;
+	ReadId m_nextRead = 1;
+	std::unordered_map<ReadId, std::unique_ptr<Operation>> m_operations;
+	std::vector<Operation*> m_queued;
+	std::uint32_t m_inFlight = 0;
+
+	// Filled by the pool threads or the port drain, emptied by RunCallbacks.
+	std::mutex m_mutex;
+	std::condition_variable m_readFinished;
+	std::deque<Operation*> m_finished;
+};
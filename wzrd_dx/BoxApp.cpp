@@ -1,6 +1,7 @@
 #include "BoxApp.h"
 #include <DirectXColors.h>
 #include "MeshGeometry.h"
+#include "PrimitiveTables.h"
 
 using namespace DirectX;
 using namespace DirectX::PackedVector;
@@ -173,62 +174,26 @@ void BoxApp::BuildShadersAndInputLayout() {
 
 
 void BoxApp::BuildBoxGeometry() {
-	std::array<Vertex, 8> vertices =
-	{
-		Vertex({ XMFLOAT3(-1.0f, -1.0f, -1.0f), XMFLOAT4(Colors::White) }),
-		Vertex({ XMFLOAT3(-1.0f, +1.0f, -1.0f), XMFLOAT4(Colors::Black) }),
-		Vertex({ XMFLOAT3(+1.0f, +1.0f, -1.0f), XMFLOAT4(Colors::Red) }),
-		Vertex({ XMFLOAT3(+1.0f, -1.0f, -1.0f), XMFLOAT4(Colors::Green) }),
-		Vertex({ XMFLOAT3(-1.0f, -1.0f, +1.0f), XMFLOAT4(Colors::Blue) }),
-		Vertex({ XMFLOAT3(-1.0f, +1.0f, +1.0f), XMFLOAT4(Colors::Yellow) }),
-		Vertex({ XMFLOAT3(+1.0f, +1.0f, +1.0f), XMFLOAT4(Colors::Cyan) }),
-		Vertex({ XMFLOAT3(+1.0f, -1.0f, +1.0f), XMFLOAT4(Colors::Magenta) })
-	};
-
-	std::array<std::uint16_t, 36> indices =
-	{
-		// front face
-		0, 1, 2,
-		0, 2, 3,
-
-		// back face
-		4, 6, 5,
-		4, 7, 6,
-
-		// left face
-		4, 5, 1,
-		4, 1, 0,
-
-		// right face
-		3, 2, 6,
-		3, 6, 7,
-
-		// top face
-		1, 5, 6,
-		1, 6, 2,
-
-		// bottom face
-		4, 0, 3,
-		4, 3, 7
-	};
+	// Built by the compiler; uploaded straight from the executable.
+	static constexpr auto box = MakeColorCubeTable<Vertex>();
 
-	const UINT vbByteSize = (UINT)vertices.size() * sizeof(Vertex);
-	const UINT ibByteSize = (UINT)indices.size() * sizeof(std::uint16_t);
+	const UINT vbByteSize = box.VertexBufferByteSize();
+	const UINT ibByteSize = box.IndexBufferByteSize();
 
 	m_boxGeometry = std::make_unique<MeshGeometry>();
 	m_boxGeometry->Name = "myBox";
 
 	ThrowIfFailed(D3DCreateBlob(vbByteSize, &m_boxGeometry->VertexBufferCPU));
-	CopyMemory(m_boxGeometry->VertexBufferCPU->GetBufferPointer(), vertices.data(), vbByteSize);
+	CopyMemory(m_boxGeometry->VertexBufferCPU->GetBufferPointer(), box.Vertices.data(), vbByteSize);
 
 	ThrowIfFailed(D3DCreateBlob(ibByteSize, &m_boxGeometry->IndexBufferCPU));
-	CopyMemory(m_boxGeometry->IndexBufferCPU->GetBufferPointer(), indices.data(), ibByteSize);
+	CopyMemory(m_boxGeometry->IndexBufferCPU->GetBufferPointer(), box.Indices.data(), ibByteSize);
 
 	m_boxGeometry->VertexBufferGPU = CreateDefaultBuffer(m_device.Get(), m_graphicsCommandList.Get(),
-		vertices.data(), vbByteSize, m_boxGeometry->VertexBufferUploader);
+		box.Vertices.data(), vbByteSize, m_boxGeometry->VertexBufferUploader);
 
 	m_boxGeometry->IndexBufferGPU = CreateDefaultBuffer(m_device.Get(), m_graphicsCommandList.Get(),
-		indices.data(), ibByteSize, m_boxGeometry->IndexBufferUploader);
+		box.Indices.data(), ibByteSize, m_boxGeometry->IndexBufferUploader);
 
 	m_boxGeometry->VertexByteStride = sizeof(Vertex);
 	m_boxGeometry->VertexBufferByteSize = vbByteSize;
@@ -236,7 +201,7 @@ void BoxApp::BuildBoxGeometry() {
 	m_boxGeometry->IndexBufferByteSize = ibByteSize;
 
 	SubmeshGeometry submesh;
-	submesh.IndexCount = (UINT)indices.size();
+	submesh.IndexCount = (UINT)box.Indices.size();
 	submesh.StartIndexLocation = 0;
 	submesh.BaseVertexLocation = 0;
 
@@ -1,4 +1,5 @@
 #include "Camera.h"
+#include "MeshLod.h"
 
 using namespace DirectX;
 
@@ -72,6 +73,10 @@ float Camera::GetFovX()const {
 	return 2.0f * atan(halfWidth / m_nearZ);
 }
 
+float Camera::GetLodErrorScale(float viewportHeight)const {
+	return LodErrorScale(1.0f / tanf(0.5f * m_fovY), viewportHeight);
+}
+
 float Camera::GetNearWindowWidth() const {
 	return m_aspect * m_nearWindowHeight;
 }
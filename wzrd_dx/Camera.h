@@ -36,6 +36,9 @@ public:
 	float GetFarWindowsWidth()const;
 	float GetFarWindowHeight()const;
 
+	// Pixels covered by one world unit at distance 1, for LOD selection
+	float GetLodErrorScale(float viewportHeight)const;
+
 	// Set frustum
 	void SetLens(float fovY, float aspect, float zn, float zf);
 
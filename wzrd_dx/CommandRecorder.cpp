@@ -0,0 +1,226 @@
+#include "CommandRecorder.h"
+#include <cassert>
+
+CommandRecorder::CommandRecorder(CommandBackend* backend) :
+	m_backend(backend)
+{
+}
+
+void CommandRecorder::SetBackend(CommandBackend* backend) {
+	m_backend = backend;
+	Invalidate();
+}
+
+void CommandRecorder::Invalidate(const void* initialPipelineState) {
+	m_rootSignature = nullptr;
+	m_pipelineState = initialPipelineState;
+	InvalidateRootParameters();
+	m_vertexBufferValid = false;
+	m_indexBufferValid = false;
+	m_topologyValid = false;
+}
+
+void CommandRecorder::InvalidateRootParameters() {
+	for (auto& p : m_rootParameters)
+		p = RootParameter();
+}
+
+void CommandRecorder::SetGraphicsRootSignature(const void* rootSignature) {
+	if (rootSignature == m_rootSignature)
+	{
+		m_stats.StateChangesAvoided++;
+		return;
+	}
+
+	// Changing the root signature clears every root argument on the command list.
+	m_backend->SetGraphicsRootSignature(rootSignature);
+	m_rootSignature = rootSignature;
+	InvalidateRootParameters();
+	m_stats.StateChangesIssued++;
+}
+
+void CommandRecorder::SetPipelineState(const void* pipelineState) {
+	if (pipelineState == m_pipelineState)
+	{
+		m_stats.StateChangesAvoided++;
+		return;
+	}
+
+	m_backend->SetPipelineState(pipelineState);
+	m_pipelineState = pipelineState;
+	m_stats.StateChangesIssued++;
+}
+
+bool CommandRecorder::SetRootParameter(std::uint32_t rootParameterIndex, RootBinding type, std::uint64_t value) {
+	assert(rootParameterIndex < MaxRootParameters);
+
+	RootParameter& p = m_rootParameters[rootParameterIndex];
+	if (p.Type == type && p.Value == value)
+	{
+		m_stats.StateChangesAvoided++;
+		return false;
+	}
+
+	p.Type = type;
+	p.Value = value;
+	m_stats.StateChangesIssued++;
+	return true;
+}
+
+void CommandRecorder::SetGraphicsRootDescriptorTable(std::uint32_t rootParameterIndex, std::uint64_t baseDescriptor) {
+	if (SetRootParameter(rootParameterIndex, RootBinding::DescriptorTable, baseDescriptor))
+		m_backend->SetGraphicsRootDescriptorTable(rootParameterIndex, baseDescriptor);
+}
+
+void CommandRecorder::SetGraphicsRootConstantBufferView(std::uint32_t rootParameterIndex, std::uint64_t bufferLocation) {
+	if (SetRootParameter(rootParameterIndex, RootBinding::ConstantBufferView, bufferLocation))
+		m_backend->SetGraphicsRootConstantBufferView(rootParameterIndex, bufferLocation);
+}
+
+void CommandRecorder::SetGraphicsRootShaderResourceView(std::uint32_t rootParameterIndex, std::uint64_t bufferLocation) {
+	if (SetRootParameter(rootParameterIndex, RootBinding::ShaderResourceView, bufferLocation))
+		m_backend->SetGraphicsRootShaderResourceView(rootParameterIndex, bufferLocation);
+}
+
+void CommandRecorder::SetGraphicsRoot32BitConstant(std::uint32_t rootParameterIndex, std::uint32_t srcData, std::uint32_t destOffsetIn32BitValues) {
+	std::uint64_t value = ((std::uint64_t)destOffsetIn32BitValues << 32) | srcData;
+	if (SetRootParameter(rootParameterIndex, RootBinding::Constant, value))
+		m_backend->SetGraphicsRoot32BitConstant(rootParameterIndex, srcData, destOffsetIn32BitValues);
+}
+
+void CommandRecorder::IASetVertexBuffer(const VertexBufferBinding& view) {
+	if (m_vertexBufferValid && view == m_vertexBuffer)
+	{
+		m_stats.StateChangesAvoided++;
+		return;
+	}
+
+	m_backend->IASetVertexBuffer(view);
+	m_vertexBuffer = view;
+	m_vertexBufferValid = true;
+	m_stats.StateChangesIssued++;
+}
+
+void CommandRecorder::IASetIndexBuffer(const IndexBufferBinding& view) {
+	if (m_indexBufferValid && view == m_indexBuffer)
+	{
+		m_stats.StateChangesAvoided++;
+		return;
+	}
+
+	m_backend->IASetIndexBuffer(view);
+	m_indexBuffer = view;
+	m_indexBufferValid = true;
+	m_stats.StateChangesIssued++;
+}
+
+void CommandRecorder::IASetPrimitiveTopology(std::uint32_t topology) {
+	if (m_topologyValid && topology == m_topology)
+	{
+		m_stats.StateChangesAvoided++;
+		return;
+	}
+
+	m_backend->IASetPrimitiveTopology(topology);
+	m_topology = topology;
+	m_topologyValid = true;
+	m_stats.StateChangesIssued++;
+}
+
+void CommandRecorder::DrawIndexedInstanced(std::uint32_t indexCountPerInstance, std::uint32_t instanceCount,
+	std::uint32_t startIndexLocation, std::int32_t baseVertexLocation, std::uint32_t startInstanceLocation)
+{
+	m_backend->DrawIndexedInstanced(indexCountPerInstance, instanceCount, startIndexLocation, baseVertexLocation, startInstanceLocation);
+	m_stats.DrawCalls++;
+}
+
+void RecordingCommandBackend::SetGraphicsRootSignature(const void* rootSignature) {
+	Command c;
+	c.Type = CommandType::SetGraphicsRootSignature;
+	c.Value = (std::uint64_t)(std::uintptr_t)rootSignature;
+	m_commands.push_back(c);
+}
+
+void RecordingCommandBackend::SetPipelineState(const void* pipelineState) {
+	Command c;
+	c.Type = CommandType::SetPipelineState;
+	c.Value = (std::uint64_t)(std::uintptr_t)pipelineState;
+	m_commands.push_back(c);
+}
+
+void RecordingCommandBackend::SetGraphicsRootDescriptorTable(std::uint32_t rootParameterIndex, std::uint64_t baseDescriptor) {
+	Command c;
+	c.Type = CommandType::SetGraphicsRootDescriptorTable;
+	c.RootParameterIndex = rootParameterIndex;
+	c.Value = baseDescriptor;
+	m_commands.push_back(c);
+}
+
+void RecordingCommandBackend::SetGraphicsRootConstantBufferView(std::uint32_t rootParameterIndex, std::uint64_t bufferLocation) {
+	Command c;
+	c.Type = CommandType::SetGraphicsRootConstantBufferView;
+	c.RootParameterIndex = rootParameterIndex;
+	c.Value = bufferLocation;
+	m_commands.push_back(c);
+}
+
+void RecordingCommandBackend::SetGraphicsRootShaderResourceView(std::uint32_t rootParameterIndex, std::uint64_t bufferLocation) {
+	Command c;
+	c.Type = CommandType::SetGraphicsRootShaderResourceView;
+	c.RootParameterIndex = rootParameterIndex;
+	c.Value = bufferLocation;
+	m_commands.push_back(c);
+}
+
+void RecordingCommandBackend::SetGraphicsRoot32BitConstant(std::uint32_t rootParameterIndex, std::uint32_t srcData, std::uint32_t destOffsetIn32BitValues) {
+	Command c;
+	c.Type = CommandType::SetGraphicsRoot32BitConstant;
+	c.RootParameterIndex = rootParameterIndex;
+	c.Value = srcData;
+	c.DestOffset = destOffsetIn32BitValues;
+	m_commands.push_back(c);
+}
+
+void RecordingCommandBackend::IASetVertexBuffer(const VertexBufferBinding& view) {
+	Command c;
+	c.Type = CommandType::IASetVertexBuffer;
+	c.VertexBuffer = view;
+	m_commands.push_back(c);
+}
+
+void RecordingCommandBackend::IASetIndexBuffer(const IndexBufferBinding& view) {
+	Command c;
+	c.Type = CommandType::IASetIndexBuffer;
+	c.IndexBuffer = view;
+	m_commands.push_back(c);
+}
+
+void RecordingCommandBackend::IASetPrimitiveTopology(std::uint32_t topology) {
+	Command c;
+	c.Type = CommandType::IASetPrimitiveTopology;
+	c.Value = topology;
+	m_commands.push_back(c);
+}
+
+void RecordingCommandBackend::DrawIndexedInstanced(std::uint32_t indexCountPerInstance, std::uint32_t instanceCount,
+	std::uint32_t startIndexLocation, std::int32_t baseVertexLocation, std::uint32_t startInstanceLocation)
+{
+	Command c;
+	c.Type = CommandType::DrawIndexedInstanced;
+	c.IndexCount = indexCountPerInstance;
+	c.InstanceCount = instanceCount;
+	c.StartIndexLocation = startIndexLocation;
+	c.BaseVertexLocation = baseVertexLocation;
+	c.StartInstanceLocation = startInstanceLocation;
+	m_commands.push_back(c);
+}
+
+std::uint32_t RecordingCommandBackend::CountOf(CommandType type) const {
+	std::uint32_t count = 0;
+	for (const Command& c : m_commands)
+	{
+		if (c.Type == type)
+			count++;
+	}
+	return count;
+}
@@ -0,0 +1,169 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+// GPU addresses and descriptor handles are carried as plain integers and API
+// objects as opaque pointers, so this layer builds without the D3D12 headers.
+struct VertexBufferBinding {
+	std::uint64_t BufferLocation = 0;
+	std::uint32_t SizeInBytes = 0;
+	std::uint32_t StrideInBytes = 0;
+
+	bool operator==(const VertexBufferBinding& rhs) const {
+		return BufferLocation == rhs.BufferLocation && SizeInBytes == rhs.SizeInBytes && StrideInBytes == rhs.StrideInBytes;
+	}
+	bool operator!=(const VertexBufferBinding& rhs) const { return !(*this == rhs); }
+};
+
+struct IndexBufferBinding {
+	std::uint64_t BufferLocation = 0;
+	std::uint32_t SizeInBytes = 0;
+	std::uint32_t Format = 0;
+
+	bool operator==(const IndexBufferBinding& rhs) const {
+		return BufferLocation == rhs.BufferLocation && SizeInBytes == rhs.SizeInBytes && Format == rhs.Format;
+	}
+	bool operator!=(const IndexBufferBinding& rhs) const { return !(*this == rhs); }
+};
+
+// The calls the renderer records while drawing. One implementation forwards to a
+// real command list, the recording one stores the calls so they can be inspected
+// without a GPU.
+class CommandBackend {
+public:
+	virtual ~CommandBackend() = default;
+
+	virtual void SetGraphicsRootSignature(const void* rootSignature) = 0;
+	virtual void SetPipelineState(const void* pipelineState) = 0;
+	virtual void SetGraphicsRootDescriptorTable(std::uint32_t rootParameterIndex, std::uint64_t baseDescriptor) = 0;
+	virtual void SetGraphicsRootConstantBufferView(std::uint32_t rootParameterIndex, std::uint64_t bufferLocation) = 0;
+	virtual void SetGraphicsRootShaderResourceView(std::uint32_t rootParameterIndex, std::uint64_t bufferLocation) = 0;
+	virtual void SetGraphicsRoot32BitConstant(std::uint32_t rootParameterIndex, std::uint32_t srcData, std::uint32_t destOffsetIn32BitValues) = 0;
+	virtual void IASetVertexBuffer(const VertexBufferBinding& view) = 0;
+	virtual void IASetIndexBuffer(const IndexBufferBinding& view) = 0;
+	virtual void IASetPrimitiveTopology(std::uint32_t topology) = 0;
+	virtual void DrawIndexedInstanced(std::uint32_t indexCountPerInstance, std::uint32_t instanceCount,
+		std::uint32_t startIndexLocation, std::int32_t baseVertexLocation, std::uint32_t startInstanceLocation) = 0;
+};
+
+// Counts how many state changes were actually issued during submission and how
+// many were dropped because the same value was already bound.
+struct DrawStats {
+	std::uint32_t DrawCalls = 0;
+	std::uint32_t StateChangesIssued = 0;
+	std::uint32_t StateChangesAvoided = 0;
+
+	void Reset() { DrawCalls = 0; StateChangesIssued = 0; StateChangesAvoided = 0; }
+};
+
+// Thin wrapper that remembers what is bound on the command list and drops the
+// calls that would set the same value again.
+class CommandRecorder {
+public:
+	static const std::uint32_t MaxRootParameters = 16;
+
+	explicit CommandRecorder(CommandBackend* backend = nullptr);
+
+	void SetBackend(CommandBackend* backend);
+	CommandBackend* GetBackend() const { return m_backend; }
+
+	// Forget all cached state. Call this whenever the command list is reset.
+	// The PSO passed to ID3D12GraphicsCommandList::Reset is already bound.
+	void Invalidate(const void* initialPipelineState = nullptr);
+
+	void SetGraphicsRootSignature(const void* rootSignature);
+	void SetPipelineState(const void* pipelineState);
+	void SetGraphicsRootDescriptorTable(std::uint32_t rootParameterIndex, std::uint64_t baseDescriptor);
+	void SetGraphicsRootConstantBufferView(std::uint32_t rootParameterIndex, std::uint64_t bufferLocation);
+	void SetGraphicsRootShaderResourceView(std::uint32_t rootParameterIndex, std::uint64_t bufferLocation);
+	// Only the last constant written to a root parameter is remembered, so keep
+	// one constant per parameter to get the filtering.
+	void SetGraphicsRoot32BitConstant(std::uint32_t rootParameterIndex, std::uint32_t srcData, std::uint32_t destOffsetIn32BitValues = 0);
+	void IASetVertexBuffer(const VertexBufferBinding& view);
+	void IASetIndexBuffer(const IndexBufferBinding& view);
+	void IASetPrimitiveTopology(std::uint32_t topology);
+	void DrawIndexedInstanced(std::uint32_t indexCountPerInstance, std::uint32_t instanceCount,
+		std::uint32_t startIndexLocation, std::int32_t baseVertexLocation, std::uint32_t startInstanceLocation);
+
+	const DrawStats& Stats() const { return m_stats; }
+	void ResetStats() { m_stats.Reset(); }
+
+private:
+	enum class RootBinding : std::uint8_t { None, DescriptorTable, ConstantBufferView, ShaderResourceView, Constant };
+
+	struct RootParameter {
+		RootBinding Type = RootBinding::None;
+		std::uint64_t Value = 0;
+	};
+
+	void InvalidateRootParameters();
+	bool SetRootParameter(std::uint32_t rootParameterIndex, RootBinding type, std::uint64_t value);
+
+	CommandBackend* m_backend = nullptr;
+
+	const void* m_rootSignature = nullptr;
+	const void* m_pipelineState = nullptr;
+	RootParameter m_rootParameters[MaxRootParameters];
+
+	bool m_vertexBufferValid = false;
+	VertexBufferBinding m_vertexBuffer;
+	bool m_indexBufferValid = false;
+	IndexBufferBinding m_indexBuffer;
+	bool m_topologyValid = false;
+	std::uint32_t m_topology = 0;
+
+	DrawStats m_stats;
+};
+
+// Backend that stores every call it receives. Used to check what the recorder
+// lets through without a device.
+class RecordingCommandBackend : public CommandBackend {
+public:
+	enum class CommandType : std::uint8_t {
+		SetGraphicsRootSignature,
+		SetPipelineState,
+		SetGraphicsRootDescriptorTable,
+		SetGraphicsRootConstantBufferView,
+		SetGraphicsRootShaderResourceView,
+		SetGraphicsRoot32BitConstant,
+		IASetVertexBuffer,
+		IASetIndexBuffer,
+		IASetPrimitiveTopology,
+		DrawIndexedInstanced,
+		Count
+	};
+
+	struct Command {
+		CommandType Type = CommandType::Count;
+		std::uint32_t RootParameterIndex = 0;
+		std::uint64_t Value = 0;
+		std::uint32_t DestOffset = 0;
+		VertexBufferBinding VertexBuffer;
+		IndexBufferBinding IndexBuffer;
+		std::uint32_t IndexCount = 0;
+		std::uint32_t InstanceCount = 0;
+		std::uint32_t StartIndexLocation = 0;
+		std::int32_t BaseVertexLocation = 0;
+		std::uint32_t StartInstanceLocation = 0;
+	};
+
+	void SetGraphicsRootSignature(const void* rootSignature) override;
+	void SetPipelineState(const void* pipelineState) override;
+	void SetGraphicsRootDescriptorTable(std::uint32_t rootParameterIndex, std::uint64_t baseDescriptor) override;
+	void SetGraphicsRootConstantBufferView(std::uint32_t rootParameterIndex, std::uint64_t bufferLocation) override;
+	void SetGraphicsRootShaderResourceView(std::uint32_t rootParameterIndex, std::uint64_t bufferLocation) override;
+	void SetGraphicsRoot32BitConstant(std::uint32_t rootParameterIndex, std::uint32_t srcData, std::uint32_t destOffsetIn32BitValues) override;
+	void IASetVertexBuffer(const VertexBufferBinding& view) override;
+	void IASetIndexBuffer(const IndexBufferBinding& view) override;
+	void IASetPrimitiveTopology(std::uint32_t topology) override;
+	void DrawIndexedInstanced(std::uint32_t indexCountPerInstance, std::uint32_t instanceCount,
+		std::uint32_t startIndexLocation, std::int32_t baseVertexLocation, std::uint32_t startInstanceLocation) override;
+
+	const std::vector<Command>& Commands() const { return m_commands; }
+	std::uint32_t CountOf(CommandType type) const;
+	void Clear() { m_commands.clear(); }
+
+private:
+	std::vector<Command> m_commands;
+};
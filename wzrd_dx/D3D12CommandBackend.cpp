@@ -0,0 +1,53 @@
+#include "D3D12CommandBackend.h"
+
+void D3D12CommandBackend::SetGraphicsRootSignature(const void* rootSignature) {
+	m_cmdList->SetGraphicsRootSignature((ID3D12RootSignature*)rootSignature);
+}
+
+void D3D12CommandBackend::SetPipelineState(const void* pipelineState) {
+	m_cmdList->SetPipelineState((ID3D12PipelineState*)pipelineState);
+}
+
+void D3D12CommandBackend::SetGraphicsRootDescriptorTable(std::uint32_t rootParameterIndex, std::uint64_t baseDescriptor) {
+	D3D12_GPU_DESCRIPTOR_HANDLE handle;
+	handle.ptr = baseDescriptor;
+	m_cmdList->SetGraphicsRootDescriptorTable(rootParameterIndex, handle);
+}
+
+void D3D12CommandBackend::SetGraphicsRootConstantBufferView(std::uint32_t rootParameterIndex, std::uint64_t bufferLocation) {
+	m_cmdList->SetGraphicsRootConstantBufferView(rootParameterIndex, bufferLocation);
+}
+
+void D3D12CommandBackend::SetGraphicsRootShaderResourceView(std::uint32_t rootParameterIndex, std::uint64_t bufferLocation) {
+	m_cmdList->SetGraphicsRootShaderResourceView(rootParameterIndex, bufferLocation);
+}
+
+void D3D12CommandBackend::SetGraphicsRoot32BitConstant(std::uint32_t rootParameterIndex, std::uint32_t srcData, std::uint32_t destOffsetIn32BitValues) {
+	m_cmdList->SetGraphicsRoot32BitConstant(rootParameterIndex, srcData, destOffsetIn32BitValues);
+}
+
+void D3D12CommandBackend::IASetVertexBuffer(const VertexBufferBinding& view) {
+	D3D12_VERTEX_BUFFER_VIEW vbv;
+	vbv.BufferLocation = view.BufferLocation;
+	vbv.SizeInBytes = view.SizeInBytes;
+	vbv.StrideInBytes = view.StrideInBytes;
+	m_cmdList->IASetVertexBuffers(0, 1, &vbv);
+}
+
+void D3D12CommandBackend::IASetIndexBuffer(const IndexBufferBinding& view) {
+	D3D12_INDEX_BUFFER_VIEW ibv;
+	ibv.BufferLocation = view.BufferLocation;
+	ibv.SizeInBytes = view.SizeInBytes;
+	ibv.Format = (DXGI_FORMAT)view.Format;
+	m_cmdList->IASetIndexBuffer(&ibv);
+}
+
+void D3D12CommandBackend::IASetPrimitiveTopology(std::uint32_t topology) {
+	m_cmdList->IASetPrimitiveTopology((D3D12_PRIMITIVE_TOPOLOGY)topology);
+}
+
+void D3D12CommandBackend::DrawIndexedInstanced(std::uint32_t indexCountPerInstance, std::uint32_t instanceCount,
+	std::uint32_t startIndexLocation, std::int32_t baseVertexLocation, std::uint32_t startInstanceLocation)
+{
+	m_cmdList->DrawIndexedInstanced(indexCountPerInstance, instanceCount, startIndexLocation, baseVertexLocation, startInstanceLocation);
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include "Utilities.h"
+#include "CommandRecorder.h"
+
+// Forwards the recorder's calls to a D3D12 graphics command list.
+class D3D12CommandBackend : public CommandBackend {
+public:
+	explicit D3D12CommandBackend(ID3D12GraphicsCommandList* cmdList = nullptr) : m_cmdList(cmdList) {}
+
+	void SetCommandList(ID3D12GraphicsCommandList* cmdList) { m_cmdList = cmdList; }
+	ID3D12GraphicsCommandList* GetCommandList() const { return m_cmdList; }
+
+	void SetGraphicsRootSignature(const void* rootSignature) override;
+	void SetPipelineState(const void* pipelineState) override;
+	void SetGraphicsRootDescriptorTable(std::uint32_t rootParameterIndex, std::uint64_t baseDescriptor) override;
+	void SetGraphicsRootConstantBufferView(std::uint32_t rootParameterIndex, std::uint64_t bufferLocation) override;
+	void SetGraphicsRootShaderResourceView(std::uint32_t rootParameterIndex, std::uint64_t bufferLocation) override;
+	void SetGraphicsRoot32BitConstant(std::uint32_t rootParameterIndex, std::uint32_t srcData, std::uint32_t destOffsetIn32BitValues) override;
+	void IASetVertexBuffer(const VertexBufferBinding& view) override;
+	void IASetIndexBuffer(const IndexBufferBinding& view) override;
+	void IASetPrimitiveTopology(std::uint32_t topology) override;
+	void DrawIndexedInstanced(std::uint32_t indexCountPerInstance, std::uint32_t instanceCount,
+		std::uint32_t startIndexLocation, std::int32_t baseVertexLocation, std::uint32_t startInstanceLocation) override;
+
+private:
+	ID3D12GraphicsCommandList* m_cmdList = nullptr;
+};
+
+inline VertexBufferBinding ToVertexBufferBinding(const D3D12_VERTEX_BUFFER_VIEW& view) {
+	VertexBufferBinding binding;
+	binding.BufferLocation = view.BufferLocation;
+	binding.SizeInBytes = view.SizeInBytes;
+	binding.StrideInBytes = view.StrideInBytes;
+	return binding;
+}
+
+inline IndexBufferBinding ToIndexBufferBinding(const D3D12_INDEX_BUFFER_VIEW& view) {
+	IndexBufferBinding binding;
+	binding.BufferLocation = view.BufferLocation;
+	binding.SizeInBytes = view.SizeInBytes;
+	binding.Format = (std::uint32_t)view.Format;
+	return binding;
+}
@@ -0,0 +1,751 @@
+#include "DDSParser.h"
+#include <algorithm>
+#include <cstring>
+
+//--------------------------------------------------------------------------------------
+// Macros
+//--------------------------------------------------------------------------------------
+#ifndef MAKEFOURCC
+#define MAKEFOURCC(ch0, ch1, ch2, ch3)                              \
+                ((uint32_t)(uint8_t)(ch0) | ((uint32_t)(uint8_t)(ch1) << 8) |       \
+                ((uint32_t)(uint8_t)(ch2) << 16) | ((uint32_t)(uint8_t)(ch3) << 24 ))
+#endif /* defined(MAKEFOURCC) */
+
+namespace {
+
+// Direct3D 12's D3D12_REQ_* limits. Larger sizes in a file are not trusted.
+const std::uint32_t MaxMipLevels = 15;
+const std::uint32_t MaxTexture1DSize = 16384;
+const std::uint32_t MaxTexture2DSize = 16384;
+const std::uint32_t MaxTextureCubeSize = 16384;
+const std::uint32_t MaxTexture3DSize = 2048;
+const std::uint32_t MaxArraySize = 2048;
+
+bool Fail(DDSError* error, DDSError reason) {
+	if (error)
+		*error = reason;
+	return false;
+}
+
+// Reads the format and shape from the DX10 extension header.
+bool ParseDXT10(const DDS_HEADER_DXT10& ext, DDSTexture& texture, DDSError* error) {
+	if (ext.arraySize == 0)
+		return Fail(error, DDSError::InvalidData);
+	if (ext.arraySize > MaxArraySize)
+		return Fail(error, DDSError::NotSupported);
+
+	switch (ext.dxgiFormat)
+	{
+	case DXGI_FORMAT_AI44:
+	case DXGI_FORMAT_IA44:
+	case DXGI_FORMAT_P8:
+	case DXGI_FORMAT_A8P8:
+		return Fail(error, DDSError::NotSupported);
+
+	default:
+		if (DDSBitsPerPixel(ext.dxgiFormat) == 0)
+			return Fail(error, DDSError::NotSupported);
+	}
+
+	texture.Format = ext.dxgiFormat;
+	texture.ArraySize = ext.arraySize;
+
+	switch (ext.resourceDimension)
+	{
+	case DDS_DIMENSION_TEXTURE1D:
+		if ((texture.Header->flags & DDS_HEIGHT) && texture.Height != 1)
+			return Fail(error, DDSError::InvalidData);
+		texture.Dimension = DDSDimension::Texture1D;
+		texture.Height = texture.Depth = 1;
+		break;
+
+	case DDS_DIMENSION_TEXTURE2D:
+		if (ext.miscFlag & DDS_RESOURCE_MISC_TEXTURECUBE)
+		{
+			texture.ArraySize *= 6;
+			texture.IsCubeMap = true;
+		}
+		texture.Dimension = DDSDimension::Texture2D;
+		texture.Depth = 1;
+		break;
+
+	case DDS_DIMENSION_TEXTURE3D:
+		if (!(texture.Header->flags & DDS_HEADER_FLAGS_VOLUME))
+			return Fail(error, DDSError::InvalidData);
+		if (texture.ArraySize > 1)
+			return Fail(error, DDSError::NotSupported);
+		texture.Dimension = DDSDimension::Texture3D;
+		break;
+
+	default:
+		return Fail(error, DDSError::NotSupported);
+	}
+	return true;
+}
+
+// Reads the format and shape from a legacy header.
+bool ParseLegacy(DDSTexture& texture, DDSError* error) {
+	const DDS_HEADER& header = *texture.Header;
+	texture.Format = GetDDSFormat(header.ddspf);
+	if (texture.Format == DXGI_FORMAT_UNKNOWN)
+		return Fail(error, DDSError::NotSupported);
+
+	texture.ArraySize = 1;
+	if (header.flags & DDS_HEADER_FLAGS_VOLUME)
+	{
+		texture.Dimension = DDSDimension::Texture3D;
+		return true;
+	}
+
+	if (header.caps2 & DDS_CUBEMAP)
+	{
+		if ((header.caps2 & DDS_CUBEMAP_ALLFACES) != DDS_CUBEMAP_ALLFACES)
+			return Fail(error, DDSError::NotSupported);
+		texture.ArraySize = 6;
+		texture.IsCubeMap = true;
+	}
+	texture.Dimension = DDSDimension::Texture2D;
+	texture.Depth = 1;
+	return true;
+}
+
+bool WithinLimits(const DDSTexture& texture) {
+	if (texture.MipCount > MaxMipLevels || texture.ArraySize > MaxArraySize)
+		return false;
+
+	switch (texture.Dimension)
+	{
+	case DDSDimension::Texture1D:
+		return texture.Width <= MaxTexture1DSize;
+	case DDSDimension::Texture2D:
+		if (texture.IsCubeMap)
+			return texture.Width <= MaxTextureCubeSize && texture.Height <= MaxTextureCubeSize;
+		return texture.Width <= MaxTexture2DSize && texture.Height <= MaxTexture2DSize;
+	case DDSDimension::Texture3D:
+		return texture.ArraySize == 1 && texture.Width <= MaxTexture3DSize && texture.Height <= MaxTexture3DSize &&
+			texture.Depth <= MaxTexture3DSize;
+	}
+	return false;
+}
+
+}
+
+bool ParseDDS(const std::uint8_t* data, std::size_t size, DDSTexture& texture, DDSError* error) {
+	texture = DDSTexture();
+	if (error)
+		*error = DDSError::None;
+
+	std::size_t offset = sizeof(std::uint32_t) + sizeof(DDS_HEADER);
+	if (!data || size < offset)
+		return Fail(error, DDSError::NotDDS);
+
+	std::uint32_t magic;
+	std::memcpy(&magic, data, sizeof(magic));
+	if (magic != DDS_MAGIC)
+		return Fail(error, DDSError::NotDDS);
+
+	auto header = reinterpret_cast<const DDS_HEADER*>(data + sizeof(std::uint32_t));
+	if (header->size != sizeof(DDS_HEADER) || header->ddspf.size != sizeof(DDS_PIXELFORMAT))
+		return Fail(error, DDSError::NotDDS);
+
+	texture.Header = header;
+	texture.Width = header->width;
+	texture.Height = header->height;
+	texture.Depth = header->depth;
+	texture.MipCount = std::max<std::uint32_t>(header->mipMapCount, 1);
+
+	if ((header->ddspf.flags & DDS_FOURCC) && MAKEFOURCC('D', 'X', '1', '0') == header->ddspf.fourCC)
+	{
+		if (size < offset + sizeof(DDS_HEADER_DXT10))
+			return Fail(error, DDSError::NotDDS);
+		auto ext = reinterpret_cast<const DDS_HEADER_DXT10*>(data + offset);
+		offset += sizeof(DDS_HEADER_DXT10);
+
+		if (!ParseDXT10(*ext, texture, error))
+			return false;
+	}
+	else if (!ParseLegacy(texture, error))
+	{
+		return false;
+	}
+
+	if (!WithinLimits(texture))
+		return Fail(error, DDSError::NotSupported);
+
+	// Subresources follow the headers back to back, every mip of one item before
+	// the next item. Volume mips hold all their slices.
+	const std::uint8_t* bits = data + offset;
+	const std::uint8_t* end = data + size;
+	texture.Subresources.reserve((std::size_t)texture.ArraySize * texture.MipCount);
+	for (std::uint32_t item = 0; item < texture.ArraySize; ++item)
+	{
+		std::uint32_t width = texture.Width;
+		std::uint32_t height = texture.Height;
+		std::uint32_t depth = texture.Depth;
+		for (std::uint32_t mip = 0; mip < texture.MipCount; ++mip)
+		{
+			DDSSubresource subresource;
+			subresource.Data = bits;
+			subresource.Width = width;
+			subresource.Height = height;
+			subresource.Depth = depth;
+			GetDDSSurfaceInfo(width, height, texture.Format, &subresource.SlicePitch, &subresource.RowPitch, nullptr);
+
+			const std::size_t byteSize = subresource.SlicePitch * depth;
+			if ((std::size_t)(end - bits) < byteSize)
+				return Fail(error, DDSError::Truncated);
+			bits += byteSize;
+			texture.Subresources.push_back(subresource);
+
+			width = std::max<std::uint32_t>(width >> 1, 1);
+			height = std::max<std::uint32_t>(height >> 1, 1);
+			depth = std::max<std::uint32_t>(depth >> 1, 1);
+		}
+	}
+	return true;
+}
+
+std::uint32_t FirstDDSMipWithin(const DDSTexture& texture, std::size_t maxSize) {
+	if (texture.MipCount <= 1 || maxSize == 0)
+		return 0;
+
+	for (std::uint32_t mip = 0; mip < texture.MipCount; ++mip)
+	{
+		const DDSSubresource& subresource = texture.Subresources[mip];
+		if (subresource.Width <= maxSize && subresource.Height <= maxSize && subresource.Depth <= maxSize)
+			return mip;
+	}
+	return texture.MipCount;
+}
+
+std::uint64_t DDSBytesFrom(const DDSTexture& texture, std::uint32_t mip) {
+	std::uint64_t bytes = 0;
+	for (std::uint32_t item = 0; item < texture.ArraySize; ++item)
+	{
+		for (std::uint32_t level = mip; level < texture.MipCount; ++level)
+		{
+			const DDSSubresource& subresource = texture.Subresource(item, level);
+			bytes += (std::uint64_t)subresource.SlicePitch * subresource.Depth;
+		}
+	}
+	return bytes;
+}
+
+std::uint32_t DDSTailMip(const DDSTexture& texture, std::size_t tailMaxSize) {
+	std::uint32_t mip = FirstDDSMipWithin(texture, tailMaxSize);
+	return mip < texture.MipCount ? mip : 0;
+}
+
+std::uint64_t DDSStreamingBudget(const std::vector<const DDSTexture*>& textures, std::size_t tailMaxSize) {
+	std::uint64_t tails = 0;
+	std::uint64_t largest = 0;
+	for (const DDSTexture* texture : textures)
+	{
+		const std::uint32_t tailMip = DDSTailMip(*texture, tailMaxSize);
+		tails += DDSBytesFrom(*texture, tailMip);
+		if (tailMip == 0)
+			continue;
+
+		// Mip 1 is a streamed level only when it is finer than the tail.
+		std::uint64_t streamed = DDSBytesFrom(*texture, 0);
+		if (tailMip > 1)
+			streamed += DDSBytesFrom(*texture, 1);
+		largest = std::max<std::uint64_t>(largest, streamed);
+	}
+	return tails + largest;
+}
+
+//--------------------------------------------------------------------------------------
+// Return the BPP for a particular format
+//--------------------------------------------------------------------------------------
+std::size_t DDSBitsPerPixel(DXGI_FORMAT fmt)
+{
+	switch (fmt)
+	{
+	case DXGI_FORMAT_R32G32B32A32_TYPELESS:
+	case DXGI_FORMAT_R32G32B32A32_FLOAT:
+	case DXGI_FORMAT_R32G32B32A32_UINT:
+	case DXGI_FORMAT_R32G32B32A32_SINT:
+		return 128;
+
+	case DXGI_FORMAT_R32G32B32_TYPELESS:
+	case DXGI_FORMAT_R32G32B32_FLOAT:
+	case DXGI_FORMAT_R32G32B32_UINT:
+	case DXGI_FORMAT_R32G32B32_SINT:
+		return 96;
+
+	case DXGI_FORMAT_R16G16B16A16_TYPELESS:
+	case DXGI_FORMAT_R16G16B16A16_FLOAT:
+	case DXGI_FORMAT_R16G16B16A16_UNORM:
+	case DXGI_FORMAT_R16G16B16A16_UINT:
+	case DXGI_FORMAT_R16G16B16A16_SNORM:
+	case DXGI_FORMAT_R16G16B16A16_SINT:
+	case DXGI_FORMAT_R32G32_TYPELESS:
+	case DXGI_FORMAT_R32G32_FLOAT:
+	case DXGI_FORMAT_R32G32_UINT:
+	case DXGI_FORMAT_R32G32_SINT:
+	case DXGI_FORMAT_R32G8X24_TYPELESS:
+	case DXGI_FORMAT_D32_FLOAT_S8X24_UINT:
+	case DXGI_FORMAT_R32_FLOAT_X8X24_TYPELESS:
+	case DXGI_FORMAT_X32_TYPELESS_G8X24_UINT:
+	case DXGI_FORMAT_Y416:
+	case DXGI_FORMAT_Y210:
+	case DXGI_FORMAT_Y216:
+		return 64;
+
+	case DXGI_FORMAT_R10G10B10A2_TYPELESS:
+	case DXGI_FORMAT_R10G10B10A2_UNORM:
+	case DXGI_FORMAT_R10G10B10A2_UINT:
+	case DXGI_FORMAT_R11G11B10_FLOAT:
+	case DXGI_FORMAT_R8G8B8A8_TYPELESS:
+	case DXGI_FORMAT_R8G8B8A8_UNORM:
+	case DXGI_FORMAT_R8G8B8A8_UNORM_SRGB:
+	case DXGI_FORMAT_R8G8B8A8_UINT:
+	case DXGI_FORMAT_R8G8B8A8_SNORM:
+	case DXGI_FORMAT_R8G8B8A8_SINT:
+	case DXGI_FORMAT_R16G16_TYPELESS:
+	case DXGI_FORMAT_R16G16_FLOAT:
+	case DXGI_FORMAT_R16G16_UNORM:
+	case DXGI_FORMAT_R16G16_UINT:
+	case DXGI_FORMAT_R16G16_SNORM:
+	case DXGI_FORMAT_R16G16_SINT:
+	case DXGI_FORMAT_R32_TYPELESS:
+	case DXGI_FORMAT_D32_FLOAT:
+	case DXGI_FORMAT_R32_FLOAT:
+	case DXGI_FORMAT_R32_UINT:
+	case DXGI_FORMAT_R32_SINT:
+	case DXGI_FORMAT_R24G8_TYPELESS:
+	case DXGI_FORMAT_D24_UNORM_S8_UINT:
+	case DXGI_FORMAT_R24_UNORM_X8_TYPELESS:
+	case DXGI_FORMAT_X24_TYPELESS_G8_UINT:
+	case DXGI_FORMAT_R9G9B9E5_SHAREDEXP:
+	case DXGI_FORMAT_R8G8_B8G8_UNORM:
+	case DXGI_FORMAT_G8R8_G8B8_UNORM:
+	case DXGI_FORMAT_B8G8R8A8_UNORM:
+	case DXGI_FORMAT_B8G8R8X8_UNORM:
+	case DXGI_FORMAT_R10G10B10_XR_BIAS_A2_UNORM:
+	case DXGI_FORMAT_B8G8R8A8_TYPELESS:
+	case DXGI_FORMAT_B8G8R8A8_UNORM_SRGB:
+	case DXGI_FORMAT_B8G8R8X8_TYPELESS:
+	case DXGI_FORMAT_B8G8R8X8_UNORM_SRGB:
+	case DXGI_FORMAT_AYUV:
+	case DXGI_FORMAT_Y410:
+	case DXGI_FORMAT_YUY2:
+		return 32;
+
+	case DXGI_FORMAT_P010:
+	case DXGI_FORMAT_P016:
+		return 24;
+
+	case DXGI_FORMAT_R8G8_TYPELESS:
+	case DXGI_FORMAT_R8G8_UNORM:
+	case DXGI_FORMAT_R8G8_UINT:
+	case DXGI_FORMAT_R8G8_SNORM:
+	case DXGI_FORMAT_R8G8_SINT:
+	case DXGI_FORMAT_R16_TYPELESS:
+	case DXGI_FORMAT_R16_FLOAT:
+	case DXGI_FORMAT_D16_UNORM:
+	case DXGI_FORMAT_R16_UNORM:
+	case DXGI_FORMAT_R16_UINT:
+	case DXGI_FORMAT_R16_SNORM:
+	case DXGI_FORMAT_R16_SINT:
+	case DXGI_FORMAT_B5G6R5_UNORM:
+	case DXGI_FORMAT_B5G5R5A1_UNORM:
+	case DXGI_FORMAT_A8P8:
+	case DXGI_FORMAT_B4G4R4A4_UNORM:
+		return 16;
+
+	case DXGI_FORMAT_NV12:
+	case DXGI_FORMAT_420_OPAQUE:
+	case DXGI_FORMAT_NV11:
+		return 12;
+
+	case DXGI_FORMAT_R8_TYPELESS:
+	case DXGI_FORMAT_R8_UNORM:
+	case DXGI_FORMAT_R8_UINT:
+	case DXGI_FORMAT_R8_SNORM:
+	case DXGI_FORMAT_R8_SINT:
+	case DXGI_FORMAT_A8_UNORM:
+	case DXGI_FORMAT_AI44:
+	case DXGI_FORMAT_IA44:
+	case DXGI_FORMAT_P8:
+		return 8;
+
+	case DXGI_FORMAT_R1_UNORM:
+		return 1;
+
+	case DXGI_FORMAT_BC1_TYPELESS:
+	case DXGI_FORMAT_BC1_UNORM:
+	case DXGI_FORMAT_BC1_UNORM_SRGB:
+	case DXGI_FORMAT_BC4_TYPELESS:
+	case DXGI_FORMAT_BC4_UNORM:
+	case DXGI_FORMAT_BC4_SNORM:
+		return 4;
+
+	case DXGI_FORMAT_BC2_TYPELESS:
+	case DXGI_FORMAT_BC2_UNORM:
+	case DXGI_FORMAT_BC2_UNORM_SRGB:
+	case DXGI_FORMAT_BC3_TYPELESS:
+	case DXGI_FORMAT_BC3_UNORM:
+	case DXGI_FORMAT_BC3_UNORM_SRGB:
+	case DXGI_FORMAT_BC5_TYPELESS:
+	case DXGI_FORMAT_BC5_UNORM:
+	case DXGI_FORMAT_BC5_SNORM:
+	case DXGI_FORMAT_BC6H_TYPELESS:
+	case DXGI_FORMAT_BC6H_UF16:
+	case DXGI_FORMAT_BC6H_SF16:
+	case DXGI_FORMAT_BC7_TYPELESS:
+	case DXGI_FORMAT_BC7_UNORM:
+	case DXGI_FORMAT_BC7_UNORM_SRGB:
+		return 8;
+
+	default:
+		return 0;
+	}
+}
+
+
+//--------------------------------------------------------------------------------------
+// Get surface information for a particular format
+//--------------------------------------------------------------------------------------
+void GetDDSSurfaceInfo(std::size_t width,
+	std::size_t height,
+	DXGI_FORMAT fmt,
+	std::size_t* outNumBytes,
+	std::size_t* outRowBytes,
+	std::size_t* outNumRows)
+{
+	size_t numBytes = 0;
+	size_t rowBytes = 0;
+	size_t numRows = 0;
+
+	bool bc = false;
+	bool packed = false;
+	bool planar = false;
+	size_t bpe = 0;
+	switch (fmt)
+	{
+	case DXGI_FORMAT_BC1_TYPELESS:
+	case DXGI_FORMAT_BC1_UNORM:
+	case DXGI_FORMAT_BC1_UNORM_SRGB:
+	case DXGI_FORMAT_BC4_TYPELESS:
+	case DXGI_FORMAT_BC4_UNORM:
+	case DXGI_FORMAT_BC4_SNORM:
+		bc = true;
+		bpe = 8;
+		break;
+
+	case DXGI_FORMAT_BC2_TYPELESS:
+	case DXGI_FORMAT_BC2_UNORM:
+	case DXGI_FORMAT_BC2_UNORM_SRGB:
+	case DXGI_FORMAT_BC3_TYPELESS:
+	case DXGI_FORMAT_BC3_UNORM:
+	case DXGI_FORMAT_BC3_UNORM_SRGB:
+	case DXGI_FORMAT_BC5_TYPELESS:
+	case DXGI_FORMAT_BC5_UNORM:
+	case DXGI_FORMAT_BC5_SNORM:
+	case DXGI_FORMAT_BC6H_TYPELESS:
+	case DXGI_FORMAT_BC6H_UF16:
+	case DXGI_FORMAT_BC6H_SF16:
+	case DXGI_FORMAT_BC7_TYPELESS:
+	case DXGI_FORMAT_BC7_UNORM:
+	case DXGI_FORMAT_BC7_UNORM_SRGB:
+		bc = true;
+		bpe = 16;
+		break;
+
+	case DXGI_FORMAT_R8G8_B8G8_UNORM:
+	case DXGI_FORMAT_G8R8_G8B8_UNORM:
+	case DXGI_FORMAT_YUY2:
+		packed = true;
+		bpe = 4;
+		break;
+
+	case DXGI_FORMAT_Y210:
+	case DXGI_FORMAT_Y216:
+		packed = true;
+		bpe = 8;
+		break;
+
+	case DXGI_FORMAT_NV12:
+	case DXGI_FORMAT_420_OPAQUE:
+		planar = true;
+		bpe = 2;
+		break;
+
+	case DXGI_FORMAT_P010:
+	case DXGI_FORMAT_P016:
+		planar = true;
+		bpe = 4;
+		break;
+	}
+
+	if (bc)
+	{
+		size_t numBlocksWide = 0;
+		if (width > 0)
+		{
+			numBlocksWide = std::max<size_t>(1, (width + 3) / 4);
+		}
+		size_t numBlocksHigh = 0;
+		if (height > 0)
+		{
+			numBlocksHigh = std::max<size_t>(1, (height + 3) / 4);
+		}
+		rowBytes = numBlocksWide * bpe;
+		numRows = numBlocksHigh;
+		numBytes = rowBytes * numBlocksHigh;
+	}
+	else if (packed)
+	{
+		rowBytes = ((width + 1) >> 1) * bpe;
+		numRows = height;
+		numBytes = rowBytes * height;
+	}
+	else if (fmt == DXGI_FORMAT_NV11)
+	{
+		rowBytes = ((width + 3) >> 2) * 4;
+		numRows = height * 2; // Direct3D makes this simplifying assumption, although it is larger than the 4:1:1 data
+		numBytes = rowBytes * numRows;
+	}
+	else if (planar)
+	{
+		rowBytes = ((width + 1) >> 1) * bpe;
+		numBytes = (rowBytes * height) + ((rowBytes * height + 1) >> 1);
+		numRows = height + ((height + 1) >> 1);
+	}
+	else
+	{
+		size_t bpp = DDSBitsPerPixel(fmt);
+		rowBytes = (width * bpp + 7) / 8; // round up to nearest byte
+		numRows = height;
+		numBytes = rowBytes * height;
+	}
+
+	if (outNumBytes)
+	{
+		*outNumBytes = numBytes;
+	}
+	if (outRowBytes)
+	{
+		*outRowBytes = rowBytes;
+	}
+	if (outNumRows)
+	{
+		*outNumRows = numRows;
+	}
+}
+
+
+//--------------------------------------------------------------------------------------
+#define ISBITMASK( r,g,b,a ) ( ddpf.RBitMask == r && ddpf.GBitMask == g && ddpf.BBitMask == b && ddpf.ABitMask == a )
+
+DXGI_FORMAT GetDDSFormat(const DDS_PIXELFORMAT& ddpf)
+{
+	if (ddpf.flags & DDS_RGB)
+	{
+		// Note that sRGB formats are written using the "DX10" extended header
+
+		switch (ddpf.RGBBitCount)
+		{
+		case 32:
+			if (ISBITMASK(0x000000ff, 0x0000ff00, 0x00ff0000, 0xff000000))
+			{
+				return DXGI_FORMAT_R8G8B8A8_UNORM;
+			}
+
+			if (ISBITMASK(0x00ff0000, 0x0000ff00, 0x000000ff, 0xff000000))
+			{
+				return DXGI_FORMAT_B8G8R8A8_UNORM;
+			}
+
+			if (ISBITMASK(0x00ff0000, 0x0000ff00, 0x000000ff, 0x00000000))
+			{
+				return DXGI_FORMAT_B8G8R8X8_UNORM;
+			}
+
+			// No DXGI format maps to ISBITMASK(0x000000ff,0x0000ff00,0x00ff0000,0x00000000) aka D3DFMT_X8B8G8R8
+
+			// Note that many common DDS reader/writers (including D3DX) swap the
+			// the RED/BLUE masks for 10:10:10:2 formats. We assume
+			// below that the 'backwards' header mask is being used since it is most
+			// likely written by D3DX. The more robust solution is to use the 'DX10'
+			// header extension and specify the DXGI_FORMAT_R10G10B10A2_UNORM format directly
+
+			// For 'correct' writers, this should be 0x000003ff,0x000ffc00,0x3ff00000 for RGB data
+			if (ISBITMASK(0x3ff00000, 0x000ffc00, 0x000003ff, 0xc0000000))
+			{
+				return DXGI_FORMAT_R10G10B10A2_UNORM;
+			}
+
+			// No DXGI format maps to ISBITMASK(0x000003ff,0x000ffc00,0x3ff00000,0xc0000000) aka D3DFMT_A2R10G10B10
+
+			if (ISBITMASK(0x0000ffff, 0xffff0000, 0x00000000, 0x00000000))
+			{
+				return DXGI_FORMAT_R16G16_UNORM;
+			}
+
+			if (ISBITMASK(0xffffffff, 0x00000000, 0x00000000, 0x00000000))
+			{
+				// Only 32-bit color channel format in D3D9 was R32F
+				return DXGI_FORMAT_R32_FLOAT; // D3DX writes this out as a FourCC of 114
+			}
+			break;
+
+		case 24:
+			// No 24bpp DXGI formats aka D3DFMT_R8G8B8
+			break;
+
+		case 16:
+			if (ISBITMASK(0x7c00, 0x03e0, 0x001f, 0x8000))
+			{
+				return DXGI_FORMAT_B5G5R5A1_UNORM;
+			}
+			if (ISBITMASK(0xf800, 0x07e0, 0x001f, 0x0000))
+			{
+				return DXGI_FORMAT_B5G6R5_UNORM;
+			}
+
+			// No DXGI format maps to ISBITMASK(0x7c00,0x03e0,0x001f,0x0000) aka D3DFMT_X1R5G5B5
+
+			if (ISBITMASK(0x0f00, 0x00f0, 0x000f, 0xf000))
+			{
+				return DXGI_FORMAT_B4G4R4A4_UNORM;
+			}
+
+			// No DXGI format maps to ISBITMASK(0x0f00,0x00f0,0x000f,0x0000) aka D3DFMT_X4R4G4B4
+
+			// No 3:3:2, 3:3:2:8, or paletted DXGI formats aka D3DFMT_A8R3G3B2, D3DFMT_R3G3B2, D3DFMT_P8, D3DFMT_A8P8, etc.
+			break;
+		}
+	}
+	else if (ddpf.flags & DDS_LUMINANCE)
+	{
+		if (8 == ddpf.RGBBitCount)
+		{
+			if (ISBITMASK(0x000000ff, 0x00000000, 0x00000000, 0x00000000))
+			{
+				return DXGI_FORMAT_R8_UNORM; // D3DX10/11 writes this out as DX10 extension
+			}
+
+			// No DXGI format maps to ISBITMASK(0x0f,0x00,0x00,0xf0) aka D3DFMT_A4L4
+		}
+
+		if (16 == ddpf.RGBBitCount)
+		{
+			if (ISBITMASK(0x0000ffff, 0x00000000, 0x00000000, 0x00000000))
+			{
+				return DXGI_FORMAT_R16_UNORM; // D3DX10/11 writes this out as DX10 extension
+			}
+			if (ISBITMASK(0x000000ff, 0x00000000, 0x00000000, 0x0000ff00))
+			{
+				return DXGI_FORMAT_R8G8_UNORM; // D3DX10/11 writes this out as DX10 extension
+			}
+		}
+	}
+	else if (ddpf.flags & DDS_ALPHA)
+	{
+		if (8 == ddpf.RGBBitCount)
+		{
+			return DXGI_FORMAT_A8_UNORM;
+		}
+	}
+	else if (ddpf.flags & DDS_FOURCC)
+	{
+		if (MAKEFOURCC('D', 'X', 'T', '1') == ddpf.fourCC)
+		{
+			return DXGI_FORMAT_BC1_UNORM;
+		}
+		if (MAKEFOURCC('D', 'X', 'T', '3') == ddpf.fourCC)
+		{
+			return DXGI_FORMAT_BC2_UNORM;
+		}
+		if (MAKEFOURCC('D', 'X', 'T', '5') == ddpf.fourCC)
+		{
+			return DXGI_FORMAT_BC3_UNORM;
+		}
+
+		// While pre-multiplied alpha isn't directly supported by the DXGI formats,
+		// they are basically the same as these BC formats so they can be mapped
+		if (MAKEFOURCC('D', 'X', 'T', '2') == ddpf.fourCC)
+		{
+			return DXGI_FORMAT_BC2_UNORM;
+		}
+		if (MAKEFOURCC('D', 'X', 'T', '4') == ddpf.fourCC)
+		{
+			return DXGI_FORMAT_BC3_UNORM;
+		}
+
+		if (MAKEFOURCC('A', 'T', 'I', '1') == ddpf.fourCC)
+		{
+			return DXGI_FORMAT_BC4_UNORM;
+		}
+		if (MAKEFOURCC('B', 'C', '4', 'U') == ddpf.fourCC)
+		{
+			return DXGI_FORMAT_BC4_UNORM;
+		}
+		if (MAKEFOURCC('B', 'C', '4', 'S') == ddpf.fourCC)
+		{
+			return DXGI_FORMAT_BC4_SNORM;
+		}
+
+		if (MAKEFOURCC('A', 'T', 'I', '2') == ddpf.fourCC)
+		{
+			return DXGI_FORMAT_BC5_UNORM;
+		}
+		if (MAKEFOURCC('B', 'C', '5', 'U') == ddpf.fourCC)
+		{
+			return DXGI_FORMAT_BC5_UNORM;
+		}
+		if (MAKEFOURCC('B', 'C', '5', 'S') == ddpf.fourCC)
+		{
+			return DXGI_FORMAT_BC5_SNORM;
+		}
+
+		// BC6H and BC7 are written using the "DX10" extended header
+
+		if (MAKEFOURCC('R', 'G', 'B', 'G') == ddpf.fourCC)
+		{
+			return DXGI_FORMAT_R8G8_B8G8_UNORM;
+		}
+		if (MAKEFOURCC('G', 'R', 'G', 'B') == ddpf.fourCC)
+		{
+			return DXGI_FORMAT_G8R8_G8B8_UNORM;
+		}
+
+		if (MAKEFOURCC('Y', 'U', 'Y', '2') == ddpf.fourCC)
+		{
+			return DXGI_FORMAT_YUY2;
+		}
+
+		// Check for D3DFORMAT enums being set here
+		switch (ddpf.fourCC)
+		{
+		case 36: // D3DFMT_A16B16G16R16
+			return DXGI_FORMAT_R16G16B16A16_UNORM;
+
+		case 110: // D3DFMT_Q16W16V16U16
+			return DXGI_FORMAT_R16G16B16A16_SNORM;
+
+		case 111: // D3DFMT_R16F
+			return DXGI_FORMAT_R16_FLOAT;
+
+		case 112: // D3DFMT_G16R16F
+			return DXGI_FORMAT_R16G16_FLOAT;
+
+		case 113: // D3DFMT_A16B16G16R16F
+			return DXGI_FORMAT_R16G16B16A16_FLOAT;
+
+		case 114: // D3DFMT_R32F
+			return DXGI_FORMAT_R32_FLOAT;
+
+		case 115: // D3DFMT_G32R32F
+			return DXGI_FORMAT_R32G32_FLOAT;
+
+		case 116: // D3DFMT_A32B32G32R32F
+			return DXGI_FORMAT_R32G32B32A32_FLOAT;
+		}
+	}
+
+	return DXGI_FORMAT_UNKNOWN;
+}
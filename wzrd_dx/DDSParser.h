@@ -0,0 +1,179 @@
+#pragma once
+
+#include <dxgiformat.h>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Platform-neutral DDS parsing: header validation and subresource layout over
+// bytes already in memory, typically a MappedFile view. Nothing here touches
+// Direct3D, so it builds and runs anywhere dxgiformat.h is available.
+
+//--------------------------------------------------------------------------------------
+// DDS file structure definitions
+//
+// See DDS.h in the 'Texconv' sample and the 'DirectXTex' library
+//--------------------------------------------------------------------------------------
+#pragma pack(push,1)
+
+const uint32_t DDS_MAGIC = 0x20534444; // "DDS "
+
+struct DDS_PIXELFORMAT
+{
+	uint32_t    size;
+	uint32_t    flags;
+	uint32_t    fourCC;
+	uint32_t    RGBBitCount;
+	uint32_t    RBitMask;
+	uint32_t    GBitMask;
+	uint32_t    BBitMask;
+	uint32_t    ABitMask;
+};
+
+#define DDS_FOURCC      0x00000004  // DDPF_FOURCC
+#define DDS_RGB         0x00000040  // DDPF_RGB
+#define DDS_LUMINANCE   0x00020000  // DDPF_LUMINANCE
+#define DDS_ALPHA       0x00000002  // DDPF_ALPHA
+
+#define DDS_HEADER_FLAGS_VOLUME         0x00800000  // DDSD_DEPTH
+
+#define DDS_HEIGHT 0x00000002 // DDSD_HEIGHT
+#define DDS_WIDTH  0x00000004 // DDSD_WIDTH
+
+#define DDS_CUBEMAP_POSITIVEX 0x00000600 // DDSCAPS2_CUBEMAP | DDSCAPS2_CUBEMAP_POSITIVEX
+#define DDS_CUBEMAP_NEGATIVEX 0x00000a00 // DDSCAPS2_CUBEMAP | DDSCAPS2_CUBEMAP_NEGATIVEX
+#define DDS_CUBEMAP_POSITIVEY 0x00001200 // DDSCAPS2_CUBEMAP | DDSCAPS2_CUBEMAP_POSITIVEY
+#define DDS_CUBEMAP_NEGATIVEY 0x00002200 // DDSCAPS2_CUBEMAP | DDSCAPS2_CUBEMAP_NEGATIVEY
+#define DDS_CUBEMAP_POSITIVEZ 0x00004200 // DDSCAPS2_CUBEMAP | DDSCAPS2_CUBEMAP_POSITIVEZ
+#define DDS_CUBEMAP_NEGATIVEZ 0x00008200 // DDSCAPS2_CUBEMAP | DDSCAPS2_CUBEMAP_NEGATIVEZ
+
+#define DDS_CUBEMAP_ALLFACES ( DDS_CUBEMAP_POSITIVEX | DDS_CUBEMAP_NEGATIVEX |\
+                               DDS_CUBEMAP_POSITIVEY | DDS_CUBEMAP_NEGATIVEY |\
+                               DDS_CUBEMAP_POSITIVEZ | DDS_CUBEMAP_NEGATIVEZ )
+
+#define DDS_CUBEMAP 0x00000200 // DDSCAPS2_CUBEMAP
+
+enum DDS_MISC_FLAGS2
+{
+	DDS_MISC_FLAGS2_ALPHA_MODE_MASK = 0x7L,
+};
+
+struct DDS_HEADER
+{
+	uint32_t        size;
+	uint32_t        flags;
+	uint32_t        height;
+	uint32_t        width;
+	uint32_t        pitchOrLinearSize;
+	uint32_t        depth; // only if DDS_HEADER_FLAGS_VOLUME is set in flags
+	uint32_t        mipMapCount;
+	uint32_t        reserved1[11];
+	DDS_PIXELFORMAT ddspf;
+	uint32_t        caps;
+	uint32_t        caps2;
+	uint32_t        caps3;
+	uint32_t        caps4;
+	uint32_t        reserved2;
+};
+
+struct DDS_HEADER_DXT10
+{
+	DXGI_FORMAT     dxgiFormat;
+	uint32_t        resourceDimension;
+	uint32_t        miscFlag; // see D3D11_RESOURCE_MISC_FLAG
+	uint32_t        arraySize;
+	uint32_t        miscFlags2;
+};
+
+#pragma pack(pop)
+
+// DDS_HEADER_DXT10 resourceDimension values and the cube map miscFlag.
+#define DDS_DIMENSION_TEXTURE1D 2
+#define DDS_DIMENSION_TEXTURE2D 3
+#define DDS_DIMENSION_TEXTURE3D 4
+#define DDS_RESOURCE_MISC_TEXTURECUBE 0x4
+
+// Same values as D3D12_RESOURCE_DIMENSION.
+enum class DDSDimension : std::uint32_t {
+	Texture1D = 2,
+	Texture2D = 3,
+	Texture3D = 4,
+};
+
+enum class DDSError {
+	None,
+	// Too small for the headers, or the magic number or header sizes are wrong.
+	NotDDS,
+	InvalidData,
+	// A format, dimension or size Direct3D 12 cannot create.
+	NotSupported,
+	// The pixel data ends before the last subresource.
+	Truncated,
+};
+
+// One mip of one array item, inside the parsed bytes.
+struct DDSSubresource {
+	const std::uint8_t* Data = nullptr;
+	std::uint32_t Width = 0;
+	std::uint32_t Height = 0;
+	std::uint32_t Depth = 0;
+	// Bytes per row of pixels or blocks, and per 2D slice.
+	std::size_t RowPitch = 0;
+	std::size_t SlicePitch = 0;
+};
+
+struct DDSTexture {
+	const DDS_HEADER* Header = nullptr;
+	DDSDimension Dimension = DDSDimension::Texture2D;
+	DXGI_FORMAT Format = DXGI_FORMAT_UNKNOWN;
+	std::uint32_t Width = 0;
+	std::uint32_t Height = 0;
+	std::uint32_t Depth = 0;
+	std::uint32_t MipCount = 0;
+	// Array items, six per cube.
+	std::uint32_t ArraySize = 0;
+	bool IsCubeMap = false;
+	// All mips of item 0, then all mips of item 1 and so on, which is also
+	// Direct3D's subresource order.
+	std::vector<DDSSubresource> Subresources;
+
+	const DDSSubresource& Subresource(std::uint32_t item, std::uint32_t mip) const {
+		return Subresources[(std::size_t)item * MipCount + mip];
+	}
+};
+
+// Validates a DDS file held in memory and lays out its subresources, which point
+// into data and stay valid as long as it does. Sizes beyond Direct3D 12's limits
+// are rejected. On failure, error says why.
+bool ParseDDS(const std::uint8_t* data, std::size_t size, DDSTexture& texture, DDSError* error = nullptr);
+
+// First mip whose sides are all at most maxSize, which is where a load capped
+// at maxSize starts. 0 when maxSize is 0 or there is one mip, and MipCount when
+// no mip is small enough.
+std::uint32_t FirstDDSMipWithin(const DDSTexture& texture, std::size_t maxSize);
+
+// Bytes of the mips from mip on, over every array item: what a texture loaded
+// from mip holds.
+std::uint64_t DDSBytesFrom(const DDSTexture& texture, std::uint32_t mip);
+
+// First mip of the tail a TextureStreamer keeps resident: FirstDDSMipWithin
+// tailMaxSize, or 0 for a texture loaded whole because it has one mip or none
+// that small.
+std::uint32_t DDSTailMip(const DDSTexture& texture, std::size_t tailMaxSize);
+
+// Smallest streaming budget with which every texture can reach mip 0 once the
+// others are back on their tails: all the tails, plus the largest full chain
+// and the level it replaces, which stays resident until the switch.
+std::uint64_t DDSStreamingBudget(const std::vector<const DDSTexture*>& textures, std::size_t tailMaxSize);
+
+// Bits per pixel of an uncompressed format, or per texel of a block-compressed
+// one. 0 for formats DDS files cannot hold.
+std::size_t DDSBitsPerPixel(DXGI_FORMAT format);
+
+// Byte size of a width x height surface, with its row pitch and row count.
+// Block-compressed formats count rows of blocks.
+void GetDDSSurfaceInfo(std::size_t width, std::size_t height, DXGI_FORMAT format,
+	std::size_t* numBytes, std::size_t* rowBytes, std::size_t* numRows);
+
+// Format described by a legacy pixel format, or DXGI_FORMAT_UNKNOWN.
+DXGI_FORMAT GetDDSFormat(const DDS_PIXELFORMAT& pixelFormat);
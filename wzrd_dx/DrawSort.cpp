@@ -0,0 +1,100 @@
+#include "DrawSort.h"
+#include <cstddef>
+#include <utility>
+
+static std::uint64_t MaskField(std::uint32_t value, std::uint32_t bits) {
+	return (std::uint64_t)(value & ((1u << bits) - 1u));
+}
+
+std::uint32_t DrawKey::QuantizeDepth(float depth, float farZ, std::uint32_t bits) {
+	const std::uint32_t maxDepth = (1u << bits) - 1u;
+
+	if (!(depth > 0.0f) || farZ <= 0.0f)
+		return 0;
+
+	float normalized = depth / farZ;
+	if (normalized >= 1.0f)
+		return maxDepth;
+
+	return (std::uint32_t)(normalized * (float)maxDepth);
+}
+
+std::uint64_t DrawKey::MakeOpaque(std::uint32_t layer, std::uint32_t pso, std::uint32_t geometry, std::uint32_t submesh,
+	std::uint32_t material, float depth, float farZ)
+{
+	std::uint64_t key = 0;
+	key |= MaskField(layer, LayerBits) << 60;
+	key |= MaskField(pso, PsoBits) << 52;
+	key |= MaskField(geometry, GeometryBits) << 40;
+	key |= MaskField(submesh, SubmeshBits) << 32;
+	key |= MaskField(material, MaterialBits) << 20;
+	key |= MaskField(QuantizeDepth(depth, farZ, OpaqueDepthBits), OpaqueDepthBits);
+	return key;
+}
+
+std::uint64_t DrawKey::MakeTranslucent(std::uint32_t layer, std::uint32_t pso, std::uint32_t geometry, std::uint32_t material, float depth, float farZ) {
+	const std::uint32_t maxDepth = (1u << DepthBits) - 1u;
+
+	std::uint64_t key = 0;
+	key |= MaskField(layer, LayerBits) << 60;
+	key |= MaskField(maxDepth - QuantizeDepth(depth, farZ), DepthBits) << 32;
+	key |= MaskField(pso, PsoBits) << 24;
+	key |= MaskField(geometry, GeometryBits) << 12;
+	key |= MaskField(material, MaterialBits);
+	return key;
+}
+
+std::uint32_t SubmeshSortIds::Get(std::uint32_t startIndexLocation, std::int32_t baseVertexLocation) {
+	std::uint64_t range = ((std::uint64_t)startIndexLocation << 32) | (std::uint32_t)baseVertexLocation;
+	return m_ids.emplace(range, (std::uint32_t)m_ids.size()).first->second;
+}
+
+void RadixSortDraws(std::vector<SortedDraw>& draws, std::vector<SortedDraw>& scratch) {
+	const size_t count = draws.size();
+	if (count < 2)
+		return;
+
+	// Find which bytes actually differ so we only run the passes that matter.
+	std::uint64_t allOr = 0;
+	std::uint64_t allAnd = ~0ull;
+	for (size_t i = 0; i < count; ++i)
+	{
+		allOr |= draws[i].Key;
+		allAnd &= draws[i].Key;
+	}
+	const std::uint64_t varyingBits = allOr ^ allAnd;
+	if (varyingBits == 0)
+		return;
+
+	scratch.resize(count);
+
+	SortedDraw* src = draws.data();
+	SortedDraw* dst = scratch.data();
+
+	for (std::uint32_t shift = 0; shift < 64; shift += 8)
+	{
+		if (((varyingBits >> shift) & 0xff) == 0)
+			continue;
+
+		std::uint32_t histogram[256] = {};
+		for (size_t i = 0; i < count; ++i)
+			histogram[(src[i].Key >> shift) & 0xff]++;
+
+		std::uint32_t offset = 0;
+		for (std::uint32_t b = 0; b < 256; ++b)
+		{
+			std::uint32_t c = histogram[b];
+			histogram[b] = offset;
+			offset += c;
+		}
+
+		for (size_t i = 0; i < count; ++i)
+			dst[histogram[(src[i].Key >> shift) & 0xff]++] = src[i];
+
+		std::swap(src, dst);
+	}
+
+	// An odd number of passes leaves the result in the scratch buffer.
+	if (src != draws.data())
+		draws.swap(scratch);
+}
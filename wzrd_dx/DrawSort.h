@@ -0,0 +1,56 @@
+#pragma once
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+// 64-bit sort keys for draw submission. The most significant fields are the ones
+// that are the most expensive to change, so sorting by key groups draws by state.
+//
+// Opaque layout (front-to-back inside a state bucket):
+//   [63..60] layer  [59..52] pso  [51..40] geometry  [39..32] submesh  [31..20] material  [19..0] depth
+//
+// Draws of the same submesh and material end up next to each other whatever
+// their depth, which is what lets the instance batcher merge them.
+//
+// Translucent layout (back-to-front, state only breaks ties):
+//   [63..60] layer  [59..32] inverted depth  [31..24] pso  [23..12] geometry  [11..0] material
+class DrawKey {
+public:
+	static const std::uint32_t LayerBits = 4;
+	static const std::uint32_t PsoBits = 8;
+	static const std::uint32_t GeometryBits = 12;
+	static const std::uint32_t SubmeshBits = 8;
+	static const std::uint32_t MaterialBits = 12;
+	static const std::uint32_t DepthBits = 28;
+	static const std::uint32_t OpaqueDepthBits = 20;
+
+	static std::uint64_t MakeOpaque(std::uint32_t layer, std::uint32_t pso, std::uint32_t geometry, std::uint32_t submesh,
+		std::uint32_t material, float depth, float farZ);
+	static std::uint64_t MakeTranslucent(std::uint32_t layer, std::uint32_t pso, std::uint32_t geometry, std::uint32_t material, float depth, float farZ);
+
+	static std::uint32_t Layer(std::uint64_t key) { return (std::uint32_t)(key >> 60); }
+
+	// Maps a view space depth in [0, farZ] to bits of precision.
+	static std::uint32_t QuantizeDepth(float depth, float farZ, std::uint32_t bits = DepthBits);
+};
+
+// Hands out small ids for the submesh field of opaque keys, one per distinct
+// draw range seen so far. Ids past SubmeshBits wrap, which only costs batching.
+class SubmeshSortIds {
+public:
+	std::uint32_t Get(std::uint32_t startIndexLocation, std::int32_t baseVertexLocation);
+
+private:
+	std::unordered_map<std::uint64_t, std::uint32_t> m_ids;
+};
+
+struct SortedDraw {
+	std::uint64_t Key = 0;
+	std::uint32_t ItemIndex = 0;
+};
+
+// LSD radix sort on the 64-bit key, 8 bits per pass. Passes where every key has
+// the same byte are skipped, so in practice only a few passes run per frame.
+// scratch is reused between frames to avoid allocations.
+void RadixSortDraws(std::vector<SortedDraw>& draws, std::vector<SortedDraw>& scratch);
@@ -0,0 +1,358 @@
+#include "FrameGraph.h"
+#include <algorithm>
+#include <cassert>
+
+// States a resource can be in while several passes read it without a barrier.
+static const std::uint32_t ReadOnlyStates = ResourceState_DepthRead | ResourceState_ShaderResource | ResourceState_CopySource;
+
+static std::uint64_t AlignUp(std::uint64_t value, std::uint64_t alignment) {
+	return (value + alignment - 1) / alignment * alignment;
+}
+
+void FrameGraph::PassBuilder::Read(FrameGraphResource resource, std::uint32_t state) {
+	m_graph->AddAccess(m_pass, resource, state, false);
+}
+
+void FrameGraph::PassBuilder::Write(FrameGraphResource resource, std::uint32_t state) {
+	m_graph->AddAccess(m_pass, resource, state, true);
+}
+
+void FrameGraph::PassBuilder::SideEffect() {
+	m_graph->m_passes[m_pass].HasSideEffect = true;
+}
+
+FrameGraphResource FrameGraph::ImportResource(const std::string& name, std::uint32_t initialState, std::uint32_t finalState, void* external) {
+	ResourceNode node;
+	node.Name = name;
+	node.Imported = true;
+	node.External = external;
+	node.InitialState = initialState;
+	node.FinalState = finalState;
+	m_resources.push_back(node);
+	return (FrameGraphResource)(m_resources.size() - 1);
+}
+
+void FrameGraph::SetImportedResource(FrameGraphResource resource, void* external) {
+	assert(m_resources[resource].Imported);
+	m_resources[resource].External = external;
+}
+
+FrameGraphResource FrameGraph::CreateTransient(const std::string& name, std::uint64_t sizeInBytes, std::uint64_t alignment) {
+	ResourceNode node;
+	node.Name = name;
+	node.SizeInBytes = sizeInBytes;
+	node.Alignment = alignment > 0 ? alignment : 1;
+	m_resources.push_back(node);
+	return (FrameGraphResource)(m_resources.size() - 1);
+}
+
+std::uint32_t FrameGraph::AddPass(const std::string& name, const std::function<void(PassBuilder&)>& setup, const std::function<void()>& execute) {
+	PassNode node;
+	node.Name = name;
+	node.Execute = execute;
+	m_passes.push_back(node);
+
+	std::uint32_t pass = (std::uint32_t)(m_passes.size() - 1);
+	PassBuilder builder(this, pass);
+	setup(builder);
+	return pass;
+}
+
+void FrameGraph::AddAccess(std::uint32_t pass, FrameGraphResource resource, std::uint32_t state, bool isWrite) {
+	assert(resource < m_resources.size());
+	m_passes[pass].Accesses.push_back({ resource, state, isWrite });
+}
+
+void FrameGraph::CullPasses() {
+	// Walk backwards: a pass survives when it writes something a later surviving
+	// pass reads, writes an imported resource or is marked as having side effects.
+	// A pass that blends into a resource must also Read it to keep its producer.
+	std::vector<bool> needed(m_resources.size(), false);
+
+	for (std::uint32_t p = (std::uint32_t)m_passes.size(); p-- > 0;)
+	{
+		PassNode& pass = m_passes[p];
+
+		bool live = pass.HasSideEffect;
+		for (const Access& a : pass.Accesses)
+		{
+			if (a.IsWrite && (m_resources[a.Resource].Imported || needed[a.Resource]))
+				live = true;
+		}
+
+		pass.Culled = !live;
+		if (!live)
+			continue;
+
+		// Written-only resources are overwritten here, so earlier producers are
+		// only needed if this pass also reads them.
+		for (const Access& a : pass.Accesses)
+		{
+			if (a.IsWrite)
+				needed[a.Resource] = false;
+		}
+		for (const Access& a : pass.Accesses)
+		{
+			if (!a.IsWrite)
+				needed[a.Resource] = true;
+		}
+	}
+}
+
+void FrameGraph::AllocateTransients(std::vector<FrameGraphBarrier>& aliasingBarriers, std::vector<std::uint32_t>& aliasingStep) {
+	std::vector<FrameGraphResource> transients;
+	for (FrameGraphResource r = 0; r < (FrameGraphResource)m_resources.size(); ++r)
+	{
+		const ResourceNode& node = m_resources[r];
+		if (!node.Imported && node.FirstUse != 0xffffffff)
+		{
+			transients.push_back(r);
+			m_stats.TransientBytes += node.SizeInBytes;
+		}
+	}
+
+	// Largest first, each at the lowest offset that does not overlap a resource
+	// alive at the same time.
+	std::stable_sort(transients.begin(), transients.end(), [this](FrameGraphResource a, FrameGraphResource b) {
+		return m_resources[a].SizeInBytes > m_resources[b].SizeInBytes;
+	});
+
+	auto lifetimesOverlap = [this](FrameGraphResource a, FrameGraphResource b) {
+		const ResourceNode& x = m_resources[a];
+		const ResourceNode& y = m_resources[b];
+		return x.FirstUse <= y.LastUse && y.FirstUse <= x.LastUse;
+	};
+	auto memoryOverlaps = [this](FrameGraphResource a, FrameGraphResource b) {
+		const ResourceNode& x = m_resources[a];
+		const ResourceNode& y = m_resources[b];
+		return x.HeapOffset < y.HeapOffset + y.SizeInBytes && y.HeapOffset < x.HeapOffset + x.SizeInBytes;
+	};
+
+	std::vector<FrameGraphResource> placed;
+	std::uint64_t heapSize = 0;
+
+	for (FrameGraphResource r : transients)
+	{
+		ResourceNode& node = m_resources[r];
+
+		std::vector<std::uint64_t> candidates(1, 0);
+		for (FrameGraphResource q : placed)
+		{
+			if (lifetimesOverlap(r, q))
+				candidates.push_back(AlignUp(m_resources[q].HeapOffset + m_resources[q].SizeInBytes, node.Alignment));
+		}
+		std::sort(candidates.begin(), candidates.end());
+
+		for (std::uint64_t offset : candidates)
+		{
+			node.HeapOffset = offset;
+
+			bool fits = true;
+			for (FrameGraphResource q : placed)
+			{
+				if (lifetimesOverlap(r, q) && memoryOverlaps(r, q))
+				{
+					fits = false;
+					break;
+				}
+			}
+			if (fits)
+				break;
+		}
+
+		placed.push_back(r);
+		heapSize = std::max(heapSize, node.HeapOffset + node.SizeInBytes);
+	}
+
+	m_stats.AliasedTransientBytes = heapSize;
+
+	// A transient that reuses memory needs an aliasing barrier against the
+	// resource that used it last.
+	for (FrameGraphResource r : transients)
+	{
+		FrameGraphResource before = InvalidFrameGraphResource;
+		for (FrameGraphResource q : transients)
+		{
+			if (q == r || !memoryOverlaps(r, q) || m_resources[q].LastUse >= m_resources[r].FirstUse)
+				continue;
+			if (before == InvalidFrameGraphResource || m_resources[q].LastUse > m_resources[before].LastUse)
+				before = q;
+		}
+
+		if (before != InvalidFrameGraphResource)
+		{
+			FrameGraphBarrier barrier;
+			barrier.BarrierType = FrameGraphBarrier::Type::Aliasing;
+			barrier.Resource = r;
+			barrier.AliasBefore = before;
+			aliasingBarriers.push_back(barrier);
+			aliasingStep.push_back(m_resources[r].FirstUse);
+		}
+	}
+}
+
+void FrameGraph::Compile() {
+	m_schedule.clear();
+	m_barriers.clear();
+	m_stats = FrameGraphStats();
+	m_stats.PassCount = (std::uint32_t)m_passes.size();
+
+	for (auto& r : m_resources)
+	{
+		r.FirstUse = 0xffffffff;
+		r.LastUse = 0;
+		r.HeapOffset = 0;
+	}
+
+	CullPasses();
+
+	for (std::uint32_t p = 0; p < (std::uint32_t)m_passes.size(); ++p)
+	{
+		if (m_passes[p].Culled)
+		{
+			m_stats.CulledPassCount++;
+			continue;
+		}
+
+		std::uint32_t step = (std::uint32_t)m_schedule.size();
+		for (const Access& a : m_passes[p].Accesses)
+		{
+			ResourceNode& r = m_resources[a.Resource];
+			r.FirstUse = std::min(r.FirstUse, step);
+			r.LastUse = std::max(r.LastUse, step);
+		}
+		m_schedule.push_back({ p, 0, 0 });
+	}
+
+	std::vector<FrameGraphBarrier> aliasingBarriers;
+	std::vector<std::uint32_t> aliasingStep;
+	AllocateTransients(aliasingBarriers, aliasingStep);
+
+	// Imported resources start in their initial state. Transients are created in
+	// the state of their first use, so they have no state until then.
+	const std::uint32_t NoState = 0xffffffff;
+	std::vector<std::uint32_t> currentState(m_resources.size(), NoState);
+	for (FrameGraphResource r = 0; r < (FrameGraphResource)m_resources.size(); ++r)
+	{
+		if (m_resources[r].Imported)
+			currentState[r] = m_resources[r].InitialState;
+	}
+
+	for (std::uint32_t s = 0; s < (std::uint32_t)m_schedule.size(); ++s)
+	{
+		Step& step = m_schedule[s];
+		step.FirstBarrier = (std::uint32_t)m_barriers.size();
+
+		for (size_t i = 0; i < aliasingBarriers.size(); ++i)
+		{
+			if (aliasingStep[i] == s)
+				m_barriers.push_back(aliasingBarriers[i]);
+		}
+
+		// Merge all accesses of the pass to the same resource.
+		const std::vector<Access>& accesses = m_passes[step.Pass].Accesses;
+		std::vector<FrameGraphResource> touched;
+		for (const Access& a : accesses)
+		{
+			if (std::find(touched.begin(), touched.end(), a.Resource) == touched.end())
+				touched.push_back(a.Resource);
+		}
+
+		for (FrameGraphResource r : touched)
+		{
+			std::uint32_t required = 0;
+			bool isWrite = false;
+			for (const Access& a : accesses)
+			{
+				if (a.Resource == r)
+				{
+					required |= a.State;
+					isWrite |= a.IsWrite;
+				}
+			}
+
+			std::uint32_t current = currentState[r];
+
+			if (!isWrite && (required & ~ReadOnlyStates) == 0)
+			{
+				// Already in a read state that covers this pass.
+				if (current != NoState && (current & ~ReadOnlyStates) == 0 && (current & required) == required)
+					continue;
+
+				// Take in the states of the following read-only users so the
+				// whole run of reads needs a single transition.
+				for (std::uint32_t next = s + 1; next < (std::uint32_t)m_schedule.size(); ++next)
+				{
+					std::uint32_t nextState = 0;
+					bool nextTouches = false;
+					bool nextWrites = false;
+					for (const Access& a : m_passes[m_schedule[next].Pass].Accesses)
+					{
+						if (a.Resource == r)
+						{
+							nextTouches = true;
+							nextState |= a.State;
+							nextWrites |= a.IsWrite;
+						}
+					}
+
+					if (!nextTouches)
+						continue;
+					if (nextWrites || (nextState & ~ReadOnlyStates) != 0)
+						break;
+					required |= nextState;
+				}
+			}
+
+			if (current == required)
+				continue;
+
+			if (current != NoState)
+			{
+				FrameGraphBarrier barrier;
+				barrier.Resource = r;
+				barrier.StateBefore = current;
+				barrier.StateAfter = required;
+				m_barriers.push_back(barrier);
+			}
+			currentState[r] = required;
+		}
+
+		step.BarrierCount = (std::uint32_t)m_barriers.size() - step.FirstBarrier;
+		if (step.BarrierCount > 0)
+			m_stats.BarrierBatchCount++;
+	}
+
+	m_finalBarrierStart = (std::uint32_t)m_barriers.size();
+	for (FrameGraphResource r = 0; r < (FrameGraphResource)m_resources.size(); ++r)
+	{
+		const ResourceNode& node = m_resources[r];
+		if (node.Imported && currentState[r] != node.FinalState)
+		{
+			FrameGraphBarrier barrier;
+			barrier.Resource = r;
+			barrier.StateBefore = currentState[r];
+			barrier.StateAfter = node.FinalState;
+			m_barriers.push_back(barrier);
+		}
+	}
+	if (m_barriers.size() > m_finalBarrierStart)
+		m_stats.BarrierBatchCount++;
+
+	m_stats.BarrierCount = (std::uint32_t)m_barriers.size();
+}
+
+void FrameGraph::Execute(const std::function<void(const FrameGraphBarrier* barriers, std::uint32_t count)>& issueBarriers) const {
+	for (const Step& step : m_schedule)
+	{
+		if (step.BarrierCount > 0)
+			issueBarriers(&m_barriers[step.FirstBarrier], step.BarrierCount);
+
+		if (m_passes[step.Pass].Execute)
+			m_passes[step.Pass].Execute();
+	}
+
+	std::uint32_t finalCount = (std::uint32_t)m_barriers.size() - m_finalBarrierStart;
+	if (finalCount > 0)
+		issueBarriers(&m_barriers[m_finalBarrierStart], finalCount);
+}
@@ -0,0 +1,134 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+// Resource states used by the frame graph. They mirror the D3D12 states the
+// passes need and are translated by whoever issues the barriers.
+enum ResourceStateFlags : std::uint32_t {
+	ResourceState_Common = 0,
+	ResourceState_RenderTarget = 1 << 0,
+	ResourceState_DepthWrite = 1 << 1,
+	ResourceState_DepthRead = 1 << 2,
+	ResourceState_ShaderResource = 1 << 3,
+	ResourceState_CopySource = 1 << 4,
+	ResourceState_CopyDest = 1 << 5,
+	ResourceState_Present = 1 << 6
+};
+
+typedef std::uint32_t FrameGraphResource;
+static const FrameGraphResource InvalidFrameGraphResource = 0xffffffff;
+
+struct FrameGraphBarrier {
+	enum class Type : std::uint8_t { Transition, Aliasing };
+
+	Type BarrierType = Type::Transition;
+	FrameGraphResource Resource = InvalidFrameGraphResource;
+	// Aliasing barriers: the transient that used the memory before Resource.
+	FrameGraphResource AliasBefore = InvalidFrameGraphResource;
+	std::uint32_t StateBefore = ResourceState_Common;
+	std::uint32_t StateAfter = ResourceState_Common;
+};
+
+struct FrameGraphStats {
+	std::uint32_t PassCount = 0;
+	std::uint32_t CulledPassCount = 0;
+	std::uint32_t BarrierCount = 0;
+	// Number of ResourceBarrier calls once barriers are batched per pass.
+	std::uint32_t BarrierBatchCount = 0;
+	// Transient memory with one allocation per resource, and with aliasing.
+	std::uint64_t TransientBytes = 0;
+	std::uint64_t AliasedTransientBytes = 0;
+};
+
+// Small frame graph: passes declare what they read and write, Compile() drops
+// passes whose output is never used, computes the barriers each pass needs and
+// packs transient resources with disjoint lifetimes into the same memory.
+// Passes run in the order they were added.
+class FrameGraph {
+public:
+	class PassBuilder {
+	public:
+		void Read(FrameGraphResource resource, std::uint32_t state);
+		void Write(FrameGraphResource resource, std::uint32_t state);
+		// Keeps the pass even when nothing reads its output.
+		void SideEffect();
+
+	private:
+		friend class FrameGraph;
+		PassBuilder(FrameGraph* graph, std::uint32_t pass) : m_graph(graph), m_pass(pass) {}
+
+		FrameGraph* m_graph;
+		std::uint32_t m_pass;
+	};
+
+	// Imported resources live outside the graph. They are never culled away and
+	// are moved to finalState at the end of the frame.
+	FrameGraphResource ImportResource(const std::string& name, std::uint32_t initialState, std::uint32_t finalState, void* external = nullptr);
+	void SetImportedResource(FrameGraphResource resource, void* external);
+
+	// Transient resources only live inside the frame and can share memory.
+	FrameGraphResource CreateTransient(const std::string& name, std::uint64_t sizeInBytes, std::uint64_t alignment);
+
+	std::uint32_t AddPass(const std::string& name, const std::function<void(PassBuilder&)>& setup, const std::function<void()>& execute);
+
+	void Compile();
+
+	// Runs the live passes, calling issueBarriers once per batch.
+	void Execute(const std::function<void(const FrameGraphBarrier* barriers, std::uint32_t count)>& issueBarriers) const;
+
+	void* GetExternal(FrameGraphResource resource) const { return m_resources[resource].External; }
+	const std::string& GetResourceName(FrameGraphResource resource) const { return m_resources[resource].Name; }
+	std::uint64_t GetHeapOffset(FrameGraphResource resource) const { return m_resources[resource].HeapOffset; }
+	bool IsPassCulled(std::uint32_t pass) const { return m_passes[pass].Culled; }
+	const FrameGraphStats& Stats() const { return m_stats; }
+
+private:
+	struct Access {
+		FrameGraphResource Resource;
+		std::uint32_t State;
+		bool IsWrite;
+	};
+
+	struct ResourceNode {
+		std::string Name;
+		bool Imported = false;
+		void* External = nullptr;
+		std::uint32_t InitialState = ResourceState_Common;
+		std::uint32_t FinalState = ResourceState_Common;
+		std::uint64_t SizeInBytes = 0;
+		std::uint64_t Alignment = 1;
+		std::uint64_t HeapOffset = 0;
+		// First and last step of the schedule that use the resource.
+		std::uint32_t FirstUse = 0xffffffff;
+		std::uint32_t LastUse = 0;
+	};
+
+	struct PassNode {
+		std::string Name;
+		std::vector<Access> Accesses;
+		std::function<void()> Execute;
+		bool HasSideEffect = false;
+		bool Culled = false;
+	};
+
+	struct Step {
+		std::uint32_t Pass;
+		std::uint32_t FirstBarrier;
+		std::uint32_t BarrierCount;
+	};
+
+	void AddAccess(std::uint32_t pass, FrameGraphResource resource, std::uint32_t state, bool isWrite);
+	void CullPasses();
+	void AllocateTransients(std::vector<FrameGraphBarrier>& aliasingBarriers, std::vector<std::uint32_t>& aliasingStep);
+
+	std::vector<ResourceNode> m_resources;
+	std::vector<PassNode> m_passes;
+
+	std::vector<Step> m_schedule;
+	std::vector<FrameGraphBarrier> m_barriers;
+	std::uint32_t m_finalBarrierStart = 0;
+	FrameGraphStats m_stats;
+};
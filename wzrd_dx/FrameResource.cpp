@@ -1,14 +1,34 @@
 #include "FrameResource.h"
 
-FrameResource::FrameResource(ID3D12Device* device, UINT passCount, UINT objectCount, UINT materialCount,UINT waveVertCount)
+FrameResource::FrameResource(ID3D12Device* device, UINT passCount, UINT objectCount, UINT materialCount,UINT waveVertCount, UINT workerCount)
 {
 	ThrowIfFailed(device->CreateCommandAllocator(
 		D3D12_COMMAND_LIST_TYPE_DIRECT,
 		IID_PPV_ARGS(CmdListAlloc.GetAddressOf())));
 
+	WorkerCmdListAllocs.resize(workerCount);
+	WorkerCmdLists.resize(workerCount);
+	for (UINT i = 0; i < workerCount; ++i)
+	{
+		ThrowIfFailed(device->CreateCommandAllocator(
+			D3D12_COMMAND_LIST_TYPE_DIRECT,
+			IID_PPV_ARGS(WorkerCmdListAllocs[i].GetAddressOf())));
+
+		ThrowIfFailed(device->CreateCommandList(
+			0,
+			D3D12_COMMAND_LIST_TYPE_DIRECT,
+			WorkerCmdListAllocs[i].Get(),
+			nullptr,
+			IID_PPV_ARGS(WorkerCmdLists[i].GetAddressOf())));
+
+		// Closed so render() can reset it like the main list.
+		WorkerCmdLists[i]->Close();
+	}
+
 	PassCB = std::make_unique<UploadBuffer<PassConstants>>(device, passCount, true);
 	ObjectCB = std::make_unique<UploadBuffer<AbstractRenderer::ObjectConstants>>(device, objectCount, true);
 	MaterialCB = std::make_unique<UploadBuffer<MaterialConstants>>(device, materialCount, true);
+	InstanceBuffer = std::make_unique<UploadBuffer<InstanceData>>(device, objectCount, false);
 	ParticlesVB = std::make_unique<UploadBuffer<TestSpriteVertex>>(device, 1, false);
 	WavesVB = std::make_unique<UploadBuffer<AbstractRenderer::Vertex2>>(device, waveVertCount, false);
 }
@@ -30,13 +30,24 @@ struct PassConstants
 	float gFogRange = 150.0f;
 	DirectX::XMFLOAT2 cbPerObjectPad2;
 	Light Lights[MaxLights];
+	// Flattens geometry onto a plane as seen from a light. Only used by the
+	// planar shadow passes.
+	DirectX::XMFLOAT4X4 ShadowTransform = MathHelper::Identity4x4();
+};
+
+// Per-instance data read by the instanced vertex shader through SV_InstanceID.
+// Matches InstanceData in Default.hlsl.
+struct InstanceData
+{
+	DirectX::XMFLOAT4X4 World = MathHelper::Identity4x4();
+	DirectX::XMFLOAT4X4 TexTransform = MathHelper::Identity4x4();
 };
 
 // Stores the resources needed for the CPU to build the command lists for a frame.  
 struct FrameResource
 {
 public:
-	FrameResource(ID3D12Device* device, UINT passCount, UINT objectCount, UINT materialCount ,UINT waveVertCount);
+	FrameResource(ID3D12Device* device, UINT passCount, UINT objectCount, UINT materialCount ,UINT waveVertCount, UINT workerCount = 0);
 	FrameResource(ID3D12Device* device, UINT passCount, UINT objectCount, UINT materialCount);
 	FrameResource(const FrameResource& rhs) = delete;
 	FrameResource& operator=(const FrameResource& rhs) = delete;
@@ -46,11 +57,17 @@ public:
 	// So each frame needs their own allocator.
 	Microsoft::WRL::ComPtr<ID3D12CommandAllocator> CmdListAlloc;
 
+	// One allocator and list per recording thread. The lists are created closed.
+	std::vector<Microsoft::WRL::ComPtr<ID3D12CommandAllocator>> WorkerCmdListAllocs;
+	std::vector<Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList>> WorkerCmdLists;
+
 	// We cannot update a cbuffer until the GPU is done processing the commands
 	// that reference it.  So each frame needs their own cbuffers.
 	std::unique_ptr<UploadBuffer<PassConstants>> PassCB = nullptr;
 	std::unique_ptr<UploadBuffer<AbstractRenderer::ObjectConstants>> ObjectCB = nullptr;
 	std::unique_ptr<UploadBuffer<MaterialConstants>> MaterialCB = nullptr;
+	// Structured buffer holding the instances of every batched draw, one slot per object.
+	std::unique_ptr<UploadBuffer<InstanceData>> InstanceBuffer = nullptr;
 	// We cannot update a dynamic vertex buffer until the GPU is done processing
 	// the commands that reference it.  So each frame needs their own.
 	std::unique_ptr<UploadBuffer<AbstractRenderer::Vertex2>> WavesVB = nullptr;
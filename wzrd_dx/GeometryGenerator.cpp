@@ -3,275 +3,168 @@
 //***************************************************************************************
 
 #include "GeometryGenerator.h"
+#include "PrimitiveTables.h"
+#include "ThreadPool.h"
 #include <algorithm>
+#include <functional>
 
 using namespace DirectX;
 
-GeometryGenerator::MeshData GeometryGenerator::CreateBox(float width, float height, float depth, uint32 numSubdivisions)
-{
-	MeshData meshData;
-
-	//
-	// Create the vertices.
-	//
-
-	Vertex v[24];
-
-	float w2 = 0.5f*width;
-	float h2 = 0.5f*height;
-	float d2 = 0.5f*depth;
-
-	// Fill in the front face vertex data.
-	v[0] = Vertex(-w2, -h2, -d2, 0.0f, 0.0f, -1.0f, 1.0f, 0.0f, 0.0f, 0.0f, 1.0f);
-	v[1] = Vertex(-w2, +h2, -d2, 0.0f, 0.0f, -1.0f, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f);
-	v[2] = Vertex(+w2, +h2, -d2, 0.0f, 0.0f, -1.0f, 1.0f, 0.0f, 0.0f, 1.0f, 0.0f);
-	v[3] = Vertex(+w2, -h2, -d2, 0.0f, 0.0f, -1.0f, 1.0f, 0.0f, 0.0f, 1.0f, 1.0f);
-
-	// Fill in the back face vertex data.
-	v[4] = Vertex(-w2, -h2, +d2, 0.0f, 0.0f, 1.0f, -1.0f, 0.0f, 0.0f, 1.0f, 1.0f);
-	v[5] = Vertex(+w2, -h2, +d2, 0.0f, 0.0f, 1.0f, -1.0f, 0.0f, 0.0f, 0.0f, 1.0f);
-	v[6] = Vertex(+w2, +h2, +d2, 0.0f, 0.0f, 1.0f, -1.0f, 0.0f, 0.0f, 0.0f, 0.0f);
-	v[7] = Vertex(-w2, +h2, +d2, 0.0f, 0.0f, 1.0f, -1.0f, 0.0f, 0.0f, 1.0f, 0.0f);
+namespace {
 
-	// Fill in the top face vertex data.
-	v[8] = Vertex(-w2, +h2, -d2, 0.0f, 1.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 1.0f);
-	v[9] = Vertex(-w2, +h2, +d2, 0.0f, 1.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f);
-	v[10] = Vertex(+w2, +h2, +d2, 0.0f, 1.0f, 0.0f, 1.0f, 0.0f, 0.0f, 1.0f, 0.0f);
-	v[11] = Vertex(+w2, +h2, -d2, 0.0f, 1.0f, 0.0f, 1.0f, 0.0f, 0.0f, 1.0f, 1.0f);
-
-	// Fill in the bottom face vertex data.
-	v[12] = Vertex(-w2, -h2, -d2, 0.0f, -1.0f, 0.0f, -1.0f, 0.0f, 0.0f, 1.0f, 1.0f);
-	v[13] = Vertex(+w2, -h2, -d2, 0.0f, -1.0f, 0.0f, -1.0f, 0.0f, 0.0f, 0.0f, 1.0f);
-	v[14] = Vertex(+w2, -h2, +d2, 0.0f, -1.0f, 0.0f, -1.0f, 0.0f, 0.0f, 0.0f, 0.0f);
-	v[15] = Vertex(-w2, -h2, +d2, 0.0f, -1.0f, 0.0f, -1.0f, 0.0f, 0.0f, 1.0f, 0.0f);
-
-	// Fill in the left face vertex data.
-	v[16] = Vertex(-w2, -h2, +d2, -1.0f, 0.0f, 0.0f, 0.0f, 0.0f, -1.0f, 0.0f, 1.0f);
-	v[17] = Vertex(-w2, +h2, +d2, -1.0f, 0.0f, 0.0f, 0.0f, 0.0f, -1.0f, 0.0f, 0.0f);
-	v[18] = Vertex(-w2, +h2, -d2, -1.0f, 0.0f, 0.0f, 0.0f, 0.0f, -1.0f, 1.0f, 0.0f);
-	v[19] = Vertex(-w2, -h2, -d2, -1.0f, 0.0f, 0.0f, 0.0f, 0.0f, -1.0f, 1.0f, 1.0f);
-
-	// Fill in the right face vertex data.
-	v[20] = Vertex(+w2, -h2, -d2, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 1.0f);
-	v[21] = Vertex(+w2, +h2, -d2, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f);
-	v[22] = Vertex(+w2, +h2, +d2, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 1.0f, 0.0f);
-	v[23] = Vertex(+w2, -h2, +d2, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 1.0f, 1.0f);
+// Calls fn on contiguous ranges covering [0, count), spread over the thread
+// pool when there is one and the work is worth splitting.
+void ForEachRange(ThreadPool* threadPool, GeometryGenerator::uint32 count,
+	const std::function<void(GeometryGenerator::uint32, GeometryGenerator::uint32)>& fn)
+{
+	const GeometryGenerator::uint32 minRangeSize = 4096;
+	if (!threadPool || count <= minRangeSize)
+	{
+		fn(0, count);
+		return;
+	}
 
-	meshData.Vertices.assign(&v[0], &v[24]);
+	GeometryGenerator::uint32 rangeCount = std::min<GeometryGenerator::uint32>(threadPool->Concurrency() * 4, (count + minRangeSize - 1) / minRangeSize);
+	threadPool->ParallelFor(rangeCount, [&](GeometryGenerator::uint32 r) {
+		fn((GeometryGenerator::uint32)((std::uint64_t)count * r / rangeCount), (GeometryGenerator::uint32)((std::uint64_t)count * (r + 1) / rangeCount));
+	});
+}
 
-	//
-	// Create the indices.
-	//
+}
 
-	uint32 i[36];
+GeometryGenerator::MeshData GeometryGenerator::CreateBox(float width, float height, float depth, uint32 numSubdivisions)
+{
+	MeshData meshData;
 
-	// Fill in the front face index data
-	i[0] = 0; i[1] = 1; i[2] = 2;
-	i[3] = 0; i[4] = 2; i[5] = 3;
+	MeshSize size = BoxSize(numSubdivisions);
+	meshData.Vertices.resize(size.VertexCount);
+	meshData.Indices32.resize(size.IndexCount);
 
-	// Fill in the back face index data
-	i[6] = 4; i[7] = 5; i[8] = 6;
-	i[9] = 4; i[10] = 6; i[11] = 7;
+	WriteBox(width, height, depth, numSubdivisions, [&meshData](uint32 i, const Vertex& v) { meshData.Vertices[i] = v; }, meshData.Indices32.data());
 
-	// Fill in the top face index data
-	i[12] = 8; i[13] = 9; i[14] = 10;
-	i[15] = 8; i[16] = 10; i[17] = 11;
+	return meshData;
+}
 
-	// Fill in the bottom face index data
-	i[18] = 12; i[19] = 13; i[20] = 14;
-	i[21] = 12; i[22] = 14; i[23] = 15;
+void GeometryGenerator::BoxFaceCorners(float width, float height, float depth, Vertex corners[24])
+{
+	// Four corners per face, in the order of the face's two triangles
+	// (c0, c1, c2) and (c0, c2, c3).
 
-	// Fill in the left face index data
-	i[24] = 16; i[25] = 17; i[26] = 18;
-	i[27] = 16; i[28] = 18; i[29] = 19;
+	float w2 = 0.5f*width;
+	float h2 = 0.5f*height;
+	float d2 = 0.5f*depth;
 
-	// Fill in the right face index data
-	i[30] = 20; i[31] = 21; i[32] = 22;
-	i[33] = 20; i[34] = 22; i[35] = 23;
+	for (uint32 i = 0; i < 24; ++i)
+	{
+		const BoxCorner& c = UnitBoxCorners[i];
+		corners[i] = Vertex(
+			c.X * w2, c.Y * h2, c.Z * d2,
+			c.NormalX, c.NormalY, c.NormalZ,
+			c.TangentX, c.TangentY, c.TangentZ,
+			c.U, c.V);
+	}
+}
 
-	meshData.Indices32.assign(&i[0], &i[36]);
+GeometryGenerator::MeshData GeometryGenerator::CreateSphere(float radius, uint32 sliceCount, uint32 stackCount)
+{
+	MeshData meshData;
 
-	// Put a cap on the number of subdivisions.
-	numSubdivisions = std::min<uint32>(numSubdivisions, 6u);
+	MeshSize size = SphereSize(sliceCount, stackCount);
+	meshData.Vertices.resize(size.VertexCount);
+	meshData.Indices32.resize(size.IndexCount);
 
-	for (uint32 i = 0; i < numSubdivisions; ++i)
-		Subdivide(meshData);
+	WriteSphere(radius, sliceCount, stackCount, [&meshData](uint32 i, const Vertex& v) { meshData.Vertices[i] = v; }, meshData.Indices32.data());
 
 	return meshData;
 }
 
-GeometryGenerator::MeshData GeometryGenerator::CreateSphere(float radius, uint32 sliceCount, uint32 stackCount)
+void GeometryGenerator::Subdivide(MeshData& meshData, ThreadPool* threadPool)
 {
-	MeshData meshData;
+	//       v1
+	//       *
+	//      / \
+	//     /   \
+	//  m0*-----*m1
+	//   / \   / \
+	//  /   \ /   \
+	// *-----*-----*
+	// v0    m2     v2
 
-	//
-	// Compute the vertices stating at the top pole and moving down the stacks.
-	//
+	// Every edge gets one midpoint, shared by the triangles on both sides. The
+	// existing vertices keep their indices and the midpoints are appended in the
+	// order their edges are first seen.
+	uint32 numVertices = (uint32)meshData.Vertices.size();
+	uint32 numTris = (uint32)meshData.Indices32.size() / 3;
 
-	// Poles: note that there will be texture coordinate distortion as there is
-	// not a unique point on the texture map to assign to the pole when mapping
-	// a rectangular texture onto a sphere.
-	Vertex topVertex(0.0f, +radius, 0.0f, 0.0f, +1.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f);
-	Vertex bottomVertex(0.0f, -radius, 0.0f, 0.0f, -1.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 1.0f);
+	// Open addressing table from edge to midpoint, at most half full. An edge
+	// is probed from a slot picked by its lower vertex, so the lookups of nearby
+	// triangles stay in the same part of the table.
+	size_t tableSize = 16;
+	while (tableSize < 6 * (size_t)numTris || tableSize < 8 * (size_t)numVertices)
+		tableSize <<= 1;
 
-	meshData.Vertices.push_back(topVertex);
+	const std::uint64_t emptyKey = ~0ull;
+	std::vector<std::uint64_t> keys(tableSize, emptyKey);
+	std::vector<uint32> values(tableSize);
 
-	float phiStep = XM_PI / stackCount;
-	float thetaStep = 2.0f*XM_PI / sliceCount;
+	std::vector<uint32> midpoints(3 * (size_t)numTris);
+	std::vector<uint32> edgeVertices;
+	edgeVertices.reserve(6 * (size_t)numTris);
 
-	// Compute vertices for each stack ring (do not count the poles as rings).
-	for (uint32 i = 1; i <= stackCount - 1; ++i)
+	for (uint32 i = 0; i < numTris; ++i)
 	{
-		float phi = i * phiStep;
-
-		// Vertices of ring.
-		for (uint32 j = 0; j <= sliceCount; ++j)
+		for (uint32 e = 0; e < 3; ++e)
 		{
-			float theta = j * thetaStep;
-
-			Vertex v;
-
-			// spherical to cartesian
-			v.Position.x = radius * sinf(phi)*cosf(theta);
-			v.Position.y = radius * cosf(phi);
-			v.Position.z = radius * sinf(phi)*sinf(theta);
-
-			// Partial derivative of P with respect to theta
-			v.TangentU.x = -radius * sinf(phi)*sinf(theta);
-			v.TangentU.y = 0.0f;
-			v.TangentU.z = +radius * sinf(phi)*cosf(theta);
-
-			XMVECTOR T = XMLoadFloat3(&v.TangentU);
-			XMStoreFloat3(&v.TangentU, XMVector3Normalize(T));
-
-			XMVECTOR p = XMLoadFloat3(&v.Position);
-			XMStoreFloat3(&v.Normal, XMVector3Normalize(p));
-
-			v.TexC.x = theta / XM_2PI;
-			v.TexC.y = phi / XM_PI;
-
-			meshData.Vertices.push_back(v);
+			uint32 a = meshData.Indices32[i * 3 + e];
+			uint32 b = meshData.Indices32[i * 3 + (e + 1) % 3];
+			std::uint64_t key = a < b ? ((std::uint64_t)a << 32) | b : ((std::uint64_t)b << 32) | a;
+
+			size_t slot = ((size_t)std::min(a, b) * 8) & (tableSize - 1);
+			while (keys[slot] != emptyKey && keys[slot] != key)
+				slot = (slot + 1) & (tableSize - 1);
+
+			if (keys[slot] == emptyKey)
+			{
+				keys[slot] = key;
+				values[slot] = numVertices + (uint32)(edgeVertices.size() / 2);
+				edgeVertices.push_back(a);
+				edgeVertices.push_back(b);
+			}
+
+			midpoints[i * 3 + e] = values[slot];
 		}
 	}
 
-	meshData.Vertices.push_back(bottomVertex);
-
-	//
-	// Compute indices for top stack.  The top stack was written first to the vertex buffer
-	// and connects the top pole to the first ring.
-	//
+	uint32 numEdges = (uint32)(edgeVertices.size() / 2);
+	meshData.Vertices.resize(numVertices + numEdges);
 
-	for (uint32 i = 1; i <= sliceCount; ++i)
-	{
-		meshData.Indices32.push_back(0);
-		meshData.Indices32.push_back(i + 1);
-		meshData.Indices32.push_back(i);
-	}
+	ForEachRange(threadPool, numEdges, [&](uint32 begin, uint32 end) {
+		for (uint32 e = begin; e < end; ++e)
+			meshData.Vertices[numVertices + e] = MidPoint(meshData.Vertices[edgeVertices[e * 2]], meshData.Vertices[edgeVertices[e * 2 + 1]]);
+	});
 
-	//
-	// Compute indices for inner stacks (not connected to poles).
-	//
+	std::vector<uint32> indices(12 * (size_t)numTris);
 
-	// Offset the indices to the index of the first vertex in the first ring.
-	// This is just skipping the top pole vertex.
-	uint32 baseIndex = 1;
-	uint32 ringVertexCount = sliceCount + 1;
-	for (uint32 i = 0; i < stackCount - 2; ++i)
-	{
-		for (uint32 j = 0; j < sliceCount; ++j)
+	ForEachRange(threadPool, numTris, [&](uint32 begin, uint32 end) {
+		for (uint32 i = begin; i < end; ++i)
 		{
-			meshData.Indices32.push_back(baseIndex + i * ringVertexCount + j);
-			meshData.Indices32.push_back(baseIndex + i * ringVertexCount + j + 1);
-			meshData.Indices32.push_back(baseIndex + (i + 1)*ringVertexCount + j);
-
-			meshData.Indices32.push_back(baseIndex + (i + 1)*ringVertexCount + j);
-			meshData.Indices32.push_back(baseIndex + i * ringVertexCount + j + 1);
-			meshData.Indices32.push_back(baseIndex + (i + 1)*ringVertexCount + j + 1);
+			uint32 v0 = meshData.Indices32[i * 3 + 0];
+			uint32 v1 = meshData.Indices32[i * 3 + 1];
+			uint32 v2 = meshData.Indices32[i * 3 + 2];
+
+			uint32 m0 = midpoints[i * 3 + 0];
+			uint32 m1 = midpoints[i * 3 + 1];
+			uint32 m2 = midpoints[i * 3 + 2];
+
+			uint32* out = &indices[i * 12];
+			out[0] = v0; out[1] = m0;  out[2] = m2;
+			out[3] = m0; out[4] = m1;  out[5] = m2;
+			out[6] = m2; out[7] = m1;  out[8] = v2;
+			out[9] = m0; out[10] = v1; out[11] = m1;
 		}
-	}
-
-	//
-	// Compute indices for bottom stack.  The bottom stack was written last to the vertex buffer
-	// and connects the bottom pole to the bottom ring.
-	//
-
-	// South pole vertex was added last.
-	uint32 southPoleIndex = (uint32)meshData.Vertices.size() - 1;
+	});
 
-	// Offset the indices to the index of the first vertex in the last ring.
-	baseIndex = southPoleIndex - ringVertexCount;
-
-	for (uint32 i = 0; i < sliceCount; ++i)
-	{
-		meshData.Indices32.push_back(southPoleIndex);
-		meshData.Indices32.push_back(baseIndex + i);
-		meshData.Indices32.push_back(baseIndex + i + 1);
-	}
-
-	return meshData;
-}
-
-void GeometryGenerator::Subdivide(MeshData& meshData)
-{
-	// Save a copy of the input geometry.
-	MeshData inputCopy = meshData;
-
-
-	meshData.Vertices.resize(0);
-	meshData.Indices32.resize(0);
-
-	//       v1
-	//       *
-	//      / \
-		//     /   \
-	//  m0*-----*m1
-//   / \   / \
-	//  /   \ /   \
-	// *-----*-----*
-// v0    m2     v2
-
-	uint32 numTris = (uint32)inputCopy.Indices32.size() / 3;
-	for (uint32 i = 0; i < numTris; ++i)
-	{
-		Vertex v0 = inputCopy.Vertices[inputCopy.Indices32[i * 3 + 0]];
-		Vertex v1 = inputCopy.Vertices[inputCopy.Indices32[i * 3 + 1]];
-		Vertex v2 = inputCopy.Vertices[inputCopy.Indices32[i * 3 + 2]];
-
-		//
-		// Generate the midpoints.
-		//
-
-		Vertex m0 = MidPoint(v0, v1);
-		Vertex m1 = MidPoint(v1, v2);
-		Vertex m2 = MidPoint(v0, v2);
-
-		//
-		// Add new geometry.
-		//
-
-		meshData.Vertices.push_back(v0); // 0
-		meshData.Vertices.push_back(v1); // 1
-		meshData.Vertices.push_back(v2); // 2
-		meshData.Vertices.push_back(m0); // 3
-		meshData.Vertices.push_back(m1); // 4
-		meshData.Vertices.push_back(m2); // 5
-
-		meshData.Indices32.push_back(i * 6 + 0);
-		meshData.Indices32.push_back(i * 6 + 3);
-		meshData.Indices32.push_back(i * 6 + 5);
-
-		meshData.Indices32.push_back(i * 6 + 3);
-		meshData.Indices32.push_back(i * 6 + 4);
-		meshData.Indices32.push_back(i * 6 + 5);
-
-		meshData.Indices32.push_back(i * 6 + 5);
-		meshData.Indices32.push_back(i * 6 + 4);
-		meshData.Indices32.push_back(i * 6 + 2);
-
-		meshData.Indices32.push_back(i * 6 + 3);
-		meshData.Indices32.push_back(i * 6 + 1);
-		meshData.Indices32.push_back(i * 6 + 4);
-	}
+	meshData.Indices32.swap(indices);
 }
 
 GeometryGenerator::Vertex GeometryGenerator::MidPoint(const Vertex& v0, const Vertex& v1)
@@ -304,12 +197,12 @@ GeometryGenerator::Vertex GeometryGenerator::MidPoint(const Vertex& v0, const Ve
 	return v;
 }
 
-GeometryGenerator::MeshData GeometryGenerator::CreateGeosphere(float radius, uint32 numSubdivisions)
+GeometryGenerator::MeshData GeometryGenerator::CreateGeosphere(float radius, uint32 numSubdivisions, ThreadPool* threadPool)
 {
 	MeshData meshData;
 
 	// Put a cap on the number of subdivisions.
-	numSubdivisions = std::min<uint32>(numSubdivisions, 6u);
+	numSubdivisions = std::min<uint32>(numSubdivisions, MaxGeosphereSubdivisions);
 
 	// Approximate a sphere by tessellating an icosahedron.
 
@@ -341,40 +234,42 @@ GeometryGenerator::MeshData GeometryGenerator::CreateGeosphere(float radius, uin
 		meshData.Vertices[i].Position = pos[i];
 
 	for (uint32 i = 0; i < numSubdivisions; ++i)
-		Subdivide(meshData);
+		Subdivide(meshData, threadPool);
 
 	// Project vertices onto sphere and scale.
-	for (uint32 i = 0; i < meshData.Vertices.size(); ++i)
-	{
-		// Project onto unit sphere.
-		XMVECTOR n = XMVector3Normalize(XMLoadFloat3(&meshData.Vertices[i].Position));
+	ForEachRange(threadPool, (uint32)meshData.Vertices.size(), [&](uint32 begin, uint32 end) {
+		for (uint32 i = begin; i < end; ++i)
+		{
+			// Project onto unit sphere.
+			XMVECTOR n = XMVector3Normalize(XMLoadFloat3(&meshData.Vertices[i].Position));
 
-		// Project onto sphere.
-		XMVECTOR p = radius * n;
+			// Project onto sphere.
+			XMVECTOR p = radius * n;
 
-		XMStoreFloat3(&meshData.Vertices[i].Position, p);
-		XMStoreFloat3(&meshData.Vertices[i].Normal, n);
+			XMStoreFloat3(&meshData.Vertices[i].Position, p);
+			XMStoreFloat3(&meshData.Vertices[i].Normal, n);
 
-		// Derive texture coordinates from spherical coordinates.
-		float theta = atan2f(meshData.Vertices[i].Position.z, meshData.Vertices[i].Position.x);
+			// Derive texture coordinates from spherical coordinates.
+			float theta = atan2f(meshData.Vertices[i].Position.z, meshData.Vertices[i].Position.x);
 
-		// Put in [0, 2pi].
-		if (theta < 0.0f)
-			theta += XM_2PI;
+			// Put in [0, 2pi].
+			if (theta < 0.0f)
+				theta += XM_2PI;
 
-		float phi = acosf(meshData.Vertices[i].Position.y / radius);
+			float phi = acosf(meshData.Vertices[i].Position.y / radius);
 
-		meshData.Vertices[i].TexC.x = theta / XM_2PI;
-		meshData.Vertices[i].TexC.y = phi / XM_PI;
+			meshData.Vertices[i].TexC.x = theta / XM_2PI;
+			meshData.Vertices[i].TexC.y = phi / XM_PI;
 
-		// Partial derivative of P with respect to theta
-		meshData.Vertices[i].TangentU.x = -radius * sinf(phi)*sinf(theta);
-		meshData.Vertices[i].TangentU.y = 0.0f;
-		meshData.Vertices[i].TangentU.z = +radius * sinf(phi)*cosf(theta);
+			// Partial derivative of P with respect to theta
+			meshData.Vertices[i].TangentU.x = -radius * sinf(phi)*sinf(theta);
+			meshData.Vertices[i].TangentU.y = 0.0f;
+			meshData.Vertices[i].TangentU.z = +radius * sinf(phi)*cosf(theta);
 
-		XMVECTOR T = XMLoadFloat3(&meshData.Vertices[i].TangentU);
-		XMStoreFloat3(&meshData.Vertices[i].TangentU, XMVector3Normalize(T));
-	}
+			XMVECTOR T = XMLoadFloat3(&meshData.Vertices[i].TangentU);
+			XMStoreFloat3(&meshData.Vertices[i].TangentU, XMVector3Normalize(T));
+		}
+	});
 
 	return meshData;
 }
@@ -383,232 +278,25 @@ GeometryGenerator::MeshData GeometryGenerator::CreateCylinder(float bottomRadius
 {
 	MeshData meshData;
 
-	//
-	// Build Stacks.
-	// 
-
-	float stackHeight = height / stackCount;
-
-	// Amount to increment radius as we move up each stack level from bottom to top.
-	float radiusStep = (topRadius - bottomRadius) / stackCount;
-
-	uint32 ringCount = stackCount + 1;
-
-	// Compute vertices for each stack ring starting at the bottom and moving up.
-	for (uint32 i = 0; i < ringCount; ++i)
-	{
-		float y = -0.5f*height + i * stackHeight;
-		float r = bottomRadius + i * radiusStep;
+	MeshSize size = CylinderSize(sliceCount, stackCount);
+	meshData.Vertices.resize(size.VertexCount);
+	meshData.Indices32.resize(size.IndexCount);
 
-		// vertices of ring
-		float dTheta = 2.0f*XM_PI / sliceCount;
-		for (uint32 j = 0; j <= sliceCount; ++j)
-		{
-			Vertex vertex;
-
-			float c = cosf(j*dTheta);
-			float s = sinf(j*dTheta);
-
-			vertex.Position = XMFLOAT3(r*c, y, r*s);
-
-			vertex.TexC.x = (float)j / sliceCount;
-			vertex.TexC.y = 1.0f - (float)i / stackCount;
-
-			// Cylinder can be parameterized as follows, where we introduce v
-			// parameter that goes in the same direction as the v tex-coord
-			// so that the bitangent goes in the same direction as the v tex-coord.
-			//   Let r0 be the bottom radius and let r1 be the top radius.
-			//   y(v) = h - hv for v in [0,1].
-			//   r(v) = r1 + (r0-r1)v
-			//
-			//   x(t, v) = r(v)*cos(t)
-			//   y(t, v) = h - hv
-			//   z(t, v) = r(v)*sin(t)
-			// 
-			//  dx/dt = -r(v)*sin(t)
-			//  dy/dt = 0
-			//  dz/dt = +r(v)*cos(t)
-			//
-			//  dx/dv = (r0-r1)*cos(t)
-			//  dy/dv = -h
-			//  dz/dv = (r0-r1)*sin(t)
-
-			// This is unit length.
-			vertex.TangentU = XMFLOAT3(-s, 0.0f, c);
-
-			float dr = bottomRadius - topRadius;
-			XMFLOAT3 bitangent(dr*c, -height, dr*s);
-
-			XMVECTOR T = XMLoadFloat3(&vertex.TangentU);
-			XMVECTOR B = XMLoadFloat3(&bitangent);
-			XMVECTOR N = XMVector3Normalize(XMVector3Cross(T, B));
-			XMStoreFloat3(&vertex.Normal, N);
-
-			meshData.Vertices.push_back(vertex);
-		}
-	}
-
-	// Add one because we duplicate the first and last vertex per ring
-	// since the texture coordinates are different.
-	uint32 ringVertexCount = sliceCount + 1;
-
-	// Compute indices for each stack.
-	for (uint32 i = 0; i < stackCount; ++i)
-	{
-		for (uint32 j = 0; j < sliceCount; ++j)
-		{
-			meshData.Indices32.push_back(i*ringVertexCount + j);
-			meshData.Indices32.push_back((i + 1)*ringVertexCount + j);
-			meshData.Indices32.push_back((i + 1)*ringVertexCount + j + 1);
-
-			meshData.Indices32.push_back(i*ringVertexCount + j);
-			meshData.Indices32.push_back((i + 1)*ringVertexCount + j + 1);
-			meshData.Indices32.push_back(i*ringVertexCount + j + 1);
-		}
-	}
-
-	BuildCylinderTopCap(bottomRadius, topRadius, height, sliceCount, stackCount, meshData);
-	BuildCylinderBottomCap(bottomRadius, topRadius, height, sliceCount, stackCount, meshData);
+	WriteCylinder(bottomRadius, topRadius, height, sliceCount, stackCount,
+		[&meshData](uint32 i, const Vertex& v) { meshData.Vertices[i] = v; }, meshData.Indices32.data());
 
 	return meshData;
 }
 
-void GeometryGenerator::BuildCylinderTopCap(float bottomRadius, float topRadius, float height,
-	uint32 sliceCount, uint32 stackCount, MeshData& meshData)
-{
-	uint32 baseIndex = (uint32)meshData.Vertices.size();
-
-	float y = 0.5f*height;
-	float dTheta = 2.0f*XM_PI / sliceCount;
-
-	// Duplicate cap ring vertices because the texture coordinates and normals differ.
-	for (uint32 i = 0; i <= sliceCount; ++i)
-	{
-		float x = topRadius * cosf(i*dTheta);
-		float z = topRadius * sinf(i*dTheta);
-
-		// Scale down by the height to try and make top cap texture coord area
-		// proportional to base.
-		float u = x / height + 0.5f;
-		float v = z / height + 0.5f;
-
-		meshData.Vertices.push_back(Vertex(x, y, z, 0.0f, 1.0f, 0.0f, 1.0f, 0.0f, 0.0f, u, v));
-	}
-
-	// Cap center vertex.
-	meshData.Vertices.push_back(Vertex(0.0f, y, 0.0f, 0.0f, 1.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.5f, 0.5f));
-
-	// Index of center vertex.
-	uint32 centerIndex = (uint32)meshData.Vertices.size() - 1;
-
-	for (uint32 i = 0; i < sliceCount; ++i)
-	{
-		meshData.Indices32.push_back(centerIndex);
-		meshData.Indices32.push_back(baseIndex + i + 1);
-		meshData.Indices32.push_back(baseIndex + i);
-	}
-}
-
-void GeometryGenerator::BuildCylinderBottomCap(float bottomRadius, float topRadius, float height,
-	uint32 sliceCount, uint32 stackCount, MeshData& meshData)
-{
-	// 
-	// Build bottom cap.
-	//
-
-	uint32 baseIndex = (uint32)meshData.Vertices.size();
-	float y = -0.5f*height;
-
-	// vertices of ring
-	float dTheta = 2.0f*XM_PI / sliceCount;
-	for (uint32 i = 0; i <= sliceCount; ++i)
-	{
-		float x = bottomRadius * cosf(i*dTheta);
-		float z = bottomRadius * sinf(i*dTheta);
-
-		// Scale down by the height to try and make top cap texture coord area
-		// proportional to base.
-		float u = x / height + 0.5f;
-		float v = z / height + 0.5f;
-
-		meshData.Vertices.push_back(Vertex(x, y, z, 0.0f, -1.0f, 0.0f, 1.0f, 0.0f, 0.0f, u, v));
-	}
-
-	// Cap center vertex.
-	meshData.Vertices.push_back(Vertex(0.0f, y, 0.0f, 0.0f, -1.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.5f, 0.5f));
-
-	// Cache the index of center vertex.
-	uint32 centerIndex = (uint32)meshData.Vertices.size() - 1;
-
-	for (uint32 i = 0; i < sliceCount; ++i)
-	{
-		meshData.Indices32.push_back(centerIndex);
-		meshData.Indices32.push_back(baseIndex + i);
-		meshData.Indices32.push_back(baseIndex + i + 1);
-	}
-}
-
 GeometryGenerator::MeshData GeometryGenerator::CreateGrid(float width, float depth, uint32 m, uint32 n)
 {
 	MeshData meshData;
 
-	uint32 vertexCount = m * n;
-	uint32 faceCount = (m - 1)*(n - 1) * 2;
-
-	//
-	// Create the vertices.
-	//
-
-	float halfWidth = 0.5f*width;
-	float halfDepth = 0.5f*depth;
-
-	float dx = width / (n - 1);
-	float dz = depth / (m - 1);
-
-	float du = 1.0f / (n - 1);
-	float dv = 1.0f / (m - 1);
-
-	meshData.Vertices.resize(vertexCount);
-	for (uint32 i = 0; i < m; ++i)
-	{
-		float z = halfDepth - i * dz;
-		for (uint32 j = 0; j < n; ++j)
-		{
-			float x = -halfWidth + j * dx;
-
-			meshData.Vertices[i*n + j].Position = XMFLOAT3(x, 0.0f, z);
-			meshData.Vertices[i*n + j].Normal = XMFLOAT3(0.0f, 1.0f, 0.0f);
-			meshData.Vertices[i*n + j].TangentU = XMFLOAT3(1.0f, 0.0f, 0.0f);
-
-			// Stretch texture over grid.
-			meshData.Vertices[i*n + j].TexC.x = j * du;
-			meshData.Vertices[i*n + j].TexC.y = i * dv;
-		}
-	}
-
-	//
-	// Create the indices.
-	//
+	MeshSize size = GridSize(m, n);
+	meshData.Vertices.resize(size.VertexCount);
+	meshData.Indices32.resize(size.IndexCount);
 
-	meshData.Indices32.resize(faceCount * 3); // 3 indices per face
-
-											  // Iterate over each quad and compute indices.
-	uint32 k = 0;
-	for (uint32 i = 0; i < m - 1; ++i)
-	{
-		for (uint32 j = 0; j < n - 1; ++j)
-		{
-			meshData.Indices32[k] = i * n + j;
-			meshData.Indices32[k + 1] = i * n + j + 1;
-			meshData.Indices32[k + 2] = (i + 1)*n + j;
-
-			meshData.Indices32[k + 3] = (i + 1)*n + j;
-			meshData.Indices32[k + 4] = i * n + j + 1;
-			meshData.Indices32[k + 5] = (i + 1)*n + j + 1;
-
-			k += 6; // next quad
-		}
-	}
+	WriteGrid(width, depth, m, n, [&meshData](uint32 i, const Vertex& v) { meshData.Vertices[i] = v; }, meshData.Indices32.data());
 
 	return meshData;
 }
@@ -655,3 +343,40 @@ GeometryGenerator::MeshData GeometryGenerator::CreateQuad(float x, float y, floa
 
 	return meshData;
 }
+
+GeometryGenerator::MeshSize GeometryGenerator::BoxSize(uint32 numSubdivisions)
+{
+	uint32 segments = 1u << std::min<uint32>(numSubdivisions, MaxBoxSubdivisions);
+
+	MeshSize size;
+	size.VertexCount = 6 * (segments + 1) * (segments + 1);
+	size.IndexCount = 6 * segments * segments * 6;
+	return size;
+}
+
+GeometryGenerator::MeshSize GeometryGenerator::SphereSize(uint32 sliceCount, uint32 stackCount)
+{
+	// Two poles and stackCount - 1 rings; a fan at each pole and two triangles
+	// per slice in between.
+	MeshSize size;
+	size.VertexCount = 2 + (stackCount - 1) * (sliceCount + 1);
+	size.IndexCount = 6 * sliceCount * (stackCount - 1);
+	return size;
+}
+
+GeometryGenerator::MeshSize GeometryGenerator::CylinderSize(uint32 sliceCount, uint32 stackCount)
+{
+	// stackCount + 1 rings, plus a ring and a center vertex per cap.
+	MeshSize size;
+	size.VertexCount = (stackCount + 1) * (sliceCount + 1) + 2 * (sliceCount + 2);
+	size.IndexCount = 6 * sliceCount * stackCount + 2 * 3 * sliceCount;
+	return size;
+}
+
+GeometryGenerator::MeshSize GeometryGenerator::GridSize(uint32 m, uint32 n)
+{
+	MeshSize size;
+	size.VertexCount = m * n;
+	size.IndexCount = (m - 1) * (n - 1) * 6;
+	return size;
+}
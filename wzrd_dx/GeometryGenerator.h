@@ -14,10 +14,15 @@
 
 #pragma once
 
+#include <algorithm>
+#include <cassert>
+#include <cmath>
 #include <cstdint>
 #include <DirectXMath.h>
 #include <vector>
 
+class ThreadPool;
+
 class GeometryGenerator
 {
 public:
@@ -56,22 +61,8 @@ public:
 	struct MeshData
 	{
 		std::vector<Vertex> Vertices;
+		// Narrowed to 16 bits where they fit by IndexBufferBuilder.
 		std::vector<uint32> Indices32;
-
-		std::vector<uint16>& GetIndices16()
-		{
-			if (mIndices16.empty())
-			{
-				mIndices16.resize(Indices32.size());
-				for (size_t i = 0; i < Indices32.size(); ++i)
-					mIndices16[i] = static_cast<uint16>(Indices32[i]);
-			}
-
-			return mIndices16;
-		}
-
-	private:
-		std::vector<uint16> mIndices16;
 	};
 
 	///<summary>
@@ -88,9 +79,10 @@ public:
 
 	///<summary>
 	/// Creates a geosphere centered at the origin with the given radius.  The
-	/// depth controls the level of tessellation.
+	/// depth controls the level of tessellation, up to 9. With a thread pool the
+	/// per-vertex work of each level is split across its threads.
 	///</summary>
-	MeshData CreateGeosphere(float radius, uint32 numSubdivisions);
+	MeshData CreateGeosphere(float radius, uint32 numSubdivisions, ThreadPool* threadPool = nullptr);
 
 	///<summary>
 	/// Creates a cylinder parallel to the y-axis, and centered about the origin.  
@@ -110,10 +102,376 @@ public:
 	///</summary>
 	MeshData CreateQuad(float x, float y, float w, float h, float depth);
 
+	// Vertex and index counts of a shape, known before it is generated.
+	struct MeshSize
+	{
+		uint32 VertexCount = 0;
+		uint32 IndexCount = 0;
+	};
+
+	static MeshSize BoxSize(uint32 numSubdivisions);
+	static MeshSize SphereSize(uint32 sliceCount, uint32 stackCount);
+	static MeshSize CylinderSize(uint32 sliceCount, uint32 stackCount);
+	static MeshSize GridSize(uint32 m, uint32 n);
+
+	///<summary>
+	/// The shapes above written straight into caller memory in a single pass, for
+	/// example into a vertex buffer blob or a mapped upload buffer. Size the
+	/// destination with the matching *Size function. writeVertex(index, vertex)
+	/// is called once per vertex and stores it in the caller's vertex layout;
+	/// indices receives IndexCount indices of type Index.
+	///</summary>
+	template<typename VertexWriter, typename Index>
+	void WriteBox(float width, float height, float depth, uint32 numSubdivisions, VertexWriter&& writeVertex, Index* indices);
+	template<typename VertexWriter, typename Index>
+	void WriteSphere(float radius, uint32 sliceCount, uint32 stackCount, VertexWriter&& writeVertex, Index* indices);
+	template<typename VertexWriter, typename Index>
+	void WriteCylinder(float bottomRadius, float topRadius, float height, uint32 sliceCount, uint32 stackCount, VertexWriter&& writeVertex, Index* indices);
+	template<typename VertexWriter, typename Index>
+	void WriteGrid(float width, float depth, uint32 m, uint32 n, VertexWriter&& writeVertex, Index* indices);
+
 private:
-	void Subdivide(MeshData& meshData);
+	static const uint32 MaxBoxSubdivisions = 6;
+	// Geospheres past this level would not fit in memory comfortably.
+	static const uint32 MaxGeosphereSubdivisions = 9;
+
+	void Subdivide(MeshData& meshData, ThreadPool* threadPool = nullptr);
 	Vertex MidPoint(const Vertex& v0, const Vertex& v1);
-	void BuildCylinderTopCap(float bottomRadius, float topRadius, float height, uint32 sliceCount, uint32 stackCount, MeshData& meshData);
-	void BuildCylinderBottomCap(float bottomRadius, float topRadius, float height, uint32 sliceCount, uint32 stackCount, MeshData& meshData);
+	static void BoxFaceCorners(float width, float height, float depth, Vertex corners[24]);
 };
 
+template<typename VertexWriter, typename Index>
+void GeometryGenerator::WriteBox(float width, float height, float depth, uint32 numSubdivisions, VertexWriter&& writeVertex, Index* indices)
+{
+	Vertex corners[24];
+	BoxFaceCorners(width, height, depth, corners);
+
+	// Each subdivision splits every cell in four, so a face ends up as a grid of
+	// segments x segments cells spanned by its corners c0, c1 and c3.
+	uint32 segments = 1u << std::min<uint32>(numSubdivisions, MaxBoxSubdivisions);
+	uint32 rowVertexCount = segments + 1;
+	float step = 1.0f / segments;
+
+	for (uint32 f = 0; f < 6; ++f)
+	{
+		const Vertex& c0 = corners[f * 4 + 0];
+		const Vertex& c1 = corners[f * 4 + 1];
+		const Vertex& c3 = corners[f * 4 + 3];
+		uint32 baseIndex = f * rowVertexCount * rowVertexCount;
+
+		for (uint32 a = 0; a <= segments; ++a)
+		{
+			for (uint32 b = 0; b <= segments; ++b)
+			{
+				float s = a * step;
+				float t = b * step;
+
+				Vertex v = c0;
+				v.Position.x = c0.Position.x + s * (c1.Position.x - c0.Position.x) + t * (c3.Position.x - c0.Position.x);
+				v.Position.y = c0.Position.y + s * (c1.Position.y - c0.Position.y) + t * (c3.Position.y - c0.Position.y);
+				v.Position.z = c0.Position.z + s * (c1.Position.z - c0.Position.z) + t * (c3.Position.z - c0.Position.z);
+				v.TexC.x = c0.TexC.x + s * (c1.TexC.x - c0.TexC.x) + t * (c3.TexC.x - c0.TexC.x);
+				v.TexC.y = c0.TexC.y + s * (c1.TexC.y - c0.TexC.y) + t * (c3.TexC.y - c0.TexC.y);
+
+				writeVertex(baseIndex + a * rowVertexCount + b, v);
+			}
+		}
+
+		// Same winding as the face's (c0, c1, c2), (c0, c2, c3).
+		for (uint32 a = 0; a < segments; ++a)
+		{
+			for (uint32 b = 0; b < segments; ++b)
+			{
+				uint32 i00 = baseIndex + a * rowVertexCount + b;
+				uint32 i10 = i00 + rowVertexCount;
+
+				*indices++ = (Index)i00;
+				*indices++ = (Index)i10;
+				*indices++ = (Index)(i10 + 1);
+
+				*indices++ = (Index)i00;
+				*indices++ = (Index)(i10 + 1);
+				*indices++ = (Index)(i00 + 1);
+			}
+		}
+	}
+}
+
+template<typename VertexWriter, typename Index>
+void GeometryGenerator::WriteSphere(float radius, uint32 sliceCount, uint32 stackCount, VertexWriter&& writeVertex, Index* indices)
+{
+	//
+	// Compute the vertices stating at the top pole and moving down the stacks.
+	//
+
+	// Poles: note that there will be texture coordinate distortion as there is
+	// not a unique point on the texture map to assign to the pole when mapping
+	// a rectangular texture onto a sphere.
+	uint32 k = 0;
+	writeVertex(k++, Vertex(0.0f, +radius, 0.0f, 0.0f, +1.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f));
+
+	float phiStep = DirectX::XM_PI / stackCount;
+	float thetaStep = 2.0f*DirectX::XM_PI / sliceCount;
+
+	// Compute vertices for each stack ring (do not count the poles as rings).
+	for (uint32 i = 1; i <= stackCount - 1; ++i)
+	{
+		float phi = i * phiStep;
+		float sinPhi = sinf(phi);
+		float cosPhi = cosf(phi);
+
+		// Vertices of ring.
+		for (uint32 j = 0; j <= sliceCount; ++j)
+		{
+			float theta = j * thetaStep;
+			float sinTheta = sinf(theta);
+			float cosTheta = cosf(theta);
+
+			Vertex v;
+
+			// spherical to cartesian
+			v.Position.x = radius * sinPhi*cosTheta;
+			v.Position.y = radius * cosPhi;
+			v.Position.z = radius * sinPhi*sinTheta;
+
+			// Partial derivative of P with respect to theta, normalized.
+			v.TangentU = DirectX::XMFLOAT3(-sinTheta, 0.0f, cosTheta);
+			v.Normal = DirectX::XMFLOAT3(sinPhi*cosTheta, cosPhi, sinPhi*sinTheta);
+
+			v.TexC.x = theta / DirectX::XM_2PI;
+			v.TexC.y = phi / DirectX::XM_PI;
+
+			writeVertex(k++, v);
+		}
+	}
+
+	uint32 southPoleIndex = k;
+	writeVertex(k++, Vertex(0.0f, -radius, 0.0f, 0.0f, -1.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 1.0f));
+
+	//
+	// Compute indices for top stack.  The top stack was written first to the vertex buffer
+	// and connects the top pole to the first ring.
+	//
+
+	for (uint32 i = 1; i <= sliceCount; ++i)
+	{
+		*indices++ = (Index)0;
+		*indices++ = (Index)(i + 1);
+		*indices++ = (Index)i;
+	}
+
+	//
+	// Compute indices for inner stacks (not connected to poles).
+	//
+
+	// Offset the indices to the index of the first vertex in the first ring.
+	// This is just skipping the top pole vertex.
+	uint32 baseIndex = 1;
+	uint32 ringVertexCount = sliceCount + 1;
+	for (uint32 i = 0; i < stackCount - 2; ++i)
+	{
+		for (uint32 j = 0; j < sliceCount; ++j)
+		{
+			*indices++ = (Index)(baseIndex + i * ringVertexCount + j);
+			*indices++ = (Index)(baseIndex + i * ringVertexCount + j + 1);
+			*indices++ = (Index)(baseIndex + (i + 1)*ringVertexCount + j);
+
+			*indices++ = (Index)(baseIndex + (i + 1)*ringVertexCount + j);
+			*indices++ = (Index)(baseIndex + i * ringVertexCount + j + 1);
+			*indices++ = (Index)(baseIndex + (i + 1)*ringVertexCount + j + 1);
+		}
+	}
+
+	//
+	// Compute indices for bottom stack.  The bottom stack was written last to the vertex buffer
+	// and connects the bottom pole to the bottom ring.
+	//
+
+	// Offset the indices to the index of the first vertex in the last ring.
+	baseIndex = southPoleIndex - ringVertexCount;
+
+	for (uint32 i = 0; i < sliceCount; ++i)
+	{
+		*indices++ = (Index)southPoleIndex;
+		*indices++ = (Index)(baseIndex + i);
+		*indices++ = (Index)(baseIndex + i + 1);
+	}
+}
+
+template<typename VertexWriter, typename Index>
+void GeometryGenerator::WriteCylinder(float bottomRadius, float topRadius, float height, uint32 sliceCount, uint32 stackCount,
+	VertexWriter&& writeVertex, Index* indices)
+{
+	//
+	// Build Stacks.
+	// 
+
+	float stackHeight = height / stackCount;
+
+	// Amount to increment radius as we move up each stack level from bottom to top.
+	float radiusStep = (topRadius - bottomRadius) / stackCount;
+
+	uint32 ringCount = stackCount + 1;
+	float dTheta = 2.0f*DirectX::XM_PI / sliceCount;
+	uint32 k = 0;
+
+	// Compute vertices for each stack ring starting at the bottom and moving up.
+	for (uint32 i = 0; i < ringCount; ++i)
+	{
+		float y = -0.5f*height + i * stackHeight;
+		float r = bottomRadius + i * radiusStep;
+
+		// vertices of ring
+		for (uint32 j = 0; j <= sliceCount; ++j)
+		{
+			Vertex vertex;
+
+			float c = cosf(j*dTheta);
+			float s = sinf(j*dTheta);
+
+			vertex.Position = DirectX::XMFLOAT3(r*c, y, r*s);
+
+			vertex.TexC.x = (float)j / sliceCount;
+			vertex.TexC.y = 1.0f - (float)i / stackCount;
+
+			// Cylinder can be parameterized as follows, where we introduce v
+			// parameter that goes in the same direction as the v tex-coord
+			// so that the bitangent goes in the same direction as the v tex-coord.
+			//   Let r0 be the bottom radius and let r1 be the top radius.
+			//   y(v) = h - hv for v in [0,1].
+			//   r(v) = r1 + (r0-r1)v
+			//
+			//   x(t, v) = r(v)*cos(t)
+			//   y(t, v) = h - hv
+			//   z(t, v) = r(v)*sin(t)
+			// 
+			//  dx/dt = -r(v)*sin(t)
+			//  dy/dt = 0
+			//  dz/dt = +r(v)*cos(t)
+			//
+			//  dx/dv = (r0-r1)*cos(t)
+			//  dy/dv = -h
+			//  dz/dv = (r0-r1)*sin(t)
+
+			// This is unit length.
+			vertex.TangentU = DirectX::XMFLOAT3(-s, 0.0f, c);
+
+			float dr = bottomRadius - topRadius;
+			DirectX::XMFLOAT3 bitangent(dr*c, -height, dr*s);
+
+			DirectX::XMVECTOR T = DirectX::XMLoadFloat3(&vertex.TangentU);
+			DirectX::XMVECTOR B = DirectX::XMLoadFloat3(&bitangent);
+			DirectX::XMVECTOR N = DirectX::XMVector3Normalize(DirectX::XMVector3Cross(T, B));
+			DirectX::XMStoreFloat3(&vertex.Normal, N);
+
+			writeVertex(k++, vertex);
+		}
+	}
+
+	// Add one because we duplicate the first and last vertex per ring
+	// since the texture coordinates are different.
+	uint32 ringVertexCount = sliceCount + 1;
+
+	// Compute indices for each stack.
+	for (uint32 i = 0; i < stackCount; ++i)
+	{
+		for (uint32 j = 0; j < sliceCount; ++j)
+		{
+			*indices++ = (Index)(i*ringVertexCount + j);
+			*indices++ = (Index)((i + 1)*ringVertexCount + j);
+			*indices++ = (Index)((i + 1)*ringVertexCount + j + 1);
+
+			*indices++ = (Index)(i*ringVertexCount + j);
+			*indices++ = (Index)((i + 1)*ringVertexCount + j + 1);
+			*indices++ = (Index)(i*ringVertexCount + j + 1);
+		}
+	}
+
+	//
+	// Build the caps, top first. Duplicate the cap ring vertices because the
+	// texture coordinates and normals differ.
+	//
+
+	for (int cap = 0; cap < 2; ++cap)
+	{
+		bool top = cap == 0;
+		float y = top ? 0.5f*height : -0.5f*height;
+		float ny = top ? 1.0f : -1.0f;
+		float radius = top ? topRadius : bottomRadius;
+		uint32 baseIndex = k;
+
+		for (uint32 i = 0; i <= sliceCount; ++i)
+		{
+			float x = radius * cosf(i*dTheta);
+			float z = radius * sinf(i*dTheta);
+
+			// Scale down by the height to try and make top cap texture coord area
+			// proportional to base.
+			float u = x / height + 0.5f;
+			float v = z / height + 0.5f;
+
+			writeVertex(k++, Vertex(x, y, z, 0.0f, ny, 0.0f, 1.0f, 0.0f, 0.0f, u, v));
+		}
+
+		// Cap center vertex.
+		uint32 centerIndex = k;
+		writeVertex(k++, Vertex(0.0f, y, 0.0f, 0.0f, ny, 0.0f, 1.0f, 0.0f, 0.0f, 0.5f, 0.5f));
+
+		// The caps face opposite ways, so their windings are mirrored.
+		for (uint32 i = 0; i < sliceCount; ++i)
+		{
+			*indices++ = (Index)centerIndex;
+			*indices++ = (Index)(baseIndex + (top ? i + 1 : i));
+			*indices++ = (Index)(baseIndex + (top ? i : i + 1));
+		}
+	}
+}
+
+template<typename VertexWriter, typename Index>
+void GeometryGenerator::WriteGrid(float width, float depth, uint32 m, uint32 n, VertexWriter&& writeVertex, Index* indices)
+{
+	//
+	// Create the vertices.
+	//
+
+	float halfWidth = 0.5f*width;
+	float halfDepth = 0.5f*depth;
+
+	float dx = width / (n - 1);
+	float dz = depth / (m - 1);
+
+	float du = 1.0f / (n - 1);
+	float dv = 1.0f / (m - 1);
+
+	for (uint32 i = 0; i < m; ++i)
+	{
+		float z = halfDepth - i * dz;
+		for (uint32 j = 0; j < n; ++j)
+		{
+			float x = -halfWidth + j * dx;
+
+			// Stretch texture over grid.
+			writeVertex(i*n + j, Vertex(x, 0.0f, z, 0.0f, 1.0f, 0.0f, 1.0f, 0.0f, 0.0f, j * du, i * dv));
+		}
+	}
+
+	//
+	// Create the indices.
+	//
+
+	// Iterate over each quad and compute indices.
+	for (uint32 i = 0; i < m - 1; ++i)
+	{
+		for (uint32 j = 0; j < n - 1; ++j)
+		{
+			*indices++ = (Index)(i * n + j);
+			*indices++ = (Index)(i * n + j + 1);
+			*indices++ = (Index)((i + 1)*n + j);
+
+			*indices++ = (Index)((i + 1)*n + j);
+			*indices++ = (Index)(i * n + j + 1);
+			*indices++ = (Index)((i + 1)*n + j + 1);
+		}
+	}
+}
+
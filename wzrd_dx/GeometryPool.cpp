@@ -0,0 +1,140 @@
+#include "GeometryPool.h"
+
+namespace {
+
+UINT IndexSize(DXGI_FORMAT format) {
+	return format == DXGI_FORMAT_R16_UINT ? sizeof(std::uint16_t) : sizeof(std::uint32_t);
+}
+
+}
+
+GeometryPool::GeometryPool(ID3D12Device* device, UINT arenaByteSize) :
+	m_device(device),
+	m_arenaByteSize(arenaByteSize)
+{
+}
+
+GeometryPool::Arena* GeometryPool::Allocate(UINT elementSize, DXGI_FORMAT indexFormat, UINT count, UINT& offset) {
+	for (auto& arena : m_arenas)
+	{
+		if (arena->ElementSize != elementSize || arena->IndexFormat != indexFormat)
+			continue;
+		offset = arena->Ranges.Allocate(count);
+		if (offset != RangeAllocator::InvalidOffset)
+			return arena.get();
+	}
+
+	// Meshes larger than an arena get one of their own size.
+	UINT capacity = std::max<UINT>(m_arenaByteSize / elementSize, count);
+
+	auto arena = std::make_unique<Arena>();
+	arena->ElementSize = elementSize;
+	arena->IndexFormat = indexFormat;
+	arena->Ranges = RangeAllocator(capacity);
+
+	ThrowIfFailed(m_device->CreateCommittedResource(
+		&CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT),
+		D3D12_HEAP_FLAG_NONE,
+		&CD3DX12_RESOURCE_DESC::Buffer((UINT64)capacity * elementSize),
+		D3D12_RESOURCE_STATE_COMMON,
+		nullptr,
+		IID_PPV_ARGS(arena->Buffer.GetAddressOf())
+	));
+
+	offset = arena->Ranges.Allocate(count);
+	m_arenas.push_back(std::move(arena));
+	return m_arenas.back().get();
+}
+
+void GeometryPool::Add(MeshGeometry& geo, const void* vertices, const void* indices, ID3D12GraphicsCommandList* cmdList) {
+	assert(m_allocations.find(&geo) == m_allocations.end());
+
+	const UINT indexSize = IndexSize(geo.IndexFormat);
+
+	Allocation allocation;
+	allocation.VertexCount = geo.VertexBufferByteSize / geo.VertexByteStride;
+	allocation.IndexCount = geo.IndexBufferByteSize / indexSize;
+	allocation.Vertices = Allocate(geo.VertexByteStride, DXGI_FORMAT_UNKNOWN, allocation.VertexCount, allocation.BaseVertex);
+	allocation.Indices = Allocate(indexSize, geo.IndexFormat, allocation.IndexCount, allocation.StartIndex);
+
+	// Both halves go through one upload buffer, the indices 4-byte aligned.
+	const UINT64 vbByteSize = geo.VertexBufferByteSize;
+	const UINT64 ibByteSize = geo.IndexBufferByteSize;
+	const UINT64 ibUploadOffset = (vbByteSize + 3) & ~3ull;
+
+	ComPtr<ID3D12Resource> uploader;
+	ThrowIfFailed(m_device->CreateCommittedResource(
+		&CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD),
+		D3D12_HEAP_FLAG_NONE,
+		&CD3DX12_RESOURCE_DESC::Buffer(std::max<UINT64>(ibUploadOffset + ibByteSize, 1)),
+		D3D12_RESOURCE_STATE_GENERIC_READ,
+		nullptr,
+		IID_PPV_ARGS(uploader.GetAddressOf())
+	));
+
+	std::uint8_t* mapped = nullptr;
+	ThrowIfFailed(uploader->Map(0, nullptr, (void**)&mapped));
+	CopyMemory(mapped, vertices, (SIZE_T)vbByteSize);
+	CopyMemory(mapped + ibUploadOffset, indices, (SIZE_T)ibByteSize);
+	uploader->Unmap(0, nullptr);
+
+	ID3D12Resource* vertexArena = allocation.Vertices->Buffer.Get();
+	ID3D12Resource* indexArena = allocation.Indices->Buffer.Get();
+
+	D3D12_RESOURCE_BARRIER toCopy[2] = {
+		CD3DX12_RESOURCE_BARRIER::Transition(vertexArena, D3D12_RESOURCE_STATE_COMMON, D3D12_RESOURCE_STATE_COPY_DEST),
+		CD3DX12_RESOURCE_BARRIER::Transition(indexArena, D3D12_RESOURCE_STATE_COMMON, D3D12_RESOURCE_STATE_COPY_DEST)
+	};
+	cmdList->ResourceBarrier(2, toCopy);
+
+	cmdList->CopyBufferRegion(vertexArena, (UINT64)allocation.BaseVertex * geo.VertexByteStride, uploader.Get(), 0, vbByteSize);
+	cmdList->CopyBufferRegion(indexArena, (UINT64)allocation.StartIndex * indexSize, uploader.Get(), ibUploadOffset, ibByteSize);
+
+	D3D12_RESOURCE_BARRIER toCommon[2] = {
+		CD3DX12_RESOURCE_BARRIER::Transition(vertexArena, D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_COMMON),
+		CD3DX12_RESOURCE_BARRIER::Transition(indexArena, D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_COMMON)
+	};
+	cmdList->ResourceBarrier(2, toCommon);
+
+	m_uploaders.push_back(uploader);
+
+	// Point the geometry at the arenas. Whole-arena views are what lets the
+	// recorder see the bindings of two meshes as the same.
+	geo.VertexBufferGPU = allocation.Vertices->Buffer;
+	geo.IndexBufferGPU = allocation.Indices->Buffer;
+	geo.VertexBufferByteSize = allocation.Vertices->Ranges.Capacity() * geo.VertexByteStride;
+	geo.IndexBufferByteSize = allocation.Indices->Ranges.Capacity() * indexSize;
+	geo.PoolBaseVertex = allocation.BaseVertex;
+	geo.PoolStartIndex = allocation.StartIndex;
+
+	for (auto& drawArgs : geo.DrawArgs)
+	{
+		drawArgs.second.StartIndexLocation += allocation.StartIndex;
+		drawArgs.second.BaseVertexLocation += (INT)allocation.BaseVertex;
+	}
+
+	m_allocations[&geo] = allocation;
+}
+
+void GeometryPool::Remove(MeshGeometry& geo) {
+	auto allocation = m_allocations.find(&geo);
+	if (allocation == m_allocations.end())
+		return;
+
+	const Allocation& a = allocation->second;
+	a.Vertices->Ranges.Free(a.BaseVertex, a.VertexCount);
+	a.Indices->Ranges.Free(a.StartIndex, a.IndexCount);
+	m_allocations.erase(allocation);
+}
+
+GeometryPool::Stats GeometryPool::GetStats() const {
+	Stats stats;
+	for (const auto& arena : m_arenas)
+	{
+		const RangeAllocator& ranges = arena->Ranges;
+		stats.ArenaCount++;
+		stats.ArenaBytes += (UINT64)ranges.Capacity() * arena->ElementSize;
+		stats.UsedBytes += (UINT64)(ranges.Capacity() - ranges.FreeSize()) * arena->ElementSize;
+	}
+	return stats;
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include "Utilities.h"
+#include "MeshGeometry.h"
+#include "RangeAllocator.h"
+
+// Static meshes share a few large default heap buffers instead of owning a
+// vertex and an index buffer each. Vertices go into arenas per vertex stride and
+// indices into arenas per index format, so meshes with the same layout bind the
+// same views and the command recorder drops the rebinds between their draws.
+// A mesh never spans two arenas; a full arena gets a neighbour.
+class GeometryPool {
+public:
+	static const UINT DefaultArenaByteSize = 8 * 1024 * 1024;
+
+	explicit GeometryPool(ID3D12Device* device, UINT arenaByteSize = DefaultArenaByteSize);
+
+	// Records the copy of a mesh into the pool on cmdList. geo describes the data:
+	// its stride, byte sizes, index format and DrawArgs relative to it. Afterwards
+	// its GPU buffers are the arenas, its views cover them whole and its DrawArgs
+	// are offset to where the mesh landed; PoolBaseVertex and PoolStartIndex keep
+	// the offsets for code that reads the CPU copies.
+	// The arenas return to COMMON after the copy, to be promoted when drawn from,
+	// so record Adds before draws from the pool in the same command list.
+	void Add(MeshGeometry& geo, const void* vertices, const void* indices, ID3D12GraphicsCommandList* cmdList);
+	// Frees the ranges of geo. The GPU must be done drawing it.
+	void Remove(MeshGeometry& geo);
+
+	// Releases the upload buffers of earlier Adds once their copies have run.
+	void DisposeUploaders() { m_uploaders.clear(); }
+
+	struct Stats {
+		UINT ArenaCount = 0;
+		UINT64 ArenaBytes = 0;
+		UINT64 UsedBytes = 0;
+	};
+	Stats GetStats() const;
+
+private:
+	struct Arena {
+		ComPtr<ID3D12Resource> Buffer;
+		// Vertex stride or index size.
+		UINT ElementSize = 0;
+		// DXGI_FORMAT_UNKNOWN for vertex arenas.
+		DXGI_FORMAT IndexFormat = DXGI_FORMAT_UNKNOWN;
+		// In elements.
+		RangeAllocator Ranges;
+	};
+
+	struct Allocation {
+		Arena* Vertices = nullptr;
+		UINT BaseVertex = 0;
+		UINT VertexCount = 0;
+		Arena* Indices = nullptr;
+		UINT StartIndex = 0;
+		UINT IndexCount = 0;
+	};
+
+	// Takes count elements from the first arena of the kind with room, creating
+	// one if none has it, and returns the arena and the offset in it.
+	Arena* Allocate(UINT elementSize, DXGI_FORMAT indexFormat, UINT count, UINT& offset);
+
+	ID3D12Device* m_device;
+	UINT m_arenaByteSize;
+	std::vector<std::unique_ptr<Arena>> m_arenas;
+	std::unordered_map<const MeshGeometry*, Allocation> m_allocations;
+	std::vector<ComPtr<ID3D12Resource>> m_uploaders;
+};
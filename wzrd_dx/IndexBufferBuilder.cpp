@@ -0,0 +1,126 @@
+#include "IndexBufferBuilder.h"
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+const std::uint32_t MaxIndex16 = 0xffff;
+
+// A run of indices of a submesh drawn from one base vertex.
+struct Part {
+	std::size_t First;
+	std::size_t Count;
+	std::uint32_t MinIndex;
+	std::uint32_t MaxIndex;
+};
+
+void Bounds(const std::uint32_t* indices, std::size_t count, std::uint32_t& minIndex, std::uint32_t& maxIndex) {
+	minIndex = count ? indices[0] : 0;
+	maxIndex = minIndex;
+	for (std::size_t i = 1; i < count; ++i)
+	{
+		minIndex = std::min(minIndex, indices[i]);
+		maxIndex = std::max(maxIndex, indices[i]);
+	}
+}
+
+// Grows each part one triangle at a time until the next one would widen its span
+// past 16 bits. Returns false if a single triangle is already too wide.
+bool SplitTriangles(const std::uint32_t* indices, std::size_t count, std::vector<Part>& parts) {
+	Part part = { 0, 0, 0, 0 };
+	for (std::size_t i = 0; i < count; i += 3)
+	{
+		std::uint32_t minIndex, maxIndex;
+		Bounds(indices + i, 3, minIndex, maxIndex);
+		if (maxIndex - minIndex > MaxIndex16)
+			return false;
+
+		if (part.Count > 0)
+		{
+			std::uint32_t mergedMin = std::min(part.MinIndex, minIndex);
+			std::uint32_t mergedMax = std::max(part.MaxIndex, maxIndex);
+			if (mergedMax - mergedMin <= MaxIndex16)
+			{
+				part.Count += 3;
+				part.MinIndex = mergedMin;
+				part.MaxIndex = mergedMax;
+				continue;
+			}
+			parts.push_back(part);
+		}
+		part = { i, 3, minIndex, maxIndex };
+	}
+
+	if (part.Count > 0 || parts.empty())
+		parts.push_back(part);
+	return true;
+}
+
+}
+
+void IndexBufferBuilder::Add(const std::string& name, const std::uint32_t* indices, std::size_t indexCount,
+	std::int32_t baseVertex, bool splittable)
+{
+	// Only whole triangles can be split off.
+	m_submeshes.push_back({ name, indices, indexCount, baseVertex, splittable && indexCount % 3 == 0 });
+}
+
+void IndexBufferBuilder::Build() {
+	std::vector<std::vector<Part>> parts(m_submeshes.size());
+	bool fits16 = true;
+
+	for (std::size_t s = 0; s < m_submeshes.size() && fits16; ++s)
+	{
+		const Submesh& submesh = m_submeshes[s];
+		Part whole = { 0, submesh.IndexCount, 0, 0 };
+		Bounds(submesh.Indices, submesh.IndexCount, whole.MinIndex, whole.MaxIndex);
+
+		if (whole.MaxIndex - whole.MinIndex <= MaxIndex16)
+			parts[s].push_back(whole);
+		else if (!submesh.Splittable || !SplitTriangles(submesh.Indices, submesh.IndexCount, parts[s]))
+			fits16 = false;
+	}
+
+	std::size_t totalIndexCount = 0;
+	for (const Submesh& submesh : m_submeshes)
+		totalIndexCount += submesh.IndexCount;
+
+	m_indexSize = fits16 ? 2 : 4;
+	m_data.resize(totalIndexCount * m_indexSize);
+	m_ranges.clear();
+
+	std::uint32_t start = 0;
+	for (std::size_t s = 0; s < m_submeshes.size(); ++s)
+	{
+		const Submesh& submesh = m_submeshes[s];
+		std::vector<IndexBufferRange>& ranges = m_ranges[submesh.Name];
+
+		// 32-bit buffers keep every submesh whole and its indices as they are.
+		if (!fits16)
+		{
+			if (submesh.IndexCount > 0)
+				std::memcpy(m_data.data() + start * m_indexSize, submesh.Indices, submesh.IndexCount * m_indexSize);
+			ranges.push_back({ (std::uint32_t)submesh.IndexCount, start, submesh.BaseVertex });
+			start += (std::uint32_t)submesh.IndexCount;
+			continue;
+		}
+
+		auto indices16 = (std::uint16_t*)m_data.data();
+		for (const Part& part : parts[s])
+		{
+			for (std::size_t i = 0; i < part.Count; ++i)
+				indices16[start + i] = (std::uint16_t)(submesh.Indices[part.First + i] - part.MinIndex);
+
+			ranges.push_back({ (std::uint32_t)part.Count, start, submesh.BaseVertex + (std::int32_t)part.MinIndex });
+			start += (std::uint32_t)part.Count;
+		}
+	}
+
+	m_submeshes.clear();
+}
+
+const std::vector<IndexBufferRange>& IndexBufferBuilder::Ranges(const std::string& name) const {
+	static const std::vector<IndexBufferRange> none;
+	auto ranges = m_ranges.find(name);
+	return ranges != m_ranges.end() ? ranges->second : none;
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <dxgiformat.h>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// One draw from an index buffer built by IndexBufferBuilder.
+struct IndexBufferRange {
+	std::uint32_t IndexCount = 0;
+	std::uint32_t StartIndexLocation = 0;
+	std::int32_t BaseVertexLocation = 0;
+};
+
+// Packs the index lists of the submeshes of a geometry into one index buffer,
+// with 16-bit indices whenever the draws allow it:
+//
+// - Each range is rebased on the smallest vertex it uses, which moves into its
+//   BaseVertexLocation, so only the span of vertices it uses has to fit.
+// - A splittable submesh that spans more vertices is cut between triangles into
+//   parts that each fit, and every part becomes its own draw.
+// - Only when some range cannot fit does the whole buffer fall back to R32.
+//
+// Indices are never truncated.
+class IndexBufferBuilder {
+public:
+	// indices are relative to baseVertex, as in a draw, and must stay valid until
+	// Build returns. Submeshes whose index ranges are used as a whole, such as LOD
+	// levels or meshlets, must not be split; splittable submeshes are triangle lists.
+	void Add(const std::string& name, const std::uint32_t* indices, std::size_t indexCount,
+		std::int32_t baseVertex = 0, bool splittable = false);
+
+	// Picks the index format and lays out the buffer, submeshes in the order they
+	// were added.
+	void Build();
+
+	DXGI_FORMAT Format() const { return m_indexSize == 2 ? DXGI_FORMAT_R16_UINT : DXGI_FORMAT_R32_UINT; }
+	std::size_t IndexSize() const { return m_indexSize; }
+	std::uint32_t IndexCount() const { return (std::uint32_t)(m_data.size() / m_indexSize); }
+
+	const void* Data() const { return m_data.data(); }
+	std::uint32_t ByteSize() const { return (std::uint32_t)m_data.size(); }
+
+	// The draws of a submesh: one unless it was split. Empty for unknown names.
+	const std::vector<IndexBufferRange>& Ranges(const std::string& name) const;
+
+private:
+	struct Submesh {
+		std::string Name;
+		const std::uint32_t* Indices;
+		std::size_t IndexCount;
+		std::int32_t BaseVertex;
+		bool Splittable;
+	};
+
+	std::vector<Submesh> m_submeshes;
+	std::unordered_map<std::string, std::vector<IndexBufferRange>> m_ranges;
+	std::vector<std::uint8_t> m_data;
+	std::size_t m_indexSize = 2;
+};
@@ -0,0 +1,85 @@
+#include "InstanceBatcher.h"
+
+std::size_t InstanceBatchKey::Hash::operator()(const InstanceBatchKey& key) const {
+	// FNV-1a over the fields.
+	const std::uint64_t fields[] = {
+		(std::uint64_t)(std::uintptr_t)key.Geometry,
+		(std::uint64_t)(std::uintptr_t)key.Material,
+		(std::uint64_t)(std::uintptr_t)key.PipelineState,
+		((std::uint64_t)key.Topology << 32) | key.IndexCount,
+		((std::uint64_t)key.StartIndexLocation << 32) | (std::uint32_t)key.BaseVertexLocation,
+	};
+
+	std::uint64_t hash = 14695981039346656037ull;
+	for (std::uint64_t field : fields)
+	{
+		hash ^= field;
+		hash *= 1099511628211ull;
+	}
+	return (std::size_t)hash;
+}
+
+void InstanceBatcher::Clear() {
+	m_batches.clear();
+	m_instanceItems.clear();
+	m_pending.clear();
+	m_openBatches.clear();
+}
+
+void InstanceBatcher::Add(const InstanceBatchKey& key, std::uint32_t itemIndex, InstanceMerge merge) {
+	if (merge == InstanceMerge::Any)
+	{
+		auto open = m_openBatches.find(key);
+		if (open != m_openBatches.end())
+		{
+			m_batches[open->second].InstanceCount++;
+			m_pending.push_back({ itemIndex, open->second });
+			return;
+		}
+	}
+	else
+	{
+		// Later items must not be drawn before this one.
+		m_openBatches.clear();
+
+		if (merge == InstanceMerge::Adjacent && !m_batches.empty())
+		{
+			InstanceBatch& last = m_batches.back();
+			if (last.Mergeable && last.Key == key)
+			{
+				last.InstanceCount++;
+				m_pending.push_back({ itemIndex, (std::uint32_t)m_batches.size() - 1 });
+				return;
+			}
+		}
+	}
+
+	InstanceBatch batch;
+	batch.Key = key;
+	batch.InstanceCount = 1;
+	batch.Mergeable = merge != InstanceMerge::Never;
+	m_batches.push_back(batch);
+
+	const std::uint32_t batchIndex = (std::uint32_t)m_batches.size() - 1;
+	if (merge == InstanceMerge::Any)
+		m_openBatches[key] = batchIndex;
+	m_pending.push_back({ itemIndex, batchIndex });
+}
+
+void InstanceBatcher::Finish() {
+	std::uint32_t first = 0;
+	for (InstanceBatch& batch : m_batches)
+	{
+		batch.FirstInstance = first;
+		first += batch.InstanceCount;
+	}
+
+	// Items keep their order inside each batch.
+	std::vector<std::uint32_t> next(m_batches.size());
+	for (std::size_t b = 0; b < m_batches.size(); ++b)
+		next[b] = m_batches[b].FirstInstance;
+
+	m_instanceItems.resize(m_pending.size());
+	for (const PendingItem& item : m_pending)
+		m_instanceItems[next[item.Batch]++] = item.ItemIndex;
+}
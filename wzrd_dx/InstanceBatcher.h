@@ -0,0 +1,79 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+// Everything that has to match for two items to be drawn by the same
+// DrawIndexedInstanced call. API objects are opaque pointers so the grouping
+// can run without a device.
+struct InstanceBatchKey {
+	const void* Geometry = nullptr;
+	const void* Material = nullptr;
+	const void* PipelineState = nullptr;
+	std::uint32_t Topology = 0;
+	std::uint32_t IndexCount = 0;
+	std::uint32_t StartIndexLocation = 0;
+	std::int32_t BaseVertexLocation = 0;
+
+	bool operator==(const InstanceBatchKey& rhs) const {
+		return Geometry == rhs.Geometry && Material == rhs.Material && PipelineState == rhs.PipelineState &&
+			Topology == rhs.Topology && IndexCount == rhs.IndexCount &&
+			StartIndexLocation == rhs.StartIndexLocation && BaseVertexLocation == rhs.BaseVertexLocation;
+	}
+	bool operator!=(const InstanceBatchKey& rhs) const { return !(*this == rhs); }
+
+	struct Hash {
+		std::size_t operator()(const InstanceBatchKey& key) const;
+	};
+};
+
+// Instances sharing one key. Instance i of the batch is the item
+// InstanceItems()[FirstInstance + i].
+struct InstanceBatch {
+	InstanceBatchKey Key;
+	std::uint32_t FirstInstance = 0;
+	std::uint32_t InstanceCount = 0;
+	bool Mergeable = true;
+};
+
+// How an item may join the batches added before it.
+enum class InstanceMerge {
+	// Joins any earlier batch with the same key, for draws whose order does not
+	// matter. It never moves ahead of an item added with another mode.
+	Any,
+	// Only joins the batch right before it, so draw order is kept.
+	Adjacent,
+	// Always gets a batch of its own, for draws whose shaders do not read the
+	// instance buffer.
+	Never,
+};
+
+// Groups items into instanced draws. Items are added in submission order, and
+// batches are drawn in the order of their first item.
+class InstanceBatcher {
+public:
+	void Clear();
+
+	void Add(const InstanceBatchKey& key, std::uint32_t itemIndex, InstanceMerge merge = InstanceMerge::Any);
+	// Lays the instances of every batch out next to each other. Call after the
+	// last Add and before reading the batches.
+	void Finish();
+
+	const std::vector<InstanceBatch>& Batches() const { return m_batches; }
+	const std::vector<std::uint32_t>& InstanceItems() const { return m_instanceItems; }
+	std::uint32_t InstanceCount() const { return (std::uint32_t)m_instanceItems.size(); }
+
+private:
+	struct PendingItem {
+		std::uint32_t ItemIndex;
+		std::uint32_t Batch;
+	};
+
+	std::vector<InstanceBatch> m_batches;
+	std::vector<std::uint32_t> m_instanceItems;
+	std::vector<PendingItem> m_pending;
+	// Batches Any items can still join, by key.
+	std::unordered_map<InstanceBatchKey, std::uint32_t, InstanceBatchKey::Hash> m_openBatches;
+};
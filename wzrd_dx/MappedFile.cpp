@@ -0,0 +1,154 @@
+#include "MappedFile.h"
+#include <utility>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::MappedFile(MappedFile&& rhs) noexcept {
+	Swap(rhs);
+}
+
+MappedFile& MappedFile::operator=(MappedFile&& rhs) noexcept {
+	if (this != &rhs)
+	{
+		Close();
+		Swap(rhs);
+	}
+	return *this;
+}
+
+MappedFile::~MappedFile() {
+	Close();
+}
+
+void MappedFile::Swap(MappedFile& rhs) {
+	std::swap(m_data, rhs.m_data);
+	std::swap(m_size, rhs.m_size);
+	std::swap(m_open, rhs.m_open);
+#ifdef _WIN32
+	std::swap(m_file, rhs.m_file);
+	std::swap(m_mapping, rhs.m_mapping);
+#endif
+}
+
+#ifdef _WIN32
+
+bool MappedFile::Open(const std::string& path) {
+	Close();
+
+	HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+		FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	if (file == INVALID_HANDLE_VALUE)
+		return false;
+	return Map(file);
+}
+
+bool MappedFile::Open(const std::wstring& path) {
+	Close();
+
+	HANDLE file = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+		FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	if (file == INVALID_HANDLE_VALUE)
+		return false;
+	return Map(file);
+}
+
+bool MappedFile::Map(void* file) {
+	LARGE_INTEGER size;
+	if (!GetFileSizeEx(file, &size))
+	{
+		CloseHandle(file);
+		return false;
+	}
+
+	m_file = file;
+	m_size = (std::size_t)size.QuadPart;
+	m_open = true;
+
+	// Zero-length files cannot be mapped.
+	if (m_size == 0)
+		return true;
+
+	m_mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (m_mapping)
+		m_data = (const std::uint8_t*)MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0);
+
+	if (!m_data)
+	{
+		Close();
+		return false;
+	}
+
+	return true;
+}
+
+void MappedFile::Close() {
+	if (m_data)
+		UnmapViewOfFile(m_data);
+	if (m_mapping)
+		CloseHandle(m_mapping);
+	if (m_file)
+		CloseHandle(m_file);
+
+	m_data = nullptr;
+	m_size = 0;
+	m_open = false;
+	m_file = nullptr;
+	m_mapping = nullptr;
+}
+
+#else
+
+bool MappedFile::Open(const std::string& path) {
+	Close();
+
+	int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+	if (fd < 0)
+		return false;
+
+	struct stat status;
+	if (fstat(fd, &status) != 0)
+	{
+		close(fd);
+		return false;
+	}
+
+	m_size = (std::size_t)status.st_size;
+	m_open = true;
+
+	// The mapping keeps its own reference to the file.
+	if (m_size > 0)
+	{
+		void* data = mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+		if (data == MAP_FAILED)
+		{
+			close(fd);
+			m_size = 0;
+			m_open = false;
+			return false;
+		}
+
+		madvise(data, m_size, MADV_SEQUENTIAL);
+		m_data = (const std::uint8_t*)data;
+	}
+
+	close(fd);
+	return true;
+}
+
+void MappedFile::Close() {
+	if (m_data)
+		munmap((void*)m_data, m_size);
+
+	m_data = nullptr;
+	m_size = 0;
+	m_open = false;
+}
+
+#endif
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Read-only view of a whole file mapped into memory. Pages are read from disk on
+// first access and the view stays valid until the file is closed.
+class MappedFile {
+public:
+	MappedFile() = default;
+	MappedFile(const MappedFile& rhs) = delete;
+	MappedFile& operator=(const MappedFile& rhs) = delete;
+	MappedFile(MappedFile&& rhs) noexcept;
+	MappedFile& operator=(MappedFile&& rhs) noexcept;
+	~MappedFile();
+
+	// Returns false if the file cannot be opened or mapped. An empty file opens
+	// with a null Data().
+	bool Open(const std::string& path);
+#ifdef _WIN32
+	bool Open(const std::wstring& path);
+#endif
+	void Close();
+
+	bool IsOpen() const { return m_open; }
+	const std::uint8_t* Data() const { return m_data; }
+	std::size_t Size() const { return m_size; }
+
+private:
+	void Swap(MappedFile& rhs);
+#ifdef _WIN32
+	// Takes ownership of an open file HANDLE and maps it.
+	bool Map(void* file);
+#endif
+
+	const std::uint8_t* m_data = nullptr;
+	std::size_t m_size = 0;
+	bool m_open = false;
+
+#ifdef _WIN32
+	// File and file mapping HANDLEs.
+	void* m_file = nullptr;
+	void* m_mapping = nullptr;
+#endif
+};
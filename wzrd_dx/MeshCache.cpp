@@ -0,0 +1,310 @@
+#include "MeshCache.h"
+#include "MeshCodec.h"
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/stat.h>
+#endif
+
+namespace {
+	// DXGI_FORMAT_R16_UINT and DXGI_FORMAT_R32_UINT, without pulling in dxgi here.
+	const std::uint32_t IndexFormatR16 = 57;
+	const std::uint32_t IndexFormatR32 = 42;
+
+	static_assert(sizeof(MeshCacheHeader) == 144, "MeshCacheHeader is part of the file format");
+	static_assert(sizeof(MeshCacheAttribute) == 48, "MeshCacheAttribute is part of the file format");
+	static_assert(sizeof(MeshCacheSubmesh) == 72, "MeshCacheSubmesh is part of the file format");
+	static_assert(sizeof(MeshCacheBlob) == 48, "MeshCacheBlob is part of the file format");
+
+	std::uint64_t AlignUp(std::uint64_t offset) {
+		return (offset + MeshCacheAlignment - 1) & ~(std::uint64_t)(MeshCacheAlignment - 1);
+	}
+
+	std::uint32_t IndexSize(std::uint32_t format) {
+		return format == IndexFormatR16 ? 2 : format == IndexFormatR32 ? 4 : 0;
+	}
+
+	bool CopyName(char (&dest)[MeshCacheNameLength], const std::string& name) {
+		if (name.size() >= MeshCacheNameLength)
+			return false;
+		std::memset(dest, 0, MeshCacheNameLength);
+		std::memcpy(dest, name.data(), name.size());
+		return true;
+	}
+
+	bool NameEquals(const char (&stored)[MeshCacheNameLength], const std::string& name) {
+		return name.size() < MeshCacheNameLength && std::memcmp(stored, name.data(), name.size()) == 0 && stored[name.size()] == '\0';
+	}
+
+	// Range [offset, offset + size) lies inside a file of fileSize bytes.
+	bool InFile(std::uint64_t offset, std::uint64_t size, std::uint64_t fileSize) {
+		return offset <= fileSize && size <= fileSize - offset;
+	}
+}
+
+#ifdef _WIN32
+
+MeshCacheSource GetMeshCacheSource(const std::string& path) {
+	MeshCacheSource source;
+	WIN32_FILE_ATTRIBUTE_DATA attributes;
+	if (GetFileAttributesExA(path.c_str(), GetFileExInfoStandard, &attributes))
+	{
+		source.Size = ((std::uint64_t)attributes.nFileSizeHigh << 32) | attributes.nFileSizeLow;
+		source.Time = ((std::uint64_t)attributes.ftLastWriteTime.dwHighDateTime << 32) | attributes.ftLastWriteTime.dwLowDateTime;
+	}
+	return source;
+}
+
+#else
+
+MeshCacheSource GetMeshCacheSource(const std::string& path) {
+	MeshCacheSource source;
+	struct stat status;
+	if (stat(path.c_str(), &status) == 0)
+	{
+		source.Size = (std::uint64_t)status.st_size;
+		source.Time = (std::uint64_t)status.st_mtime;
+	}
+	return source;
+}
+
+#endif
+
+void MeshCacheContents::AddAttribute(const char* semantic, std::uint32_t semanticIndex, std::uint32_t format, std::uint32_t offset) {
+	MeshCacheAttribute attribute = {};
+	std::strncpy(attribute.Semantic, semantic, MeshCacheNameLength - 1);
+	attribute.SemanticIndex = semanticIndex;
+	attribute.Format = format;
+	attribute.Offset = offset;
+	Attributes.push_back(attribute);
+}
+
+bool MeshCacheContents::AddSubmesh(const std::string& name, std::uint32_t indexCount, std::uint32_t startIndexLocation, std::int32_t baseVertexLocation,
+	const DirectX::XMFLOAT3& boundsCenter, const DirectX::XMFLOAT3& boundsExtents, float geometricError) {
+	MeshCacheSubmesh submesh = {};
+	if (!CopyName(submesh.Name, name))
+		return false;
+	submesh.IndexCount = indexCount;
+	submesh.StartIndexLocation = startIndexLocation;
+	submesh.BaseVertexLocation = baseVertexLocation;
+	submesh.GeometricError = geometricError;
+	submesh.BoundsCenter = boundsCenter;
+	submesh.BoundsExtents = boundsExtents;
+	Submeshes.push_back(submesh);
+	return true;
+}
+
+bool WriteMeshCache(const std::string& path, const MeshCacheContents& contents, const MeshCacheSource& source) {
+	const std::uint32_t indexSize = IndexSize(contents.IndexFormat);
+	if (indexSize == 0)
+		return false;
+
+	std::vector<MeshCacheBlob> blobs(contents.Blobs.size());
+
+	MeshCacheHeader header = {};
+	header.Magic = MeshCacheMagic;
+	header.Version = MeshCacheVersion;
+	header.SourceSize = source.Size;
+	header.SourceTime = source.Time;
+	header.VertexStride = contents.VertexStride;
+	header.VertexCount = contents.VertexCount;
+	header.IndexFormat = contents.IndexFormat;
+	header.IndexCount = contents.IndexCount;
+	header.AttributeCount = (std::uint32_t)contents.Attributes.size();
+	header.SubmeshCount = (std::uint32_t)contents.Submeshes.size();
+	header.BlobCount = (std::uint32_t)blobs.size();
+	header.Flags = contents.Compress ? MeshCache_CompressedVertices | MeshCache_CompressedIndices : 0;
+	header.BoundsMin = contents.BoundsMin;
+	header.BoundsMax = contents.BoundsMax;
+
+	// Tables follow the header back to back, the data blocks are aligned.
+	std::uint64_t offset = sizeof(MeshCacheHeader);
+	header.AttributeOffset = offset;
+	offset += contents.Attributes.size() * sizeof(MeshCacheAttribute);
+	header.SubmeshOffset = offset;
+	offset += contents.Submeshes.size() * sizeof(MeshCacheSubmesh);
+	header.BlobOffset = offset;
+	offset += blobs.size() * sizeof(MeshCacheBlob);
+
+	const void* vertexData = contents.Vertices;
+	const void* indexData = contents.Indices;
+	header.VertexDataSize = (std::uint64_t)contents.VertexStride * contents.VertexCount;
+	header.IndexDataSize = (std::uint64_t)indexSize * contents.IndexCount;
+
+	std::vector<std::uint8_t> encodedVertices, encodedIndices;
+	if (contents.Compress)
+	{
+		encodedVertices = EncodeVertexBuffer(contents.Vertices, contents.VertexCount, contents.VertexStride);
+		encodedIndices = EncodeIndexBuffer(contents.Indices, contents.IndexCount, indexSize);
+		vertexData = encodedVertices.data();
+		indexData = encodedIndices.data();
+		header.VertexDataSize = encodedVertices.size();
+		header.IndexDataSize = encodedIndices.size();
+	}
+
+	header.VertexDataOffset = AlignUp(offset);
+	offset = header.VertexDataOffset + header.VertexDataSize;
+	header.IndexDataOffset = AlignUp(offset);
+	offset = header.IndexDataOffset + header.IndexDataSize;
+
+	for (std::size_t i = 0; i < blobs.size(); ++i)
+	{
+		if (!CopyName(blobs[i].Name, contents.Blobs[i].Name))
+			return false;
+		blobs[i].Offset = AlignUp(offset);
+		blobs[i].Size = contents.Blobs[i].Size;
+		offset = blobs[i].Offset + blobs[i].Size;
+	}
+
+	header.FileSize = offset;
+
+	const std::string tempPath = path + ".tmp";
+	{
+		std::ofstream fout(tempPath, std::ios::binary | std::ios::trunc);
+		if (!fout)
+			return false;
+
+		const char padding[MeshCacheAlignment] = {};
+		std::uint64_t written = 0;
+		auto write = [&](std::uint64_t at, const void* data, std::size_t size) {
+			fout.write(padding, (std::streamsize)(at - written));
+			fout.write((const char*)data, (std::streamsize)size);
+			written = at + size;
+		};
+
+		write(0, &header, sizeof(header));
+		write(header.AttributeOffset, contents.Attributes.data(), contents.Attributes.size() * sizeof(MeshCacheAttribute));
+		write(header.SubmeshOffset, contents.Submeshes.data(), contents.Submeshes.size() * sizeof(MeshCacheSubmesh));
+		write(header.BlobOffset, blobs.data(), blobs.size() * sizeof(MeshCacheBlob));
+		write(header.VertexDataOffset, vertexData, (std::size_t)header.VertexDataSize);
+		write(header.IndexDataOffset, indexData, (std::size_t)header.IndexDataSize);
+		for (std::size_t i = 0; i < blobs.size(); ++i)
+			write(blobs[i].Offset, contents.Blobs[i].Data, contents.Blobs[i].Size);
+
+		fout.close();
+		if (!fout)
+		{
+			std::remove(tempPath.c_str());
+			return false;
+		}
+	}
+
+	// rename does not replace an existing file on Windows.
+	std::remove(path.c_str());
+	if (std::rename(tempPath.c_str(), path.c_str()) != 0)
+	{
+		std::remove(tempPath.c_str());
+		return false;
+	}
+	return true;
+}
+
+bool MeshCache::Open(const std::string& path, const MeshCacheSource& source) {
+	Close();
+
+	if (!m_file.Open(path) || m_file.Size() < sizeof(MeshCacheHeader))
+	{
+		Close();
+		return false;
+	}
+
+	const std::uint64_t fileSize = m_file.Size();
+	const MeshCacheHeader& header = *(const MeshCacheHeader*)m_file.Data();
+
+	bool valid = header.Magic == MeshCacheMagic && header.Version == MeshCacheVersion && header.FileSize == fileSize &&
+		header.SourceSize == source.Size && header.SourceTime == source.Time && IndexSize(header.IndexFormat) != 0 &&
+		InFile(header.AttributeOffset, (std::uint64_t)header.AttributeCount * sizeof(MeshCacheAttribute), fileSize) &&
+		InFile(header.SubmeshOffset, (std::uint64_t)header.SubmeshCount * sizeof(MeshCacheSubmesh), fileSize) &&
+		InFile(header.BlobOffset, (std::uint64_t)header.BlobCount * sizeof(MeshCacheBlob), fileSize) &&
+		InFile(header.VertexDataOffset, header.VertexDataSize, fileSize) && InFile(header.IndexDataOffset, header.IndexDataSize, fileSize);
+
+	// Uncompressed buffers are stored at their full size.
+	valid = valid &&
+		((header.Flags & MeshCache_CompressedVertices) || header.VertexDataSize == (std::uint64_t)header.VertexStride * header.VertexCount) &&
+		((header.Flags & MeshCache_CompressedIndices) || header.IndexDataSize == (std::uint64_t)IndexSize(header.IndexFormat) * header.IndexCount);
+
+	// Tables are read in place, so their offsets must keep them aligned.
+	valid = valid && header.AttributeOffset % 8 == 0 && header.SubmeshOffset % 8 == 0 && header.BlobOffset % 8 == 0 &&
+		header.VertexDataOffset % MeshCacheAlignment == 0 && header.IndexDataOffset % MeshCacheAlignment == 0;
+
+	if (valid)
+	{
+		auto submeshes = (const MeshCacheSubmesh*)(m_file.Data() + header.SubmeshOffset);
+		for (std::uint32_t i = 0; valid && i < header.SubmeshCount; ++i)
+			valid = (std::uint64_t)submeshes[i].StartIndexLocation + submeshes[i].IndexCount <= header.IndexCount;
+
+		auto blobs = (const MeshCacheBlob*)(m_file.Data() + header.BlobOffset);
+		for (std::uint32_t i = 0; valid && i < header.BlobCount; ++i)
+			valid = InFile(blobs[i].Offset, blobs[i].Size, fileSize);
+	}
+
+	if (!valid)
+	{
+		Close();
+		return false;
+	}
+
+	m_header = &header;
+	return true;
+}
+
+void MeshCache::Close() {
+	m_file.Close();
+	m_header = nullptr;
+}
+
+const MeshCacheSubmesh* MeshCache::FindSubmesh(const std::string& name) const {
+	const MeshCacheSubmesh* submeshes = Submeshes();
+	for (std::uint32_t i = 0; i < m_header->SubmeshCount; ++i)
+		if (NameEquals(submeshes[i].Name, name))
+			return &submeshes[i];
+	return nullptr;
+}
+
+std::size_t MeshCache::IndexBufferSize() const {
+	return (std::size_t)IndexSize(m_header->IndexFormat) * m_header->IndexCount;
+}
+
+const void* MeshCache::MappedVertices() const {
+	return (m_header->Flags & MeshCache_CompressedVertices) ? nullptr : m_file.Data() + m_header->VertexDataOffset;
+}
+
+const void* MeshCache::MappedIndices() const {
+	return (m_header->Flags & MeshCache_CompressedIndices) ? nullptr : m_file.Data() + m_header->IndexDataOffset;
+}
+
+bool MeshCache::ReadVertices(void* vertices, ThreadPool* pool) const {
+	const std::uint8_t* data = m_file.Data() + m_header->VertexDataOffset;
+	if (m_header->Flags & MeshCache_CompressedVertices)
+		return DecodeVertexBuffer(vertices, m_header->VertexCount, m_header->VertexStride, data, (std::size_t)m_header->VertexDataSize, pool);
+
+	std::memcpy(vertices, data, VertexBufferSize());
+	return true;
+}
+
+bool MeshCache::ReadIndices(void* indices, ThreadPool* pool) const {
+	const std::uint8_t* data = m_file.Data() + m_header->IndexDataOffset;
+	if (m_header->Flags & MeshCache_CompressedIndices)
+		return DecodeIndexBuffer(indices, m_header->IndexCount, IndexSize(m_header->IndexFormat), data, (std::size_t)m_header->IndexDataSize, pool);
+
+	std::memcpy(indices, data, IndexBufferSize());
+	return true;
+}
+
+const void* MeshCache::FindBlob(const std::string& name, std::size_t& size) const {
+	auto blobs = (const MeshCacheBlob*)(m_file.Data() + m_header->BlobOffset);
+	for (std::uint32_t i = 0; i < m_header->BlobCount; ++i)
+	{
+		if (NameEquals(blobs[i].Name, name))
+		{
+			size = (std::size_t)blobs[i].Size;
+			return m_file.Data() + blobs[i].Offset;
+		}
+	}
+	size = 0;
+	return nullptr;
+}
@@ -0,0 +1,174 @@
+#pragma once
+
+#include "MappedFile.h"
+#include <DirectXMath.h>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+class ThreadPool;
+
+// Binary container for a processed mesh, read back without parsing. Layout:
+//
+//	MeshCacheHeader
+//	MeshCacheAttribute[AttributeCount]	vertex layout
+//	MeshCacheSubmesh[SubmeshCount]		DrawArgs entries
+//	MeshCacheBlob[BlobCount]			extra named data
+//	vertex data, index data, blob data	each aligned to MeshCacheAlignment
+//
+// All fields are little-endian. The header stamps the size and write time of the
+// file the mesh was built from, so a cache is rebuilt once its source changes.
+// The vertex and index data may be stored compressed with MeshCodec.
+
+const std::uint32_t MeshCacheMagic = 0x434d5a57; // "WZMC"
+const std::uint32_t MeshCacheVersion = 2;
+const std::uint32_t MeshCacheAlignment = 64;
+const std::size_t MeshCacheNameLength = 32;
+
+enum MeshCacheFlags : std::uint32_t {
+	MeshCache_CompressedVertices = 1 << 0,
+	MeshCache_CompressedIndices = 1 << 1,
+};
+
+struct MeshCacheHeader {
+	std::uint32_t Magic;
+	std::uint32_t Version;
+	std::uint64_t FileSize;
+	std::uint64_t SourceSize;
+	std::uint64_t SourceTime;
+
+	std::uint32_t VertexStride;
+	std::uint32_t VertexCount;
+	// DXGI_FORMAT_R16_UINT or DXGI_FORMAT_R32_UINT.
+	std::uint32_t IndexFormat;
+	std::uint32_t IndexCount;
+
+	std::uint32_t AttributeCount;
+	std::uint32_t SubmeshCount;
+	std::uint32_t BlobCount;
+	std::uint32_t Flags;
+
+	DirectX::XMFLOAT3 BoundsMin;
+	DirectX::XMFLOAT3 BoundsMax;
+
+	std::uint64_t AttributeOffset;
+	std::uint64_t SubmeshOffset;
+	std::uint64_t BlobOffset;
+	std::uint64_t VertexDataOffset;
+	std::uint64_t IndexDataOffset;
+	// Stored sizes, smaller than the buffers when compressed.
+	std::uint64_t VertexDataSize;
+	std::uint64_t IndexDataSize;
+};
+
+// One element of the vertex layout, as in D3D12_INPUT_ELEMENT_DESC.
+struct MeshCacheAttribute {
+	char Semantic[MeshCacheNameLength];
+	std::uint32_t SemanticIndex;
+	// DXGI_FORMAT of the element.
+	std::uint32_t Format;
+	std::uint32_t Offset;
+	std::uint32_t Reserved;
+};
+
+struct MeshCacheSubmesh {
+	char Name[MeshCacheNameLength];
+	std::uint32_t IndexCount;
+	std::uint32_t StartIndexLocation;
+	std::int32_t BaseVertexLocation;
+	// LodLevel::GeometricError of the submesh, 0 when it is not a level of detail.
+	float GeometricError;
+	DirectX::XMFLOAT3 BoundsCenter;
+	DirectX::XMFLOAT3 BoundsExtents;
+};
+
+struct MeshCacheBlob {
+	char Name[MeshCacheNameLength];
+	std::uint64_t Offset;
+	std::uint64_t Size;
+};
+
+// Size and last write time of a file, 0 when it does not exist.
+struct MeshCacheSource {
+	std::uint64_t Size = 0;
+	std::uint64_t Time = 0;
+};
+
+MeshCacheSource GetMeshCacheSource(const std::string& path);
+
+// What WriteMeshCache stores. The pointed-to data only has to live for the call.
+struct MeshCacheContents {
+	std::vector<MeshCacheAttribute> Attributes;
+	std::vector<MeshCacheSubmesh> Submeshes;
+
+	const void* Vertices = nullptr;
+	std::uint32_t VertexStride = 0;
+	std::uint32_t VertexCount = 0;
+
+	const void* Indices = nullptr;
+	std::uint32_t IndexFormat = 0;
+	std::uint32_t IndexCount = 0;
+
+	DirectX::XMFLOAT3 BoundsMin = { 0.0f, 0.0f, 0.0f };
+	DirectX::XMFLOAT3 BoundsMax = { 0.0f, 0.0f, 0.0f };
+
+	// Stores the vertices and indices with MeshCodec. Smaller on disk, but they
+	// can no longer be uploaded straight from the mapping.
+	bool Compress = false;
+
+	struct Blob {
+		std::string Name;
+		const void* Data;
+		std::size_t Size;
+	};
+	std::vector<Blob> Blobs;
+
+	void AddAttribute(const char* semantic, std::uint32_t semanticIndex, std::uint32_t format, std::uint32_t offset);
+	// Returns false if the name does not fit in MeshCacheNameLength - 1 characters.
+	bool AddSubmesh(const std::string& name, std::uint32_t indexCount, std::uint32_t startIndexLocation, std::int32_t baseVertexLocation,
+		const DirectX::XMFLOAT3& boundsCenter, const DirectX::XMFLOAT3& boundsExtents, float geometricError = 0.0f);
+	void AddBlob(const std::string& name, const void* data, std::size_t size) { Blobs.push_back({ name, data, size }); }
+};
+
+// Writes the cache through a temporary file that replaces path once complete, so
+// a crash never leaves a torn cache behind. Blob names that do not fit fail the
+// write.
+bool WriteMeshCache(const std::string& path, const MeshCacheContents& contents, const MeshCacheSource& source);
+
+// Read-only view of a cache file. The data pointers point into the mapping and
+// stay valid until the cache is closed.
+class MeshCache {
+public:
+	// Maps the file and checks its header, tables and ranges. Fails if the file is
+	// missing or damaged, was written by another version, or was not built from
+	// the given source.
+	bool Open(const std::string& path, const MeshCacheSource& source);
+	void Close();
+
+	bool IsOpen() const { return m_header != nullptr; }
+	const MeshCacheHeader& Header() const { return *m_header; }
+
+	const MeshCacheAttribute* Attributes() const { return (const MeshCacheAttribute*)(m_file.Data() + m_header->AttributeOffset); }
+	const MeshCacheSubmesh* Submeshes() const { return (const MeshCacheSubmesh*)(m_file.Data() + m_header->SubmeshOffset); }
+	const MeshCacheSubmesh* FindSubmesh(const std::string& name) const;
+
+	std::size_t VertexBufferSize() const { return (std::size_t)m_header->VertexStride * m_header->VertexCount; }
+	std::size_t IndexBufferSize() const;
+
+	// The buffers inside the mapping, or null when they are stored compressed.
+	const void* MappedVertices() const;
+	const void* MappedIndices() const;
+
+	// Copies or decodes the buffers into VertexBufferSize() and IndexBufferSize()
+	// bytes at the destination. Returns false if compressed data is damaged.
+	bool ReadVertices(void* vertices, ThreadPool* pool = nullptr) const;
+	bool ReadIndices(void* indices, ThreadPool* pool = nullptr) const;
+
+	// Returns null if there is no blob of that name.
+	const void* FindBlob(const std::string& name, std::size_t& size) const;
+
+private:
+	MappedFile m_file;
+	const MeshCacheHeader* m_header = nullptr;
+};
@@ -0,0 +1,624 @@
+#include "MeshCodec.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <cstring>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#define MESH_CODEC_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace {
+	const std::uint32_t VertexChunkSize = 4096;
+	const std::uint32_t IndexChunkSize = 3 * 8192;
+
+	// rANS with 12-bit probabilities and a 32-bit state renormalized 16 bits at a
+	// time, as in Fabian Giesen's rans_word, so a symbol needs at most one read.
+	// Symbol i is coded with state i % RansStates, which gives the decoder that
+	// many independent dependency chains.
+	const std::uint32_t ProbBits = 12;
+	const std::uint32_t ProbScale = 1 << ProbBits;
+	const std::uint32_t RansLow = 1u << 16;
+	const std::uint32_t RansStates = 4;
+
+	enum PlaneMode : std::uint8_t {
+		Plane_Constant = 0,
+		Plane_Raw = 1,
+		Plane_Rans = 2,
+	};
+
+	void PutU16(std::vector<std::uint8_t>& out, std::uint32_t value) {
+		out.push_back((std::uint8_t)value);
+		out.push_back((std::uint8_t)(value >> 8));
+	}
+
+	void PutU32(std::vector<std::uint8_t>& out, std::uint32_t value) {
+		PutU16(out, value);
+		PutU16(out, value >> 16);
+	}
+
+	std::uint32_t GetU32(const std::uint8_t* p) {
+		return p[0] | (p[1] << 8) | (p[2] << 16) | ((std::uint32_t)p[3] << 24);
+	}
+
+	// Bounds-checked cursor over an encoded stream.
+	struct ByteReader {
+		const std::uint8_t* Position;
+		const std::uint8_t* End;
+
+		std::size_t Remaining() const { return (std::size_t)(End - Position); }
+
+		// Returns null if fewer than size bytes are left.
+		const std::uint8_t* Take(std::size_t size) {
+			if (size > Remaining())
+				return nullptr;
+			const std::uint8_t* p = Position;
+			Position += size;
+			return p;
+		}
+
+		bool ReadU8(std::uint32_t& value) {
+			const std::uint8_t* p = Take(1);
+			if (p)
+				value = p[0];
+			return p != nullptr;
+		}
+
+		bool ReadU16(std::uint32_t& value) {
+			const std::uint8_t* p = Take(2);
+			if (p)
+				value = p[0] | (p[1] << 8);
+			return p != nullptr;
+		}
+
+		bool ReadU32(std::uint32_t& value) {
+			const std::uint8_t* p = Take(4);
+			if (p)
+				value = GetU32(p);
+			return p != nullptr;
+		}
+	};
+
+	//
+	// Entropy coding
+	//
+
+	// Scales symbol counts to frequencies summing to ProbScale, keeping every
+	// present symbol at least 1.
+	void NormalizeFrequencies(const std::uint32_t (&counts)[256], std::size_t total, std::uint32_t (&freqs)[256]) {
+		std::uint32_t sum = 0;
+		for (int s = 0; s < 256; ++s)
+		{
+			freqs[s] = counts[s] ? std::max<std::uint32_t>(1, (std::uint32_t)((std::uint64_t)counts[s] * ProbScale / total)) : 0;
+			sum += freqs[s];
+		}
+
+		// Rounding down leaves a few slots over and the minimum of 1 may take a few
+		// too many. Settle the difference on the most frequent symbols, where it
+		// costs the least.
+		while (sum != ProbScale)
+		{
+			int largest = (int)(std::max_element(freqs, freqs + 256) - freqs);
+			if (sum < ProbScale)
+			{
+				freqs[largest] += ProbScale - sum;
+				sum = ProbScale;
+			}
+			else
+			{
+				std::uint32_t take = std::min(sum - ProbScale, freqs[largest] - 1);
+				freqs[largest] -= take;
+				sum -= take;
+			}
+		}
+	}
+
+	void RansPut(std::uint32_t& state, std::uint8_t*& p, std::uint32_t start, std::uint32_t freq) {
+		const std::uint32_t stateMax = ((RansLow >> ProbBits) << 16) * freq;
+		if (state >= stateMax)
+		{
+			p -= 2;
+			p[0] = (std::uint8_t)state;
+			p[1] = (std::uint8_t)(state >> 8);
+			state >>= 16;
+		}
+		state = ((state / freq) << ProbBits) + (state % freq) + start;
+	}
+
+	void RansFlush(std::uint32_t state, std::uint8_t*& p) {
+		p -= 4;
+		p[0] = (std::uint8_t)state;
+		p[1] = (std::uint8_t)(state >> 8);
+		p[2] = (std::uint8_t)(state >> 16);
+		p[3] = (std::uint8_t)(state >> 24);
+	}
+
+	// Appends one plane of n bytes in the smallest of the three modes.
+	void EncodePlane(const std::uint8_t* bytes, std::size_t n, std::vector<std::uint8_t>& out) {
+		std::uint32_t counts[256] = {};
+		for (std::size_t i = 0; i < n; ++i)
+			++counts[bytes[i]];
+
+		int symbolCount = 0;
+		for (int s = 0; s < 256; ++s)
+			symbolCount += counts[s] != 0;
+
+		if (symbolCount <= 1)
+		{
+			out.push_back(Plane_Constant);
+			out.push_back(n ? bytes[0] : 0);
+			return;
+		}
+
+		std::uint32_t freqs[256];
+		std::uint32_t starts[256];
+		NormalizeFrequencies(counts, n, freqs);
+		for (std::uint32_t s = 0, start = 0; s < 256; ++s)
+		{
+			starts[s] = start;
+			start += freqs[s];
+		}
+
+		// Each symbol emits at most two bytes, plus the flushed states.
+		std::vector<std::uint8_t> buffer(n * 2 + 4 * RansStates);
+		std::uint8_t* end = buffer.data() + buffer.size();
+		std::uint8_t* p = end;
+
+		// Coded backwards, so the decoder reads forwards.
+		std::uint32_t states[RansStates];
+		std::fill(states, states + RansStates, RansLow);
+		for (std::size_t i = n; i > 0; --i)
+			RansPut(states[(i - 1) % RansStates], p, starts[bytes[i - 1]], freqs[bytes[i - 1]]);
+		for (std::uint32_t k = RansStates; k > 0; --k)
+			RansFlush(states[k - 1], p);
+
+		// Raw planes decode with a copy, so rANS has to save at least an eighth of
+		// the plane to be worth its decode time.
+		const std::size_t payloadSize = (std::size_t)(end - p);
+		if (2 + 3 * (std::size_t)symbolCount + 4 + payloadSize > n - n / 8)
+		{
+			out.push_back(Plane_Raw);
+			out.insert(out.end(), bytes, bytes + n);
+			return;
+		}
+
+		out.push_back(Plane_Rans);
+		out.push_back((std::uint8_t)(symbolCount - 1));
+		for (int s = 0; s < 256; ++s)
+		{
+			if (freqs[s])
+			{
+				out.push_back((std::uint8_t)s);
+				PutU16(out, freqs[s] - 1);
+			}
+		}
+		PutU32(out, (std::uint32_t)payloadSize);
+		out.insert(out.end(), p, end);
+	}
+
+	bool DecodePlane(ByteReader& reader, std::uint8_t* bytes, std::size_t n) {
+		std::uint32_t mode;
+		if (!reader.ReadU8(mode))
+			return false;
+
+		if (mode == Plane_Constant)
+		{
+			std::uint32_t value;
+			if (!reader.ReadU8(value))
+				return false;
+			std::memset(bytes, (int)value, n);
+			return true;
+		}
+
+		if (mode == Plane_Raw)
+		{
+			const std::uint8_t* raw = reader.Take(n);
+			if (!raw)
+				return false;
+			std::memcpy(bytes, raw, n);
+			return true;
+		}
+
+		if (mode != Plane_Rans)
+			return false;
+
+		std::uint32_t symbolCount;
+		if (!reader.ReadU8(symbolCount))
+			return false;
+		++symbolCount;
+
+		// With at least two symbols every frequency and start fits in 12 bits, so
+		// a slot packs as freq | start << 12 | symbol << 24.
+		std::uint32_t slots[ProbScale];
+		std::uint32_t start = 0;
+		for (std::uint32_t i = 0; i < symbolCount; ++i)
+		{
+			std::uint32_t symbol, freq;
+			if (!reader.ReadU8(symbol) || !reader.ReadU16(freq))
+				return false;
+			++freq;
+			if (freq >= ProbScale || freq > ProbScale - start)
+				return false;
+			std::fill(slots + start, slots + start + freq, freq | (start << 12) | (symbol << 24));
+			start += freq;
+		}
+		if (start != ProbScale)
+			return false;
+
+		std::uint32_t payloadSize;
+		if (!reader.ReadU32(payloadSize) || payloadSize < 4 * RansStates)
+			return false;
+		const std::uint8_t* p = reader.Take(payloadSize);
+		if (!p)
+			return false;
+		const std::uint8_t* end = p + payloadSize;
+
+		std::uint32_t states[RansStates];
+		for (std::uint32_t k = 0; k < RansStates; ++k)
+			states[k] = GetU32(p + 4 * k);
+		p += 4 * RansStates;
+
+		const std::uint32_t mask = ProbScale - 1;
+		auto decode = [&](std::uint32_t& state) -> std::uint8_t {
+			std::uint32_t slot = slots[state & mask];
+			state = (slot & 0xfff) * (state >> ProbBits) + (state & mask) - ((slot >> 12) & 0xfff);
+			return (std::uint8_t)(slot >> 24);
+		};
+
+		// While every state can refill without running out of payload, refill
+		// without branching on the state.
+		// The states are kept in locals so they stay in registers.
+		static_assert(RansStates == 4, "the loop below is unrolled for four states");
+		std::uint32_t state0 = states[0], state1 = states[1], state2 = states[2], state3 = states[3];
+		auto refill = [&](std::uint32_t& state) {
+			std::uint32_t low = state < RansLow;
+			state = low ? (state << 16) | p[0] | (p[1] << 8) : state;
+			p += 2 * low;
+		};
+
+		std::size_t i = 0;
+		for (; i + RansStates <= n && (std::size_t)(end - p) >= 2 * RansStates; i += RansStates)
+		{
+			bytes[i] = decode(state0);
+			bytes[i + 1] = decode(state1);
+			bytes[i + 2] = decode(state2);
+			bytes[i + 3] = decode(state3);
+			refill(state0);
+			refill(state1);
+			refill(state2);
+			refill(state3);
+		}
+
+		states[0] = state0;
+		states[1] = state1;
+		states[2] = state2;
+		states[3] = state3;
+
+		for (; i < n; ++i)
+		{
+			std::uint32_t& state = states[i % RansStates];
+			bytes[i] = decode(state);
+			if (state < RansLow && end - p >= 2)
+			{
+				state = (state << 16) | p[0] | (p[1] << 8);
+				p += 2;
+			}
+		}
+
+		// The states are back where the encoder started once all of the payload
+		// has been read, unless the data is damaged.
+		for (std::uint32_t k = 0; k < RansStates; ++k)
+			if (states[k] != RansLow)
+				return false;
+		return p == end;
+	}
+
+	//
+	// Vertices
+	//
+
+	void EncodeVertexChunk(const std::uint8_t* vertices, std::size_t count, std::size_t stride, std::vector<std::uint8_t>& out) {
+		std::vector<std::uint8_t> plane(count);
+		for (std::size_t word = 0; word < stride / 4; ++word)
+		{
+			for (std::uint32_t byte = 0; byte < 4; ++byte)
+			{
+				std::uint32_t previous = 0;
+				for (std::size_t i = 0; i < count; ++i)
+				{
+					std::uint32_t value;
+					std::memcpy(&value, vertices + i * stride + word * 4, 4);
+					plane[i] = (std::uint8_t)((value ^ previous) >> (8 * byte));
+					previous = value;
+				}
+				EncodePlane(plane.data(), count, out);
+			}
+		}
+	}
+
+	// Joins the four byte planes of a word into XOR deltas and undoes the deltas
+	// with a running XOR.
+	void BuildColumn(const std::uint8_t* planes, std::size_t count, std::uint32_t* column) {
+		const std::uint8_t* b0 = planes;
+		const std::uint8_t* b1 = planes + count;
+		const std::uint8_t* b2 = planes + 2 * count;
+		const std::uint8_t* b3 = planes + 3 * count;
+
+		std::size_t i = 0;
+		std::uint32_t previous = 0;
+
+#ifdef MESH_CODEC_SSE2
+		__m128i carry = _mm_setzero_si128();
+		for (; i + 16 <= count; i += 16)
+		{
+			__m128i p0 = _mm_loadu_si128((const __m128i*)(b0 + i));
+			__m128i p1 = _mm_loadu_si128((const __m128i*)(b1 + i));
+			__m128i p2 = _mm_loadu_si128((const __m128i*)(b2 + i));
+			__m128i p3 = _mm_loadu_si128((const __m128i*)(b3 + i));
+
+			__m128i low01 = _mm_unpacklo_epi8(p0, p1);
+			__m128i high01 = _mm_unpackhi_epi8(p0, p1);
+			__m128i low23 = _mm_unpacklo_epi8(p2, p3);
+			__m128i high23 = _mm_unpackhi_epi8(p2, p3);
+
+			__m128i deltas[4] = {
+				_mm_unpacklo_epi16(low01, low23),
+				_mm_unpackhi_epi16(low01, low23),
+				_mm_unpacklo_epi16(high01, high23),
+				_mm_unpackhi_epi16(high01, high23),
+			};
+
+			// Prefix XOR across the four lanes, then across vectors.
+			for (int k = 0; k < 4; ++k)
+			{
+				__m128i v = deltas[k];
+				v = _mm_xor_si128(v, _mm_slli_si128(v, 4));
+				v = _mm_xor_si128(v, _mm_slli_si128(v, 8));
+				v = _mm_xor_si128(v, carry);
+				_mm_storeu_si128((__m128i*)(column + i + 4 * k), v);
+				carry = _mm_shuffle_epi32(v, _MM_SHUFFLE(3, 3, 3, 3));
+			}
+		}
+		previous = (std::uint32_t)_mm_cvtsi128_si32(carry);
+#endif
+
+		for (; i < count; ++i)
+		{
+			previous ^= b0[i] | (b1[i] << 8) | (b2[i] << 16) | ((std::uint32_t)b3[i] << 24);
+			column[i] = previous;
+		}
+	}
+
+	// Writes word w of vertex i from columns[w * count + i].
+	void ScatterColumns(const std::uint32_t* columns, std::size_t words, std::size_t count, std::uint8_t* vertices, std::size_t stride) {
+		std::size_t word = 0;
+
+#ifdef MESH_CODEC_SSE2
+		// Four words of four vertices at a time, with a 4x4 transpose.
+		for (; word + 4 <= words; word += 4)
+		{
+			const std::uint32_t* c0 = columns + word * count;
+			const std::uint32_t* c1 = c0 + count;
+			const std::uint32_t* c2 = c1 + count;
+			const std::uint32_t* c3 = c2 + count;
+
+			std::size_t i = 0;
+			for (; i + 4 <= count; i += 4)
+			{
+				__m128i r0 = _mm_loadu_si128((const __m128i*)(c0 + i));
+				__m128i r1 = _mm_loadu_si128((const __m128i*)(c1 + i));
+				__m128i r2 = _mm_loadu_si128((const __m128i*)(c2 + i));
+				__m128i r3 = _mm_loadu_si128((const __m128i*)(c3 + i));
+
+				__m128i t0 = _mm_unpacklo_epi32(r0, r1);
+				__m128i t1 = _mm_unpacklo_epi32(r2, r3);
+				__m128i t2 = _mm_unpackhi_epi32(r0, r1);
+				__m128i t3 = _mm_unpackhi_epi32(r2, r3);
+
+				std::uint8_t* v = vertices + i * stride + word * 4;
+				_mm_storeu_si128((__m128i*)v, _mm_unpacklo_epi64(t0, t1));
+				_mm_storeu_si128((__m128i*)(v + stride), _mm_unpackhi_epi64(t0, t1));
+				_mm_storeu_si128((__m128i*)(v + 2 * stride), _mm_unpacklo_epi64(t2, t3));
+				_mm_storeu_si128((__m128i*)(v + 3 * stride), _mm_unpackhi_epi64(t2, t3));
+			}
+
+			for (; i < count; ++i)
+			{
+				const std::uint32_t values[4] = { c0[i], c1[i], c2[i], c3[i] };
+				std::memcpy(vertices + i * stride + word * 4, values, sizeof(values));
+			}
+		}
+#endif
+
+		for (; word < words; ++word)
+			for (std::size_t i = 0; i < count; ++i)
+				std::memcpy(vertices + i * stride + word * 4, &columns[word * count + i], 4);
+	}
+
+	bool DecodeVertexChunk(ByteReader& reader, std::uint8_t* vertices, std::size_t count, std::size_t stride) {
+		const std::size_t words = stride / 4;
+		std::vector<std::uint8_t> planes(4 * count);
+		std::vector<std::uint32_t> columns(words * count);
+
+		for (std::size_t word = 0; word < words; ++word)
+		{
+			for (std::size_t byte = 0; byte < 4; ++byte)
+				if (!DecodePlane(reader, &planes[byte * count], count))
+					return false;
+			BuildColumn(planes.data(), count, &columns[word * count]);
+		}
+
+		ScatterColumns(columns.data(), words, count, vertices, stride);
+		return reader.Remaining() == 0;
+	}
+
+	//
+	// Indices
+	//
+
+	template <typename Index>
+	void EncodeIndexChunk(const Index* indices, std::size_t count, std::vector<std::uint8_t>& out) {
+		std::vector<std::uint8_t> bytes;
+		bytes.reserve(count * 2);
+
+		std::uint32_t previous = 0;
+		for (std::size_t i = 0; i < count; ++i)
+		{
+			std::uint32_t delta = (std::uint32_t)indices[i] - previous;
+			std::uint32_t zigzag = (delta << 1) ^ (0u - (delta >> 31));
+			while (zigzag >= 0x80)
+			{
+				bytes.push_back((std::uint8_t)(zigzag | 0x80));
+				zigzag >>= 7;
+			}
+			bytes.push_back((std::uint8_t)zigzag);
+			previous = indices[i];
+		}
+
+		PutU32(out, (std::uint32_t)bytes.size());
+		EncodePlane(bytes.data(), bytes.size(), out);
+	}
+
+	template <typename Index>
+	bool DecodeIndexChunk(ByteReader& reader, Index* indices, std::size_t count) {
+		std::uint32_t byteCount;
+		if (!reader.ReadU32(byteCount) || byteCount < count || byteCount > count * 5)
+			return false;
+
+		std::vector<std::uint8_t> bytes(byteCount);
+		if (!DecodePlane(reader, bytes.data(), byteCount) || reader.Remaining() != 0)
+			return false;
+
+		const std::uint8_t* p = bytes.data();
+		const std::uint8_t* end = p + byteCount;
+		std::uint32_t previous = 0;
+		for (std::size_t i = 0; i < count; ++i)
+		{
+			std::uint32_t zigzag = 0;
+			for (std::uint32_t shift = 0; ; shift += 7)
+			{
+				if (p == end || shift > 28)
+					return false;
+				std::uint32_t byte = *p++;
+				zigzag |= (byte & 0x7f) << shift;
+				if (byte < 0x80)
+					break;
+			}
+
+			previous += (zigzag >> 1) ^ (0u - (zigzag & 1));
+			if (previous > (Index)~(Index)0)
+				return false;
+			indices[i] = (Index)previous;
+		}
+		return p == end;
+	}
+
+	//
+	// Chunked streams
+	//
+	// Header: element count, element size, elements per chunk, chunk count, and
+	// the encoded size of every chunk, followed by the chunks.
+
+	template <typename EncodeChunk>
+	std::vector<std::uint8_t> EncodeChunks(std::size_t elementCount, std::size_t elementSize, std::uint32_t chunkSize, EncodeChunk&& encode) {
+		const std::size_t chunkCount = (elementCount + chunkSize - 1) / chunkSize;
+
+		std::vector<std::vector<std::uint8_t>> chunks(chunkCount);
+		for (std::size_t c = 0; c < chunkCount; ++c)
+		{
+			std::size_t first = c * chunkSize;
+			encode(first, std::min<std::size_t>(chunkSize, elementCount - first), chunks[c]);
+		}
+
+		std::vector<std::uint8_t> out;
+		PutU32(out, (std::uint32_t)elementCount);
+		PutU32(out, (std::uint32_t)elementSize);
+		PutU32(out, chunkSize);
+		PutU32(out, (std::uint32_t)chunkCount);
+		for (const auto& chunk : chunks)
+			PutU32(out, (std::uint32_t)chunk.size());
+		for (const auto& chunk : chunks)
+			out.insert(out.end(), chunk.begin(), chunk.end());
+		return out;
+	}
+
+	template <typename DecodeChunk>
+	bool DecodeChunks(const std::uint8_t* data, std::size_t size, std::size_t elementCount, std::size_t elementSize,
+		ThreadPool* pool, DecodeChunk&& decode) {
+		ByteReader reader = { data, data + size };
+
+		std::uint32_t storedCount, storedSize, chunkSize, chunkCount;
+		if (!reader.ReadU32(storedCount) || !reader.ReadU32(storedSize) || !reader.ReadU32(chunkSize) || !reader.ReadU32(chunkCount))
+			return false;
+		if (storedCount != elementCount || storedSize != elementSize || chunkSize == 0 ||
+			chunkCount != (elementCount + chunkSize - 1) / chunkSize || chunkCount > reader.Remaining() / 4)
+			return false;
+
+		std::vector<ByteReader> chunks(chunkCount);
+		const std::uint8_t* chunkData = reader.Position + chunkCount * 4;
+		std::size_t offset = 0;
+		for (std::uint32_t c = 0; c < chunkCount; ++c)
+		{
+			std::uint32_t chunkBytes = 0;
+			reader.ReadU32(chunkBytes);
+			if (chunkBytes > (std::size_t)(data + size - chunkData) - offset)
+				return false;
+			chunks[c] = { chunkData + offset, chunkData + offset + chunkBytes };
+			offset += chunkBytes;
+		}
+
+		// One flag per chunk, written by the thread that decodes it.
+		std::vector<std::uint8_t> decoded(chunkCount, 0);
+		auto run = [&](std::uint32_t c) {
+			std::size_t first = (std::size_t)c * chunkSize;
+			decoded[c] = decode(chunks[c], first, std::min<std::size_t>(chunkSize, elementCount - first));
+		};
+
+		if (pool && chunkCount > 1)
+			pool->ParallelFor(chunkCount, run);
+		else
+			for (std::uint32_t c = 0; c < chunkCount; ++c)
+				run(c);
+
+		return std::find(decoded.begin(), decoded.end(), 0) == decoded.end();
+	}
+}
+
+std::vector<std::uint8_t> EncodeVertexBuffer(const void* vertices, std::size_t vertexCount, std::size_t vertexStride) {
+	auto bytes = (const std::uint8_t*)vertices;
+	return EncodeChunks(vertexCount, vertexStride, VertexChunkSize, [&](std::size_t first, std::size_t count, std::vector<std::uint8_t>& out) {
+		EncodeVertexChunk(bytes + first * vertexStride, count, vertexStride, out);
+	});
+}
+
+bool DecodeVertexBuffer(void* vertices, std::size_t vertexCount, std::size_t vertexStride,
+	const std::uint8_t* data, std::size_t size, ThreadPool* pool) {
+	if (vertexStride == 0 || vertexStride % 4 != 0)
+		return false;
+
+	auto bytes = (std::uint8_t*)vertices;
+	return DecodeChunks(data, size, vertexCount, vertexStride, pool, [&](ByteReader reader, std::size_t first, std::size_t count) {
+		return DecodeVertexChunk(reader, bytes + first * vertexStride, count, vertexStride);
+	});
+}
+
+std::vector<std::uint8_t> EncodeIndexBuffer(const void* indices, std::size_t indexCount, std::size_t indexSize) {
+	return EncodeChunks(indexCount, indexSize, IndexChunkSize, [&](std::size_t first, std::size_t count, std::vector<std::uint8_t>& out) {
+		if (indexSize == 2)
+			EncodeIndexChunk((const std::uint16_t*)indices + first, count, out);
+		else
+			EncodeIndexChunk((const std::uint32_t*)indices + first, count, out);
+	});
+}
+
+bool DecodeIndexBuffer(void* indices, std::size_t indexCount, std::size_t indexSize,
+	const std::uint8_t* data, std::size_t size, ThreadPool* pool) {
+	if (indexSize != 2 && indexSize != 4)
+		return false;
+
+	return DecodeChunks(data, size, indexCount, indexSize, pool, [&](ByteReader reader, std::size_t first, std::size_t count) {
+		if (indexSize == 2)
+			return DecodeIndexChunk(reader, (std::uint16_t*)indices + first, count);
+		return DecodeIndexChunk(reader, (std::uint32_t*)indices + first, count);
+	});
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+class ThreadPool;
+
+// Lossless compression for vertex and index buffers on disk. Both buffers are
+// split into chunks that are coded independently, so they decode in parallel.
+//
+// Vertices: each 32-bit word of a vertex is XORed with the same word of the
+// previous vertex, which zeroes the sign, exponent and high mantissa bits that
+// neighbouring vertices share once the mesh is in vertex fetch order. The deltas
+// are split into byte planes (byte b of word w of every vertex) and each plane
+// is entropy coded on its own.
+//
+// Indices: each index is stored as the zigzag-coded difference to the previous
+// one, which is small for meshes in vertex cache order, as a LEB128 varint. The
+// varint bytes are then entropy coded.
+//
+// Entropy coding is order-0 rANS with a table per plane. Planes that do not
+// compress are stored raw, and planes holding a single value as that value.
+
+// vertexStride must be a multiple of 4 bytes.
+std::vector<std::uint8_t> EncodeVertexBuffer(const void* vertices, std::size_t vertexCount, std::size_t vertexStride);
+
+// Returns false if the data is damaged or was encoded with another count or stride.
+bool DecodeVertexBuffer(void* vertices, std::size_t vertexCount, std::size_t vertexStride,
+	const std::uint8_t* data, std::size_t size, ThreadPool* pool = nullptr);
+
+// indexSize is 2 or 4 bytes.
+std::vector<std::uint8_t> EncodeIndexBuffer(const void* indices, std::size_t indexCount, std::size_t indexSize);
+
+// Returns false if the data is damaged or was encoded with another count or index size.
+bool DecodeIndexBuffer(void* indices, std::size_t indexCount, std::size_t indexSize,
+	const std::uint8_t* data, std::size_t size, ThreadPool* pool = nullptr);
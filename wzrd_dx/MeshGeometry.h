@@ -33,6 +33,11 @@ public:
 	DXGI_FORMAT IndexFormat = DXGI_FORMAT_R16_UINT;
 	UINT IndexBufferByteSize = 0;
 
+	// Where GeometryPool put the mesh in its shared buffers. DrawArgs already
+	// include these; the CPU copies do not.
+	UINT PoolBaseVertex = 0;
+	UINT PoolStartIndex = 0;
+
 	// MeshGeometry can store multiple geometries in one vertex/index buffer.
 	// This container defines the Submesh geometries so we can draw them individually.
 	std::unordered_map<std::string, SubmeshGeometry> DrawArgs;
@@ -0,0 +1,68 @@
+#include "MeshLod.h"
+#include <cmath>
+
+using namespace DirectX;
+
+std::string LodSubmeshName(const std::string& baseName, std::uint32_t level) {
+	if (level == 0)
+		return baseName;
+	return baseName + "_lod" + std::to_string(level);
+}
+
+float LodErrorScale(float yScale, float viewportHeight) {
+	return 0.5f * yScale * viewportHeight;
+}
+
+float LodWorldScale(FXMMATRIX world) {
+	float sx = XMVectorGetX(XMVector3LengthSq(world.r[0]));
+	float sy = XMVectorGetX(XMVector3LengthSq(world.r[1]));
+	float sz = XMVectorGetX(XMVector3LengthSq(world.r[2]));
+	float s = sx > sy ? sx : sy;
+	return sqrtf(s > sz ? s : sz);
+}
+
+std::uint32_t SelectLod(const LodChain& chain, std::uint32_t currentLod, float worldScale, float distance,
+	float errorScale, float maxPixelError, float hysteresis)
+{
+	if (chain.Levels.empty())
+		return 0;
+
+	std::uint32_t levelCount = (std::uint32_t)chain.Levels.size();
+	if (currentLod >= levelCount)
+		currentLod = levelCount - 1;
+
+	// Inside the bounds every level is too coarse.
+	if (distance <= 0.0f)
+		return 0;
+
+	float pixelsPerUnit = worldScale * errorScale / distance;
+	auto pixelError = [&](std::uint32_t level) { return chain.Levels[level].GeometricError * pixelsPerUnit; };
+
+	// Too coarse: refine to the coarsest level that is good enough.
+	if (pixelError(currentLod) > maxPixelError)
+	{
+		std::uint32_t level = currentLod;
+		while (level > 0 && pixelError(level) > maxPixelError)
+			level--;
+		return level;
+	}
+
+	// Good enough: only coarsen with some margin.
+	float coarsenThreshold = maxPixelError * (1.0f - hysteresis);
+	std::uint32_t level = currentLod;
+	while (level + 1 < levelCount && pixelError(level + 1) <= coarsenThreshold)
+		level++;
+	return level;
+}
+
+std::uint32_t SelectItemLod(const LodChain& chain, std::uint32_t currentLod, const BoundingBox& bounds,
+	FXMMATRIX world, FXMVECTOR eyePos, float errorScale, float maxPixelError)
+{
+	BoundingBox worldBounds;
+	bounds.Transform(worldBounds, world);
+
+	float distance = XMVectorGetX(XMVector3Length(XMLoadFloat3(&worldBounds.Center) - eyePos)) -
+		XMVectorGetX(XMVector3Length(XMLoadFloat3(&worldBounds.Extents)));
+
+	return SelectLod(chain, currentLod, LodWorldScale(world), distance, errorScale, maxPixelError);
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <DirectXCollision.h>
+#include <DirectXMath.h>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// One level of detail: the DrawArgs submesh to draw and how far, in object
+// space units, it may be from the full detail surface.
+struct LodLevel {
+	std::string Submesh;
+	float GeometricError = 0.0f;
+};
+
+// Levels from finest to coarsest, all stored in the same MeshGeometry.
+struct LodChain {
+	std::vector<LodLevel> Levels;
+};
+
+// Name of the DrawArgs entry of a level: level 0 keeps the base name, the others
+// are stored as "<name>_lod<level>".
+std::string LodSubmeshName(const std::string& baseName, std::uint32_t level);
+
+// Pixels covered by one world unit at distance 1. yScale is 1/tan(fovY/2), the
+// (1,1) entry of the projection matrix.
+float LodErrorScale(float yScale, float viewportHeight);
+
+// Largest scale factor of a world matrix, to bring object space errors to world space.
+float LodWorldScale(DirectX::FXMMATRIX world);
+
+// Picks the coarsest level whose error projects to at most maxPixelError. To
+// stop items flickering between two levels at the boundary, a coarser level is
+// only taken once its error is below maxPixelError * (1 - hysteresis).
+std::uint32_t SelectLod(const LodChain& chain, std::uint32_t currentLod, float worldScale, float distance,
+	float errorScale, float maxPixelError, float hysteresis = 0.2f);
+
+// SelectLod for an item with local space bounds placed by world, seen from
+// eyePos. The distance is to the closest point of the bounding sphere.
+std::uint32_t SelectItemLod(const LodChain& chain, std::uint32_t currentLod, const DirectX::BoundingBox& bounds,
+	DirectX::FXMMATRIX world, DirectX::FXMVECTOR eyePos, float errorScale, float maxPixelError);
@@ -0,0 +1,340 @@
+#include "MeshOptimizer.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+using namespace DirectX;
+
+VertexCacheStats AnalyzeVertexCache(const std::uint32_t* indices, std::size_t indexCount, std::size_t vertexCount, std::uint32_t cacheSize) {
+	VertexCacheStats stats;
+	if (indexCount < 3)
+		return stats;
+
+	// Timestamp of the miss that loaded each vertex. A vertex is in the FIFO
+	// while fewer than cacheSize misses happened since then.
+	std::vector<std::uint32_t> loadedAt(vertexCount, 0);
+	std::vector<bool> referenced(vertexCount, false);
+	std::uint32_t misses = 0;
+
+	for (std::size_t i = 0; i < indexCount; ++i)
+	{
+		std::uint32_t v = indices[i];
+		referenced[v] = true;
+		if (loadedAt[v] == 0 || misses - loadedAt[v] + 1 > cacheSize)
+		{
+			misses++;
+			loadedAt[v] = misses;
+		}
+	}
+
+	std::size_t referencedCount = std::count(referenced.begin(), referenced.end(), true);
+	stats.Acmr = (float)misses / (float)(indexCount / 3);
+	stats.Atvr = referencedCount ? (float)misses / (float)referencedCount : 0.0f;
+	return stats;
+}
+
+namespace {
+
+const std::uint32_t ForsythCacheSize = 32;
+
+// Tom Forsyth, "Linear-Speed Vertex Cache Optimisation".
+float ForsythVertexScore(int cachePosition, std::uint32_t remainingTriangles) {
+	if (remainingTriangles == 0)
+		return -1.0f;
+
+	float score = 0.0f;
+	if (cachePosition >= 0)
+	{
+		// The last triangle's vertices get a fixed score so the next triangle
+		// does not just reuse them.
+		if (cachePosition < 3)
+			score = 0.75f;
+		else
+			score = powf(1.0f - (float)(cachePosition - 3) / (ForsythCacheSize - 3), 1.5f);
+	}
+
+	// Favour vertices with few triangles left so they are finished and leave.
+	return score + 2.0f / sqrtf((float)remainingTriangles);
+}
+
+}
+
+void OptimizeVertexCache(std::uint32_t* indices, std::size_t indexCount, std::size_t vertexCount) {
+	std::size_t triangleCount = indexCount / 3;
+	if (triangleCount == 0)
+		return;
+
+	// Triangles of each vertex, packed.
+	std::vector<std::uint32_t> offsets(vertexCount + 1, 0);
+	for (std::size_t i = 0; i < triangleCount * 3; ++i)
+		offsets[indices[i] + 1]++;
+	for (std::size_t v = 0; v < vertexCount; ++v)
+		offsets[v + 1] += offsets[v];
+
+	std::vector<std::uint32_t> adjacency(triangleCount * 3);
+	std::vector<std::uint32_t> fill(offsets.begin(), offsets.end() - 1);
+	for (std::size_t t = 0; t < triangleCount; ++t)
+	{
+		for (int e = 0; e < 3; ++e)
+			adjacency[fill[indices[t * 3 + e]]++] = (std::uint32_t)t;
+	}
+
+	std::vector<std::uint32_t> remaining(vertexCount);
+	for (std::size_t v = 0; v < vertexCount; ++v)
+		remaining[v] = offsets[v + 1] - offsets[v];
+
+	std::vector<int> cachePosition(vertexCount, -1);
+	std::vector<float> vertexScore(vertexCount);
+	for (std::size_t v = 0; v < vertexCount; ++v)
+		vertexScore[v] = ForsythVertexScore(-1, remaining[v]);
+
+	std::vector<float> triangleScore(triangleCount);
+	for (std::size_t t = 0; t < triangleCount; ++t)
+		triangleScore[t] = vertexScore[indices[t * 3]] + vertexScore[indices[t * 3 + 1]] + vertexScore[indices[t * 3 + 2]];
+
+	std::vector<bool> emitted(triangleCount, false);
+	std::vector<std::uint32_t> result;
+	result.reserve(triangleCount * 3);
+
+	// Three slots past the end take the vertices pushed out by a new triangle.
+	std::uint32_t cache[ForsythCacheSize + 3];
+	std::uint32_t cacheCount = 0;
+	std::uint32_t newCache[ForsythCacheSize + 3];
+
+	std::size_t nextUnemitted = 0;
+	std::uint32_t bestTriangle = 0xffffffff;
+
+	for (std::size_t emittedCount = 0; emittedCount < triangleCount; ++emittedCount)
+	{
+		// No candidate around the cache: continue with the next triangle in input order.
+		if (bestTriangle == 0xffffffff)
+		{
+			while (emitted[nextUnemitted])
+				nextUnemitted++;
+			bestTriangle = (std::uint32_t)nextUnemitted;
+		}
+
+		const std::uint32_t* tri = &indices[bestTriangle * 3];
+		result.insert(result.end(), tri, tri + 3);
+		emitted[bestTriangle] = true;
+
+		// Move the triangle's vertices to the front of the cache.
+		std::uint32_t newCount = 0;
+		for (int e = 0; e < 3; ++e)
+			newCache[newCount++] = tri[e];
+		for (std::uint32_t i = 0; i < cacheCount; ++i)
+		{
+			std::uint32_t v = cache[i];
+			if (v != tri[0] && v != tri[1] && v != tri[2])
+				newCache[newCount++] = v;
+		}
+
+		for (int e = 0; e < 3; ++e)
+		{
+			std::uint32_t v = tri[e];
+			remaining[v]--;
+
+			// Drop the emitted triangle from the vertex's list.
+			std::uint32_t* begin = &adjacency[offsets[v]];
+			std::uint32_t* end = begin + remaining[v] + 1;
+			*std::find(begin, end, bestTriangle) = *(end - 1);
+		}
+
+		// Rescore the vertices that moved or fell out of the cache, and the
+		// triangles that use them.
+		for (std::uint32_t i = 0; i < newCount; ++i)
+		{
+			std::uint32_t v = newCache[i];
+			cachePosition[v] = i < ForsythCacheSize ? (int)i : -1;
+
+			float score = ForsythVertexScore(cachePosition[v], remaining[v]);
+			float delta = score - vertexScore[v];
+			vertexScore[v] = score;
+
+			for (std::uint32_t k = 0; k < remaining[v]; ++k)
+				triangleScore[adjacency[offsets[v] + k]] += delta;
+		}
+
+		cacheCount = std::min<std::uint32_t>(newCount, ForsythCacheSize);
+		std::copy(newCache, newCache + cacheCount, cache);
+
+		// The next triangle is the best one touching the cache.
+		bestTriangle = 0xffffffff;
+		float bestScore = -1.0f;
+		for (std::uint32_t i = 0; i < cacheCount; ++i)
+		{
+			std::uint32_t v = cache[i];
+			for (std::uint32_t k = 0; k < remaining[v]; ++k)
+			{
+				std::uint32_t t = adjacency[offsets[v] + k];
+				if (triangleScore[t] > bestScore)
+				{
+					bestScore = triangleScore[t];
+					bestTriangle = t;
+				}
+			}
+		}
+	}
+
+	std::copy(result.begin(), result.end(), indices);
+}
+
+void OptimizeOverdraw(std::uint32_t* indices, std::size_t indexCount, const XMFLOAT3* positions, std::size_t positionStride,
+	std::size_t vertexCount, float threshold)
+{
+	std::size_t triangleCount = indexCount / 3;
+	if (triangleCount < 2)
+		return;
+
+	auto position = [&](std::uint32_t v) {
+		return XMLoadFloat3((const XMFLOAT3*)((const std::uint8_t*)positions + v * positionStride));
+	};
+
+	// Split into clusters where the cache order jumps: a triangle whose three
+	// vertices all miss the cache starts a new cluster.
+	std::vector<std::uint32_t> clusterStarts;
+	{
+		std::vector<std::uint32_t> loadedAt(vertexCount, 0);
+		std::uint32_t misses = 0;
+		for (std::size_t t = 0; t < triangleCount; ++t)
+		{
+			int triangleMisses = 0;
+			for (int e = 0; e < 3; ++e)
+			{
+				std::uint32_t v = indices[t * 3 + e];
+				if (loadedAt[v] == 0 || misses - loadedAt[v] + 1 > 16)
+				{
+					misses++;
+					loadedAt[v] = misses;
+					triangleMisses++;
+				}
+			}
+			if (t == 0 || triangleMisses == 3)
+				clusterStarts.push_back((std::uint32_t)t);
+		}
+	}
+
+	if (clusterStarts.size() < 2)
+		return;
+
+	XMVECTOR meshCentroid = XMVectorZero();
+	for (std::size_t i = 0; i < indexCount; ++i)
+		meshCentroid += position(indices[i]);
+	meshCentroid /= (float)indexCount;
+
+	// Clusters that face away from the centre of the mesh are drawn first, they
+	// are the ones most likely to occlude the rest.
+	struct Cluster {
+		std::uint32_t First;
+		std::uint32_t Count;
+		float SortKey;
+	};
+	std::vector<Cluster> clusters;
+
+	for (std::size_t c = 0; c < clusterStarts.size(); ++c)
+	{
+		Cluster cluster;
+		cluster.First = clusterStarts[c];
+		cluster.Count = (c + 1 < clusterStarts.size() ? clusterStarts[c + 1] : (std::uint32_t)triangleCount) - cluster.First;
+
+		XMVECTOR centroid = XMVectorZero();
+		XMVECTOR normal = XMVectorZero();
+		float area = 0.0f;
+		for (std::uint32_t t = cluster.First; t < cluster.First + cluster.Count; ++t)
+		{
+			XMVECTOR p0 = position(indices[t * 3]);
+			XMVECTOR p1 = position(indices[t * 3 + 1]);
+			XMVECTOR p2 = position(indices[t * 3 + 2]);
+
+			// Area weighted normal and centroid.
+			XMVECTOR n = XMVector3Cross(p1 - p0, p2 - p0);
+			float a = XMVectorGetX(XMVector3Length(n));
+			normal += n;
+			centroid += (p0 + p1 + p2) * (a / 3.0f);
+			area += a;
+		}
+
+		if (area > 0.0f)
+			centroid /= area;
+		cluster.SortKey = XMVectorGetX(XMVector3Dot(centroid - meshCentroid, XMVector3Normalize(normal)));
+		clusters.push_back(cluster);
+	}
+
+	std::stable_sort(clusters.begin(), clusters.end(), [](const Cluster& a, const Cluster& b) { return a.SortKey > b.SortKey; });
+
+	std::vector<std::uint32_t> result;
+	result.reserve(indexCount);
+	for (const Cluster& cluster : clusters)
+		result.insert(result.end(), &indices[cluster.First * 3], &indices[(cluster.First + cluster.Count) * 3]);
+
+	// Only keep the new order when it does not cost too much vertex reuse.
+	float before = AnalyzeVertexCache(indices, triangleCount * 3, vertexCount).Acmr;
+	float after = AnalyzeVertexCache(result.data(), result.size(), vertexCount).Acmr;
+	if (after <= before * threshold)
+		std::copy(result.begin(), result.end(), indices);
+}
+
+std::size_t OptimizeVertexFetchRemap(std::vector<std::uint32_t>& remap, const std::uint32_t* indices, std::size_t indexCount, std::size_t vertexCount) {
+	remap.assign(vertexCount, 0xffffffff);
+
+	std::uint32_t next = 0;
+	for (std::size_t i = 0; i < indexCount; ++i)
+	{
+		if (remap[indices[i]] == 0xffffffff)
+			remap[indices[i]] = next++;
+	}
+	return next;
+}
+
+void RemapIndexBuffer(std::uint32_t* indices, std::size_t indexCount, const std::vector<std::uint32_t>& remap) {
+	for (std::size_t i = 0; i < indexCount; ++i)
+		indices[i] = remap[indices[i]];
+}
+
+void RemapVertexBuffer(void* destination, const void* vertices, std::size_t vertexCount, std::size_t vertexStride, const std::vector<std::uint32_t>& remap) {
+	// Work on a copy so destination may be the source buffer.
+	std::vector<std::uint8_t> source((const std::uint8_t*)vertices, (const std::uint8_t*)vertices + vertexCount * vertexStride);
+
+	for (std::size_t v = 0; v < vertexCount; ++v)
+	{
+		if (remap[v] != 0xffffffff)
+			memcpy((std::uint8_t*)destination + remap[v] * vertexStride, &source[v * vertexStride], vertexStride);
+	}
+}
+
+MeshOptimizationReport OptimizeMesh(std::vector<std::uint32_t>& indices, void* vertices, std::size_t& vertexCount, std::size_t vertexStride,
+	const XMFLOAT3* positions, std::uint32_t flags)
+{
+	MeshOptimizationReport report;
+	report.Before = AnalyzeVertexCache(indices.data(), indices.size(), vertexCount);
+
+	// Forsyth's order is tuned for a larger LRU cache and can lose to an input
+	// that is already in cache friendly order, such as the terrain strips.
+	if (flags & MeshOptimize_VertexCache)
+	{
+		std::vector<std::uint32_t> reordered = indices;
+		OptimizeVertexCache(reordered.data(), reordered.size(), vertexCount);
+		if (AnalyzeVertexCache(reordered.data(), reordered.size(), vertexCount).Acmr < report.Before.Acmr)
+			indices.swap(reordered);
+	}
+
+	// Overdraw may give back some of the vertex reuse won above, never more.
+	if ((flags & MeshOptimize_Overdraw) && positions)
+	{
+		float acmr = AnalyzeVertexCache(indices.data(), indices.size(), vertexCount).Acmr;
+		float threshold = acmr > 0.0f ? std::min(1.05f, report.Before.Acmr / acmr) : 1.0f;
+		OptimizeOverdraw(indices.data(), indices.size(), positions, vertexStride, vertexCount, threshold);
+	}
+
+	if (flags & MeshOptimize_VertexFetch)
+	{
+		std::vector<std::uint32_t> remap;
+		std::size_t fetchedVertexCount = OptimizeVertexFetchRemap(remap, indices.data(), indices.size(), vertexCount);
+		RemapIndexBuffer(indices.data(), indices.size(), remap);
+		RemapVertexBuffer(vertices, vertices, vertexCount, vertexStride, remap);
+		vertexCount = fetchedVertexCount;
+	}
+
+	report.After = AnalyzeVertexCache(indices.data(), indices.size(), vertexCount);
+	return report;
+}
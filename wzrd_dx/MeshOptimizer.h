@@ -0,0 +1,56 @@
+#pragma once
+
+#include <DirectXMath.h>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Post-transform vertex cache efficiency of an index buffer, simulated with a
+// FIFO cache. ACMR is misses per triangle (0.5 is ideal for large grids, 3 is
+// the worst), ATVR is misses per referenced vertex (1 is ideal).
+struct VertexCacheStats {
+	float Acmr = 0.0f;
+	float Atvr = 0.0f;
+};
+
+VertexCacheStats AnalyzeVertexCache(const std::uint32_t* indices, std::size_t indexCount, std::size_t vertexCount, std::uint32_t cacheSize = 16);
+
+// Reorders triangles for the post-transform vertex cache (Forsyth's linear-speed
+// algorithm). In place, triangles keep their winding.
+void OptimizeVertexCache(std::uint32_t* indices, std::size_t indexCount, std::size_t vertexCount);
+
+// Reorders clusters of triangles so the outward facing ones come first, which
+// lowers overdraw on convex-ish opaque meshes (Sander et al., "Fast triangle
+// reordering for vertex locality and reduced overdraw"). Expects cache
+// optimized indices and keeps the order when ACMR would grow above threshold
+// times the current value.
+void OptimizeOverdraw(std::uint32_t* indices, std::size_t indexCount, const DirectX::XMFLOAT3* positions, std::size_t positionStride,
+	std::size_t vertexCount, float threshold = 1.05f);
+
+// Builds a remap table that puts vertices in the order the indices first use
+// them, and returns the number of referenced vertices. Unreferenced vertices map
+// to 0xffffffff and are dropped by RemapVertexBuffer.
+std::size_t OptimizeVertexFetchRemap(std::vector<std::uint32_t>& remap, const std::uint32_t* indices, std::size_t indexCount, std::size_t vertexCount);
+void RemapIndexBuffer(std::uint32_t* indices, std::size_t indexCount, const std::vector<std::uint32_t>& remap);
+void RemapVertexBuffer(void* destination, const void* vertices, std::size_t vertexCount, std::size_t vertexStride, const std::vector<std::uint32_t>& remap);
+
+struct MeshOptimizationReport {
+	VertexCacheStats Before;
+	VertexCacheStats After;
+};
+
+enum MeshOptimizationFlags : std::uint32_t {
+	MeshOptimize_VertexCache = 1 << 0,
+	// Opaque meshes only: the order of translucent triangles matters for blending.
+	MeshOptimize_Overdraw = 1 << 1,
+	// Off for meshes whose vertices are rewritten by index every frame.
+	MeshOptimize_VertexFetch = 1 << 2,
+	MeshOptimize_All = MeshOptimize_VertexCache | MeshOptimize_Overdraw | MeshOptimize_VertexFetch
+};
+
+// Runs the enabled passes on a mesh. vertices are reordered in place and
+// vertices no triangle uses are dropped, so vertexCount may shrink. positions
+// points at the position of the first vertex, inside vertices. The triangle
+// order is only changed where it keeps After.Acmr at or below Before.Acmr.
+MeshOptimizationReport OptimizeMesh(std::vector<std::uint32_t>& indices, void* vertices, std::size_t& vertexCount, std::size_t vertexStride,
+	const DirectX::XMFLOAT3* positions, std::uint32_t flags = MeshOptimize_All);
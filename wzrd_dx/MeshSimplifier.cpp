@@ -0,0 +1,601 @@
+#include "MeshSimplifier.h"
+#include <algorithm>
+#include <cmath>
+#include <queue>
+
+using namespace DirectX;
+
+namespace {
+
+// Position and scaled normal of a vertex.
+const int AttributeCount = 6;
+typedef double Point[AttributeCount];
+
+// Symmetric quadric Q(v) = v'Av + 2b'v + c. Only the upper triangle of A is stored.
+struct Quadric {
+	double A[AttributeCount * (AttributeCount + 1) / 2] = {};
+	double b[AttributeCount] = {};
+	double c = 0.0;
+
+	static int Index(int i, int j) {
+		if (i > j)
+			std::swap(i, j);
+		return i * AttributeCount - i * (i - 1) / 2 + (j - i);
+	}
+
+	void Add(const Quadric& q) {
+		for (int i = 0; i < AttributeCount * (AttributeCount + 1) / 2; ++i)
+			A[i] += q.A[i];
+		for (int i = 0; i < AttributeCount; ++i)
+			b[i] += q.b[i];
+		c += q.c;
+	}
+
+	double Evaluate(const Point& v) const {
+		// Walks the packed upper triangle in storage order.
+		double result = c;
+		const double* a = A;
+		for (int i = 0; i < AttributeCount; ++i)
+		{
+			double row = *a++ * v[i];
+			for (int j = i + 1; j < AttributeCount; ++j)
+				row += 2.0 * *a++ * v[j];
+			result += v[i] * (row + 2.0 * b[i]);
+		}
+		return result > 0.0 ? result : 0.0;
+	}
+
+	// Point minimizing the quadric, if A is well conditioned.
+	bool Minimize(Point& v) const {
+		double m[AttributeCount][AttributeCount + 1];
+		for (int i = 0; i < AttributeCount; ++i)
+		{
+			for (int j = 0; j < AttributeCount; ++j)
+				m[i][j] = A[Index(i, j)];
+			m[i][AttributeCount] = -b[i];
+		}
+
+		// Gaussian elimination with partial pivoting.
+		for (int col = 0; col < AttributeCount; ++col)
+		{
+			int pivot = col;
+			for (int row = col + 1; row < AttributeCount; ++row)
+			{
+				if (fabs(m[row][col]) > fabs(m[pivot][col]))
+					pivot = row;
+			}
+			if (fabs(m[pivot][col]) < 1e-12)
+				return false;
+
+			if (pivot != col)
+			{
+				for (int j = 0; j <= AttributeCount; ++j)
+					std::swap(m[col][j], m[pivot][j]);
+			}
+
+			for (int row = col + 1; row < AttributeCount; ++row)
+			{
+				double f = m[row][col] / m[col][col];
+				for (int j = col; j <= AttributeCount; ++j)
+					m[row][j] -= f * m[col][j];
+			}
+		}
+
+		for (int i = AttributeCount - 1; i >= 0; --i)
+		{
+			double sum = m[i][AttributeCount];
+			for (int j = i + 1; j < AttributeCount; ++j)
+				sum -= m[i][j] * v[j];
+			v[i] = sum / m[i][i];
+		}
+		return true;
+	}
+};
+
+double Dot(const Point& a, const Point& b) {
+	double result = 0.0;
+	for (int i = 0; i < AttributeCount; ++i)
+		result += a[i] * b[i];
+	return result;
+}
+
+void Cross(const double* a, const double* b, double* result) {
+	result[0] = a[1] * b[2] - a[2] * b[1];
+	result[1] = a[2] * b[0] - a[0] * b[2];
+	result[2] = a[0] * b[1] - a[1] * b[0];
+}
+
+// Quadric of the squared distance to the plane through the triangle in the
+// combined position and normal space (Garland and Heckbert 1998).
+Quadric TriangleQuadric(const Point& p, const Point& q, const Point& r, double weight) {
+	Quadric result;
+
+	Point e1, e2;
+	for (int i = 0; i < AttributeCount; ++i)
+	{
+		e1[i] = q[i] - p[i];
+		e2[i] = r[i] - p[i];
+	}
+
+	double l1 = sqrt(Dot(e1, e1));
+	if (l1 < 1e-20)
+		return result;
+	for (int i = 0; i < AttributeCount; ++i)
+		e1[i] /= l1;
+
+	double d = Dot(e1, e2);
+	for (int i = 0; i < AttributeCount; ++i)
+		e2[i] -= d * e1[i];
+	double l2 = sqrt(Dot(e2, e2));
+	if (l2 < 1e-20)
+		return result;
+	for (int i = 0; i < AttributeCount; ++i)
+		e2[i] /= l2;
+
+	double pe1 = Dot(p, e1);
+	double pe2 = Dot(p, e2);
+
+	for (int i = 0; i < AttributeCount; ++i)
+	{
+		for (int j = i; j < AttributeCount; ++j)
+			result.A[Quadric::Index(i, j)] = weight * ((i == j ? 1.0 : 0.0) - e1[i] * e1[j] - e2[i] * e2[j]);
+		result.b[i] = weight * (pe1 * e1[i] + pe2 * e2[i] - p[i]);
+	}
+	result.c = weight * (Dot(p, p) - pe1 * pe1 - pe2 * pe2);
+	return result;
+}
+
+// Quadric of the squared distance to a plane in position space only.
+Quadric PlaneQuadric(const double* normal, double d, double weight) {
+	Quadric result;
+	for (int i = 0; i < 3; ++i)
+	{
+		for (int j = i; j < 3; ++j)
+			result.A[Quadric::Index(i, j)] = weight * normal[i] * normal[j];
+		result.b[i] = weight * d * normal[i];
+	}
+	result.c = weight * d * d;
+	return result;
+}
+
+struct Collapse {
+	double Cost;
+	// Vertex that goes away and vertex that is moved to Target.
+	std::uint32_t Removed;
+	std::uint32_t Kept;
+	std::uint32_t RemovedVersion;
+	std::uint32_t KeptVersion;
+	float Target[AttributeCount];
+
+	bool operator<(const Collapse& rhs) const { return Cost > rhs.Cost; }
+};
+
+class Simplifier {
+public:
+	Simplifier(const XMFLOAT3* positions, const XMFLOAT3* normals, std::size_t vertexStride,
+		std::size_t vertexCount, const std::uint32_t* indices, std::size_t indexCount, const SimplifyOptions& options);
+
+	SimplifyResult Run();
+
+private:
+	void ComputeQuadrics();
+	bool PlanCollapse(std::uint32_t a, std::uint32_t b, Collapse& collapse) const;
+	bool FlipsTriangle(const Collapse& collapse) const;
+	void ApplyCollapse(const Collapse& collapse);
+	void PushEdges(std::uint32_t vertex);
+	void TriangleNormal(std::uint32_t t, std::uint32_t moved, const float* target, double* normal) const;
+
+	const SimplifyOptions& m_options;
+	std::size_t m_vertexCount;
+	double m_normalScale = 0.0;
+
+	std::vector<double> m_points;
+	std::vector<Quadric> m_quadrics;
+	std::vector<std::uint32_t> m_version;
+	std::vector<bool> m_removed;
+	std::vector<bool> m_boundary;
+
+	std::vector<std::uint32_t> m_triangles;
+	std::vector<bool> m_triangleRemoved;
+	std::size_t m_liveTriangles = 0;
+	std::vector<std::vector<std::uint32_t>> m_vertexTriangles;
+
+	std::priority_queue<Collapse> m_heap;
+	std::vector<std::uint32_t> m_neighbours;
+};
+
+Simplifier::Simplifier(const XMFLOAT3* positions, const XMFLOAT3* normals, std::size_t vertexStride,
+	std::size_t vertexCount, const std::uint32_t* indices, std::size_t indexCount, const SimplifyOptions& options) :
+	m_options(options),
+	m_vertexCount(vertexCount)
+{
+	auto fetch = [vertexStride](const XMFLOAT3* base, std::size_t i) {
+		return *(const XMFLOAT3*)((const std::uint8_t*)base + i * vertexStride);
+	};
+
+	m_triangles.assign(indices, indices + indexCount - indexCount % 3);
+	m_triangleRemoved.assign(m_triangles.size() / 3, false);
+	m_liveTriangles = m_triangles.size() / 3;
+
+	// Normals are scaled so a unit change costs NormalWeight mean edge lengths.
+	double edgeLength = 0.0;
+	for (std::size_t t = 0; t < m_triangles.size(); t += 3)
+	{
+		for (int e = 0; e < 3; ++e)
+		{
+			XMFLOAT3 p = fetch(positions, m_triangles[t + e]);
+			XMFLOAT3 q = fetch(positions, m_triangles[t + (e + 1) % 3]);
+			double dx = p.x - q.x, dy = p.y - q.y, dz = p.z - q.z;
+			edgeLength += sqrt(dx * dx + dy * dy + dz * dz);
+		}
+	}
+	if (!m_triangles.empty() && normals)
+		m_normalScale = options.NormalWeight * edgeLength / m_triangles.size();
+
+	m_points.resize(vertexCount * AttributeCount);
+	for (std::size_t i = 0; i < vertexCount; ++i)
+	{
+		XMFLOAT3 p = fetch(positions, i);
+		XMFLOAT3 n = normals ? fetch(normals, i) : XMFLOAT3(0.0f, 0.0f, 0.0f);
+		double* point = &m_points[i * AttributeCount];
+		point[0] = p.x;
+		point[1] = p.y;
+		point[2] = p.z;
+		point[3] = n.x * m_normalScale;
+		point[4] = n.y * m_normalScale;
+		point[5] = n.z * m_normalScale;
+	}
+
+	m_version.assign(vertexCount, 0);
+	m_removed.assign(vertexCount, false);
+	m_boundary.assign(vertexCount, false);
+
+	m_vertexTriangles.resize(vertexCount);
+	for (std::uint32_t t = 0; t < (std::uint32_t)m_triangleRemoved.size(); ++t)
+	{
+		for (int e = 0; e < 3; ++e)
+			m_vertexTriangles[m_triangles[t * 3 + e]].push_back(t);
+	}
+}
+
+void Simplifier::ComputeQuadrics() {
+	m_quadrics.assign(m_vertexCount, Quadric());
+
+	// Edges as (min, max, triangle), sorted so shared edges are next to each other.
+	struct Edge {
+		std::uint32_t A, B, Triangle;
+		bool operator<(const Edge& rhs) const { return A != rhs.A ? A < rhs.A : B < rhs.B; }
+	};
+	std::vector<Edge> edges;
+	edges.reserve(m_triangles.size());
+
+	for (std::uint32_t t = 0; t < (std::uint32_t)m_triangleRemoved.size(); ++t)
+	{
+		const std::uint32_t* v = &m_triangles[t * 3];
+		const double* p = &m_points[v[0] * AttributeCount];
+		const double* q = &m_points[v[1] * AttributeCount];
+		const double* r = &m_points[v[2] * AttributeCount];
+
+		double e1[3] = { q[0] - p[0], q[1] - p[1], q[2] - p[2] };
+		double e2[3] = { r[0] - p[0], r[1] - p[1], r[2] - p[2] };
+		double n[3];
+		Cross(e1, e2, n);
+		double area = 0.5 * sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+
+		Quadric quadric = TriangleQuadric(*(const Point*)p, *(const Point*)q, *(const Point*)r, area);
+		for (int e = 0; e < 3; ++e)
+		{
+			m_quadrics[v[e]].Add(quadric);
+
+			std::uint32_t a = v[e];
+			std::uint32_t b = v[(e + 1) % 3];
+			edges.push_back({ std::min(a, b), std::max(a, b), t });
+		}
+	}
+
+	std::sort(edges.begin(), edges.end());
+
+	for (std::size_t i = 0; i < edges.size();)
+	{
+		std::size_t j = i + 1;
+		while (j < edges.size() && edges[j].A == edges[i].A && edges[j].B == edges[i].B)
+			++j;
+
+		// An edge used by a single triangle is on an open border. It gets a plane
+		// perpendicular to the triangle through the edge so the border cannot drift.
+		if (j - i == 1)
+		{
+			const std::uint32_t* v = &m_triangles[edges[i].Triangle * 3];
+			const double* a = &m_points[edges[i].A * AttributeCount];
+			const double* b = &m_points[edges[i].B * AttributeCount];
+			const double* p = &m_points[v[0] * AttributeCount];
+			const double* q = &m_points[v[1] * AttributeCount];
+			const double* r = &m_points[v[2] * AttributeCount];
+
+			double e1[3] = { q[0] - p[0], q[1] - p[1], q[2] - p[2] };
+			double e2[3] = { r[0] - p[0], r[1] - p[1], r[2] - p[2] };
+			double faceNormal[3];
+			Cross(e1, e2, faceNormal);
+
+			double edge[3] = { b[0] - a[0], b[1] - a[1], b[2] - a[2] };
+			double edgeLengthSq = edge[0] * edge[0] + edge[1] * edge[1] + edge[2] * edge[2];
+
+			double n[3];
+			Cross(edge, faceNormal, n);
+			double length = sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+			if (length > 1e-20)
+			{
+				n[0] /= length;
+				n[1] /= length;
+				n[2] /= length;
+				double d = -(n[0] * a[0] + n[1] * a[1] + n[2] * a[2]);
+
+				Quadric border = PlaneQuadric(n, d, m_options.BoundaryWeight * edgeLengthSq);
+				m_quadrics[edges[i].A].Add(border);
+				m_quadrics[edges[i].B].Add(border);
+			}
+
+			m_boundary[edges[i].A] = true;
+			m_boundary[edges[i].B] = true;
+		}
+
+		i = j;
+	}
+
+	for (std::size_t i = 0; i < edges.size(); ++i)
+	{
+		if (i > 0 && edges[i].A == edges[i - 1].A && edges[i].B == edges[i - 1].B)
+			continue;
+
+		Collapse collapse;
+		if (PlanCollapse(edges[i].A, edges[i].B, collapse))
+			m_heap.push(collapse);
+	}
+}
+
+bool Simplifier::PlanCollapse(std::uint32_t a, std::uint32_t b, Collapse& collapse) const {
+	bool lockA = m_options.LockBoundary && m_boundary[a];
+	bool lockB = m_options.LockBoundary && m_boundary[b];
+	if (lockA && lockB)
+		return false;
+
+	Quadric q = m_quadrics[a];
+	q.Add(m_quadrics[b]);
+
+	const Point& pa = *(const Point*)&m_points[a * AttributeCount];
+	const Point& pb = *(const Point*)&m_points[b * AttributeCount];
+
+	double bestCost = DBL_MAX;
+	Point best;
+	bool keepA = false;
+
+	auto consider = [&](const Point& p, bool collapseIntoA) {
+		double cost = q.Evaluate(p);
+		if (cost < bestCost)
+		{
+			bestCost = cost;
+			std::copy(p, p + AttributeCount, best);
+			keepA = collapseIntoA;
+		}
+	};
+
+	if (!lockB)
+		consider(pa, true);
+	if (!lockA)
+		consider(pb, false);
+
+	if (!m_options.KeepOriginalVertices && !lockA && !lockB)
+	{
+		// The midpoint is only worth trying when the quadric has no unique minimum.
+		Point optimum;
+		if (q.Minimize(optimum))
+		{
+			consider(optimum, false);
+		}
+		else
+		{
+			for (int i = 0; i < AttributeCount; ++i)
+				optimum[i] = 0.5 * (pa[i] + pb[i]);
+			consider(optimum, false);
+		}
+	}
+
+	collapse.Cost = bestCost;
+	collapse.Kept = keepA ? a : b;
+	collapse.Removed = keepA ? b : a;
+	collapse.KeptVersion = m_version[collapse.Kept];
+	collapse.RemovedVersion = m_version[collapse.Removed];
+	for (int i = 0; i < AttributeCount; ++i)
+		collapse.Target[i] = (float)best[i];
+	return true;
+}
+
+void Simplifier::TriangleNormal(std::uint32_t t, std::uint32_t moved, const float* target, double* normal) const {
+	double p[3][3];
+	for (int e = 0; e < 3; ++e)
+	{
+		std::uint32_t v = m_triangles[t * 3 + e];
+		for (int i = 0; i < 3; ++i)
+			p[e][i] = v == moved && target ? target[i] : m_points[v * AttributeCount + i];
+	}
+
+	double e1[3] = { p[1][0] - p[0][0], p[1][1] - p[0][1], p[1][2] - p[0][2] };
+	double e2[3] = { p[2][0] - p[0][0], p[2][1] - p[0][1], p[2][2] - p[0][2] };
+	Cross(e1, e2, normal);
+}
+
+bool Simplifier::FlipsTriangle(const Collapse& collapse) const {
+	for (std::uint32_t moved : { collapse.Removed, collapse.Kept })
+	{
+		for (std::uint32_t t : m_vertexTriangles[moved])
+		{
+			if (m_triangleRemoved[t])
+				continue;
+
+			const std::uint32_t* v = &m_triangles[t * 3];
+			bool hasRemoved = v[0] == collapse.Removed || v[1] == collapse.Removed || v[2] == collapse.Removed;
+			bool hasKept = v[0] == collapse.Kept || v[1] == collapse.Kept || v[2] == collapse.Kept;
+			if (hasRemoved && hasKept)
+				continue;
+
+			double before[3], after[3];
+			TriangleNormal(t, moved, nullptr, before);
+			TriangleNormal(t, moved, collapse.Target, after);
+
+			// Turning by more than about 75 degrees counts as a flip, so a triangle
+			// cannot fold over in steps or stand up on a locked border.
+			double dot = before[0] * after[0] + before[1] * after[1] + before[2] * after[2];
+			double beforeLengthSq = before[0] * before[0] + before[1] * before[1] + before[2] * before[2];
+			double afterLengthSq = after[0] * after[0] + after[1] * after[1] + after[2] * after[2];
+			if (afterLengthSq < 1e-30 || dot <= 0.25 * sqrt(beforeLengthSq * afterLengthSq))
+				return true;
+		}
+	}
+	return false;
+}
+
+void Simplifier::ApplyCollapse(const Collapse& collapse) {
+	std::uint32_t u = collapse.Removed;
+	std::uint32_t v = collapse.Kept;
+
+	m_quadrics[v].Add(m_quadrics[u]);
+	for (int i = 0; i < AttributeCount; ++i)
+		m_points[v * AttributeCount + i] = collapse.Target[i];
+
+	m_removed[u] = true;
+	m_boundary[v] = m_boundary[v] || m_boundary[u];
+	m_version[u]++;
+	m_version[v]++;
+
+	std::vector<std::uint32_t>& kept = m_vertexTriangles[v];
+	for (std::uint32_t t : m_vertexTriangles[u])
+	{
+		if (m_triangleRemoved[t])
+			continue;
+
+		std::uint32_t* tri = &m_triangles[t * 3];
+		if (tri[0] == v || tri[1] == v || tri[2] == v)
+		{
+			m_triangleRemoved[t] = true;
+			m_liveTriangles--;
+			continue;
+		}
+
+		for (int e = 0; e < 3; ++e)
+		{
+			if (tri[e] == u)
+				tri[e] = v;
+		}
+		kept.push_back(t);
+	}
+	m_vertexTriangles[u].clear();
+	m_vertexTriangles[u].shrink_to_fit();
+
+	kept.erase(std::remove_if(kept.begin(), kept.end(), [this](std::uint32_t t) { return (bool)m_triangleRemoved[t]; }), kept.end());
+}
+
+void Simplifier::PushEdges(std::uint32_t vertex) {
+	m_neighbours.clear();
+	for (std::uint32_t t : m_vertexTriangles[vertex])
+	{
+		for (int e = 0; e < 3; ++e)
+		{
+			std::uint32_t other = m_triangles[t * 3 + e];
+			if (other != vertex)
+				m_neighbours.push_back(other);
+		}
+	}
+	std::sort(m_neighbours.begin(), m_neighbours.end());
+	m_neighbours.erase(std::unique(m_neighbours.begin(), m_neighbours.end()), m_neighbours.end());
+
+	for (std::uint32_t other : m_neighbours)
+	{
+		Collapse collapse;
+		if (PlanCollapse(vertex, other, collapse))
+			m_heap.push(collapse);
+	}
+}
+
+SimplifyResult Simplifier::Run() {
+	SimplifyResult result;
+
+	ComputeQuadrics();
+
+	double maxCost = (double)m_options.TargetError * (double)m_options.TargetError;
+	double worstCost = 0.0;
+
+	while (m_liveTriangles > m_options.TargetTriangleCount && !m_heap.empty())
+	{
+		Collapse collapse = m_heap.top();
+		m_heap.pop();
+
+		// Either end changed since the entry was pushed: a newer entry exists.
+		if (m_removed[collapse.Removed] || m_removed[collapse.Kept] ||
+			m_version[collapse.Removed] != collapse.RemovedVersion || m_version[collapse.Kept] != collapse.KeptVersion)
+			continue;
+
+		if (collapse.Cost > maxCost)
+			break;
+
+		if (FlipsTriangle(collapse))
+			continue;
+
+		ApplyCollapse(collapse);
+		worstCost = std::max(worstCost, collapse.Cost);
+		PushEdges(collapse.Kept);
+	}
+
+	result.Error = (float)sqrt(worstCost);
+
+	if (m_options.KeepOriginalVertices)
+	{
+		result.Indices.reserve(m_liveTriangles * 3);
+		for (std::size_t t = 0; t < m_triangleRemoved.size(); ++t)
+		{
+			if (!m_triangleRemoved[t])
+				result.Indices.insert(result.Indices.end(), &m_triangles[t * 3], &m_triangles[t * 3] + 3);
+		}
+		return result;
+	}
+
+	// Compact the vertices still used by a triangle.
+	std::vector<std::uint32_t> remap(m_vertexCount, 0xffffffff);
+	result.Indices.reserve(m_liveTriangles * 3);
+	for (std::size_t t = 0; t < m_triangleRemoved.size(); ++t)
+	{
+		if (m_triangleRemoved[t])
+			continue;
+
+		for (int e = 0; e < 3; ++e)
+		{
+			std::uint32_t v = m_triangles[t * 3 + e];
+			if (remap[v] == 0xffffffff)
+			{
+				const double* p = &m_points[v * AttributeCount];
+
+				SimplifiedVertex vertex;
+				vertex.Position = XMFLOAT3((float)p[0], (float)p[1], (float)p[2]);
+				vertex.Normal = XMFLOAT3(0.0f, 0.0f, 0.0f);
+				double length = sqrt(p[3] * p[3] + p[4] * p[4] + p[5] * p[5]);
+				if (length > 0.0)
+					vertex.Normal = XMFLOAT3((float)(p[3] / length), (float)(p[4] / length), (float)(p[5] / length));
+				vertex.Source = v;
+
+				remap[v] = (std::uint32_t)result.Vertices.size();
+				result.Vertices.push_back(vertex);
+			}
+			result.Indices.push_back(remap[v]);
+		}
+	}
+
+	return result;
+}
+
+}
+
+SimplifyResult SimplifyMesh(const XMFLOAT3* positions, const XMFLOAT3* normals, std::size_t vertexStride,
+	std::size_t vertexCount, const std::uint32_t* indices, std::size_t indexCount, const SimplifyOptions& options)
+{
+	Simplifier simplifier(positions, normals, vertexStride, vertexCount, indices, indexCount, options);
+	return simplifier.Run();
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <DirectXMath.h>
+#include <cfloat>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+struct SimplifyOptions {
+	// Stop once at most this many triangles are left. 0 only stops on error.
+	std::size_t TargetTriangleCount = 0;
+	// Stop before a collapse would move the surface further than this, in
+	// object space units.
+	float TargetError = FLT_MAX;
+	// How much a change of normal costs. A unit change of the normal costs as
+	// much as moving the vertex NormalWeight mean edge lengths.
+	float NormalWeight = 0.5f;
+	// Extra weight of the planes that keep open borders in place.
+	float BoundaryWeight = 10.0f;
+	// Never move vertices on open borders.
+	bool LockBoundary = false;
+	// Only collapse onto one of the two edge vertices. The result then indexes
+	// the input vertices, so LOD levels can share one vertex buffer.
+	bool KeepOriginalVertices = false;
+};
+
+struct SimplifiedVertex {
+	DirectX::XMFLOAT3 Position;
+	DirectX::XMFLOAT3 Normal;
+	// Input vertex this one was collapsed into. Attributes the simplifier does
+	// not know about (texture coordinates...) can be copied from it.
+	std::uint32_t Source;
+};
+
+struct SimplifyResult {
+	std::vector<std::uint32_t> Indices;
+	// Empty with KeepOriginalVertices, where Indices refer to the input vertices.
+	std::vector<SimplifiedVertex> Vertices;
+	// Largest error of the collapses that were done, in object space units.
+	float Error = 0.0f;
+};
+
+// Edge collapse simplification driven by quadric error metrics (Garland and
+// Heckbert) over position and normal. Edges are collapsed cheapest first from
+// a heap; stale heap entries are skipped when popped instead of being updated.
+// Collapses that would flip a triangle, or turn it by more than about 75
+// degrees, are rejected.
+SimplifyResult SimplifyMesh(const DirectX::XMFLOAT3* positions, const DirectX::XMFLOAT3* normals, std::size_t vertexStride,
+	std::size_t vertexCount, const std::uint32_t* indices, std::size_t indexCount, const SimplifyOptions& options);
@@ -0,0 +1,301 @@
+#include "Meshlets.h"
+#include "MeshLod.h"
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+using namespace DirectX;
+
+namespace {
+
+// Cones whose triangles spread further than this (the smallest dot product
+// between a normal and the axis) can never be backface culled.
+const float MinConeSpread = 0.1f;
+
+void FinishMeshlet(MeshletMesh& mesh, Meshlet& meshlet, const std::vector<XMFLOAT3>& triangleNormals,
+	const std::vector<std::uint32_t>& triangles, const XMFLOAT3* positions, std::size_t positionStride)
+{
+	auto position = [&](std::uint32_t v) {
+		return XMLoadFloat3((const XMFLOAT3*)((const std::uint8_t*)positions + v * positionStride));
+	};
+
+	// Sphere around the centre of the bounding box.
+	XMFLOAT3 minP = { FLT_MAX, FLT_MAX, FLT_MAX };
+	XMFLOAT3 maxP = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+	for (std::uint32_t i = 0; i < meshlet.VertexCount; ++i)
+	{
+		XMFLOAT3 p;
+		XMStoreFloat3(&p, position(mesh.Vertices[meshlet.FirstVertex + i]));
+		minP = { std::min(minP.x, p.x), std::min(minP.y, p.y), std::min(minP.z, p.z) };
+		maxP = { std::max(maxP.x, p.x), std::max(maxP.y, p.y), std::max(maxP.z, p.z) };
+	}
+
+	XMVECTOR center = (XMLoadFloat3(&minP) + XMLoadFloat3(&maxP)) * 0.5f;
+	float radius = 0.0f;
+	for (std::uint32_t i = 0; i < meshlet.VertexCount; ++i)
+		radius = std::max(radius, XMVectorGetX(XMVector3Length(position(mesh.Vertices[meshlet.FirstVertex + i]) - center)));
+
+	XMStoreFloat3(&meshlet.Center, center);
+	meshlet.Radius = radius;
+
+	// Normal cone around the mean of the unit normals. Degenerate triangles have
+	// a zero normal and do not take part.
+	XMVECTOR axis = XMVectorZero();
+	for (std::uint32_t t : triangles)
+		axis += XMLoadFloat3(&triangleNormals[t]);
+
+	meshlet.ConeCutoff = 1.0f;
+	if (XMVectorGetX(XMVector3Length(axis)) < 1e-6f)
+		return;
+
+	axis = XMVector3Normalize(axis);
+	XMStoreFloat3(&meshlet.ConeAxis, axis);
+
+	float minDot = 1.0f;
+	for (std::uint32_t t : triangles)
+	{
+		XMVECTOR n = XMLoadFloat3(&triangleNormals[t]);
+		if (XMVectorGetX(XMVector3LengthSq(n)) > 0.0f)
+			minDot = std::min(minDot, XMVectorGetX(XMVector3Dot(n, axis)));
+	}
+
+	if (minDot > MinConeSpread)
+		meshlet.ConeCutoff = sqrtf(1.0f - minDot * minDot);
+}
+
+}
+
+MeshletMesh BuildMeshlets(const std::uint32_t* indices, std::size_t indexCount, const XMFLOAT3* positions, std::size_t positionStride,
+	std::size_t vertexCount, std::uint32_t maxVertices, std::uint32_t maxTriangles)
+{
+	MeshletMesh mesh;
+	std::size_t triangleCount = indexCount / 3;
+	if (triangleCount == 0)
+		return mesh;
+
+	// Local indices are bytes, and a triangle must always fit.
+	maxVertices = std::min<std::uint32_t>(std::max<std::uint32_t>(maxVertices, 3), 255);
+	maxTriangles = std::max<std::uint32_t>(maxTriangles, 1);
+
+	auto position = [&](std::uint32_t v) {
+		return XMLoadFloat3((const XMFLOAT3*)((const std::uint8_t*)positions + v * positionStride));
+	};
+
+	// Front faces are clockwise, so this normal points out of the front side.
+	std::vector<XMFLOAT3> triangleNormals(triangleCount);
+	for (std::size_t t = 0; t < triangleCount; ++t)
+	{
+		XMVECTOR p0 = position(indices[t * 3]);
+		XMVECTOR p1 = position(indices[t * 3 + 1]);
+		XMVECTOR p2 = position(indices[t * 3 + 2]);
+		XMStoreFloat3(&triangleNormals[t], XMVector3Normalize(XMVector3Cross(p1 - p0, p2 - p0)));
+	}
+
+	// Triangles of each vertex, packed. The first remaining[v] entries of a
+	// vertex's list are the triangles not assigned to a meshlet yet.
+	std::vector<std::uint32_t> offsets(vertexCount + 1, 0);
+	for (std::size_t i = 0; i < triangleCount * 3; ++i)
+		offsets[indices[i] + 1]++;
+	for (std::size_t v = 0; v < vertexCount; ++v)
+		offsets[v + 1] += offsets[v];
+
+	std::vector<std::uint32_t> adjacency(triangleCount * 3);
+	std::vector<std::uint32_t> remaining(vertexCount, 0);
+	for (std::size_t t = 0; t < triangleCount; ++t)
+	{
+		for (int e = 0; e < 3; ++e)
+		{
+			std::uint32_t v = indices[t * 3 + e];
+			adjacency[offsets[v] + remaining[v]++] = (std::uint32_t)t;
+		}
+	}
+
+	std::vector<bool> emitted(triangleCount, false);
+	std::vector<std::uint8_t> localIndex(vertexCount, 0xff);
+	std::vector<std::uint32_t> meshletTriangles;
+	XMVECTOR normalSum = XMVectorZero();
+
+	Meshlet meshlet;
+	std::size_t nextSeed = 0;
+
+	auto closeMeshlet = [&]() {
+		FinishMeshlet(mesh, meshlet, triangleNormals, meshletTriangles, positions, positionStride);
+		mesh.Meshlets.push_back(meshlet);
+
+		for (std::uint32_t i = 0; i < meshlet.VertexCount; ++i)
+			localIndex[mesh.Vertices[meshlet.FirstVertex + i]] = 0xff;
+
+		meshlet = Meshlet();
+		meshlet.FirstIndex = (std::uint32_t)mesh.Indices.size();
+		meshlet.FirstVertex = (std::uint32_t)mesh.Vertices.size();
+		meshlet.FirstTriangle = (std::uint32_t)(mesh.Triangles.size() / 3);
+		meshletTriangles.clear();
+		normalSum = XMVectorZero();
+	};
+
+	for (std::size_t emittedCount = 0; emittedCount < triangleCount; ++emittedCount)
+	{
+		// Best unassigned triangle touching the meshlet: fewest new vertices
+		// first, then closest to the mean normal.
+		std::uint32_t best = 0xffffffff;
+		float bestCost = FLT_MAX;
+		XMVECTOR axis = XMVector3Normalize(normalSum);
+
+		for (std::uint32_t i = 0; i < meshlet.VertexCount; ++i)
+		{
+			std::uint32_t v = mesh.Vertices[meshlet.FirstVertex + i];
+			for (std::uint32_t k = 0; k < remaining[v]; ++k)
+			{
+				std::uint32_t t = adjacency[offsets[v] + k];
+
+				std::uint32_t newVertices = 0;
+				for (int e = 0; e < 3; ++e)
+					newVertices += localIndex[indices[t * 3 + e]] == 0xff ? 1 : 0;
+				if (meshlet.VertexCount + newVertices > maxVertices)
+					continue;
+
+				float cost = newVertices + 0.5f * (1.0f - XMVectorGetX(XMVector3Dot(XMLoadFloat3(&triangleNormals[t]), axis)));
+				if (cost < bestCost)
+				{
+					bestCost = cost;
+					best = t;
+				}
+			}
+		}
+
+		if (best == 0xffffffff)
+		{
+			if (meshlet.TriangleCount > 0)
+				closeMeshlet();
+
+			// Start the next meshlet at the first unassigned triangle in input order,
+			// which after cache optimization is close to the last one.
+			while (emitted[nextSeed])
+				nextSeed++;
+			best = (std::uint32_t)nextSeed;
+		}
+
+		emitted[best] = true;
+		meshletTriangles.push_back(best);
+		normalSum += XMLoadFloat3(&triangleNormals[best]);
+
+		for (int e = 0; e < 3; ++e)
+		{
+			std::uint32_t v = indices[best * 3 + e];
+			if (localIndex[v] == 0xff)
+			{
+				localIndex[v] = (std::uint8_t)meshlet.VertexCount++;
+				mesh.Vertices.push_back(v);
+			}
+			mesh.Indices.push_back(v);
+			mesh.Triangles.push_back(localIndex[v]);
+
+			// Drop the triangle from the vertex's remaining list.
+			std::uint32_t* begin = &adjacency[offsets[v]];
+			std::uint32_t* end = begin + remaining[v];
+			*std::find(begin, end, best) = *(end - 1);
+			remaining[v]--;
+		}
+
+		if (++meshlet.TriangleCount == maxTriangles)
+			closeMeshlet();
+	}
+
+	if (meshlet.TriangleCount > 0)
+		closeMeshlet();
+
+	return mesh;
+}
+
+bool ValidateMeshlets(const MeshletMesh& mesh, std::size_t indexCount, std::size_t vertexCount) {
+	if (mesh.Indices.size() != indexCount || mesh.Triangles.size() % 3 != 0)
+		return false;
+
+	for (const Meshlet& meshlet : mesh.Meshlets)
+	{
+		// 64-bit sums, so corrupt counts cannot wrap around.
+		std::uint64_t triangleCount = meshlet.TriangleCount;
+		if (meshlet.FirstIndex + 3 * triangleCount > indexCount ||
+			(meshlet.FirstTriangle + triangleCount) * 3 > mesh.Triangles.size() ||
+			(std::uint64_t)meshlet.FirstVertex + meshlet.VertexCount > mesh.Vertices.size())
+			return false;
+
+		for (std::uint64_t i = 3 * (std::uint64_t)meshlet.FirstTriangle; i < (meshlet.FirstTriangle + triangleCount) * 3; ++i)
+		{
+			if (mesh.Triangles[i] >= meshlet.VertexCount)
+				return false;
+		}
+	}
+
+	for (std::uint32_t v : mesh.Vertices)
+	{
+		if (v >= vertexCount)
+			return false;
+	}
+	for (std::uint32_t v : mesh.Indices)
+	{
+		if (v >= vertexCount)
+			return false;
+	}
+	return true;
+}
+
+MeshletCullView MakeMeshletCullView(FXMMATRIX viewProj, FXMVECTOR eyePosition) {
+	MeshletCullView view;
+
+	// Gribb and Hartmann: with row vectors the planes are sums of the columns,
+	// which are the rows of the transpose. D3D clips z to [0, w].
+	XMMATRIX m = XMMatrixTranspose(viewProj);
+	XMVECTOR planes[6] = {
+		m.r[3] + m.r[0],
+		m.r[3] - m.r[0],
+		m.r[3] + m.r[1],
+		m.r[3] - m.r[1],
+		m.r[2],
+		m.r[3] - m.r[2],
+	};
+
+	for (int i = 0; i < 6; ++i)
+		XMStoreFloat4(&view.Planes[i], XMPlaneNormalize(planes[i]));
+	view.PlaneCount = 6;
+	XMStoreFloat3(&view.EyePosition, eyePosition);
+	return view;
+}
+
+std::uint32_t CullMeshlets(const MeshletMesh& mesh, FXMMATRIX world, const MeshletCullView& view, std::vector<MeshletDrawRange>& ranges) {
+	float scale = LodWorldScale(world);
+	XMVECTOR eye = XMLoadFloat3(&view.EyePosition);
+	std::size_t firstRange = ranges.size();
+	std::uint32_t visibleCount = 0;
+
+	for (const Meshlet& meshlet : mesh.Meshlets)
+	{
+		XMVECTOR center = XMVector3TransformCoord(XMLoadFloat3(&meshlet.Center), world);
+		float radius = meshlet.Radius * scale;
+
+		bool culled = false;
+		for (std::uint32_t p = 0; p < view.PlaneCount && !culled; ++p)
+			culled = XMVectorGetX(XMPlaneDotCoord(XMLoadFloat4(&view.Planes[p]), center)) < -radius;
+
+		// Every triangle faces away when the direction to the whole sphere is
+		// inside the cone's complement.
+		if (!culled && view.CullBackfaces && meshlet.ConeCutoff < 1.0f)
+		{
+			XMVECTOR axis = XMVector3Normalize(XMVector3TransformNormal(XMLoadFloat3(&meshlet.ConeAxis), world));
+			XMVECTOR toCenter = center - eye;
+			culled = XMVectorGetX(XMVector3Dot(toCenter, axis)) >= meshlet.ConeCutoff * XMVectorGetX(XMVector3Length(toCenter)) + radius;
+		}
+
+		if (culled)
+			continue;
+
+		visibleCount++;
+		std::uint32_t indexCount = meshlet.TriangleCount * 3;
+		if (ranges.size() > firstRange && ranges.back().FirstIndex + ranges.back().IndexCount == meshlet.FirstIndex)
+			ranges.back().IndexCount += indexCount;
+		else
+			ranges.push_back({ meshlet.FirstIndex, indexCount });
+	}
+
+	return visibleCount;
+}
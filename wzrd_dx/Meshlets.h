@@ -0,0 +1,79 @@
+#pragma once
+
+#include <DirectXMath.h>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// A cluster of neighbouring triangles with what is needed to cull it as a whole.
+struct Meshlet {
+	// Range of the meshlet in MeshletMesh::Indices, relative to the submesh.
+	std::uint32_t FirstIndex = 0;
+	std::uint32_t TriangleCount = 0;
+
+	// Range in MeshletMesh::Vertices and MeshletMesh::Triangles, for drawing the
+	// meshlet with meshlet-local indices.
+	std::uint32_t FirstVertex = 0;
+	std::uint32_t VertexCount = 0;
+	std::uint32_t FirstTriangle = 0;
+
+	// Bounding sphere, object space.
+	DirectX::XMFLOAT3 Center = { 0.0f, 0.0f, 0.0f };
+	float Radius = 0.0f;
+
+	// All triangle normals are within the cone around ConeAxis. ConeCutoff is the
+	// sine of the cone's half angle; 1 when the cone is too wide to ever cull.
+	DirectX::XMFLOAT3 ConeAxis = { 0.0f, 0.0f, 1.0f };
+	float ConeCutoff = 1.0f;
+};
+
+struct MeshletMesh {
+	std::vector<Meshlet> Meshlets;
+	// The input triangles reordered meshlet by meshlet, indexing the input vertices.
+	std::vector<std::uint32_t> Indices;
+	// Vertices of each meshlet, and its triangles as three local indices into them.
+	std::vector<std::uint32_t> Vertices;
+	std::vector<std::uint8_t> Triangles;
+};
+
+// Splits a triangle list into meshlets of at most maxVertices vertices and
+// maxTriangles triangles. Triangles are added to the current meshlet by
+// adjacency, preferring those that add the fewest vertices and then those that
+// keep the normal cone narrow.
+MeshletMesh BuildMeshlets(const std::uint32_t* indices, std::size_t indexCount, const DirectX::XMFLOAT3* positions, std::size_t positionStride,
+	std::size_t vertexCount, std::uint32_t maxVertices = 64, std::uint32_t maxTriangles = 124);
+
+// Whether every range of mesh lies inside its arrays, and the meshlets inside a
+// submesh of indexCount indices over vertexCount vertices. For meshlets read
+// back from a file.
+bool ValidateMeshlets(const MeshletMesh& mesh, std::size_t indexCount, std::size_t vertexCount);
+
+// What one view culls against, in world space. Planes face inwards.
+struct MeshletCullView {
+	DirectX::XMFLOAT4 Planes[6];
+	std::uint32_t PlaneCount = 0;
+	DirectX::XMFLOAT3 EyePosition = { 0.0f, 0.0f, 0.0f };
+	bool CullBackfaces = true;
+};
+
+// Cull view of a camera, with the frustum planes taken from its view-projection matrix.
+MeshletCullView MakeMeshletCullView(DirectX::FXMMATRIX viewProj, DirectX::FXMVECTOR eyePosition);
+
+// Index range to draw, relative to the submesh.
+struct MeshletDrawRange {
+	std::uint32_t FirstIndex = 0;
+	std::uint32_t IndexCount = 0;
+};
+
+struct MeshletCullStats {
+	std::uint32_t Tested = 0;
+	std::uint32_t Visible = 0;
+
+	void Reset() { Tested = 0; Visible = 0; }
+};
+
+// Appends the index ranges of the meshlets that are inside the view and not
+// facing away from it. Neighbouring visible meshlets are merged into one range.
+// The world matrix may rotate, translate and scale uniformly. Returns the number
+// of visible meshlets.
+std::uint32_t CullMeshlets(const MeshletMesh& mesh, DirectX::FXMMATRIX world, const MeshletCullView& view, std::vector<MeshletDrawRange>& ranges);
@@ -1,26 +1,48 @@
 #include "MirrorApp.h"
 #include "GeometryGenerator.h"
+#include "IndexBufferBuilder.h"
+#include "MeshSimplifier.h"
+#include "MeshOptimizer.h"
+#include "ModelLoader.h"
+#include "TaskGraph.h"
+#include "ThreadPool.h"
 
 bool MirrorApp::init() {
 	ThrowIfFailed(m_graphicsCommandList->Reset(m_commandAllocator.Get(), nullptr));
 	m_cbvSrvDescriptorSize = m_device->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
-
-	LoadTextures();
-	BuildRootSignature();
-	BuildDescriptorHeaps();
-	BuildShaderAndInputLayout();
-	BuildRoomGeometry();
-	BuildSkullGeometry();
-	BuildMaterials();
-	BuildRenderItems();
-	BuildFrameResources();
-	BuildPSOs();
+	m_geometryPool = std::make_unique<GeometryPool>(m_device.Get());
+
+	// The skull is the long stage; textures, shaders and pipeline states load
+	// beside it. Stages that record uploads do so on lists of their own.
+	ThreadPool* pool = m_parallelStartup ? &ThreadPool::Default() : nullptr;
+	CommandListSet uploadLists(m_device.Get());
+
+	TaskGraph startup;
+	auto textures = startup.Add("textures", [&] { LoadTextures(uploadLists, pool); });
+	startup.Add("descriptor heaps", [this] { BuildDescriptorHeaps(); }, { textures });
+	auto rootSignature = startup.Add("root signature", [this] { BuildRootSignature(); });
+	auto shaders = startup.Add("shaders", [&] { BuildShaders(pool); });
+	auto inputLayouts = startup.Add("input layouts", [this] { BuildInputLayouts(); });
+	startup.Add("pipeline states", [&] { BuildPSOs(pool); }, { rootSignature, shaders, inputLayouts });
+	// The skull cache is checked against the quantized input layout.
+	auto geometry = startup.Add("geometry", [&] {
+		ID3D12GraphicsCommandList* cmdList = uploadLists.Open();
+		BuildRoomGeometry(cmdList);
+		BuildSkullGeometry(cmdList);
+	}, { inputLayouts });
+	auto materials = startup.Add("materials", [this] { BuildMaterials(); });
+	auto renderItems = startup.Add("render items", [this] { BuildRenderItems(); }, { geometry, materials });
+	startup.Add("frame resources", [this] { BuildFrameResources(); }, { renderItems });
+	startup.Add("frame graph", [this] { BuildFrameGraph(); });
+	startup.Run(pool);
 
 	ThrowIfFailed(m_graphicsCommandList->Close());
-	ID3D12CommandList* cmdsLists[] = { m_graphicsCommandList.Get() };
-	m_commandQueue->ExecuteCommandLists(_countof(cmdsLists), cmdsLists);
+	std::vector<ID3D12CommandList*> cmdsLists = { m_graphicsCommandList.Get() };
+	uploadLists.Close(cmdsLists);
+	m_commandQueue->ExecuteCommandLists((UINT)cmdsLists.size(), cmdsLists.data());
 
 	FlushCommandQueue();
+	m_geometryPool->DisposeUploaders();
 
 	return true;
 }
@@ -45,7 +67,9 @@ void MirrorApp::update(GameTimer& gameTimer) {
 	UpdateObjectCBs(gameTimer);
 	UpdateMaterialsCBs(gameTimer);
 	UpdateMainPassCB(gameTimer);
-	UpdateReflectedPassCB(gameTimer);
+	UpdateLods(gameTimer);
+	UpdateMirrors(gameTimer);
+	UpdatePlanarShadows(gameTimer);
 }
 
 void MirrorApp::OnKeyboardInput(GameTimer& gameTimer) {
@@ -78,21 +102,7 @@ void MirrorApp::OnKeyboardInput(GameTimer& gameTimer) {
 	XMMATRIX skullWorld = skullRotate * skullScale*skullOffset;
 	XMStoreFloat4x4(&m_skullRenderItem->World, skullWorld);
 
-	// Update reflection world matrix.
-	XMVECTOR mirrorPlane = XMVectorSet(0.0f, 0.0f, 1.0f, 0.0f); // xy plane
-	XMMATRIX R = XMMatrixReflect(mirrorPlane);
-	XMStoreFloat4x4(&m_reflectedSkullRenderItem->World, skullWorld * R);
-
-	// Update shadow world matrix.
-	XMVECTOR shadowPlane = XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f); // xz plane
-	XMVECTOR toMainLight = -XMLoadFloat3(&m_mainPassCB.Lights[0].Direction);
-	XMMATRIX S = XMMatrixShadow(shadowPlane, toMainLight);
-	XMMATRIX shadowOffsetY = XMMatrixTranslation(0.0f, 0.001f, 0.0f);
-	XMStoreFloat4x4(&m_shadowedSkullRenderItem->World, skullWorld * S * shadowOffsetY);
-
 	m_skullRenderItem->numFramesDirty = gNumFrameResources;
-	m_reflectedSkullRenderItem->numFramesDirty = gNumFrameResources;
-	m_shadowedSkullRenderItem->numFramesDirty = gNumFrameResources;
 }
 
 void MirrorApp::UpdateCamera(GameTimer& gameTimer) {
@@ -122,6 +132,8 @@ void MirrorApp::UpdateObjectCBs(GameTimer& gameTimer) {
 			ObjectConstants objConstants;
 			XMStoreFloat4x4(&objConstants.WorldViewProj, XMMatrixTranspose(world));
 			XMStoreFloat4x4(&objConstants.TexTransform, XMMatrixTranspose(texTransform));
+			objConstants.PosScale = XMFLOAT4(e->Quantization.Scale.x, e->Quantization.Scale.y, e->Quantization.Scale.z, 0.0f);
+			objConstants.PosOffset = XMFLOAT4(e->Quantization.Offset.x, e->Quantization.Offset.y, e->Quantization.Offset.z, 0.0f);
 
 			currentObjectCB->CopyData(e->objCBIndex, objConstants);
 
@@ -166,6 +178,7 @@ void MirrorApp::UpdateMainPassCB(GameTimer& gameTimer) {
 	XMStoreFloat4x4(&m_mainPassCB.ViewProj, XMMatrixTranspose(viewProj));
 	XMStoreFloat4x4(&m_mainPassCB.InvViewProj, XMMatrixTranspose(invViewProj));
 	m_mainPassCB.EyePosW = m_eyePos;
+	m_mainCullView = MakeMeshletCullView(viewProj, XMLoadFloat3(&m_eyePos));
 	m_mainPassCB.RenderTargetSize = XMFLOAT2((float)m_clientWidth, (float)m_clientHeight);
 	m_mainPassCB.InvRenderTargetSize = XMFLOAT2(1.0f / m_clientWidth, 1.0f / m_clientHeight);
 	m_mainPassCB.NearZ = 1.0f;
@@ -185,21 +198,289 @@ void MirrorApp::UpdateMainPassCB(GameTimer& gameTimer) {
 	currPassCB->CopyData(0, m_mainPassCB);
 }
 
-void MirrorApp::UpdateReflectedPassCB(GameTimer& gameTimer) {
-	m_reflectedPassCB = m_mainPassCB;
+void MirrorApp::UpdateLods(GameTimer& gameTimer) {
+	float errorScale = LodErrorScale(m_proj(1, 1), (float)m_clientHeight);
+	XMVECTOR eyePos = XMLoadFloat3(&m_eyePos);
+
+	for (auto& e : m_allRenderItems)
+	{
+		if (!e->Lods || e->Lods->Levels.empty())
+			continue;
+
+		e->CurrentLod = SelectItemLod(*e->Lods, e->CurrentLod, e->Bounds, XMLoadFloat4x4(&e->World), eyePos, errorScale,
+			m_lodMaxPixelError);
 
-	XMVECTOR mirrorPlane = XMVectorSet(0.0f, 0.0f, 1.0f, 0.0f);
-	XMMATRIX R = XMMatrixReflect(mirrorPlane);
+		const std::string& submeshName = e->Lods->Levels[e->CurrentLod].Submesh;
+		const SubmeshGeometry& submesh = e->Geo->DrawArgs[submeshName];
+		e->IndexCount = submesh.IndexCount;
+		e->StartIndexLocation = submesh.StartIndexLocation;
+		e->BaseVertexLocation = submesh.BaseVertexLocation;
 
-	// Reflect the lighting
-	for (int i = 0; i < 3; ++i) {
-		XMVECTOR lightDir = XMLoadFloat3(&m_mainPassCB.Lights[i].Direction);
-		XMVECTOR reflectedLightDir = XMVector3TransformNormal(lightDir, R);
-		XMStoreFloat3(&m_reflectedPassCB.Lights[i].Direction, reflectedLightDir);
+		auto meshlets = m_meshlets.find(submeshName);
+		e->Meshlets = meshlets != m_meshlets.end() ? &meshlets->second : nullptr;
 	}
+}
+
+void MirrorApp::UpdateMirrors(GameTimer& gameTimer) {
+	XMMATRIX view = XMLoadFloat4x4(&m_view);
+	XMMATRIX proj = XMLoadFloat4x4(&m_proj);
+	XMMATRIX viewProj = XMMatrixMultiply(view, proj);
+	XMVECTOR eyePos = XMVectorSet(m_eyePos.x, m_eyePos.y, m_eyePos.z, 1.0f);
 
 	auto currentPassCB = m_currentFrameResource->PassCB.get();
-	currentPassCB->CopyData(1, m_reflectedPassCB);
+
+	for (size_t i = 0; i < m_mirrors.size(); ++i)
+	{
+		Mirror& mirror = m_mirrors[i];
+		mirror.Visible = false;
+		mirror.ReflectedItems.clear();
+
+		XMVECTOR plane = XMLoadFloat4(&mirror.Plane);
+
+		// Nothing to reflect when looking at the back of the mirror.
+		if (XMVectorGetX(XMPlaneDotCoord(plane, eyePos)) <= 0.0f)
+			continue;
+
+		// Scissor to the projected mirror quad. A corner behind the camera makes
+		// the projection meaningless, so fall back to the whole viewport.
+		float minX = 1.0f, minY = 1.0f, maxX = -1.0f, maxY = -1.0f;
+		bool behindCamera = false;
+		for (int c = 0; c < 4; ++c)
+		{
+			XMVECTOR clip = XMVector4Transform(XMVectorSetW(XMLoadFloat3(&mirror.Corners[c]), 1.0f), viewProj);
+			float w = XMVectorGetW(clip);
+			if (w <= 1e-4f)
+			{
+				behindCamera = true;
+				break;
+			}
+
+			float x = XMVectorGetX(clip) / w;
+			float y = XMVectorGetY(clip) / w;
+			minX = MathHelper::Min(minX, x);
+			maxX = MathHelper::Max(maxX, x);
+			minY = MathHelper::Min(minY, y);
+			maxY = MathHelper::Max(maxY, y);
+		}
+
+		if (behindCamera)
+		{
+			mirror.ScissorRect = m_scissorsRect;
+		}
+		else
+		{
+			minX = MathHelper::Clamp(minX, -1.0f, 1.0f);
+			maxX = MathHelper::Clamp(maxX, -1.0f, 1.0f);
+			minY = MathHelper::Clamp(minY, -1.0f, 1.0f);
+			maxY = MathHelper::Clamp(maxY, -1.0f, 1.0f);
+
+			mirror.ScissorRect.left = (LONG)floorf((minX * 0.5f + 0.5f) * m_clientWidth);
+			mirror.ScissorRect.right = (LONG)ceilf((maxX * 0.5f + 0.5f) * m_clientWidth);
+			mirror.ScissorRect.top = (LONG)floorf((0.5f - maxY * 0.5f) * m_clientHeight);
+			mirror.ScissorRect.bottom = (LONG)ceilf((0.5f - minY * 0.5f) * m_clientHeight);
+
+			if (mirror.ScissorRect.right <= mirror.ScissorRect.left || mirror.ScissorRect.bottom <= mirror.ScissorRect.top)
+				continue;
+		}
+
+		mirror.Visible = true;
+
+		XMMATRIX R = XMMatrixReflect(plane);
+		XMVECTOR reflectedEye = XMVector3TransformCoord(eyePos, R);
+
+		// The reflected view frustum seen through the mirror: one plane per quad
+		// edge through the reflected eye, plus the mirror plane itself. All of
+		// them face inwards.
+		XMVECTOR cullPlanes[5];
+		XMVECTOR quadCenter = XMVectorZero();
+		for (int c = 0; c < 4; ++c)
+			quadCenter += XMLoadFloat3(&mirror.Corners[c]);
+		quadCenter = XMVectorSetW(quadCenter * 0.25f, 1.0f);
+
+		for (int c = 0; c < 4; ++c)
+		{
+			XMVECTOR p0 = XMLoadFloat3(&mirror.Corners[c]);
+			XMVECTOR p1 = XMLoadFloat3(&mirror.Corners[(c + 1) % 4]);
+			XMVECTOR edgePlane = XMPlaneNormalize(XMPlaneFromPoints(reflectedEye, p0, p1));
+			if (XMVectorGetX(XMPlaneDotCoord(edgePlane, quadCenter)) < 0.0f)
+				edgePlane = -edgePlane;
+			cullPlanes[c] = edgePlane;
+		}
+		cullPlanes[4] = plane;
+
+		for (int p = 0; p < 5; ++p)
+			XMStoreFloat4(&mirror.CullView.Planes[p], cullPlanes[p]);
+		mirror.CullView.PlaneCount = 5;
+		XMStoreFloat3(&mirror.CullView.EyePosition, reflectedEye);
+
+		for (auto ri : m_renderItemLayer[(int)RenderLayer2::Opaque])
+		{
+			BoundingBox worldBounds;
+			ri->Bounds.Transform(worldBounds, XMLoadFloat4x4(&ri->World));
+
+			XMVECTOR center = XMVectorSetW(XMLoadFloat3(&worldBounds.Center), 1.0f);
+			XMVECTOR extents = XMLoadFloat3(&worldBounds.Extents);
+
+			bool outside = false;
+			for (int p = 0; p < 5 && !outside; ++p)
+			{
+				float distance = XMVectorGetX(XMPlaneDotCoord(cullPlanes[p], center));
+				float radius = XMVectorGetX(XMVector3Dot(XMVectorAbs(cullPlanes[p]), extents));
+				outside = distance < -radius;
+			}
+
+			if (!outside)
+				mirror.ReflectedItems.push_back(ri);
+		}
+
+		// Reflect the camera instead of the objects. The eye moves behind the
+		// mirror and the lights stay where they are, so the shading matches the
+		// reflected scene. Geometry behind the mirror is cut by an oblique near plane.
+		XMMATRIX reflectedView = XMMatrixMultiply(R, view);
+		XMMATRIX planeToView = XMMatrixTranspose(XMMatrixInverse(nullptr, reflectedView));
+		XMMATRIX reflectedProj = ObliqueProjection(proj, XMPlaneTransform(plane, planeToView));
+		XMMATRIX reflectedViewProj = XMMatrixMultiply(reflectedView, reflectedProj);
+
+		PassConstants reflectedPassCB = m_mainPassCB;
+		XMStoreFloat4x4(&reflectedPassCB.View, XMMatrixTranspose(reflectedView));
+		XMStoreFloat4x4(&reflectedPassCB.InvView, XMMatrixTranspose(XMMatrixInverse(nullptr, reflectedView)));
+		XMStoreFloat4x4(&reflectedPassCB.Proj, XMMatrixTranspose(reflectedProj));
+		XMStoreFloat4x4(&reflectedPassCB.InvProj, XMMatrixTranspose(XMMatrixInverse(nullptr, reflectedProj)));
+		XMStoreFloat4x4(&reflectedPassCB.ViewProj, XMMatrixTranspose(reflectedViewProj));
+		XMStoreFloat4x4(&reflectedPassCB.InvViewProj, XMMatrixTranspose(XMMatrixInverse(nullptr, reflectedViewProj)));
+		XMStoreFloat3(&reflectedPassCB.EyePosW, reflectedEye);
+
+		currentPassCB->CopyData(1 + (int)i, reflectedPassCB);
+	}
+}
+
+XMMATRIX MirrorApp::ObliqueProjection(FXMMATRIX proj, FXMVECTOR viewSpaceClipPlane) {
+	// Lengyel's oblique near plane: replace the z column of the projection so the
+	// near plane becomes the clip plane while the far plane still maps to z = 1.
+	XMFLOAT4X4 P;
+	XMStoreFloat4x4(&P, proj);
+
+	XMFLOAT4 C;
+	XMStoreFloat4(&C, viewSpaceClipPlane);
+
+	// View space point of the far frustum corner on the clip plane's side.
+	XMVECTOR cornerClip = XMVectorSet(C.x < 0.0f ? -1.0f : 1.0f, C.y < 0.0f ? -1.0f : 1.0f, 1.0f, 1.0f);
+	XMVECTOR q = XMVector4Transform(cornerClip, XMMatrixInverse(nullptr, proj));
+
+	XMVECTOR wColumn = XMVectorSet(P(0, 3), P(1, 3), P(2, 3), P(3, 3));
+	float scale = XMVectorGetX(XMVector4Dot(q, wColumn)) / XMVectorGetX(XMVector4Dot(q, viewSpaceClipPlane));
+
+	P(0, 2) = C.x * scale;
+	P(1, 2) = C.y * scale;
+	P(2, 2) = C.z * scale;
+	P(3, 2) = C.w * scale;
+
+	return XMLoadFloat4x4(&P);
+}
+
+void MirrorApp::AddMirror(RenderItem2* item) {
+	// Mirror i reflects the scene with pass constants 1 + i.
+	assert(m_mirrors.size() < m_maxMirrors);
+
+	// The mirror submesh is a quad drawn as two triangles sharing the 0-2 diagonal.
+	MeshGeometry* geo = item->Geo;
+	assert(geo->IndexFormat == DXGI_FORMAT_R16_UINT);
+	auto indices = (const std::uint16_t*)geo->IndexBufferCPU->GetBufferPointer() + (item->StartIndexLocation - geo->PoolStartIndex);
+	auto vertices = (const Vertex3*)geo->VertexBufferCPU->GetBufferPointer() + (item->BaseVertexLocation - (INT)geo->PoolBaseVertex);
+	const std::uint16_t quad[4] = { indices[0], indices[1], indices[2], indices[5] };
+
+	XMMATRIX world = XMLoadFloat4x4(&item->World);
+
+	Mirror mirror;
+	mirror.Item = item;
+	for (int c = 0; c < 4; ++c)
+		XMStoreFloat3(&mirror.Corners[c], XMVector3TransformCoord(XMLoadFloat3(&vertices[quad[c]].Pos), world));
+
+	// Orient the plane with the vertex normal so the reflecting side is positive.
+	XMVECTOR plane = XMPlaneNormalize(XMPlaneFromPoints(
+		XMLoadFloat3(&mirror.Corners[0]), XMLoadFloat3(&mirror.Corners[1]), XMLoadFloat3(&mirror.Corners[2])));
+	XMVECTOR normal = XMVector3TransformNormal(XMLoadFloat3(&vertices[quad[0]].Normal), world);
+	if (XMVectorGetX(XMVector3Dot(plane, normal)) < 0.0f)
+		plane = -plane;
+	XMStoreFloat4(&mirror.Plane, plane);
+
+	m_mirrors.push_back(mirror);
+}
+
+void MirrorApp::AddPlanarShadows(const XMFLOAT4& receiverPlane, const std::vector<int>& lightIndices) {
+	int receiver = (int)m_shadowReceivers.size();
+	m_shadowReceivers.push_back(receiverPlane);
+
+	for (int light : lightIndices)
+	{
+		assert(m_planarShadows.size() < m_maxPlanarShadows);
+
+		PlanarShadow shadow;
+		shadow.Receiver = receiver;
+		shadow.LightIndex = light;
+		m_planarShadows.push_back(shadow);
+	}
+}
+
+void MirrorApp::UpdatePlanarShadows(GameTimer& gameTimer) {
+	// The shadow footprints are culled against the main camera frustum in world space.
+	BoundingFrustum frustum(XMLoadFloat4x4(&m_proj));
+	XMMATRIX view = XMLoadFloat4x4(&m_view);
+	frustum.Transform(frustum, XMMatrixInverse(&XMMatrixDeterminant(view), view));
+
+	auto currentPassCB = m_currentFrameResource->PassCB.get();
+
+	for (size_t i = 0; i < m_planarShadows.size(); ++i)
+	{
+		PlanarShadow& shadow = m_planarShadows[i];
+		const XMFLOAT4& plane = m_shadowReceivers[shadow.Receiver];
+		const XMFLOAT3& lightDirection = m_mainPassCB.Lights[shadow.LightIndex].Direction;
+
+		bool planeChanged = plane.x != shadow.CachedPlane.x || plane.y != shadow.CachedPlane.y ||
+			plane.z != shadow.CachedPlane.z || plane.w != shadow.CachedPlane.w;
+		bool lightChanged = lightDirection.x != shadow.CachedLightDirection.x ||
+			lightDirection.y != shadow.CachedLightDirection.y || lightDirection.z != shadow.CachedLightDirection.z;
+
+		if (!shadow.Cached || planeChanged || lightChanged)
+		{
+			// The lights are directional, so the light "position" is the direction
+			// towards the light with w = 0. The shadow is lifted a little off the
+			// receiver to avoid z-fighting.
+			XMVECTOR shadowPlane = XMLoadFloat4(&plane);
+			XMVECTOR toLight = XMVectorSetW(-XMLoadFloat3(&lightDirection), 0.0f);
+			XMMATRIX S = XMMatrixShadow(shadowPlane, toLight);
+			XMVECTOR offset = XMVectorScale(XMPlaneNormalize(shadowPlane), 0.001f);
+			XMMATRIX shadowOffset = XMMatrixTranslationFromVector(offset);
+			XMStoreFloat4x4(&shadow.ShadowTransform, S * shadowOffset);
+
+			shadow.CachedPlane = plane;
+			shadow.CachedLightDirection = lightDirection;
+			shadow.Cached = true;
+		}
+
+		XMMATRIX shadowTransform = XMLoadFloat4x4(&shadow.ShadowTransform);
+
+		shadow.VisibleCasters.clear();
+		for (auto ri : m_shadowCasters)
+		{
+			BoundingBox worldBounds;
+			ri->Bounds.Transform(worldBounds, XMLoadFloat4x4(&ri->World));
+
+			XMFLOAT3 corners[BoundingBox::CORNER_COUNT];
+			worldBounds.GetCorners(corners);
+			for (auto& corner : corners)
+				XMStoreFloat3(&corner, XMVector3TransformCoord(XMLoadFloat3(&corner), shadowTransform));
+
+			BoundingBox footprint;
+			BoundingBox::CreateFromPoints(footprint, BoundingBox::CORNER_COUNT, corners, sizeof(XMFLOAT3));
+			if (frustum.Contains(footprint) != DISJOINT)
+				shadow.VisibleCasters.push_back(ri);
+		}
+
+		PassConstants shadowPassCB = m_mainPassCB;
+		XMStoreFloat4x4(&shadowPassCB.ShadowTransform, XMMatrixTranspose(shadowTransform));
+		currentPassCB->CopyData(1 + m_maxMirrors + (int)i, shadowPassCB);
+	}
 }
 
 void MirrorApp::render() {
@@ -210,48 +491,45 @@ void MirrorApp::render() {
 	m_graphicsCommandList->RSSetViewports(1, &m_screenViewport);
 	m_graphicsCommandList->RSSetScissorRects(1, &m_scissorsRect);
 
-	m_graphicsCommandList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(GetCurrentBackBuffer(), D3D12_RESOURCE_STATE_PRESENT, D3D12_RESOURCE_STATE_RENDER_TARGET));
-	m_graphicsCommandList->ClearRenderTargetView(GetCurrentBackBufferView(), (float*)&m_mainPassCB.FogColor, 0, nullptr);
-	m_graphicsCommandList->ClearDepthStencilView(GetDepthStencilView(), D3D12_CLEAR_FLAG_DEPTH | D3D12_CLEAR_FLAG_STENCIL, 1.0f, 0, 0, nullptr);
-
-	m_graphicsCommandList->OMSetRenderTargets(1, &GetCurrentBackBufferView(), true, &GetDepthStencilView());
-
 	ID3D12DescriptorHeap* descriptorHeaps[] = { m_srvDescriptorHeap.Get() };
 	m_graphicsCommandList->SetDescriptorHeaps(_countof(descriptorHeaps), descriptorHeaps);
 
-	m_graphicsCommandList->SetGraphicsRootSignature(m_rootSignature.Get());
-
-	UINT passCBByteSize = CalcConstantBufferByteSize(sizeof(PassConstants));
-
-	// Draw opaque items (floors, walls, skull)
-	auto passCB = m_currentFrameResource->PassCB->Resource();
-	m_graphicsCommandList->SetGraphicsRootConstantBufferView(2, passCB->GetGPUVirtualAddress());
-	DrawRenderItems(m_graphicsCommandList.Get(), m_renderItemLayer[(int)RenderLayer2::Opaque]);
+	// Everything bound from here on goes through the recorder so redundant
+	// rebinds between the stencil passes are dropped.
+	m_commandBackend.SetCommandList(m_graphicsCommandList.Get());
+	m_recorder.Invalidate(m_PSOs["opaque"].Get());
+	m_recorder.ResetStats();
+	m_meshletCullStats.Reset();
 
-	// Mark the visible mirror pixels in the stencil buffer with the value 1
-	m_graphicsCommandList->OMSetStencilRef(1);
-	m_graphicsCommandList->SetPipelineState(m_PSOs["markStencilMirrors"].Get());
-	DrawRenderItems(m_graphicsCommandList.Get(), m_renderItemLayer[(int)RenderLayer2::Mirrors]);
+	m_recorder.SetGraphicsRootSignature(m_rootSignature.Get());
 
-	// Draw the reflection into the mirror only (only for pixels where the stencil buffer is 1).
-	// Note that we must supply a different per-pass constant buffer -- one with the lights reflected.
-	m_graphicsCommandList->SetGraphicsRootConstantBufferView(2, passCB->GetGPUVirtualAddress() + 1 * passCBByteSize);
-	m_graphicsCommandList->SetPipelineState(m_PSOs["drawStencilReflections"].Get());
-	DrawRenderItems(m_graphicsCommandList.Get(), m_renderItemLayer[(int)RenderLayer2::Reflected]);
+	// The back buffer changes every frame and the depth buffer on resize.
+	m_frameGraph.SetImportedResource(m_backBufferResource, GetCurrentBackBuffer());
+	m_frameGraph.SetImportedResource(m_depthStencilResource, m_depthStencilBuffer.Get());
 
-	// Restore main pass constants and stencil ref.
-	m_graphicsCommandList->SetGraphicsRootConstantBufferView(2, passCB->GetGPUVirtualAddress());
-	m_graphicsCommandList->OMSetStencilRef(0);
-
-	// Draw mirror transparency so reflection blends through.
-	m_graphicsCommandList->SetPipelineState(m_PSOs["transparent"].Get());
-	DrawRenderItems(m_graphicsCommandList.Get(), m_renderItemLayer[(int)RenderLayer2::Transparent]);
+	m_frameGraph.Execute([this](const FrameGraphBarrier* barriers, std::uint32_t count) {
+		std::vector<D3D12_RESOURCE_BARRIER> d3dBarriers;
+		for (std::uint32_t i = 0; i < count; ++i)
+		{
+			const FrameGraphBarrier& b = barriers[i];
+			auto resource = (ID3D12Resource*)m_frameGraph.GetExternal(b.Resource);
+
+			if (b.BarrierType == FrameGraphBarrier::Type::Aliasing)
+			{
+				auto before = (ID3D12Resource*)m_frameGraph.GetExternal(b.AliasBefore);
+				d3dBarriers.push_back(CD3DX12_RESOURCE_BARRIER::Aliasing(before, resource));
+			}
+			else
+			{
+				d3dBarriers.push_back(CD3DX12_RESOURCE_BARRIER::Transition(resource,
+					ToD3D12ResourceStates(b.StateBefore), ToD3D12ResourceStates(b.StateAfter)));
+			}
+		}
+		m_graphicsCommandList->ResourceBarrier((UINT)d3dBarriers.size(), d3dBarriers.data());
+	});
 
-	// Draw shadows
-	m_graphicsCommandList->SetPipelineState(m_PSOs["shadow"].Get());
-	DrawRenderItems(m_graphicsCommandList.Get(), m_renderItemLayer[(int)RenderLayer2::Shadow]);
+	m_drawStats = m_recorder.Stats();
 
-	m_graphicsCommandList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(GetCurrentBackBuffer(), D3D12_RESOURCE_STATE_RENDER_TARGET, D3D12_RESOURCE_STATE_PRESENT));
 	ThrowIfFailed(m_graphicsCommandList->Close());
 
 	ID3D12CommandList* cmdLists[] = { m_graphicsCommandList.Get() };
@@ -266,31 +544,15 @@ void MirrorApp::render() {
 	m_commandQueue->Signal(m_fence.Get(), m_currentFence);
 }
 
-void MirrorApp::LoadTextures() {
-	auto bricksTex = std::make_unique<Texture>();
-	bricksTex->Name = "bricksTex";
-	bricksTex->Filename = L"Textures/bricks3.dds";
-	ThrowIfFailed(DirectX::CreateDDSTextureFromFile12(m_device.Get(), m_graphicsCommandList.Get(), bricksTex->Filename.c_str(), bricksTex->Resource, bricksTex->UploadHeap));
-
-	auto checkboardTex = std::make_unique<Texture>();
-	checkboardTex->Name = "checkboardTex";
-	checkboardTex->Filename = L"Textures/checkboard.dds";
-	ThrowIfFailed(DirectX::CreateDDSTextureFromFile12(m_device.Get(), m_graphicsCommandList.Get(), checkboardTex->Filename.c_str(), checkboardTex->Resource, checkboardTex->UploadHeap));
-
-	auto iceTex = std::make_unique<Texture>();
-	iceTex->Name = "iceTex";
-	iceTex->Filename = L"Textures/ice.dds";
-	ThrowIfFailed(DirectX::CreateDDSTextureFromFile12(m_device.Get(), m_graphicsCommandList.Get(), iceTex->Filename.c_str(), iceTex->Resource, iceTex->UploadHeap));
-
-	auto whiteTex = std::make_unique<Texture>();
-	whiteTex->Name = "whiteTex";
-	whiteTex->Filename = L"Textures/white1x1.dds";
-	ThrowIfFailed(DirectX::CreateDDSTextureFromFile12(m_device.Get(), m_graphicsCommandList.Get(), whiteTex->Filename.c_str(), whiteTex->Resource, whiteTex->UploadHeap));
-
-	m_textures[bricksTex->Name] = std::move(bricksTex);
-	m_textures[checkboardTex->Name] = std::move(checkboardTex);
-	m_textures[iceTex->Name] = std::move(iceTex);
-	m_textures[whiteTex->Name] = std::move(whiteTex);
+void MirrorApp::LoadTextures(CommandListSet& uploadLists, ThreadPool* pool) {
+	const std::vector<TextureSource> textures =
+	{
+		{ "bricksTex", L"Textures/bricks3.dds" },
+		{ "checkboardTex", L"Textures/checkboard.dds" },
+		{ "iceTex", L"Textures/ice.dds" },
+		{ "whiteTex", L"Textures/white1x1.dds" }
+	};
+	::LoadTextures(m_device.Get(), textures, m_textures, uploadLists, pool);
 }
 
 void MirrorApp::BuildRootSignature() {
@@ -362,23 +624,43 @@ void MirrorApp::BuildDescriptorHeaps() {
 	m_device->CreateShaderResourceView(whiteTex.Get(), &srvDesc, hDescriptor);
 }
 
-void MirrorApp::BuildShaderAndInputLayout() {
+void MirrorApp::BuildShaders(ThreadPool* pool) {
 	const D3D_SHADER_MACRO defines[] = { "FOG", "1", NULL, NULL };
 	const D3D_SHADER_MACRO alphaTestDefines[] = { "FOG", "1", "ALPHA_TEST", "1", NULL, NULL };
+	const D3D_SHADER_MACRO planarShadowDefines[] = { "PLANAR_SHADOW", "1", NULL, NULL };
+	const D3D_SHADER_MACRO quantizedDefines[] = { "QUANTIZED", "1", NULL, NULL };
+	const D3D_SHADER_MACRO quantizedPlanarShadowDefines[] = { "QUANTIZED", "1", "PLANAR_SHADOW", "1", NULL, NULL };
 
-	m_shaders["standardVS"] = CompileShader(L"Shaders\\MirrorApp.hlsl", nullptr, "VS", "vs_5_0");
-	m_shaders["opaquePS"] = CompileShader(L"Shaders\\MirrorApp.hlsl", defines, "PS", "ps_5_0");
-	m_shaders["alphaTestedPS"] = CompileShader(L"Shaders\\MirrorApp.hlsl", alphaTestDefines, "PS", "ps_5_0");
+	const std::vector<ShaderSource> shaders =
+	{
+		{ "standardVS", L"Shaders\\MirrorApp.hlsl", nullptr, "VS", "vs_5_0" },
+		{ "planarShadowVS", L"Shaders\\MirrorApp.hlsl", planarShadowDefines, "VS", "vs_5_0" },
+		{ "standardQuantizedVS", L"Shaders\\MirrorApp.hlsl", quantizedDefines, "VS", "vs_5_0" },
+		{ "planarShadowQuantizedVS", L"Shaders\\MirrorApp.hlsl", quantizedPlanarShadowDefines, "VS", "vs_5_0" },
+		{ "opaquePS", L"Shaders\\MirrorApp.hlsl", defines, "PS", "ps_5_0" },
+		{ "alphaTestedPS", L"Shaders\\MirrorApp.hlsl", alphaTestDefines, "PS", "ps_5_0" }
+	};
+	CompileShaders(shaders, m_shaders, pool);
+}
 
+void MirrorApp::BuildInputLayouts() {
 	m_inputLayout =
 	{
 		{"POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0},
 		{"NORMAL", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 12, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0},
 		{"TEXCOORD", 0, DXGI_FORMAT_R32G32_FLOAT, 0, 24, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0},
 	};
+
+	// QuantizedVertex, expanded to floats by the input assembler.
+	m_quantizedInputLayout =
+	{
+		{"POSITION", 0, DXGI_FORMAT_R16G16B16A16_UNORM, 0, 0, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0},
+		{"NORMAL", 0, DXGI_FORMAT_R16G16_SNORM, 0, 8, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0},
+		{"TEXCOORD", 0, DXGI_FORMAT_R16G16_FLOAT, 0, 12, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0},
+	};
 }
 
-void MirrorApp::BuildRoomGeometry() {
+void MirrorApp::BuildRoomGeometry(ID3D12GraphicsCommandList* cmdList) {
 	std::array<Vertex3, 20> vertices =
 	{
 		// Floor: Observe we tile texture coordinates.
@@ -411,7 +693,7 @@ void MirrorApp::BuildRoomGeometry() {
 		Vertex3(2.5f, 0.0f, 0.0f, 0.0f, 0.0f, -1.0f, 1.0f, 1.0f)
 	};
 
-	std::array<std::int16_t, 30> indices =
+	std::array<std::uint32_t, 30> indices =
 	{
 		// Floor
 		0, 1, 2,
@@ -432,23 +714,30 @@ void MirrorApp::BuildRoomGeometry() {
 		16, 18, 19
 	};
 
-	SubmeshGeometry floorSubmesh;
-	floorSubmesh.IndexCount = 6;
-	floorSubmesh.StartIndexLocation = 0;
-	floorSubmesh.BaseVertexLocation = 0;
-
-	SubmeshGeometry wallSubmesh;
-	wallSubmesh.IndexCount = 18;
-	wallSubmesh.StartIndexLocation = 6;
-	wallSubmesh.BaseVertexLocation = 0;
+	IndexBufferBuilder indexBuffer;
+	indexBuffer.Add("floor", &indices[0], 6);
+	indexBuffer.Add("wall", &indices[6], 18);
+	indexBuffer.Add("mirror", &indices[24], 6);
+	indexBuffer.Build();
+
+	// Single draws: none of the submeshes is splittable.
+	auto makeSubmesh = [&](const char* name, UINT firstVertex, UINT vertexCount) {
+		assert(indexBuffer.Ranges(name).size() == 1);
+		const IndexBufferRange& range = indexBuffer.Ranges(name)[0];
+		SubmeshGeometry submesh;
+		submesh.IndexCount = range.IndexCount;
+		submesh.StartIndexLocation = range.StartIndexLocation;
+		submesh.BaseVertexLocation = range.BaseVertexLocation;
+		BoundingBox::CreateFromPoints(submesh.Bounds, vertexCount, &vertices[firstVertex].Pos, sizeof(Vertex3));
+		return submesh;
+	};
 
-	SubmeshGeometry mirrorSubmesh;
-	mirrorSubmesh.IndexCount = 6;
-	mirrorSubmesh.StartIndexLocation = 24;
-	mirrorSubmesh.BaseVertexLocation = 0;
+	SubmeshGeometry floorSubmesh = makeSubmesh("floor", 0, 4);
+	SubmeshGeometry wallSubmesh = makeSubmesh("wall", 4, 12);
+	SubmeshGeometry mirrorSubmesh = makeSubmesh("mirror", 16, 4);
 
 	const UINT vbByteSize = (UINT)vertices.size() * sizeof(Vertex3);
-	const UINT ibByteSize = (UINT)indices.size() * sizeof(std::uint16_t);
+	const UINT ibByteSize = indexBuffer.ByteSize();
 
 	auto geo = std::make_unique<MeshGeometry>();
 	geo->Name = "roomGeo";
@@ -457,87 +746,302 @@ void MirrorApp::BuildRoomGeometry() {
 	CopyMemory(geo->VertexBufferCPU->GetBufferPointer(), vertices.data(), vbByteSize);
 
 	ThrowIfFailed(D3DCreateBlob(ibByteSize, &geo->IndexBufferCPU));
-	CopyMemory(geo->IndexBufferCPU->GetBufferPointer(), indices.data(), ibByteSize);
-
-	geo->VertexBufferGPU = CreateDefaultBuffer(m_device.Get(), m_graphicsCommandList.Get(), vertices.data(), vbByteSize, geo->VertexBufferUploader);
-	geo->IndexBufferGPU = CreateDefaultBuffer(m_device.Get(), m_graphicsCommandList.Get(), indices.data(), ibByteSize, geo->IndexBufferUploader);
+	CopyMemory(geo->IndexBufferCPU->GetBufferPointer(), indexBuffer.Data(), ibByteSize);
 
 	geo->VertexByteStride = sizeof(Vertex3);
 	geo->VertexBufferByteSize = vbByteSize;
-	geo->IndexFormat = DXGI_FORMAT_R16_UINT;
+	geo->IndexFormat = indexBuffer.Format();
 	geo->IndexBufferByteSize = ibByteSize;
 
 	geo->DrawArgs["floor"] = floorSubmesh;
 	geo->DrawArgs["wall"] = wallSubmesh;
 	geo->DrawArgs["mirror"] = mirrorSubmesh;
 
+	m_geometryPool->Add(*geo, vertices.data(), indexBuffer.Data(), cmdList);
+
 	m_geometries[geo->Name] = std::move(geo);
 }
 
-void MirrorApp::BuildSkullGeometry() {
-	std::ifstream fin("Models/skull.txt");
+void MirrorApp::BuildSkullGeometry(ID3D12GraphicsCommandList* cmdList) {
+	const std::string modelPath = "Models/skull.txt";
+	const std::string cachePath = "Models/skull.mesh";
+	const MeshCacheSource source = GetMeshCacheSource(modelPath);
 
-	if (!fin) {
+	// Warm start: everything below is stored in the cache.
+	MeshCache cache;
+	if (cache.Open(cachePath, source) && LoadSkullCache(cache, cmdList))
+		return;
+	cache.Close();
+
+	// Mapped and parsed in place, in parallel chunks.
+	TextModel skull;
+	if (!LoadTextModel(modelPath, skull, &ThreadPool::Default())) {
 		MessageBox(0, L"Models/skull.txt not found", 0, 0);
 		return;
 	}
 
-	UINT vcount = 0;
-	UINT tcount = 0;
-	std::string ignore;
-
-	fin >> ignore >> vcount;
-	fin >> ignore >> tcount;
-	fin >> ignore >> ignore >> ignore >> ignore;
+	const UINT tcount = (UINT)(skull.Indices.size() / 3);
 
-	std::vector<Vertex3> vertices(vcount);
-	for (UINT i = 0; i < vcount; ++i)
+	std::vector<Vertex3> vertices(skull.Vertices.size());
+	for (std::size_t i = 0; i < vertices.size(); ++i)
 	{
-		fin >> vertices[i].Pos.x >> vertices[i].Pos.y >> vertices[i].Pos.z;
-		fin >> vertices[i].Normal.x >> vertices[i].Normal.y >> vertices[i].Normal.z;
+		vertices[i].Pos = skull.Vertices[i].Position;
+		vertices[i].Normal = skull.Vertices[i].Normal;
 		vertices[i].TexC = { 0.0f, 0.0f };
 	}
 
-	fin >> ignore;
-	fin >> ignore;
-	fin >> ignore;
+	std::vector<std::uint32_t> indices = std::move(skull.Indices);
+
+	// Reorder for the vertex cache, overdraw and vertex fetch before building
+	// the LODs, so the coarser levels inherit the vertex order.
+	std::size_t optimizedVertexCount = vertices.size();
+	OptimizeMesh(indices, vertices.data(), optimizedVertexCount, sizeof(Vertex3), &vertices[0].Pos);
+	vertices.resize(optimizedVertexCount);
+
+	BoundingBox bounds;
+	BoundingBox::CreateFromPoints(bounds, vertices.size(), &vertices[0].Pos, sizeof(Vertex3));
+
+	// Coarser levels reuse the vertices and only add index ranges. Each level
+	// keeps a quarter of the triangles of the previous one.
+	LodChain& lods = m_lodChains["skull"];
+	lods.Levels.push_back({ LodSubmeshName("skull", 0), 0.0f });
 
-	std::vector<std::int32_t> indices(3 * tcount);
-	for (UINT i = 0; i < tcount; ++i)
+	std::vector<SubmeshGeometry> lodSubmeshes(1);
+	lodSubmeshes[0].IndexCount = (UINT)indices.size();
+	lodSubmeshes[0].StartIndexLocation = 0;
+	lodSubmeshes[0].BaseVertexLocation = 0;
+	lodSubmeshes[0].Bounds = bounds;
+
+	const UINT skullLodCount = 4;
+
+	// Each level is simplified from the previous one, so its error is bounded by
+	// the sum of the errors on the way.
+	SimplifyOptions simplifyOptions;
+	simplifyOptions.KeepOriginalVertices = true;
+	simplifyOptions.TargetTriangleCount = tcount;
+
+	std::vector<std::uint32_t> lodIndices = indices;
+	float error = 0.0f;
+
+	for (UINT level = 1; level < skullLodCount; ++level)
 	{
-		fin >> indices[i * 3 + 0] >> indices[i * 3 + 1] >> indices[i * 3 + 2];
+		simplifyOptions.TargetTriangleCount /= 4;
+		SimplifyResult simplified = SimplifyMesh(&vertices[0].Pos, &vertices[0].Normal, sizeof(Vertex3), vertices.size(),
+			lodIndices.data(), lodIndices.size(), simplifyOptions);
+		lodIndices = std::move(simplified.Indices);
+		error += simplified.Error;
+
+		// Collapses leave the triangles in input order, so only the cache order
+		// needs redoing. The vertices are shared with level 0.
+		OptimizeVertexCache(lodIndices.data(), lodIndices.size(), vertices.size());
+
+		SubmeshGeometry lodSubmesh;
+		lodSubmesh.IndexCount = (UINT)lodIndices.size();
+		lodSubmesh.StartIndexLocation = (UINT)indices.size();
+		lodSubmesh.BaseVertexLocation = 0;
+		lodSubmesh.Bounds = bounds;
+		lodSubmeshes.push_back(lodSubmesh);
+
+		indices.insert(indices.end(), lodIndices.begin(), lodIndices.end());
+		lods.Levels.push_back({ LodSubmeshName("skull", level), error });
 	}
 
-	fin.close();
+	// Split every level into meshlets and store its triangles in meshlet order,
+	// so each meshlet is a contiguous index range that can be culled on its own.
+	for (UINT level = 0; level < (UINT)lodSubmeshes.size(); ++level)
+	{
+		const SubmeshGeometry& submesh = lodSubmeshes[level];
+		MeshletMesh meshlets = BuildMeshlets(&indices[submesh.StartIndexLocation], submesh.IndexCount,
+			&vertices[0].Pos, sizeof(Vertex3), vertices.size());
+		std::copy(meshlets.Indices.begin(), meshlets.Indices.end(), indices.begin() + submesh.StartIndexLocation);
+		m_meshlets[lods.Levels[level].Submesh] = std::move(meshlets);
+	}
 
-	const UINT vbByteSize = (UINT)vertices.size() * sizeof(Vertex3);
-	const UINT ibByteSize = (UINT)indices.size() * sizeof(std::int32_t);
+	// Each level is drawn whole or as meshlet ranges inside it, so the levels are
+	// never split. They share few enough vertices for 16-bit indices.
+	IndexBufferBuilder indexBuffer;
+	for (UINT level = 0; level < (UINT)lodSubmeshes.size(); ++level)
+		indexBuffer.Add(lods.Levels[level].Submesh, &indices[lodSubmeshes[level].StartIndexLocation], lodSubmeshes[level].IndexCount);
+	indexBuffer.Build();
 
-	auto geo = std::make_unique<MeshGeometry>();
-	geo->Name = "skullGeo";
+	for (UINT level = 0; level < (UINT)lodSubmeshes.size(); ++level)
+	{
+		assert(indexBuffer.Ranges(lods.Levels[level].Submesh).size() == 1);
+		const IndexBufferRange& range = indexBuffer.Ranges(lods.Levels[level].Submesh)[0];
+		lodSubmeshes[level].IndexCount = range.IndexCount;
+		lodSubmeshes[level].StartIndexLocation = range.StartIndexLocation;
+		lodSubmeshes[level].BaseVertexLocation = range.BaseVertexLocation;
+	}
 
-	ThrowIfFailed(D3DCreateBlob(vbByteSize, &geo->VertexBufferCPU));
-	CopyMemory(geo->VertexBufferCPU->GetBufferPointer(), vertices.data(), vbByteSize);
+	// The GPU gets the vertices at half the size, with the positions relative
+	// to the bounds of the mesh.
+	XMFLOAT3 boundsMin, boundsMax;
+	XMStoreFloat3(&boundsMin, XMLoadFloat3(&bounds.Center) - XMLoadFloat3(&bounds.Extents));
+	XMStoreFloat3(&boundsMax, XMLoadFloat3(&bounds.Center) + XMLoadFloat3(&bounds.Extents));
+	const PositionQuantization quantization = MakePositionQuantization(boundsMin, boundsMax);
+
+	std::vector<QuantizedVertex> quantizedVertices(vertices.size());
+	QuantizeVertices(quantizedVertices.data(), vertices.size(), quantization,
+		&vertices[0].Pos, &vertices[0].Normal, &vertices[0].TexC, sizeof(Vertex3));
+
+	CreateSkullGeometry(quantizedVertices.data(), (UINT)quantizedVertices.size(), indexBuffer.Data(), indexBuffer.IndexCount(), indexBuffer.Format(),
+		lodSubmeshes, quantization, cmdList);
+
+	// Cold start: store the result for the next launch. The bounds in the header
+	// decode the quantized positions.
+	MeshCacheContents contents;
+	for (const D3D12_INPUT_ELEMENT_DESC& element : m_quantizedInputLayout)
+		contents.AddAttribute(element.SemanticName, element.SemanticIndex, element.Format, element.AlignedByteOffset);
+
+	contents.Vertices = quantizedVertices.data();
+	contents.VertexStride = sizeof(QuantizedVertex);
+	contents.VertexCount = (std::uint32_t)quantizedVertices.size();
+	contents.Indices = indexBuffer.Data();
+	contents.IndexFormat = indexBuffer.Format();
+	contents.IndexCount = indexBuffer.IndexCount();
+	// Stored raw, so warm starts upload the vertices straight from the mapping.
+	// Compressing saves a third of the file but makes loads slower; see
+	// Tests/MeshCacheBenchmark.
+	contents.Compress = false;
+	contents.BoundsMin = boundsMin;
+	contents.BoundsMax = boundsMax;
+
+	for (UINT level = 0; level < (UINT)lodSubmeshes.size(); ++level)
+	{
+		const SubmeshGeometry& submesh = lodSubmeshes[level];
+		const std::string& name = lods.Levels[level].Submesh;
+		contents.AddSubmesh(name, submesh.IndexCount, submesh.StartIndexLocation, submesh.BaseVertexLocation,
+			submesh.Bounds.Center, submesh.Bounds.Extents, lods.Levels[level].GeometricError);
+
+		const MeshletMesh& meshlets = m_meshlets[name];
+		contents.AddBlob(name + ".meshlets", meshlets.Meshlets.data(), meshlets.Meshlets.size() * sizeof(Meshlet));
+		contents.AddBlob(name + ".vertices", meshlets.Vertices.data(), meshlets.Vertices.size() * sizeof(std::uint32_t));
+		contents.AddBlob(name + ".triangles", meshlets.Triangles.data(), meshlets.Triangles.size());
+	}
 
-	ThrowIfFailed(D3DCreateBlob(ibByteSize, &geo->IndexBufferCPU));
-	CopyMemory(geo->IndexBufferCPU->GetBufferPointer(), indices.data(), ibByteSize);
+	// If the write fails, the next launch builds the skull again.
+	WriteMeshCache(cachePath, contents, source);
+}
 
-	geo->VertexBufferGPU = CreateDefaultBuffer(m_device.Get(), m_graphicsCommandList.Get(), vertices.data(), vbByteSize, geo->VertexBufferUploader);
-	geo->IndexBufferGPU = CreateDefaultBuffer(m_device.Get(), m_graphicsCommandList.Get(), indices.data(), ibByteSize, geo->IndexBufferUploader);
+bool MirrorApp::LoadSkullCache(const MeshCache& cache, ID3D12GraphicsCommandList* cmdList) {
+	// The vertices must match the input layout the quantized PSOs are built with.
+	const MeshCacheHeader& header = cache.Header();
+	if (header.VertexStride != sizeof(QuantizedVertex) ||
+		(header.IndexFormat != DXGI_FORMAT_R16_UINT && header.IndexFormat != DXGI_FORMAT_R32_UINT) ||
+		header.AttributeCount != (std::uint32_t)m_quantizedInputLayout.size())
+		return false;
 
-	geo->VertexByteStride = sizeof(Vertex3);
+	for (UINT i = 0; i < header.AttributeCount; ++i)
+	{
+		const MeshCacheAttribute& attribute = cache.Attributes()[i];
+		const D3D12_INPUT_ELEMENT_DESC& element = m_quantizedInputLayout[i];
+		if (strcmp(attribute.Semantic, element.SemanticName) != 0 || attribute.SemanticIndex != element.SemanticIndex ||
+			attribute.Format != (std::uint32_t)element.Format || attribute.Offset != element.AlignedByteOffset)
+			return false;
+	}
+
+	// Compressed buffers are decoded in parallel chunks. The indices are needed
+	// on the CPU for the meshlets either way.
+	ThreadPool& pool = ThreadPool::Default();
+	std::vector<std::uint8_t> indices(cache.IndexBufferSize());
+	if (!cache.ReadIndices(indices.data(), &pool))
+		return false;
+
+	auto indexAt = [&](std::size_t i) -> std::uint32_t {
+		return header.IndexFormat == DXGI_FORMAT_R16_UINT ? ((const std::uint16_t*)indices.data())[i] : ((const std::uint32_t*)indices.data())[i];
+	};
+
+	std::vector<QuantizedVertex> decodedVertices;
+	auto vertices = (const QuantizedVertex*)cache.MappedVertices();
+	if (!vertices)
+	{
+		decodedVertices.resize(header.VertexCount);
+		if (!cache.ReadVertices(decodedVertices.data(), &pool))
+			return false;
+		vertices = decodedVertices.data();
+	}
+
+	LodChain lods;
+	std::vector<SubmeshGeometry> lodSubmeshes;
+	std::unordered_map<std::string, MeshletMesh> meshlets;
+
+	for (UINT level = 0; ; ++level)
+	{
+		std::string name = LodSubmeshName("skull", level);
+		const MeshCacheSubmesh* cached = cache.FindSubmesh(name);
+		if (!cached)
+			break;
+
+		SubmeshGeometry submesh;
+		submesh.IndexCount = cached->IndexCount;
+		submesh.StartIndexLocation = cached->StartIndexLocation;
+		submesh.BaseVertexLocation = cached->BaseVertexLocation;
+		submesh.Bounds = BoundingBox(cached->BoundsCenter, cached->BoundsExtents);
+		lodSubmeshes.push_back(submesh);
+		lods.Levels.push_back({ name, cached->GeometricError });
+
+		// The index range of a level is already in meshlet order.
+		std::size_t meshletsSize, verticesSize, trianglesSize;
+		auto cachedMeshlets = (const Meshlet*)cache.FindBlob(name + ".meshlets", meshletsSize);
+		auto cachedVertices = (const std::uint32_t*)cache.FindBlob(name + ".vertices", verticesSize);
+		auto cachedTriangles = (const std::uint8_t*)cache.FindBlob(name + ".triangles", trianglesSize);
+		if (!cachedMeshlets || !cachedVertices || !cachedTriangles ||
+			meshletsSize % sizeof(Meshlet) != 0 || verticesSize % sizeof(std::uint32_t) != 0)
+			return false;
+
+		// A damaged or stale cache is rebuilt rather than read out of bounds.
+		if ((std::uint64_t)submesh.StartIndexLocation + submesh.IndexCount > header.IndexCount)
+			return false;
+
+		MeshletMesh& mesh = meshlets[name];
+		mesh.Meshlets.assign(cachedMeshlets, cachedMeshlets + meshletsSize / sizeof(Meshlet));
+		mesh.Vertices.assign(cachedVertices, cachedVertices + verticesSize / sizeof(std::uint32_t));
+		mesh.Triangles.assign(cachedTriangles, cachedTriangles + trianglesSize);
+		// The meshlets index the whole vertex buffer, the index buffer is rebased
+		// on the base vertex of the level.
+		mesh.Indices.resize(submesh.IndexCount);
+		for (UINT i = 0; i < submesh.IndexCount; ++i)
+			mesh.Indices[i] = indexAt(submesh.StartIndexLocation + i) + submesh.BaseVertexLocation;
+
+		if (!ValidateMeshlets(mesh, submesh.IndexCount, header.VertexCount))
+			return false;
+	}
+
+	if (lodSubmeshes.empty())
+		return false;
+
+	m_lodChains["skull"] = std::move(lods);
+	for (auto& mesh : meshlets)
+		m_meshlets[mesh.first] = std::move(mesh.second);
+
+	CreateSkullGeometry(vertices, header.VertexCount, indices.data(), header.IndexCount, (DXGI_FORMAT)header.IndexFormat, lodSubmeshes,
+		MakePositionQuantization(header.BoundsMin, header.BoundsMax), cmdList);
+	return true;
+}
+
+void MirrorApp::CreateSkullGeometry(const QuantizedVertex* vertices, UINT vertexCount, const void* indices, UINT indexCount, DXGI_FORMAT indexFormat,
+	const std::vector<SubmeshGeometry>& lodSubmeshes, const PositionQuantization& quantization, ID3D12GraphicsCommandList* cmdList) {
+	const UINT vbByteSize = vertexCount * sizeof(QuantizedVertex);
+	const UINT ibByteSize = indexCount * (indexFormat == DXGI_FORMAT_R16_UINT ? sizeof(std::uint16_t) : sizeof(std::uint32_t));
+
+	auto geo = std::make_unique<MeshGeometry>();
+	geo->Name = "skullGeo";
+
+	geo->VertexByteStride = sizeof(QuantizedVertex);
 	geo->VertexBufferByteSize = vbByteSize;
-	geo->IndexFormat = DXGI_FORMAT_R32_UINT;
+	geo->IndexFormat = indexFormat;
 	geo->IndexBufferByteSize = ibByteSize;
 
-	SubmeshGeometry submesh;
-	submesh.IndexCount = (UINT)indices.size();
-	submesh.StartIndexLocation = 0;
-	submesh.BaseVertexLocation = 0;
+	const LodChain& lods = m_lodChains["skull"];
+	for (UINT level = 0; level < (UINT)lodSubmeshes.size(); ++level)
+		geo->DrawArgs[lods.Levels[level].Submesh] = lodSubmeshes[level];
 
-	geo->DrawArgs["skull"] = submesh;
+	// Nothing reads the skull back on the CPU, so the data is only copied into
+	// the upload buffer, which may read it straight from a mapped cache.
+	m_geometryPool->Add(*geo, vertices, indices, cmdList);
 
 	m_geometries[geo->Name] = std::move(geo);
+	m_skullQuantization = quantization;
 }
 
 void MirrorApp::BuildMaterials() {
@@ -600,6 +1104,7 @@ void MirrorApp::BuildRenderItems() {
 	floorRenderItem->IndexCount = floorRenderItem->Geo->DrawArgs["floor"].IndexCount;
 	floorRenderItem->StartIndexLocation = floorRenderItem->Geo->DrawArgs["floor"].StartIndexLocation;
 	floorRenderItem->BaseVertexLocation = floorRenderItem->Geo->DrawArgs["floor"].BaseVertexLocation;
+	floorRenderItem->Bounds = floorRenderItem->Geo->DrawArgs["floor"].Bounds;
 	m_renderItemLayer[(int)RenderLayer2::Opaque].push_back(floorRenderItem.get());
 
 	auto wallsRenderItem = std::make_unique<RenderItem2>();
@@ -612,6 +1117,7 @@ void MirrorApp::BuildRenderItems() {
 	wallsRenderItem->IndexCount = wallsRenderItem->Geo->DrawArgs["wall"].IndexCount;
 	wallsRenderItem->StartIndexLocation = wallsRenderItem->Geo->DrawArgs["wall"].StartIndexLocation;
 	wallsRenderItem->BaseVertexLocation = wallsRenderItem->Geo->DrawArgs["wall"].BaseVertexLocation;
+	wallsRenderItem->Bounds = wallsRenderItem->Geo->DrawArgs["wall"].Bounds;
 	m_renderItemLayer[(int)RenderLayer2::Opaque].push_back(wallsRenderItem.get());
 
 	auto skullRenderItem = std::make_unique<RenderItem2>();
@@ -624,80 +1130,255 @@ void MirrorApp::BuildRenderItems() {
 	skullRenderItem->IndexCount = skullRenderItem->Geo->DrawArgs["skull"].IndexCount;
 	skullRenderItem->StartIndexLocation = skullRenderItem->Geo->DrawArgs["skull"].StartIndexLocation;
 	skullRenderItem->BaseVertexLocation = skullRenderItem->Geo->DrawArgs["skull"].BaseVertexLocation;
+	skullRenderItem->Bounds = skullRenderItem->Geo->DrawArgs["skull"].Bounds;
+	skullRenderItem->Format = VertexFormat::Quantized;
+	skullRenderItem->Quantization = m_skullQuantization;
+	skullRenderItem->Lods = &m_lodChains["skull"];
+	skullRenderItem->Meshlets = &m_meshlets["skull"];
 	m_skullRenderItem = skullRenderItem.get();
 	m_renderItemLayer[(int)RenderLayer2::Opaque].push_back(skullRenderItem.get());
 
-	auto reflectedSkullRenderItem = std::make_unique<RenderItem2>();
-	*reflectedSkullRenderItem = *skullRenderItem;
-	reflectedSkullRenderItem->objCBIndex = 3;
-	m_reflectedSkullRenderItem = reflectedSkullRenderItem.get();
-	m_renderItemLayer[(int)RenderLayer2::Reflected].push_back(reflectedSkullRenderItem.get());
-	
-	auto shadowedSkullRenderItem = std::make_unique<RenderItem2>();
-	*shadowedSkullRenderItem = *skullRenderItem;
-	shadowedSkullRenderItem->objCBIndex = 4;
-	shadowedSkullRenderItem->Mat = m_materials["shadowMat"].get();
-	m_shadowedSkullRenderItem = shadowedSkullRenderItem.get();
-	m_renderItemLayer[(int)RenderLayer2::Shadow].push_back(shadowedSkullRenderItem.get());
+	m_shadowCasters.push_back(skullRenderItem.get());
 
 	auto mirrorRenderItem = std::make_unique<RenderItem2>();
 	mirrorRenderItem->World = MathHelper::Identity4x4();
 	mirrorRenderItem->TexTransform = MathHelper::Identity4x4();
-	mirrorRenderItem->objCBIndex = 5;
+	mirrorRenderItem->objCBIndex = 3;
 	mirrorRenderItem->Mat = m_materials["icemirror"].get();
 	mirrorRenderItem->Geo = m_geometries["roomGeo"].get();
 	mirrorRenderItem->PrimitiveType = D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
 	mirrorRenderItem->IndexCount = mirrorRenderItem->Geo->DrawArgs["mirror"].IndexCount;
 	mirrorRenderItem->StartIndexLocation = mirrorRenderItem->Geo->DrawArgs["mirror"].StartIndexLocation;
 	mirrorRenderItem->BaseVertexLocation = mirrorRenderItem->Geo->DrawArgs["mirror"].BaseVertexLocation;
+	mirrorRenderItem->Bounds = mirrorRenderItem->Geo->DrawArgs["mirror"].Bounds;
 	m_renderItemLayer[(int)RenderLayer2::Mirrors].push_back(mirrorRenderItem.get());
 	m_renderItemLayer[(int)RenderLayer2::Transparent].push_back(mirrorRenderItem.get());
+	AddMirror(mirrorRenderItem.get());
+
+	// The skull casts a shadow from the main light onto the floor (xz plane).
+	AddPlanarShadows(XMFLOAT4(0.0f, 1.0f, 0.0f, 0.0f), { 0 });
 
 	m_allRenderItems.push_back(std::move(floorRenderItem));
 	m_allRenderItems.push_back(std::move(wallsRenderItem));
 	m_allRenderItems.push_back(std::move(skullRenderItem));
-	m_allRenderItems.push_back(std::move(reflectedSkullRenderItem));
-	m_allRenderItems.push_back(std::move(shadowedSkullRenderItem));
 	m_allRenderItems.push_back(std::move(mirrorRenderItem));
+
+	// Give every pair of buffers a small id for the sort key. Pooled geometries
+	// that share arenas share an id, so their draws sort next to each other.
+	std::map<std::pair<ID3D12Resource*, ID3D12Resource*>, std::uint32_t> bufferIds;
+	for (auto& e : m_allRenderItems)
+	{
+		auto buffers = std::make_pair(e->Geo->VertexBufferGPU.Get(), e->Geo->IndexBufferGPU.Get());
+		m_geometrySortIds[e->Geo] = bufferIds.emplace(buffers, (std::uint32_t)bufferIds.size()).first->second;
+	}
+}
+
+D3D12_RESOURCE_STATES MirrorApp::ToD3D12ResourceStates(std::uint32_t states) {
+	if (states == ResourceState_Common)
+		return D3D12_RESOURCE_STATE_COMMON;
+
+	D3D12_RESOURCE_STATES result = D3D12_RESOURCE_STATE_COMMON;
+	if (states & ResourceState_RenderTarget) result |= D3D12_RESOURCE_STATE_RENDER_TARGET;
+	if (states & ResourceState_DepthWrite) result |= D3D12_RESOURCE_STATE_DEPTH_WRITE;
+	if (states & ResourceState_DepthRead) result |= D3D12_RESOURCE_STATE_DEPTH_READ;
+	if (states & ResourceState_ShaderResource) result |= D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE | D3D12_RESOURCE_STATE_NON_PIXEL_SHADER_RESOURCE;
+	if (states & ResourceState_CopySource) result |= D3D12_RESOURCE_STATE_COPY_SOURCE;
+	if (states & ResourceState_CopyDest) result |= D3D12_RESOURCE_STATE_COPY_DEST;
+	if (states & ResourceState_Present) result |= D3D12_RESOURCE_STATE_PRESENT;
+	return result;
+}
+
+void MirrorApp::BuildFrameGraph() {
+	m_backBufferResource = m_frameGraph.ImportResource("backBuffer", ResourceState_Present, ResourceState_Present);
+	m_depthStencilResource = m_frameGraph.ImportResource("depthStencil", ResourceState_DepthWrite, ResourceState_DepthWrite);
+
+	FrameGraphResource backBuffer = m_backBufferResource;
+	FrameGraphResource depthStencil = m_depthStencilResource;
+	UINT passCBByteSize = CalcConstantBufferByteSize(sizeof(PassConstants));
+
+	// Passes that draw on top of earlier results read what they write, so the
+	// producers are kept.
+	auto drawsOnTop = [=](FrameGraph::PassBuilder& builder) {
+		builder.Read(backBuffer, ResourceState_RenderTarget);
+		builder.Write(backBuffer, ResourceState_RenderTarget);
+		builder.Read(depthStencil, ResourceState_DepthWrite);
+		builder.Write(depthStencil, ResourceState_DepthWrite);
+	};
+
+	m_frameGraph.AddPass("clear",
+		[=](FrameGraph::PassBuilder& builder) {
+			builder.Write(backBuffer, ResourceState_RenderTarget);
+			builder.Write(depthStencil, ResourceState_DepthWrite);
+		},
+		[this]() {
+			m_graphicsCommandList->ClearRenderTargetView(GetCurrentBackBufferView(), (float*)&m_mainPassCB.FogColor, 0, nullptr);
+			m_graphicsCommandList->ClearDepthStencilView(GetDepthStencilView(), D3D12_CLEAR_FLAG_DEPTH | D3D12_CLEAR_FLAG_STENCIL, 1.0f, 0, 0, nullptr);
+			m_graphicsCommandList->OMSetRenderTargets(1, &GetCurrentBackBufferView(), true, &GetDepthStencilView());
+		});
+
+	// Draw opaque items (floors, walls, skull)
+	m_frameGraph.AddPass("opaque", drawsOnTop, [this]() {
+		auto passCB = m_currentFrameResource->PassCB->Resource();
+		m_recorder.SetGraphicsRootConstantBufferView(2, passCB->GetGPUVirtualAddress());
+		DrawRenderItems(m_recorder, "opaque", m_renderItemLayer[(int)RenderLayer2::Opaque], false, nullptr, &m_mainCullView);
+	});
+
+	// Mark the pixels of each visible mirror in the stencil buffer with its own
+	// value so the reflections cannot bleed into each other.
+	m_frameGraph.AddPass("markStencilMirrors",
+		[=](FrameGraph::PassBuilder& builder) {
+			builder.Read(depthStencil, ResourceState_DepthWrite);
+			builder.Write(depthStencil, ResourceState_DepthWrite);
+		},
+		[this]() {
+			for (size_t i = 0; i < m_mirrors.size(); ++i)
+			{
+				if (!m_mirrors[i].Visible)
+					continue;
+
+				m_graphicsCommandList->RSSetScissorRects(1, &m_mirrors[i].ScissorRect);
+				m_graphicsCommandList->OMSetStencilRef((UINT)i + 1);
+				DrawRenderItems(m_recorder, "markStencilMirrors", { m_mirrors[i].Item });
+			}
+			m_graphicsCommandList->RSSetScissorRects(1, &m_scissorsRect);
+		});
+
+	// Draw the scene once more per visible mirror from the reflected camera, only
+	// where the stencil buffer holds that mirror's value. Each mirror has its own
+	// pass constants with the reflected view and an oblique projection.
+	m_frameGraph.AddPass("reflections", drawsOnTop, [this, passCBByteSize]() {
+		auto passCB = m_currentFrameResource->PassCB->Resource();
+		for (size_t i = 0; i < m_mirrors.size(); ++i)
+		{
+			const Mirror& mirror = m_mirrors[i];
+			if (!mirror.Visible || mirror.ReflectedItems.empty())
+				continue;
+
+			m_graphicsCommandList->RSSetScissorRects(1, &mirror.ScissorRect);
+			m_graphicsCommandList->OMSetStencilRef((UINT)i + 1);
+			m_recorder.SetGraphicsRootConstantBufferView(2, passCB->GetGPUVirtualAddress() + (1 + i) * passCBByteSize);
+			DrawRenderItems(m_recorder, "drawStencilReflections", mirror.ReflectedItems, false, nullptr, &mirror.CullView);
+		}
+
+		// Restore main pass constants, scissor and stencil ref.
+		m_graphicsCommandList->RSSetScissorRects(1, &m_scissorsRect);
+		m_recorder.SetGraphicsRootConstantBufferView(2, passCB->GetGPUVirtualAddress());
+		m_graphicsCommandList->OMSetStencilRef(0);
+	});
+
+	// Draw mirror transparency so reflection blends through.
+	m_frameGraph.AddPass("transparent", drawsOnTop, [this]() {
+		DrawRenderItems(m_recorder, "transparent", m_renderItemLayer[(int)RenderLayer2::Transparent], true);
+	});
+
+	// Draw the planar shadows. Each (plane, light) pair has its own pass constants
+	// with the shadow matrix; the casters keep their object constants.
+	m_frameGraph.AddPass("shadow", drawsOnTop, [this, passCBByteSize]() {
+		auto passCB = m_currentFrameResource->PassCB->Resource();
+		const Material* shadowMat = m_materials["shadowMat"].get();
+		for (size_t i = 0; i < m_planarShadows.size(); ++i)
+		{
+			if (m_planarShadows[i].VisibleCasters.empty())
+				continue;
+
+			m_recorder.SetGraphicsRootConstantBufferView(2, passCB->GetGPUVirtualAddress() + (1 + m_maxMirrors + i) * passCBByteSize);
+			DrawRenderItems(m_recorder, "shadow", m_planarShadows[i].VisibleCasters, true, shadowMat);
+		}
+		m_recorder.SetGraphicsRootConstantBufferView(2, passCB->GetGPUVirtualAddress());
+	});
+
+	m_frameGraph.Compile();
 }
 
-void MirrorApp::DrawRenderItems(ID3D12GraphicsCommandList* cmdList, const std::vector<RenderItem2*>& renderItem) {
+void MirrorApp::DrawRenderItems(CommandRecorder& recorder, const std::string& pso, const std::vector<RenderItem2*>& renderItem, bool isTranslucent,
+	const Material* materialOverride, const MeshletCullView* cullView)
+{
+	// The variant of the PSO for each vertex format. The format is part of the
+	// sort key, so opaque items switch PSO at most once per format; the recorder
+	// drops the repeated sets.
+	ID3D12PipelineState* pipelines[(int)VertexFormat::Count] = { m_PSOs[pso].Get(), m_PSOs[pso + "Quantized"].Get() };
+
 	UINT objCBByteSize = CalcConstantBufferByteSize(sizeof(ObjectConstants));
 	UINT matCBByteSize = CalcConstantBufferByteSize(sizeof(MaterialConstants)); 
 
 	auto objectCB = m_currentFrameResource->ObjectCB->Resource();
 	auto matCB = m_currentFrameResource->MaterialCB->Resource();
 
+	// The layers are drawn in a fixed order because of the stencil passes, so
+	// only the items inside a layer are sorted.
+	XMMATRIX view = XMLoadFloat4x4(&m_view);
+	const float farZ = 1000.0f;
+
+	m_drawList.clear();
 	for (size_t i = 0; i < renderItem.size(); i++)
 	{
 		auto ri = renderItem[i];
 
-		cmdList->IASetVertexBuffers(0, 1, &ri->Geo->VertexBufferView());
-		cmdList->IASetIndexBuffer(&ri->Geo->IndexBufferView());
-		cmdList->IASetPrimitiveTopology(ri->PrimitiveType);
+		XMVECTOR origin = XMVectorSet(ri->World(3, 0), ri->World(3, 1), ri->World(3, 2), 1.0f);
+		float depth = XMVectorGetZ(XMVector3TransformCoord(origin, view));
+
+		std::uint32_t geometry = m_geometrySortIds[ri->Geo];
+		std::uint32_t submesh = m_submeshSortIds.Get(ri->StartIndexLocation, ri->BaseVertexLocation);
+		const Material* mat = materialOverride ? materialOverride : ri->Mat;
+		std::uint32_t material = (std::uint32_t)mat->MatCBIndex;
+
+		std::uint32_t format = (std::uint32_t)ri->Format;
+
+		SortedDraw draw;
+		draw.ItemIndex = (std::uint32_t)i;
+		draw.Key = isTranslucent
+			? DrawKey::MakeTranslucent(0, format, geometry, material, depth, farZ)
+			: DrawKey::MakeOpaque(0, format, geometry, submesh, material, depth, farZ);
+		m_drawList.push_back(draw);
+	}
+
+	RadixSortDraws(m_drawList, m_drawListScratch);
+
+	for (const SortedDraw& draw : m_drawList)
+	{
+		auto ri = renderItem[draw.ItemIndex];
+		const Material* mat = materialOverride ? materialOverride : ri->Mat;
+
+		recorder.SetPipelineState(pipelines[(int)ri->Format]);
+		recorder.IASetVertexBuffer(ToVertexBufferBinding(ri->Geo->VertexBufferView()));
+		recorder.IASetIndexBuffer(ToIndexBufferBinding(ri->Geo->IndexBufferView()));
+		recorder.IASetPrimitiveTopology(ri->PrimitiveType);
 
 		CD3DX12_GPU_DESCRIPTOR_HANDLE tex(m_srvDescriptorHeap->GetGPUDescriptorHandleForHeapStart());
-		tex.Offset(ri->Mat->DiffuseSrvHeapIndex, m_cbvSrvDescriptorSize);
+		tex.Offset(mat->DiffuseSrvHeapIndex, m_cbvSrvDescriptorSize);
 
+		D3D12_GPU_VIRTUAL_ADDRESS matCBAddress = matCB->GetGPUVirtualAddress() + mat->MatCBIndex * matCBByteSize;
 		D3D12_GPU_VIRTUAL_ADDRESS objCBAddress = objectCB->GetGPUVirtualAddress() + ri->objCBIndex * objCBByteSize;
-		D3D12_GPU_VIRTUAL_ADDRESS matCBAddress = matCB->GetGPUVirtualAddress() + ri->Mat->MatCBIndex * matCBByteSize;
 
-		cmdList->SetGraphicsRootDescriptorTable(0, tex);
-		cmdList->SetGraphicsRootConstantBufferView(1, objCBAddress);
-		cmdList->SetGraphicsRootConstantBufferView(3, matCBAddress);
+		recorder.SetGraphicsRootDescriptorTable(0, tex.ptr);
+		recorder.SetGraphicsRootConstantBufferView(3, matCBAddress);
+		recorder.SetGraphicsRootConstantBufferView(1, objCBAddress);
+
+		if (!cullView || !ri->Meshlets)
+		{
+			recorder.DrawIndexedInstanced(ri->IndexCount, 1, ri->StartIndexLocation, ri->BaseVertexLocation, 0);
+			continue;
+		}
+
+		// Only the meshlets that are on screen and face the camera.
+		m_meshletRanges.clear();
+		m_meshletCullStats.Tested += (std::uint32_t)ri->Meshlets->Meshlets.size();
+		m_meshletCullStats.Visible += CullMeshlets(*ri->Meshlets, XMLoadFloat4x4(&ri->World), *cullView, m_meshletRanges);
 
-		cmdList->DrawIndexedInstanced(ri->IndexCount, 1, ri->StartIndexLocation, ri->BaseVertexLocation, 0);
+		for (const MeshletDrawRange& range : m_meshletRanges)
+			recorder.DrawIndexedInstanced(range.IndexCount, 1, ri->StartIndexLocation + range.FirstIndex, ri->BaseVertexLocation, 0);
 	}
 }
 
 void MirrorApp::BuildFrameResources() {
 	for (size_t i = 0; i < gNumFrameResources; ++i)
 	{
-		m_frameResources.push_back(std::make_unique<FrameResource>(m_device.Get(), 2, (UINT)m_allRenderItems.size(), (UINT)m_materials.size()));
+		m_frameResources.push_back(std::make_unique<FrameResource>(m_device.Get(), 1 + m_maxMirrors + m_maxPlanarShadows, (UINT)m_allRenderItems.size(), (UINT)m_materials.size()));
 	}
 }
 
-void MirrorApp::BuildPSOs() {
+void MirrorApp::BuildPSOs(ThreadPool* pool) {
+	std::vector<PipelineSource> pipelines;
 
 	// PSO for opaque objects.
 	D3D12_GRAPHICS_PIPELINE_STATE_DESC opaquePsoDesc;
@@ -724,7 +1405,7 @@ void MirrorApp::BuildPSOs() {
 	opaquePsoDesc.SampleDesc.Count = m_4xMsaaState ? 4 : 1;
 	opaquePsoDesc.SampleDesc.Quality = m_4xMsaaState ? (m_4xMsaaQuality - 1) : 0;
 	opaquePsoDesc.DSVFormat = m_depthStencilFormat;
-	ThrowIfFailed(m_device->CreateGraphicsPipelineState(&opaquePsoDesc, IID_PPV_ARGS(&m_PSOs["opaque"])));
+	pipelines.push_back({ "opaque", opaquePsoDesc });
 	
 	// PSO for transparent objects.
 	D3D12_GRAPHICS_PIPELINE_STATE_DESC transparentPsoDesc = opaquePsoDesc;
@@ -742,7 +1423,7 @@ void MirrorApp::BuildPSOs() {
 	transparencyBlendDesc.RenderTargetWriteMask = D3D12_COLOR_WRITE_ENABLE_ALL;
 	
 	transparentPsoDesc.BlendState.RenderTarget[0] = transparencyBlendDesc;
-	ThrowIfFailed(m_device->CreateGraphicsPipelineState(&transparentPsoDesc, IID_PPV_ARGS(&m_PSOs["transparent"])));
+	pipelines.push_back({ "transparent", transparentPsoDesc });
 
 	// PSO for marking stencil mirrors.
 	CD3DX12_BLEND_DESC mirrorBlendState(D3D12_DEFAULT);
@@ -770,7 +1451,7 @@ void MirrorApp::BuildPSOs() {
 	D3D12_GRAPHICS_PIPELINE_STATE_DESC markMirrorsPsoDesc = opaquePsoDesc;
 	markMirrorsPsoDesc.BlendState = mirrorBlendState;
 	markMirrorsPsoDesc.DepthStencilState = mirrorDepthStencilDesc;
-	ThrowIfFailed(m_device->CreateGraphicsPipelineState(&markMirrorsPsoDesc, IID_PPV_ARGS(&m_PSOs["markStencilMirrors"])));
+	pipelines.push_back({ "markStencilMirrors", markMirrorsPsoDesc });
 
 	// PSO for stencil reflections.
 	D3D12_DEPTH_STENCIL_DESC reflectionsDepthStencilDesc;
@@ -796,7 +1477,7 @@ void MirrorApp::BuildPSOs() {
 	drawReflectionsPsoDesc.DepthStencilState = reflectionsDepthStencilDesc;
 	drawReflectionsPsoDesc.RasterizerState.CullMode = D3D12_CULL_MODE_BACK;
 	drawReflectionsPsoDesc.RasterizerState.FrontCounterClockwise = true;
-	ThrowIfFailed(m_device->CreateGraphicsPipelineState(&drawReflectionsPsoDesc, IID_PPV_ARGS(&m_PSOs["drawStencilReflections"])));
+	pipelines.push_back({ "drawStencilReflections", drawReflectionsPsoDesc });
 
 	// PSO for shadow objects.
 
@@ -821,7 +1502,31 @@ void MirrorApp::BuildPSOs() {
 
 	D3D12_GRAPHICS_PIPELINE_STATE_DESC shadowPsoDesc = transparentPsoDesc;
 	shadowPsoDesc.DepthStencilState = shadowDepthStencilDesc;
-	ThrowIfFailed(m_device->CreateGraphicsPipelineState(&shadowPsoDesc, IID_PPV_ARGS(&m_PSOs["shadow"])));
+	shadowPsoDesc.VS =
+	{
+		reinterpret_cast<BYTE*>(m_shaders["planarShadowVS"]->GetBufferPointer()),
+		m_shaders["planarShadowVS"]->GetBufferSize()
+	};
+	pipelines.push_back({ "shadow", shadowPsoDesc });
+
+	// QuantizedVertex variants: the same state with the quantized input layout
+	// and the vertex shaders that decode it.
+	auto createQuantized = [this, &pipelines](D3D12_GRAPHICS_PIPELINE_STATE_DESC desc, const char* vs, const std::string& name) {
+		desc.InputLayout = { m_quantizedInputLayout.data(), (UINT)m_quantizedInputLayout.size() };
+		desc.VS =
+		{
+			reinterpret_cast<BYTE*>(m_shaders[vs]->GetBufferPointer()),
+			m_shaders[vs]->GetBufferSize()
+		};
+		pipelines.push_back({ name + "Quantized", desc });
+	};
+	createQuantized(opaquePsoDesc, "standardQuantizedVS", "opaque");
+	createQuantized(transparentPsoDesc, "standardQuantizedVS", "transparent");
+	createQuantized(markMirrorsPsoDesc, "standardQuantizedVS", "markStencilMirrors");
+	createQuantized(drawReflectionsPsoDesc, "standardQuantizedVS", "drawStencilReflections");
+	createQuantized(shadowPsoDesc, "planarShadowQuantizedVS", "shadow");
+
+	CreatePipelineStates(m_device.Get(), pipelines, m_PSOs, pool);
 }
 
 void MirrorApp::OnMouseDown(WPARAM btnState, int x, int y) {
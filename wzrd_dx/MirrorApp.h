@@ -5,6 +5,15 @@
 #include "MeshGeometry.h"
 #include "DDSTextureLoader.h"
 #include "Texture.h"
+#include "DrawSort.h"
+#include "D3D12CommandBackend.h"
+#include "FrameGraph.h"
+#include "MeshLod.h"
+#include "Meshlets.h"
+#include "MeshCache.h"
+#include "VertexQuantization.h"
+#include "GeometryPool.h"
+#include "ParallelStartup.h"
 
 using Microsoft::WRL::ComPtr;
 
@@ -12,9 +21,16 @@ enum class RenderLayer2 : int
 {
 	Opaque = 0,
 	Mirrors,
-	Reflected,
 	Transparent,
-	Shadow,
+	Count
+};
+
+// Vertex formats of the render items. Every PSO that draws items comes in one
+// variant per format, with the matching input layout and vertex shader.
+enum class VertexFormat : int
+{
+	Float = 0,	// Vertex3
+	Quantized,	// QuantizedVertex
 	Count
 };
 
@@ -35,6 +51,57 @@ struct RenderItem2
 	UINT IndexCount = 0;
 	UINT StartIndexLocation = 0;
 	int BaseVertexLocation = 0;
+
+	// Bounds of the submesh in local space.
+	BoundingBox Bounds;
+
+	// Format of the vertices of Geo, and how quantized positions decode.
+	VertexFormat Format = VertexFormat::Float;
+	PositionQuantization Quantization;
+
+	// Optional LOD chain. The draw arguments above follow the selected level.
+	const LodChain* Lods = nullptr;
+	std::uint32_t CurrentLod = 0;
+
+	// Optional meshlets of the submesh drawn, with index ranges relative to
+	// StartIndexLocation. Passes that cull them only draw the visible ranges.
+	const MeshletMesh* Meshlets = nullptr;
+};
+
+// A planar mirror. Its reflection is drawn by rendering the opaque items again
+// with a view reflected about the mirror plane, restricted to the mirror's
+// stencil value and scissor rect.
+struct Mirror
+{
+	RenderItem2* Item = nullptr;
+
+	// World space quad in winding order and its plane. The positive side of the
+	// plane is the reflecting side.
+	XMFLOAT3 Corners[4];
+	XMFLOAT4 Plane = { 0.0f, 0.0f, 0.0f, 0.0f };
+
+	// Updated every frame.
+	bool Visible = false;
+	D3D12_RECT ScissorRect = { 0, 0, 0, 0 };
+	std::vector<RenderItem2*> ReflectedItems;
+	MeshletCullView CullView;
+};
+
+// One planar shadow: the casters flattened onto a receiver plane along the
+// direction of one light. The matrix is only rebuilt when the plane or the
+// light changes.
+struct PlanarShadow
+{
+	int Receiver = 0;
+	int LightIndex = 0;
+
+	XMFLOAT4X4 ShadowTransform = MathHelper::Identity4x4();
+	XMFLOAT4 CachedPlane = { 0.0f, 0.0f, 0.0f, 0.0f };
+	XMFLOAT3 CachedLightDirection = { 0.0f, 0.0f, 0.0f };
+	bool Cached = false;
+
+	// Updated every frame: casters whose shadow footprint is on screen.
+	std::vector<RenderItem2*> VisibleCasters;
 };
 
 class MirrorApp : public AbstractRenderer {
@@ -47,36 +114,59 @@ public:
 	void OnMouseUp(WPARAM btnState, int x, int y);
 	void OnMouseMove(WPARAM btnState, int x, int y);
 
+	const DrawStats& GetDrawStats() const { return m_drawStats; }
+	const FrameGraphStats& GetFrameGraphStats() const { return m_frameGraph.Stats(); }
+	const MeshletCullStats& GetMeshletCullStats() const { return m_meshletCullStats; }
+
 private:
-	void LoadTextures();
+	void LoadTextures(CommandListSet& uploadLists, ThreadPool* pool);
 	void BuildRootSignature();
 	void BuildDescriptorHeaps();
-	void BuildShaderAndInputLayout();
-	void BuildRoomGeometry();
-	void BuildSkullGeometry();
+	void BuildShaders(ThreadPool* pool);
+	void BuildInputLayouts();
+	void BuildRoomGeometry(ID3D12GraphicsCommandList* cmdList);
+	void BuildSkullGeometry(ID3D12GraphicsCommandList* cmdList);
+	bool LoadSkullCache(const MeshCache& cache, ID3D12GraphicsCommandList* cmdList);
+	void CreateSkullGeometry(const QuantizedVertex* vertices, UINT vertexCount, const void* indices, UINT indexCount, DXGI_FORMAT indexFormat,
+		const std::vector<SubmeshGeometry>& lodSubmeshes, const PositionQuantization& quantization, ID3D12GraphicsCommandList* cmdList);
 	void BuildMaterials();
 	void BuildRenderItems();
 	void BuildFrameResources();
-	void BuildPSOs();
-	void DrawRenderItems(ID3D12GraphicsCommandList* cmdList, const std::vector<RenderItem2*>& renderItem);
+	void BuildPSOs(ThreadPool* pool);
+	void BuildFrameGraph();
+	static D3D12_RESOURCE_STATES ToD3D12ResourceStates(std::uint32_t states);
+	void DrawRenderItems(CommandRecorder& recorder, const std::string& pso, const std::vector<RenderItem2*>& renderItem, bool isTranslucent = false,
+		const Material* materialOverride = nullptr, const MeshletCullView* cullView = nullptr);
 	void UpdateObjectCBs(GameTimer& gameTimer);
 	void UpdateMaterialsCBs(GameTimer& gameTimer);
 	void UpdateMainPassCB(GameTimer& gameTimer);
-	void UpdateReflectedPassCB(GameTimer& gameTimer);
+	void UpdateLods(GameTimer& gameTimer);
+	void UpdateMirrors(GameTimer& gameTimer);
+	void AddMirror(RenderItem2* item);
+	static XMMATRIX ObliqueProjection(FXMMATRIX proj, FXMVECTOR viewSpaceClipPlane);
+	void UpdatePlanarShadows(GameTimer& gameTimer);
+	void AddPlanarShadows(const XMFLOAT4& receiverPlane, const std::vector<int>& lightIndices);
 	void OnKeyboardInput(GameTimer& gameTimer);
 	void UpdateCamera(GameTimer& gameTimer);
 
 	std::unordered_map<std::string, std::unique_ptr<Texture>> m_textures;
 	std::unordered_map<std::string, ComPtr<ID3DBlob>> m_shaders;
 	std::unordered_map<std::string, std::unique_ptr<MeshGeometry>> m_geometries;
+	// Holds the room and the skull.
+	std::unique_ptr<GeometryPool> m_geometryPool;
 	std::unordered_map<std::string, std::unique_ptr<Material>> m_materials;
+	// LOD chains by base submesh name.
+	std::unordered_map<std::string, LodChain> m_lodChains;
+	// Meshlets by submesh name.
+	std::unordered_map<std::string, MeshletMesh> m_meshlets;
+	// PSOs by name, with the QuantizedVertex variant of each under name + "Quantized".
 	std::unordered_map<std::string, ComPtr<ID3D12PipelineState>> m_PSOs;
+	std::vector<D3D12_INPUT_ELEMENT_DESC> m_quantizedInputLayout;
 
 	std::vector<RenderItem2*> m_renderItemLayer[(int)RenderLayer2::Count];
 
 	RenderItem2* m_skullRenderItem = nullptr;
-	RenderItem2* m_reflectedSkullRenderItem = nullptr;
-	RenderItem2* m_shadowedSkullRenderItem = nullptr;
+	PositionQuantization m_skullQuantization;
 	std::vector<std::unique_ptr<RenderItem2>> m_allRenderItems;
 
 	std::vector<std::unique_ptr<FrameResource>> m_frameResources;
@@ -84,7 +174,18 @@ private:
 	int m_currentFrameResourceIndex = 0;
 
 	PassConstants m_mainPassCB;
-	PassConstants m_reflectedPassCB;
+
+	// Pass constants 0 are the main pass, 1 + i the reflected pass of mirror i.
+	// Mirror i marks the stencil buffer with i + 1.
+	static const int m_maxMirrors = 4;
+	std::vector<Mirror> m_mirrors;
+
+	// Pass constants 1 + m_maxMirrors + i hold planar shadow i. The casters are
+	// drawn again with their own object constants.
+	static const int m_maxPlanarShadows = 4;
+	std::vector<XMFLOAT4> m_shadowReceivers;
+	std::vector<PlanarShadow> m_planarShadows;
+	std::vector<RenderItem2*> m_shadowCasters;
 
 	UINT m_cbvSrvDescriptorSize = 0;
 
@@ -92,4 +193,30 @@ private:
 
 	XMFLOAT3 m_skullTranslation = { 0.0f, 1.0f, -5.0f };
 
+	// Set false to run the startup stages one after another.
+	bool m_parallelStartup = true;
+
+	// Largest on-screen error, in pixels, a LOD may have.
+	float m_lodMaxPixelError = 1.0f;
+
+	// Meshlet culling of the main pass. The reflected passes use their mirror's view.
+	MeshletCullView m_mainCullView;
+	std::vector<MeshletDrawRange> m_meshletRanges;
+	MeshletCullStats m_meshletCullStats;
+
+	std::unordered_map<const MeshGeometry*, std::uint32_t> m_geometrySortIds;
+	SubmeshSortIds m_submeshSortIds;
+	std::vector<SortedDraw> m_drawList;
+	std::vector<SortedDraw> m_drawListScratch;
+
+	D3D12CommandBackend m_commandBackend;
+	CommandRecorder m_recorder{ &m_commandBackend };
+	DrawStats m_drawStats;
+
+	// The passes are declared once in BuildFrameGraph, the imported resources are
+	// updated every frame.
+	FrameGraph m_frameGraph;
+	FrameGraphResource m_backBufferResource = InvalidFrameGraphResource;
+	FrameGraphResource m_depthStencilResource = InvalidFrameGraphResource;
+
 };
\ No newline at end of file
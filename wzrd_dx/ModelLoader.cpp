@@ -0,0 +1,413 @@
+#include "ModelLoader.h"
+#include "MappedFile.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+
+using namespace DirectX;
+
+namespace {
+
+// Chunks smaller than this are not worth a task of their own.
+const std::size_t MinChunkBytes = 64 * 1024;
+
+const std::uint64_t IntegerPowersOf10[] = { 1, 10, 100, 1000, 10000, 100000, 1000000, 10000000 };
+
+// Powers of ten that are exact in double precision.
+const double PowersOf10[] = {
+	1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+	1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+// Powers of ten that are exact in single precision.
+const float PowersOf10Float[] = { 1e0f, 1e1f, 1e2f, 1e3f, 1e4f, 1e5f, 1e6f, 1e7f, 1e8f, 1e9f, 1e10f };
+
+inline bool IsSpace(char c) {
+	return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+inline bool IsDigit(char c) {
+	return (unsigned)(c - '0') < 10u;
+}
+
+// The scanners stop at the first character that cannot continue the token,
+// and ParseTextModel only runs them on text that ends with the closing brace
+// of the triangle list. end only limits the eight-byte loads of ScanDigitRun.
+
+inline const char* SkipSpace(const char* p) {
+	while (IsSpace(*p))
+		++p;
+	return p;
+}
+
+// A number must be followed by whitespace or the closing brace of its list.
+inline bool AtTokenEnd(const char* p) {
+	return IsSpace(*p) || *p == '}';
+}
+
+// Length and value of the run of fewer than eight digits at p, with all eight
+// bytes tested and converted at once (SWAR, little-endian). Returns false when
+// fewer than eight bytes are readable or the run is longer; the scalar loops
+// handle those.
+inline bool ScanDigitRun(const char* p, const char* end, std::uint32_t& length, std::uint32_t& value) {
+	if (end - p < 8)
+		return false;
+
+	std::uint64_t digits;
+	memcpy(&digits, p, 8);
+	digits ^= 0x3030303030303030ull;
+
+	// High bit of every byte that is not '0' to '9'.
+	std::uint64_t nonDigits = (((digits & 0x7f7f7f7f7f7f7f7full) + 0x7676767676767676ull) | digits) & 0x8080808080808080ull;
+	if (nonDigits == 0)
+		return false;
+
+	// Bytes before the first non-digit, counted by summing a bit per byte.
+	std::uint64_t lowest = nonDigits & (0 - nonDigits);
+	length = (std::uint32_t)(((((lowest - 1) & 0x0101010101010101ull) * 0x0101010101010101ull) >> 56) - 1);
+	if (length == 0)
+	{
+		value = 0;
+		return true;
+	}
+
+	// Move the run to the end of the eight bytes, behind leading zeros, and
+	// combine pairs of digits, then pairs of pairs, then the two halves.
+	digits <<= 8 * (8 - length);
+	digits = ((digits & 0x0f0f0f0f0f0f0f0full) * 2561) >> 8;
+	digits = ((digits & 0x00ff00ff00ff00ffull) * 6553601) >> 16;
+	value = (std::uint32_t)(((digits & 0x0000ffff0000ffffull) * 42949672960001ull) >> 32);
+	return true;
+}
+
+bool ExpectWord(const char*& p, const char* end, const char* word) {
+	p = SkipSpace(p);
+	std::size_t length = strlen(word);
+	if ((std::size_t)(end - p) < length || memcmp(p, word, length) != 0)
+		return false;
+
+	p += length;
+	return true;
+}
+
+bool ScanUInt(const char*& p, const char* end, std::uint32_t& value) {
+	p = SkipSpace(p);
+	if (!IsDigit(*p))
+		return false;
+
+	std::uint32_t length;
+	if (ScanDigitRun(p, end, length, value))
+	{
+		p += length;
+		return AtTokenEnd(p);
+	}
+
+	std::uint64_t v = 0;
+	for (; IsDigit(*p); ++p)
+	{
+		v = v * 10 + (std::uint64_t)(*p - '0');
+		if (v > 0xffffffff)
+			return false;
+	}
+
+	value = (std::uint32_t)v;
+	return AtTokenEnd(p);
+}
+
+// Decimal number as iostreams write it: optional sign, digits with an optional
+// fraction and an optional exponent. The first 19 significant digits are kept.
+// Short mantissas take Clinger's fast path in single precision; otherwise the
+// double result is correctly rounded for up to 15 digits and powers of ten up
+// to 1e22, which covers everything these files contain.
+bool ScanFloat(const char*& p, const char* end, float& value) {
+	p = SkipSpace(p);
+
+	bool negative = false;
+	if (*p == '-' || *p == '+')
+	{
+		negative = *p == '-';
+		++p;
+	}
+
+	// Leading zeros are skipped so that they do not count as significant digits.
+	const char* digitsBegin = p;
+	while (*p == '0')
+		++p;
+
+	std::uint64_t mantissa = 0;
+	int significantDigits = 0;
+	int exponent = 0;
+
+	for (; IsDigit(*p); ++p, ++significantDigits)
+	{
+		if (significantDigits < 19)
+			mantissa = mantissa * 10 + (std::uint64_t)(*p - '0');
+		else
+			exponent++;
+	}
+
+	bool anyDigits = p != digitsBegin;
+	if (*p == '.')
+	{
+		const char* fractionBegin = ++p;
+		if (mantissa == 0)
+		{
+			while (*p == '0')
+				++p;
+			exponent -= (int)(p - fractionBegin);
+		}
+
+		std::uint32_t length, run;
+		if (significantDigits < 12 && ScanDigitRun(p, end, length, run))
+		{
+			mantissa = mantissa * IntegerPowersOf10[length] + run;
+			significantDigits += (int)length;
+			exponent -= (int)length;
+			p += length;
+		}
+
+		for (; IsDigit(*p); ++p, ++significantDigits)
+		{
+			if (significantDigits < 19)
+			{
+				mantissa = mantissa * 10 + (std::uint64_t)(*p - '0');
+				exponent--;
+			}
+		}
+
+		anyDigits = anyDigits || p != fractionBegin;
+	}
+
+	if (!anyDigits)
+		return false;
+
+	if (*p == 'e' || *p == 'E')
+	{
+		++p;
+		bool negativeExponent = false;
+		if (*p == '-' || *p == '+')
+		{
+			negativeExponent = *p == '-';
+			++p;
+		}
+
+		if (!IsDigit(*p))
+			return false;
+
+		int e = 0;
+		for (; IsDigit(*p); ++p)
+			e = std::min(e * 10 + (*p - '0'), 100000);
+
+		exponent += negativeExponent ? -e : e;
+	}
+
+	// Both the mantissa and the power of ten are exact floats, so one float
+	// operation rounds correctly.
+	if (mantissa < (1u << 24) && exponent >= -10 && exponent <= 10)
+	{
+		float f = (float)mantissa;
+		if (exponent < 0)
+			f /= PowersOf10Float[-exponent];
+		else
+			f *= PowersOf10Float[exponent];
+
+		value = negative ? -f : f;
+		return AtTokenEnd(p);
+	}
+
+	double v = (double)mantissa;
+	if (mantissa != 0 && exponent != 0)
+	{
+		if (exponent >= -22 && exponent < 0)
+			v /= PowersOf10[-exponent];
+		else if (exponent > 0 && exponent <= 22)
+			v *= PowersOf10[exponent];
+		else
+			v *= pow(10.0, (double)exponent);
+	}
+
+	value = (float)(negative ? -v : v);
+	return AtTokenEnd(p);
+}
+
+// Splits [begin, end) into at most chunkCount ranges of whole lines.
+std::vector<const char*> SplitLines(const char* begin, const char* end, std::size_t chunkCount) {
+	std::vector<const char*> bounds(1, begin);
+	std::size_t size = (std::size_t)(end - begin);
+
+	for (std::size_t i = 1; i < chunkCount; ++i)
+	{
+		const char* p = std::max(begin + size * i / chunkCount, bounds.back());
+		const char* newline = (const char*)memchr(p, '\n', (std::size_t)(end - p));
+		if (!newline || newline + 1 >= end)
+			break;
+		if (newline + 1 > bounds.back())
+			bounds.push_back(newline + 1);
+	}
+
+	bounds.push_back(end);
+	return bounds;
+}
+
+// Parses [begin, end) with parse(chunk, chunkBegin, chunkEnd, records), in
+// chunks of whole lines spread over the pool, and stores the records of all
+// chunks in file order.
+template<typename Record, typename Parse>
+bool ParseInChunks(const char* begin, const char* end, ThreadPool* pool, std::vector<Record>& records, std::size_t& chunkCount, Parse&& parse) {
+	std::size_t wantedChunks = 1;
+	if (pool)
+		wantedChunks = std::min<std::size_t>(pool->Concurrency() * 4, std::max<std::size_t>((std::size_t)(end - begin) / MinChunkBytes, 1));
+
+	std::vector<const char*> bounds = SplitLines(begin, end, wantedChunks);
+	chunkCount = bounds.size() - 1;
+
+	if (chunkCount == 1)
+		return parse(0, begin, end, records);
+
+	std::vector<std::vector<Record>> chunks(chunkCount);
+	std::vector<char> parsed(chunkCount, 0);
+	pool->ParallelFor((std::uint32_t)chunkCount, [&](std::uint32_t c) {
+		parsed[c] = parse(c, bounds[c], bounds[c + 1], chunks[c]) ? 1 : 0;
+	});
+
+	std::size_t total = 0;
+	for (std::size_t c = 0; c < chunkCount; ++c)
+	{
+		if (!parsed[c])
+			return false;
+		total += chunks[c].size();
+	}
+
+	records.resize(total);
+	Record* out = records.data();
+	for (const auto& chunk : chunks)
+	{
+		std::copy(chunk.begin(), chunk.end(), out);
+		out += chunk.size();
+	}
+
+	return true;
+}
+
+}
+
+bool ParseTextModel(const char* text, std::size_t size, TextModel& model, ThreadPool* pool) {
+	const char* p = text;
+	const char* end = text + size;
+
+	// The text must end with the closing brace of the triangle list, which
+	// stops every scan.
+	while (end > text && IsSpace(end[-1]))
+		--end;
+	if (end == text || end[-1] != '}')
+		return false;
+
+	std::uint32_t vertexCount = 0;
+	std::uint32_t triangleCount = 0;
+	if (!ExpectWord(p, end, "VertexCount:") || !ScanUInt(p, end, vertexCount))
+		return false;
+	if (!ExpectWord(p, end, "TriangleCount:") || !ScanUInt(p, end, triangleCount))
+		return false;
+
+	// "VertexList (pos, normal)", then the list in braces.
+	if (!ExpectWord(p, end, "VertexList"))
+		return false;
+	const char* vertexBegin = (const char*)memchr(p, '{', (std::size_t)(end - p));
+	if (!vertexBegin)
+		return false;
+	vertexBegin++;
+	const char* vertexEnd = (const char*)memchr(vertexBegin, '}', (std::size_t)(end - vertexBegin));
+	if (!vertexEnd)
+		return false;
+
+	p = vertexEnd + 1;
+	if (!ExpectWord(p, end, "TriangleList") || !ExpectWord(p, end, "{"))
+		return false;
+	const char* triangleBegin = p;
+	const char* triangleEnd = (const char*)memchr(triangleBegin, '}', (std::size_t)(end - triangleBegin));
+	if (!triangleEnd)
+		return false;
+
+	// Bounds are gathered per chunk and merged afterwards.
+	std::size_t maxChunks = pool ? pool->Concurrency() * 4 : 1;
+	std::vector<XMFLOAT3> chunkMin(maxChunks, XMFLOAT3(FLT_MAX, FLT_MAX, FLT_MAX));
+	std::vector<XMFLOAT3> chunkMax(maxChunks, XMFLOAT3(-FLT_MAX, -FLT_MAX, -FLT_MAX));
+	std::size_t vertexChunks = 0;
+
+	bool verticesParsed = ParseInChunks(vertexBegin, vertexEnd, pool, model.Vertices, vertexChunks,
+		[&](std::size_t chunk, const char* q, const char* chunkEnd, std::vector<ModelVertex>& vertices) {
+			XMFLOAT3 minP = chunkMin[chunk];
+			XMFLOAT3 maxP = chunkMax[chunk];
+
+			vertices.clear();
+			vertices.reserve(std::min<std::size_t>((std::size_t)(chunkEnd - q) / 32 + 1, vertexCount));
+			for (q = SkipSpace(q); q < chunkEnd; q = SkipSpace(q))
+			{
+				// A vertex running into the next chunk did not fit on its line.
+				ModelVertex v;
+				if (!ScanFloat(q, end, v.Position.x) || !ScanFloat(q, end, v.Position.y) || !ScanFloat(q, end, v.Position.z) ||
+					!ScanFloat(q, end, v.Normal.x) || !ScanFloat(q, end, v.Normal.y) || !ScanFloat(q, end, v.Normal.z) || q > chunkEnd)
+					return false;
+
+				minP = { std::min(minP.x, v.Position.x), std::min(minP.y, v.Position.y), std::min(minP.z, v.Position.z) };
+				maxP = { std::max(maxP.x, v.Position.x), std::max(maxP.y, v.Position.y), std::max(maxP.z, v.Position.z) };
+				vertices.push_back(v);
+			}
+
+			chunkMin[chunk] = minP;
+			chunkMax[chunk] = maxP;
+			return true;
+		});
+
+	if (!verticesParsed || model.Vertices.size() != vertexCount)
+		return false;
+
+	std::size_t triangleChunks = 0;
+	bool trianglesParsed = ParseInChunks(triangleBegin, triangleEnd, pool, model.Indices, triangleChunks,
+		[&](std::size_t, const char* q, const char* chunkEnd, std::vector<std::uint32_t>& indices) {
+			indices.clear();
+			indices.reserve(std::min<std::size_t>((std::size_t)(chunkEnd - q) / 4 + 1, (std::size_t)triangleCount * 3));
+			for (q = SkipSpace(q); q < chunkEnd; q = SkipSpace(q))
+			{
+				std::uint32_t i0, i1, i2;
+				if (!ScanUInt(q, end, i0) || !ScanUInt(q, end, i1) || !ScanUInt(q, end, i2) || q > chunkEnd)
+					return false;
+				if (i0 >= vertexCount || i1 >= vertexCount || i2 >= vertexCount)
+					return false;
+
+				indices.push_back(i0);
+				indices.push_back(i1);
+				indices.push_back(i2);
+			}
+			return true;
+		});
+
+	if (!trianglesParsed || model.Indices.size() != (std::size_t)triangleCount * 3)
+		return false;
+
+	if (vertexCount == 0)
+	{
+		model.BoundsMin = model.BoundsMax = XMFLOAT3(0.0f, 0.0f, 0.0f);
+		return true;
+	}
+
+	model.BoundsMin = chunkMin[0];
+	model.BoundsMax = chunkMax[0];
+	for (std::size_t c = 1; c < vertexChunks; ++c)
+	{
+		model.BoundsMin = { std::min(model.BoundsMin.x, chunkMin[c].x), std::min(model.BoundsMin.y, chunkMin[c].y), std::min(model.BoundsMin.z, chunkMin[c].z) };
+		model.BoundsMax = { std::max(model.BoundsMax.x, chunkMax[c].x), std::max(model.BoundsMax.y, chunkMax[c].y), std::max(model.BoundsMax.z, chunkMax[c].z) };
+	}
+
+	return true;
+}
+
+bool LoadTextModel(const std::string& path, TextModel& model, ThreadPool* pool) {
+	MappedFile file;
+	if (!file.Open(path))
+		return false;
+
+	return ParseTextModel((const char*)file.Data(), file.Size(), model, pool);
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <DirectXMath.h>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+class ThreadPool;
+
+struct ModelVertex {
+	DirectX::XMFLOAT3 Position;
+	DirectX::XMFLOAT3 Normal;
+};
+
+struct TextModel {
+	std::vector<ModelVertex> Vertices;
+	std::vector<std::uint32_t> Indices;
+	// Bounds of all vertex positions.
+	DirectX::XMFLOAT3 BoundsMin = { 0.0f, 0.0f, 0.0f };
+	DirectX::XMFLOAT3 BoundsMax = { 0.0f, 0.0f, 0.0f };
+};
+
+// Loads a model in the text format of Models/skull.txt and Models/car.txt:
+//
+//	VertexCount: n
+//	TriangleCount: m
+//	VertexList (pos, normal)
+//	{
+//		px py pz nx ny nz		(n lines)
+//	}
+//	TriangleList
+//	{
+//		i0 i1 i2				(m lines)
+//	}
+//
+// The file is memory-mapped and the numbers are scanned in place, independent
+// of the locale. With a pool, the vertex and triangle lists are split into
+// chunks of whole lines that are parsed in parallel. Returns false if the file
+// cannot be read, does not follow the format or indexes a missing vertex.
+bool LoadTextModel(const std::string& path, TextModel& model, ThreadPool* pool = nullptr);
+
+// Same, for a file already in memory.
+bool ParseTextModel(const char* text, std::size_t size, TextModel& model, ThreadPool* pool = nullptr);
@@ -0,0 +1,46 @@
+#include "ParallelCommandRecorder.h"
+#include <chrono>
+
+ParallelCommandRecorder::ParallelCommandRecorder(ThreadPool* pool) :
+	m_pool(pool)
+{
+}
+
+void ParallelCommandRecorder::SetBackends(const std::vector<CommandBackend*>& backends) {
+	m_recorders.clear();
+	for (auto backend : backends)
+		m_recorders.push_back(std::make_unique<CommandRecorder>(backend));
+}
+
+void ParallelCommandRecorder::Record(std::uint32_t count, const RecordRange& record) {
+	auto start = std::chrono::high_resolution_clock::now();
+
+	const std::uint32_t workerCount = WorkerCount();
+	m_pool->ParallelFor(workerCount, [&](std::uint32_t worker) {
+		// Spread the remainder over the first workers so range sizes differ by one at most.
+		std::uint32_t base = count / workerCount;
+		std::uint32_t extra = count % workerCount;
+		std::uint32_t first = worker * base + (worker < extra ? worker : extra);
+		std::uint32_t last = first + base + (worker < extra ? 1 : 0);
+
+		CommandRecorder& recorder = *m_recorders[worker];
+		recorder.Invalidate();
+		recorder.ResetStats();
+		record(worker, recorder, first, last);
+	});
+
+	auto end = std::chrono::high_resolution_clock::now();
+	m_lastRecordMilliseconds = std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+DrawStats ParallelCommandRecorder::Stats() const {
+	DrawStats total;
+	for (const auto& recorder : m_recorders)
+	{
+		const DrawStats& s = recorder->Stats();
+		total.DrawCalls += s.DrawCalls;
+		total.StateChangesIssued += s.StateChangesIssued;
+		total.StateChangesAvoided += s.StateChangesAvoided;
+	}
+	return total;
+}
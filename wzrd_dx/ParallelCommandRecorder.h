@@ -0,0 +1,35 @@
+#pragma once
+
+#include "CommandRecorder.h"
+#include "ThreadPool.h"
+#include <functional>
+#include <memory>
+
+// Records one range of draws per worker, each on its own backend. Ranges are
+// contiguous and in backend order, so submitting the lists in that order gives
+// the same result as recording everything on a single list.
+class ParallelCommandRecorder {
+public:
+	// Records [first, last) on the given worker's recorder. The recorder has been
+	// invalidated; the callback is responsible for binding the initial state.
+	using RecordRange = std::function<void(std::uint32_t worker, CommandRecorder& recorder, std::uint32_t first, std::uint32_t last)>;
+
+	explicit ParallelCommandRecorder(ThreadPool* pool = &ThreadPool::Default());
+
+	// One backend per worker. Backends must outlive the recorder.
+	void SetBackends(const std::vector<CommandBackend*>& backends);
+	std::uint32_t WorkerCount() const { return (std::uint32_t)m_recorders.size(); }
+	CommandRecorder& Recorder(std::uint32_t worker) { return *m_recorders[worker]; }
+
+	void Record(std::uint32_t count, const RecordRange& record);
+
+	// Sum of the per-worker counters for the last Record call.
+	DrawStats Stats() const;
+	// Wall time of the last Record call, for comparing worker counts.
+	double LastRecordMilliseconds() const { return m_lastRecordMilliseconds; }
+
+private:
+	ThreadPool* m_pool = nullptr;
+	std::vector<std::unique_ptr<CommandRecorder>> m_recorders;
+	double m_lastRecordMilliseconds = 0.0;
+};
@@ -0,0 +1,145 @@
+#include "ParallelStartup.h"
+#include "AsyncFileReader.h"
+#include "DDSTextureLoader.h"
+#include "MappedFile.h"
+
+CommandListSet::CommandListSet(ID3D12Device* device) :
+	m_device(device)
+{
+}
+
+ID3D12GraphicsCommandList* CommandListSet::Open() {
+	ComPtr<ID3D12CommandAllocator> allocator;
+	ComPtr<ID3D12GraphicsCommandList> list;
+	ThrowIfFailed(m_device->CreateCommandAllocator(D3D12_COMMAND_LIST_TYPE_DIRECT, IID_PPV_ARGS(allocator.GetAddressOf())));
+	ThrowIfFailed(m_device->CreateCommandList(0, D3D12_COMMAND_LIST_TYPE_DIRECT, allocator.Get(), nullptr, IID_PPV_ARGS(list.GetAddressOf())));
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_allocators.push_back(allocator);
+	m_lists.push_back(list);
+	return list.Get();
+}
+
+void CommandListSet::Close(std::vector<ID3D12CommandList*>& lists) {
+	std::lock_guard<std::mutex> lock(m_mutex);
+	for (auto& list : m_lists)
+	{
+		ThrowIfFailed(list->Close());
+		lists.push_back(list.Get());
+	}
+}
+
+void CompileShaders(const std::vector<ShaderSource>& sources, std::unordered_map<std::string, ComPtr<ID3DBlob>>& shaders,
+	ThreadPool* pool)
+{
+	std::vector<ComPtr<ID3DBlob>> byteCode(sources.size());
+	ParallelFor(pool, (std::uint32_t)sources.size(), [&](std::uint32_t i) {
+		const ShaderSource& source = sources[i];
+		byteCode[i] = CompileShader(source.Filename, source.Defines, source.EntryPoint, source.Target);
+	});
+
+	for (std::size_t i = 0; i < sources.size(); ++i)
+		shaders[sources[i].Name] = byteCode[i];
+}
+
+void CreatePipelineStates(ID3D12Device* device, const std::vector<PipelineSource>& sources,
+	std::unordered_map<std::string, ComPtr<ID3D12PipelineState>>& pipelineStates, ThreadPool* pool)
+{
+	std::vector<ComPtr<ID3D12PipelineState>> created(sources.size());
+	ParallelFor(pool, (std::uint32_t)sources.size(), [&](std::uint32_t i) {
+		ThrowIfFailed(device->CreateGraphicsPipelineState(&sources[i].Desc, IID_PPV_ARGS(created[i].GetAddressOf())));
+	});
+
+	for (std::size_t i = 0; i < sources.size(); ++i)
+		pipelineStates[sources[i].Name] = created[i];
+}
+
+namespace {
+
+std::unique_ptr<Texture> NewTexture(const TextureSource& source) {
+	auto texture = std::make_unique<Texture>();
+	texture->Name = source.Name;
+	texture->Filename = source.Filename;
+	return texture;
+}
+
+void ReadTextures(ID3D12Device* device, const std::vector<TextureSource>& sources,
+	std::vector<std::unique_ptr<Texture>>& loaded, CommandListSet& lists, ThreadPool* pool)
+{
+	// All files are read in one batch, so the drive sees every read at once
+	// instead of one blocking read per worker.
+	AsyncFileReader reader(AsyncFileReader::Backend::CompletionPort, pool);
+	std::vector<AlignedBuffer> data(sources.size());
+	std::vector<std::size_t> sizes(sources.size());
+	std::vector<AsyncFileReader::ReadResult> results(sources.size());
+
+	for (std::size_t i = 0; i < sources.size(); ++i)
+	{
+		AsyncFileReader::FileId file = reader.Open(sources[i].Filename, true);
+		if (file == AsyncFileReader::InvalidFile)
+			ThrowIfFailed(HRESULT_FROM_WIN32(ERROR_OPEN_FAILED));
+
+		// Unbuffered reads cover whole sectors; the last one comes back short.
+		const std::uint64_t sectorSize = reader.SectorSize(file);
+		const std::uint64_t readSize = (reader.FileSize(file) + sectorSize - 1) / sectorSize * sectorSize;
+		if (readSize > 0xffffffffull)
+			ThrowIfFailed(HRESULT_FROM_WIN32(ERROR_FILE_TOO_LARGE));
+
+		data[i] = AlignedBuffer((std::size_t)readSize, (std::size_t)sectorSize);
+		sizes[i] = (std::size_t)reader.FileSize(file);
+
+		AsyncFileReader::ReadRequest request;
+		request.File = file;
+		request.Size = (std::uint32_t)readSize;
+		request.Buffer = data[i].Data();
+		request.OnComplete = [&results, i](const AsyncFileReader::ReadResult& result) { results[i] = result; };
+		reader.Queue(std::move(request));
+	}
+
+	reader.Submit();
+	reader.WaitAll();
+
+	ParallelFor(pool, (std::uint32_t)sources.size(), [&](std::uint32_t i) {
+		const AsyncFileReader::ReadResult& result = results[i];
+		if (result.Status == AsyncFileReader::ReadStatus::Failed)
+			ThrowIfFailed(HRESULT_FROM_WIN32(result.Error));
+		if (result.Status != AsyncFileReader::ReadStatus::Done || result.BytesRead < sizes[i])
+			ThrowIfFailed(HRESULT_FROM_WIN32(ERROR_READ_FAULT));
+
+		auto texture = NewTexture(sources[i]);
+		ThrowIfFailed(DirectX::CreateDDSTextureFromMemory12(device, lists.Open(), data[i].Data(), sizes[i],
+			texture->Resource, texture->UploadHeap));
+		loaded[i] = std::move(texture);
+	});
+}
+
+void MapTextures(ID3D12Device* device, const std::vector<TextureSource>& sources,
+	std::vector<std::unique_ptr<Texture>>& loaded, CommandListSet& lists, ThreadPool* pool)
+{
+	ParallelFor(pool, (std::uint32_t)sources.size(), [&](std::uint32_t i) {
+		MappedFile file;
+		if (!file.Open(sources[i].Filename))
+			ThrowIfFailed(HRESULT_FROM_WIN32(ERROR_OPEN_FAILED));
+
+		auto texture = NewTexture(sources[i]);
+		ThrowIfFailed(DirectX::CreateDDSTextureFromMemory12(device, lists.Open(), file.Data(), file.Size(),
+			texture->Resource, texture->UploadHeap));
+		loaded[i] = std::move(texture);
+	});
+}
+
+}
+
+void LoadTextures(ID3D12Device* device, const std::vector<TextureSource>& sources,
+	std::unordered_map<std::string, std::unique_ptr<Texture>>& textures, CommandListSet& lists, ThreadPool* pool,
+	TextureFileAccess access)
+{
+	std::vector<std::unique_ptr<Texture>> loaded(sources.size());
+	if (access == TextureFileAccess::Read)
+		ReadTextures(device, sources, loaded, lists, pool);
+	else
+		MapTextures(device, sources, loaded, lists, pool);
+
+	for (auto& texture : loaded)
+		textures[texture->Name] = std::move(texture);
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include "Utilities.h"
+#include "Texture.h"
+#include "ThreadPool.h"
+#include <mutex>
+
+// Command lists for startup work recorded on several threads at once. Each list
+// has its own allocator and belongs to the thread that opened it until Close.
+// The set must outlive the GPU's execution of the lists.
+class CommandListSet {
+public:
+	explicit CommandListSet(ID3D12Device* device);
+
+	// Returns a new list, open for recording. Safe to call from any thread.
+	ID3D12GraphicsCommandList* Open();
+
+	// Closes the lists and appends them to lists in the order they were opened,
+	// ready for one ExecuteCommandLists call.
+	void Close(std::vector<ID3D12CommandList*>& lists);
+
+private:
+	ID3D12Device* m_device;
+	std::mutex m_mutex;
+	std::vector<ComPtr<ID3D12CommandAllocator>> m_allocators;
+	std::vector<ComPtr<ID3D12GraphicsCommandList>> m_lists;
+};
+
+// The batches below run their items in parallel on pool, or one after another
+// when it is null, and fill the app's maps on the calling thread afterwards.
+
+struct ShaderSource {
+	std::string Name;
+	const wchar_t* Filename;
+	const D3D_SHADER_MACRO* Defines;
+	const char* EntryPoint;
+	const char* Target;
+};
+
+void CompileShaders(const std::vector<ShaderSource>& sources, std::unordered_map<std::string, ComPtr<ID3DBlob>>& shaders,
+	ThreadPool* pool);
+
+struct PipelineSource {
+	std::string Name;
+	D3D12_GRAPHICS_PIPELINE_STATE_DESC Desc;
+};
+
+// Driver compilation is most of the cost of a pipeline state, and the device
+// takes concurrent calls.
+void CreatePipelineStates(ID3D12Device* device, const std::vector<PipelineSource>& sources,
+	std::unordered_map<std::string, ComPtr<ID3D12PipelineState>>& pipelineStates, ThreadPool* pool);
+
+struct TextureSource {
+	std::string Name;
+	std::wstring Filename;
+};
+
+// How LoadTextures gets at the bytes of the DDS files. Map is the default:
+// Tests/DDSLoadBenchmark loads Textures/*.dds faster and with a smaller peak
+// resident set that way.
+enum class TextureFileAccess {
+	// One batch of unbuffered reads through an AsyncFileReader, then the uploads.
+	Read,
+	// Each upload copies the pixels straight out of a mapping of its file.
+	Map,
+};
+
+// Loads the DDS files and records their uploads in parallel, each on its own list
+// from lists.
+void LoadTextures(ID3D12Device* device, const std::vector<TextureSource>& sources,
+	std::unordered_map<std::string, std::unique_ptr<Texture>>& textures, CommandListSet& lists, ThreadPool* pool,
+	TextureFileAccess access = TextureFileAccess::Map);
@@ -0,0 +1,197 @@
+#pragma once
+
+#include <DirectXMath.h>
+#include <cstddef>
+#include <cstdint>
+
+// Vertex and index arrays of primitives whose parameters are known at compile
+// time. The tables are filled in by constexpr functions, so the compiler builds
+// them into the executable's read-only data and they are uploaded from there:
+//
+//	static constexpr auto box = MakeBoxTable<Vertex2, 8>(8.0f, 8.0f, 8.0f);
+//
+// Vertex types are built as Vertex{ position, normal, texC } or, for the colour
+// cube, Vertex{ position, color }, which fits the apps' vertex structs.
+
+template<typename T, std::size_t N>
+struct PrimitiveArray {
+	T Elements[N] = {};
+
+	constexpr T& operator[](std::size_t i) { return Elements[i]; }
+	constexpr const T& operator[](std::size_t i) const { return Elements[i]; }
+	constexpr std::size_t size() const { return N; }
+	constexpr const T* data() const { return Elements; }
+};
+
+template<typename Vertex, std::size_t VertexCount, std::size_t IndexCount>
+struct PrimitiveTable {
+	PrimitiveArray<Vertex, VertexCount> Vertices;
+	PrimitiveArray<std::uint16_t, IndexCount> Indices;
+
+	constexpr std::uint32_t VertexBufferByteSize() const { return (std::uint32_t)(VertexCount * sizeof(Vertex)); }
+	constexpr std::uint32_t IndexBufferByteSize() const { return (std::uint32_t)(IndexCount * sizeof(std::uint16_t)); }
+};
+
+// Corner of a face of the box spanning [-1, 1] on every axis.
+struct BoxCorner {
+	float X, Y, Z;
+	float NormalX, NormalY, NormalZ;
+	float TangentX, TangentY, TangentZ;
+	float U, V;
+};
+
+// Four corners per face (front, back, top, bottom, left, right), in the order of
+// the face's two triangles (c0, c1, c2) and (c0, c2, c3).
+constexpr BoxCorner UnitBoxCorners[24] = {
+	{ -1.0f, -1.0f, -1.0f, 0.0f, 0.0f, -1.0f, 1.0f, 0.0f, 0.0f, 0.0f, 1.0f },
+	{ -1.0f, +1.0f, -1.0f, 0.0f, 0.0f, -1.0f, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f },
+	{ +1.0f, +1.0f, -1.0f, 0.0f, 0.0f, -1.0f, 1.0f, 0.0f, 0.0f, 1.0f, 0.0f },
+	{ +1.0f, -1.0f, -1.0f, 0.0f, 0.0f, -1.0f, 1.0f, 0.0f, 0.0f, 1.0f, 1.0f },
+
+	{ -1.0f, -1.0f, +1.0f, 0.0f, 0.0f, 1.0f, -1.0f, 0.0f, 0.0f, 1.0f, 1.0f },
+	{ +1.0f, -1.0f, +1.0f, 0.0f, 0.0f, 1.0f, -1.0f, 0.0f, 0.0f, 0.0f, 1.0f },
+	{ +1.0f, +1.0f, +1.0f, 0.0f, 0.0f, 1.0f, -1.0f, 0.0f, 0.0f, 0.0f, 0.0f },
+	{ -1.0f, +1.0f, +1.0f, 0.0f, 0.0f, 1.0f, -1.0f, 0.0f, 0.0f, 1.0f, 0.0f },
+
+	{ -1.0f, +1.0f, -1.0f, 0.0f, 1.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 1.0f },
+	{ -1.0f, +1.0f, +1.0f, 0.0f, 1.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f },
+	{ +1.0f, +1.0f, +1.0f, 0.0f, 1.0f, 0.0f, 1.0f, 0.0f, 0.0f, 1.0f, 0.0f },
+	{ +1.0f, +1.0f, -1.0f, 0.0f, 1.0f, 0.0f, 1.0f, 0.0f, 0.0f, 1.0f, 1.0f },
+
+	{ -1.0f, -1.0f, -1.0f, 0.0f, -1.0f, 0.0f, -1.0f, 0.0f, 0.0f, 1.0f, 1.0f },
+	{ +1.0f, -1.0f, -1.0f, 0.0f, -1.0f, 0.0f, -1.0f, 0.0f, 0.0f, 0.0f, 1.0f },
+	{ +1.0f, -1.0f, +1.0f, 0.0f, -1.0f, 0.0f, -1.0f, 0.0f, 0.0f, 0.0f, 0.0f },
+	{ -1.0f, -1.0f, +1.0f, 0.0f, -1.0f, 0.0f, -1.0f, 0.0f, 0.0f, 1.0f, 0.0f },
+
+	{ -1.0f, -1.0f, +1.0f, -1.0f, 0.0f, 0.0f, 0.0f, 0.0f, -1.0f, 0.0f, 1.0f },
+	{ -1.0f, +1.0f, +1.0f, -1.0f, 0.0f, 0.0f, 0.0f, 0.0f, -1.0f, 0.0f, 0.0f },
+	{ -1.0f, +1.0f, -1.0f, -1.0f, 0.0f, 0.0f, 0.0f, 0.0f, -1.0f, 1.0f, 0.0f },
+	{ -1.0f, -1.0f, -1.0f, -1.0f, 0.0f, 0.0f, 0.0f, 0.0f, -1.0f, 1.0f, 1.0f },
+
+	{ +1.0f, -1.0f, -1.0f, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 1.0f },
+	{ +1.0f, +1.0f, -1.0f, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f },
+	{ +1.0f, +1.0f, +1.0f, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 1.0f, 0.0f },
+	{ +1.0f, -1.0f, +1.0f, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 1.0f, 1.0f },
+};
+
+// Cells per strip of a box face. Two rows of a strip fit in a 16-entry
+// post-transform cache.
+constexpr std::uint32_t BoxTableStripWidth = 4;
+
+constexpr std::size_t BoxTableVertexCount(std::uint32_t segments) { return (std::size_t)6 * (segments + 1) * (segments + 1); }
+constexpr std::size_t BoxTableIndexCount(std::uint32_t segments) { return (std::size_t)36 * segments * segments; }
+
+// Box centred on the origin with every face split into Segments x Segments
+// cells. The vertices are those of GeometryGenerator::CreateBox with
+// 2^numSubdivisions = Segments; the triangles of each face are ordered in
+// strips of BoxTableStripWidth cells for the vertex cache.
+template<typename Vertex, std::uint32_t Segments>
+constexpr PrimitiveTable<Vertex, BoxTableVertexCount(Segments), BoxTableIndexCount(Segments)> MakeBoxTable(float width, float height, float depth) {
+	static_assert(Segments > 0 && BoxTableVertexCount(Segments) <= 0x10000, "box table needs 16-bit indices");
+
+	PrimitiveTable<Vertex, BoxTableVertexCount(Segments), BoxTableIndexCount(Segments)> table;
+	float w2 = 0.5f * width;
+	float h2 = 0.5f * height;
+	float d2 = 0.5f * depth;
+	std::uint32_t rowVertexCount = Segments + 1;
+	float step = 1.0f / Segments;
+	std::size_t index = 0;
+
+	for (std::uint32_t f = 0; f < 6; ++f)
+	{
+		const BoxCorner& c0 = UnitBoxCorners[f * 4 + 0];
+		const BoxCorner& c1 = UnitBoxCorners[f * 4 + 1];
+		const BoxCorner& c3 = UnitBoxCorners[f * 4 + 3];
+		std::uint32_t baseIndex = f * rowVertexCount * rowVertexCount;
+
+		for (std::uint32_t a = 0; a <= Segments; ++a)
+		{
+			for (std::uint32_t b = 0; b <= Segments; ++b)
+			{
+				float s = a * step;
+				float t = b * step;
+
+				table.Vertices[baseIndex + a * rowVertexCount + b] = Vertex{
+					DirectX::XMFLOAT3(
+						c0.X * w2 + s * (c1.X * w2 - c0.X * w2) + t * (c3.X * w2 - c0.X * w2),
+						c0.Y * h2 + s * (c1.Y * h2 - c0.Y * h2) + t * (c3.Y * h2 - c0.Y * h2),
+						c0.Z * d2 + s * (c1.Z * d2 - c0.Z * d2) + t * (c3.Z * d2 - c0.Z * d2)),
+					DirectX::XMFLOAT3(c0.NormalX, c0.NormalY, c0.NormalZ),
+					DirectX::XMFLOAT2(c0.U + s * (c1.U - c0.U) + t * (c3.U - c0.U), c0.V + s * (c1.V - c0.V) + t * (c3.V - c0.V))
+				};
+			}
+		}
+
+		// Same winding as GeometryGenerator::WriteBox.
+		for (std::uint32_t firstColumn = 0; firstColumn < Segments; firstColumn += BoxTableStripWidth)
+		{
+			std::uint32_t lastColumn = firstColumn + BoxTableStripWidth < Segments ? firstColumn + BoxTableStripWidth : Segments;
+			for (std::uint32_t a = 0; a < Segments; ++a)
+			{
+				for (std::uint32_t b = firstColumn; b < lastColumn; ++b)
+				{
+					std::uint32_t i00 = baseIndex + a * rowVertexCount + b;
+					std::uint32_t i10 = i00 + rowVertexCount;
+
+					table.Indices[index++] = (std::uint16_t)i00;
+					table.Indices[index++] = (std::uint16_t)i10;
+					table.Indices[index++] = (std::uint16_t)(i10 + 1);
+
+					table.Indices[index++] = (std::uint16_t)i00;
+					table.Indices[index++] = (std::uint16_t)(i10 + 1);
+					table.Indices[index++] = (std::uint16_t)(i00 + 1);
+				}
+			}
+		}
+	}
+
+	return table;
+}
+
+// Cube spanning [-1, 1] with a colour per corner, as drawn by BoxApp and
+// WZRDRenderer. The colours are those of DirectX::Colors.
+template<typename Vertex>
+constexpr PrimitiveTable<Vertex, 8, 36> MakeColorCubeTable() {
+	PrimitiveTable<Vertex, 8, 36> table;
+
+	table.Vertices[0] = Vertex{ DirectX::XMFLOAT3(-1.0f, -1.0f, -1.0f), DirectX::XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f) };			// White
+	table.Vertices[1] = Vertex{ DirectX::XMFLOAT3(-1.0f, +1.0f, -1.0f), DirectX::XMFLOAT4(0.0f, 0.0f, 0.0f, 1.0f) };			// Black
+	table.Vertices[2] = Vertex{ DirectX::XMFLOAT3(+1.0f, +1.0f, -1.0f), DirectX::XMFLOAT4(1.0f, 0.0f, 0.0f, 1.0f) };			// Red
+	table.Vertices[3] = Vertex{ DirectX::XMFLOAT3(+1.0f, -1.0f, -1.0f), DirectX::XMFLOAT4(0.0f, 0.501960814f, 0.0f, 1.0f) };	// Green
+	table.Vertices[4] = Vertex{ DirectX::XMFLOAT3(-1.0f, -1.0f, +1.0f), DirectX::XMFLOAT4(0.0f, 0.0f, 1.0f, 1.0f) };			// Blue
+	table.Vertices[5] = Vertex{ DirectX::XMFLOAT3(-1.0f, +1.0f, +1.0f), DirectX::XMFLOAT4(1.0f, 1.0f, 0.0f, 1.0f) };			// Yellow
+	table.Vertices[6] = Vertex{ DirectX::XMFLOAT3(+1.0f, +1.0f, +1.0f), DirectX::XMFLOAT4(0.0f, 1.0f, 1.0f, 1.0f) };			// Cyan
+	table.Vertices[7] = Vertex{ DirectX::XMFLOAT3(+1.0f, -1.0f, +1.0f), DirectX::XMFLOAT4(1.0f, 0.0f, 1.0f, 1.0f) };			// Magenta
+
+	const std::uint16_t indices[36] =
+	{
+		// front face
+		0, 1, 2,
+		0, 2, 3,
+
+		// back face
+		4, 6, 5,
+		4, 7, 6,
+
+		// left face
+		4, 5, 1,
+		4, 1, 0,
+
+		// right face
+		3, 2, 6,
+		3, 6, 7,
+
+		// top face
+		1, 5, 6,
+		1, 6, 2,
+
+		// bottom face
+		4, 0, 3,
+		4, 3, 7
+	};
+
+	for (std::size_t i = 0; i < 36; ++i)
+		table.Indices[i] = indices[i];
+
+	return table;
+}
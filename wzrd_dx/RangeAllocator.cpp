@@ -0,0 +1,69 @@
+#include "RangeAllocator.h"
+#include <algorithm>
+#include <cassert>
+#include <iterator>
+
+RangeAllocator::RangeAllocator(std::uint32_t capacity) : m_capacity(capacity), m_freeSize(capacity) {
+	if (capacity > 0)
+		m_freeRanges[0] = capacity;
+}
+
+std::uint32_t RangeAllocator::Allocate(std::uint32_t size) {
+	if (size == 0)
+		return 0;
+
+	for (auto range = m_freeRanges.begin(); range != m_freeRanges.end(); ++range)
+	{
+		if (range->second < size)
+			continue;
+
+		std::uint32_t offset = range->first;
+		std::uint32_t remaining = range->second - size;
+		m_freeRanges.erase(range);
+		if (remaining > 0)
+			m_freeRanges[offset + size] = remaining;
+
+		m_freeSize -= size;
+		return offset;
+	}
+	return InvalidOffset;
+}
+
+void RangeAllocator::Free(std::uint32_t offset, std::uint32_t size) {
+	if (size == 0)
+		return;
+	assert(offset + size <= m_capacity);
+	m_freeSize += size;
+
+	auto next = m_freeRanges.lower_bound(offset);
+	assert(next == m_freeRanges.end() || offset + size <= next->first);
+
+	// Merge with the free range that ends where this one starts...
+	if (next != m_freeRanges.begin())
+	{
+		auto previous = std::prev(next);
+		assert(previous->first + previous->second <= offset);
+		if (previous->first + previous->second == offset)
+		{
+			offset = previous->first;
+			size += previous->second;
+			m_freeRanges.erase(previous);
+		}
+	}
+
+	// ...and with the one that starts where it ends.
+	if (next != m_freeRanges.end() && offset + size == next->first)
+	{
+		size += next->second;
+		m_freeRanges.erase(next);
+	}
+
+	m_freeRanges[offset] = size;
+}
+
+std::uint32_t RangeAllocator::LargestFreeRange() const {
+	std::uint32_t largest = 0;
+	for (const auto& range : m_freeRanges)
+		largest = std::max(largest, range.second);
+	return largest;
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+
+// Hands out ranges of [0, capacity), in whatever unit the caller counts in.
+// Free ranges are kept sorted by offset; allocation takes the first one that
+// fits and freeing merges a range with its free neighbours, so the arena does
+// not crumble into pieces too small to use.
+class RangeAllocator {
+public:
+	static const std::uint32_t InvalidOffset = 0xffffffff;
+
+	explicit RangeAllocator(std::uint32_t capacity = 0);
+
+	// Returns InvalidOffset if no free range is large enough. Zero-sized
+	// requests get offset 0 and need not be freed.
+	std::uint32_t Allocate(std::uint32_t size);
+	// offset and size must be those of an earlier Allocate.
+	void Free(std::uint32_t offset, std::uint32_t size);
+
+	std::uint32_t Capacity() const { return m_capacity; }
+	std::uint32_t FreeSize() const { return m_freeSize; }
+	std::uint32_t LargestFreeRange() const;
+
+private:
+	// Offset to size.
+	std::map<std::uint32_t, std::uint32_t> m_freeRanges;
+	std::uint32_t m_capacity = 0;
+	std::uint32_t m_freeSize = 0;
+};
@@ -30,11 +30,20 @@ SamplerState gsamLinearClamp      : register(s3);
 SamplerState gsamAnisotropicWrap  : register(s4);
 SamplerState gsamAnisotropicClamp : register(s5);
 
-// Constant data that varies per frame.
-cbuffer cbPerObject : register(b0)
+// Per-instance data for the batched draws.
+struct InstanceData
 {
-    float4x4 gWorld;
-	float4x4 gTexTransform;
+    float4x4 World;
+	float4x4 TexTransform;
+};
+
+StructuredBuffer<InstanceData> gInstanceData : register(t0, space1);
+
+// SV_InstanceID does not include the start instance of the draw, so the
+// offset of the batch in gInstanceData is passed as a root constant.
+cbuffer cbInstance : register(b3)
+{
+    uint gBaseInstance;
 };
 
 // Constant data that varies per material.
@@ -91,22 +100,26 @@ struct VertexOut
 	float2 TexC    : TEXCOORD;
 };
 
-VertexOut VS(VertexIn vin)
+VertexOut VS(VertexIn vin, uint instanceID : SV_InstanceID)
 {
 	VertexOut vout = (VertexOut)0.0f;
+
+	InstanceData instData = gInstanceData[gBaseInstance + instanceID];
+	float4x4 world = instData.World;
+	float4x4 texTransform = instData.TexTransform;
 	
     // Transform to world space.
-    float4 posW = mul(float4(vin.PosL, 1.0f), gWorld);
+    float4 posW = mul(float4(vin.PosL, 1.0f), world);
     vout.PosW = posW.xyz;
 
     // Assumes nonuniform scaling; otherwise, need to use inverse-transpose of world matrix.
-    vout.NormalW = mul(vin.NormalL, (float3x3)gWorld);
+    vout.NormalW = mul(vin.NormalL, (float3x3)world);
 
     // Transform to homogeneous clip space.
     vout.PosH = mul(posW, gViewProj);
 	
 	// Output vertex attributes for interpolation across triangle.
-	float4 texC = mul(float4(vin.TexC, 0.0f, 1.0f), gTexTransform);
+	float4 texC = mul(float4(vin.TexC, 0.0f, 1.0f), texTransform);
 	vout.TexC = mul(texC, gMatTransform).xy;
 
     return vout;
@@ -35,6 +35,9 @@ cbuffer cbPerObject : register(b0)
 {
     float4x4 gWorld;
 	float4x4 gTexTransform;
+    // Quantized vertices only: position = gPosOffset + gPosScale * stored position.
+    float4 gPosScale;
+    float4 gPosOffset;
 };
 
 // Constant data that varies per material.
@@ -66,6 +69,9 @@ cbuffer cbPass : register(b1)
     // indices [NUM_DIR_LIGHTS+NUM_POINT_LIGHTS, NUM_DIR_LIGHTS+NUM_POINT_LIGHT+NUM_SPOT_LIGHTS)
     // are spot lights for a maximum of MaxLights per object.
     Light gLights[MaxLights];
+
+    // Planar shadow passes only.
+    float4x4 gShadowTransform;
 };
 
 cbuffer cbMaterial : register(b2)
@@ -76,12 +82,23 @@ cbuffer cbMaterial : register(b2)
 	float4x4 gMatTransform;
 };
 
+#ifdef QUANTIZED
+// QuantizedVertex: R16G16B16A16_UNORM position in the mesh bounds, R16G16_SNORM
+// octahedral normal and R16G16_FLOAT texture coordinates.
+struct VertexIn
+{
+	float4 PosL    : POSITION;
+    float2 NormalL : NORMAL;
+	float2 TexC    : TEXCOORD;
+};
+#else
 struct VertexIn
 {
 	float3 PosL    : POSITION;
     float3 NormalL : NORMAL;
 	float2 TexC    : TEXCOORD;
 };
+#endif
 
 struct VertexOut
 {
@@ -91,16 +108,37 @@ struct VertexOut
 	float2 TexC    : TEXCOORD;
 };
 
+// Unfolds an octahedral normal, see OctDecode in VertexQuantization.cpp.
+float3 OctDecode(float2 e)
+{
+    float3 n = float3(e, 1.0f - abs(e.x) - abs(e.y));
+    float t = saturate(-n.z);
+    n.xy += n.xy >= 0.0f ? -t : t;
+    return normalize(n);
+}
+
 VertexOut VS(VertexIn vin)
 {
 	VertexOut vout = (VertexOut)0.0f;
+
+#ifdef QUANTIZED
+    float3 posL = gPosOffset.xyz + gPosScale.xyz * vin.PosL.xyz;
+    float3 normalL = OctDecode(vin.NormalL);
+#else
+    float3 posL = vin.PosL;
+    float3 normalL = vin.NormalL;
+#endif
 	
     // Transform to world space.
-    float4 posW = mul(float4(vin.PosL, 1.0f), gWorld);
+    float4 posW = mul(float4(posL, 1.0f), gWorld);
+#ifdef PLANAR_SHADOW
+    // Flatten onto the receiver plane of this pass.
+    posW = mul(posW, gShadowTransform);
+#endif
     vout.PosW = posW.xyz;
 
     // Assumes nonuniform scaling; otherwise, need to use inverse-transpose of world matrix.
-    vout.NormalW = mul(vin.NormalL, (float3x3)gWorld);
+    vout.NormalW = mul(normalL, (float3x3)gWorld);
 
     // Transform to homogeneous clip space.
     vout.PosH = mul(posW, gViewProj);
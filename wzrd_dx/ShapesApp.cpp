@@ -1,36 +1,59 @@
 #include "ShapesApp.h"
 #include "GeometryGenerator.h"
+#include "IndexBufferBuilder.h"
+#include "MeshOptimizer.h"
+#include "PrimitiveTables.h"
+#include "TaskGraph.h"
+#include "TerrainGenerator.h"
 
 bool ShapesApp::init() {
 	ThrowIfFailed(m_graphicsCommandList->Reset(m_commandAllocator.Get(), nullptr));
 
 	m_cbvSrvDescriptorSize = m_device->GetDescriptorHandleIncrementSize(D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
+	m_geometryPool = std::make_unique<GeometryPool>(m_device.Get());
+	m_textureStreamer = std::make_unique<TextureStreamer>(m_device.Get(), m_commandQueue.Get(), &ThreadPool::Default(),
+		m_textureBudgetBytes);
 
 	m_camera.SetPosition(0.0f, 2.0f, -15.0f);
 
 	m_waves = std::make_unique<Waves>(128, 128, 1.0f, 0.03f, 4.0f, 0.2f);
 
-	LoadTextures();
-	BuildRootSignature();
-	BuildDescriptorHeaps();
-	BuildShadersAndInputLayout();
-	BuildLandGeometry();
-	BuildWavesGeometryBuffers();
-	BuildBoxGeometry();
-	BuildTreeSpritesGeometry();
-	BuildTestSpriteGeometry();
-	BuildMaterials();
-	BuildRenderItems();
-	BuildFrameResources();
-	BuildPSOs();
+	// Independent stages run at the same time. Stages that record uploads take
+	// their own command lists, and every stage fills maps no other running stage
+	// touches.
+	ThreadPool* pool = m_parallelStartup ? &ThreadPool::Default() : nullptr;
+	CommandListSet uploadLists(m_device.Get());
+
+	TaskGraph startup;
+	auto textures = startup.Add("textures", [&] { LoadTextures(uploadLists, pool); });
+	startup.Add("descriptor heaps", [this] { BuildDescriptorHeaps(); }, { textures });
+	auto rootSignature = startup.Add("root signature", [this] { BuildRootSignature(); });
+	auto shaders = startup.Add("shaders", [&] { BuildShadersAndInputLayout(pool); });
+	startup.Add("pipeline states", [&] { BuildPSOs(pool); }, { rootSignature, shaders });
+	auto geometry = startup.Add("geometry", [&] {
+		ID3D12GraphicsCommandList* cmdList = uploadLists.Open();
+		BuildLandGeometry(cmdList);
+		BuildWavesGeometryBuffers(cmdList);
+		BuildBoxGeometry(cmdList);
+		BuildTreeSpritesGeometry(cmdList);
+		BuildTestSpriteGeometry(cmdList);
+	});
+	auto materials = startup.Add("materials", [this] { BuildMaterials(); });
+	auto renderItems = startup.Add("render items", [this] { BuildRenderItems(); }, { geometry, materials });
+	startup.Add("frame resources", [this] { BuildFrameResources(); }, { renderItems });
+	startup.Run(pool);
+	BindStreamedTextures();
 
 	// Execute the initialization commands.
 	ThrowIfFailed(m_graphicsCommandList->Close());
-	ID3D12CommandList* cmdsLists[] = { m_graphicsCommandList.Get() };
-	m_commandQueue->ExecuteCommandLists(_countof(cmdsLists), cmdsLists);
+	std::vector<ID3D12CommandList*> cmdsLists = { m_graphicsCommandList.Get() };
+	uploadLists.Close(cmdsLists);
+	m_commandQueue->ExecuteCommandLists((UINT)cmdsLists.size(), cmdsLists.data());
 
 	// Wait until initialization is complete.
 	FlushCommandQueue();
+	m_geometryPool->DisposeUploaders();
+	m_textureStreamer->DisposeUploaders();
 
 	return true;
 }
@@ -55,38 +78,63 @@ void ShapesApp::render() {
 
 	m_graphicsCommandList->ClearRenderTargetView(GetCurrentBackBufferView(), (float*)&m_mainPassCB.FogColor, 0, nullptr);
 	m_graphicsCommandList->ClearDepthStencilView(GetDepthStencilView(), D3D12_CLEAR_FLAG_DEPTH | D3D12_CLEAR_FLAG_STENCIL, 1.0f, 0, 0, nullptr);
-	m_graphicsCommandList->OMSetRenderTargets(1, &GetCurrentBackBufferView(), true, &GetDepthStencilView());
 
-	ID3D12DescriptorHeap* descriptorHeaps[] = { m_srvDescriptorHeap.Get() };
-	m_graphicsCommandList->SetDescriptorHeaps(_countof(descriptorHeaps), descriptorHeaps);
+	ThrowIfFailed(m_graphicsCommandList->Close());
 
-	m_graphicsCommandList->SetGraphicsRootSignature(m_rootSignature.Get());
+	// The draws are split across the worker lists. Everything a worker needs is
+	// looked up here so the workers only read plain values.
+	ID3D12PipelineState* initialPSO = m_PSOs["opaque"].Get();
+	ID3D12Resource* backBuffer = GetCurrentBackBuffer();
+	D3D12_CPU_DESCRIPTOR_HANDLE backBufferView = GetCurrentBackBufferView();
+	D3D12_CPU_DESCRIPTOR_HANDLE depthStencilView = GetDepthStencilView();
+	D3D12_GPU_VIRTUAL_ADDRESS passCBAddress = m_currentFrameResource->PassCB->Resource()->GetGPUVirtualAddress();
+	D3D12_GPU_VIRTUAL_ADDRESS instanceBufferAddress = m_currentFrameResource->InstanceBuffer->Resource()->GetGPUVirtualAddress();
+	const std::uint32_t workerCount = m_parallelRecorder.WorkerCount();
 
-	auto passCB = m_currentFrameResource->PassCB->Resource();
-	m_graphicsCommandList->SetGraphicsRootConstantBufferView(2, passCB->GetGPUVirtualAddress());
+	for (std::uint32_t i = 0; i < workerCount; ++i)
+		m_workerBackends[i]->SetCommandList(m_currentFrameResource->WorkerCmdLists[i].Get());
 
-	DrawRenderItems(m_graphicsCommandList.Get(), m_renderItemLayer[(int)RenderLayer::Opaque]);
+	m_parallelRecorder.Record((std::uint32_t)m_instanceBatcher.Batches().size(),
+		[&](std::uint32_t worker, CommandRecorder& recorder, std::uint32_t first, std::uint32_t last) {
+		auto workerAlloc = m_currentFrameResource->WorkerCmdListAllocs[worker].Get();
+		auto workerList = m_currentFrameResource->WorkerCmdLists[worker].Get();
 
-	m_graphicsCommandList->SetPipelineState(m_PSOs["alphaTested"].Get());
-	DrawRenderItems(m_graphicsCommandList.Get(), m_renderItemLayer[(int)RenderLayer::AlphaTested]);
+		ThrowIfFailed(workerAlloc->Reset());
+		ThrowIfFailed(workerList->Reset(workerAlloc, initialPSO));
 
-	m_graphicsCommandList->SetPipelineState(m_PSOs["treeSprites"].Get());
-	DrawRenderItems(m_graphicsCommandList.Get(), m_renderItemLayer[(int)RenderLayer::AlphaTestedTreeSprites]);
+		// Command lists do not inherit state, so every worker sets up the pass.
+		workerList->RSSetViewports(1, &m_screenViewport);
+		workerList->RSSetScissorRects(1, &m_scissorsRect);
+		workerList->OMSetRenderTargets(1, &backBufferView, true, &depthStencilView);
 
-	m_graphicsCommandList->SetPipelineState(m_PSOs["testSprites"].Get());
-	DrawRenderItems(m_graphicsCommandList.Get(), m_renderItemLayer[(int)RenderLayer::AlphaTestedTestSprites]);
+		ID3D12DescriptorHeap* descriptorHeaps[] = { m_srvDescriptorHeap.Get() };
+		workerList->SetDescriptorHeaps(_countof(descriptorHeaps), descriptorHeaps);
 
-	m_graphicsCommandList->SetPipelineState(m_PSOs["transparent"].Get());
-	DrawRenderItems(m_graphicsCommandList.Get(), m_renderItemLayer[(int)RenderLayer::Transparent]);
+		recorder.Invalidate(initialPSO);
+		recorder.SetGraphicsRootSignature(m_rootSignature.Get());
+		recorder.SetGraphicsRootConstantBufferView(2, passCBAddress);
+		recorder.SetGraphicsRootShaderResourceView(4, instanceBufferAddress);
 
-	// Indicate a state transition on the resource usage.
-	m_graphicsCommandList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(GetCurrentBackBuffer(),
-		D3D12_RESOURCE_STATE_RENDER_TARGET, D3D12_RESOURCE_STATE_PRESENT));
+		DrawSortedRenderItems(recorder, first, last);
+
+		// The last list is executed last, so it hands the back buffer to present.
+		if (worker == workerCount - 1)
+		{
+			workerList->ResourceBarrier(1, &CD3DX12_RESOURCE_BARRIER::Transition(backBuffer,
+				D3D12_RESOURCE_STATE_RENDER_TARGET, D3D12_RESOURCE_STATE_PRESENT));
+		}
 
-	m_graphicsCommandList->Close();
+		ThrowIfFailed(workerList->Close());
+	});
 
-	ID3D12CommandList* cmdLists[] = { m_graphicsCommandList.Get() };
-	m_commandQueue->ExecuteCommandLists(_countof(cmdLists), cmdLists);
+	m_drawStats = m_parallelRecorder.Stats();
+
+	// Submit in a fixed order: the clear, then the worker lists in range order.
+	std::vector<ID3D12CommandList*> cmdLists;
+	cmdLists.push_back(m_graphicsCommandList.Get());
+	for (std::uint32_t i = 0; i < workerCount; ++i)
+		cmdLists.push_back(m_currentFrameResource->WorkerCmdLists[i].Get());
+	m_commandQueue->ExecuteCommandLists((UINT)cmdLists.size(), cmdLists.data());
 
 	ThrowIfFailed(m_swapChain->Present(0, 0));
 	m_currentBackBuffer = (m_currentBackBuffer + 1) % m_swapChainBufferCount;
@@ -95,32 +143,204 @@ void ShapesApp::render() {
 	m_commandQueue->Signal(m_fence.Get(), m_currentFence);
 }
 
-void ShapesApp::DrawRenderItems(ID3D12GraphicsCommandList* cmdList, const std::vector<RenderItem*>& renderItems) {
+void ShapesApp::UpdateLods() {
+	float errorScale = m_camera.GetLodErrorScale((float)m_clientHeight);
+	XMVECTOR eyePos = m_camera.GetPosition();
+
+	for (auto& e : m_allRenderItems)
+	{
+		if (!e->Lods || e->Lods->Levels.empty())
+			continue;
+
+		e->CurrentLod = SelectItemLod(*e->Lods, e->CurrentLod, e->Bounds, XMLoadFloat4x4(&e->World), eyePos, errorScale,
+			m_lodMaxPixelError);
+
+		const SubmeshGeometry& submesh = e->Geo->DrawArgs[e->Lods->Levels[e->CurrentLod].Submesh];
+		e->IndexCount = submesh.IndexCount;
+		e->StartIndexLocation = submesh.StartIndexLocation;
+		e->BaseVertexLocation = submesh.BaseVertexLocation;
+	}
+}
+
+void ShapesApp::BindStreamedTextures() {
+	const std::pair<const char*, const char*> bindings[] =
+	{
+		{ "grass", "grassTex" },
+		{ "water", "waterTex" },
+		{ "wirefence", "fenceTex" },
+		{ "treeSprites", "testTreeTex" },
+		{ "testTreeTex", "treeArrayTex" }
+	};
+	for (auto& binding : bindings)
+	{
+		Material* material = m_materials[binding.first].get();
+		m_materialTextures[material] = m_textureStreamer->Find(binding.second);
+		material->DiffuseSrvHeapIndex = m_textureStreamer->DescriptorIndex(m_materialTextures[material]);
+	}
+}
+
+void ShapesApp::UpdateTextureStreaming() {
+	float errorScale = m_camera.GetLodErrorScale((float)m_clientHeight);
+	XMVECTOR eyePos = m_camera.GetPosition();
+
+	for (auto& e : m_allRenderItems)
+	{
+		TextureStreamer::TextureId texture = m_materialTextures[e->Mat];
+
+		// Sprites are sized by their geometry shader, so their texel density is
+		// not known here and they get every mip.
+		if (e->PrimitiveType == D3D11_PRIMITIVE_TOPOLOGY_POINTLIST)
+		{
+			m_textureStreamer->Request(texture, 0);
+			continue;
+		}
+
+		XMMATRIX world = XMLoadFloat4x4(&e->World);
+		BoundingBox worldBounds;
+		e->Bounds.Transform(worldBounds, world);
+
+		// The closest point of the bounding sphere, no closer than the near plane,
+		// sees the texture at its finest.
+		float distance = XMVectorGetX(XMVector3Length(XMLoadFloat3(&worldBounds.Center) - eyePos)) -
+			XMVectorGetX(XMVector3Length(XMLoadFloat3(&worldBounds.Extents)));
+		distance = std::max<float>(distance, m_camera.GetNearZ());
+
+		float worldSize = 2.0f * std::max<float>({ worldBounds.Extents.x, worldBounds.Extents.y, worldBounds.Extents.z });
+		float uvScale = std::max<float>(std::fabs(e->TexTransform(0, 0)), std::fabs(e->TexTransform(1, 1)));
+		std::uint32_t textureSize = std::max<std::uint32_t>(m_textureStreamer->Width(texture), m_textureStreamer->Height(texture));
+
+		m_textureStreamer->Request(texture, RequiredTextureMip(textureSize, uvScale, worldSize, distance, errorScale));
+	}
+
+	m_textureStreamer->Update();
+	for (auto& binding : m_materialTextures)
+		binding.first->DiffuseSrvHeapIndex = m_textureStreamer->DescriptorIndex(binding.second);
+}
+
+void ShapesApp::BuildDrawList() {
+	m_drawList.clear();
+	m_drawItems.clear();
+
+	XMMATRIX view = m_camera.GetView();
+	float farZ = m_camera.GetFarZ();
+
+	for (std::uint32_t layer = 0; layer < (std::uint32_t)m_layerCount; ++layer)
+	{
+		RenderLayer renderLayer = m_layerDrawOrder[layer];
+		bool isTranslucent = renderLayer == RenderLayer::Transparent;
+
+		for (auto ri : m_renderItemLayer[(int)renderLayer])
+		{
+			// Sort on the view space depth of the item origin.
+			XMVECTOR origin = XMVectorSet(ri->World(3, 0), ri->World(3, 1), ri->World(3, 2), 1.0f);
+			float depth = XMVectorGetZ(XMVector3TransformCoord(origin, view));
+
+			std::uint32_t geometry = m_geometrySortIds[ri->Geo];
+			std::uint32_t submesh = m_submeshSortIds.Get(ri->StartIndexLocation, ri->BaseVertexLocation);
+			std::uint32_t material = (std::uint32_t)ri->Mat->MatCBIndex;
+
+			SortedDraw draw;
+			draw.ItemIndex = (std::uint32_t)m_drawItems.size();
+			draw.Key = isTranslucent
+				? DrawKey::MakeTranslucent(layer, layer, geometry, material, depth, farZ)
+				: DrawKey::MakeOpaque(layer, layer, geometry, submesh, material, depth, farZ);
+
+			m_drawList.push_back(draw);
+			m_drawItems.push_back(ri);
+		}
+	}
+
+	RadixSortDraws(m_drawList, m_drawListScratch);
+
+	// Merge the draws of the same submesh, material and PSO into one instanced
+	// draw. Translucent draws only merge with their neighbours, to keep their
+	// order. The batcher refers to positions in the sorted list.
+	m_instanceBatcher.Clear();
+	for (std::uint32_t i = 0; i < (std::uint32_t)m_drawList.size(); ++i)
+	{
+		auto ri = m_drawItems[m_drawList[i].ItemIndex];
+		std::uint32_t layer = DrawKey::Layer(m_drawList[i].Key);
+		bool isTranslucent = m_layerDrawOrder[layer] == RenderLayer::Transparent;
+
+		InstanceBatchKey key;
+		key.Geometry = ri->Geo;
+		key.Material = ri->Mat;
+		key.PipelineState = m_layerPSOs[layer];
+		key.Topology = (std::uint32_t)ri->PrimitiveType;
+		key.IndexCount = ri->IndexCount;
+		key.StartIndexLocation = ri->StartIndexLocation;
+		key.BaseVertexLocation = ri->BaseVertexLocation;
+
+		InstanceMerge merge = !m_layerInstanced[layer] ? InstanceMerge::Never :
+			isTranslucent ? InstanceMerge::Adjacent : InstanceMerge::Any;
+		m_instanceBatcher.Add(key, i, merge);
+	}
+	m_instanceBatcher.Finish();
+}
+
+void ShapesApp::UpdateInstanceBuffer() {
+	auto currentInstanceBuffer = m_currentFrameResource->InstanceBuffer.get();
+	const auto& instanceItems = m_instanceBatcher.InstanceItems();
+
+	for (std::uint32_t i = 0; i < (std::uint32_t)instanceItems.size(); ++i)
+	{
+		auto ri = m_drawItems[m_drawList[instanceItems[i]].ItemIndex];
+
+		XMMATRIX world = XMLoadFloat4x4(&ri->World);
+		XMMATRIX texTransform = XMLoadFloat4x4(&ri->TexTransform);
+
+		InstanceData data;
+		XMStoreFloat4x4(&data.World, XMMatrixTranspose(world));
+		XMStoreFloat4x4(&data.TexTransform, XMMatrixTranspose(texTransform));
+
+		currentInstanceBuffer->CopyData(i, data);
+	}
+}
+
+void ShapesApp::DrawSortedRenderItems(CommandRecorder& recorder, std::uint32_t firstBatch, std::uint32_t lastBatch) {
 	UINT objCBByteSize = CalcConstantBufferByteSize(sizeof(ObjectConstants));
 	UINT matCBByteSize = CalcConstantBufferByteSize(sizeof(MaterialConstants));
 
 	auto objectCB = m_currentFrameResource->ObjectCB->Resource();
 	auto matCB = m_currentFrameResource->MaterialCB->Resource();
 
-	for (size_t i = 0; i < renderItems.size(); ++i)
+	const auto& instanceItems = m_instanceBatcher.InstanceItems();
+
+	// The recorder drops every call that rebinds what is already set, so state is
+	// only really changed where the sort order moves to a new bucket.
+	for (std::uint32_t b = firstBatch; b < lastBatch; ++b)
 	{
-		auto ri = renderItems[i];
+		const InstanceBatch& batch = m_instanceBatcher.Batches()[b];
+		const SortedDraw& draw = m_drawList[instanceItems[batch.FirstInstance]];
+		auto ri = m_drawItems[draw.ItemIndex];
+
+		recorder.SetPipelineState(m_layerPSOs[DrawKey::Layer(draw.Key)]);
 
-		cmdList->IASetVertexBuffers(0, 1, &ri->Geo->VertexBufferView());
-		cmdList->IASetIndexBuffer(&ri->Geo->IndexBufferView());
-		cmdList->IASetPrimitiveTopology(ri->PrimitiveType);
+		recorder.IASetVertexBuffer(ToVertexBufferBinding(ri->Geo->VertexBufferView()));
+		recorder.IASetIndexBuffer(ToIndexBufferBinding(ri->Geo->IndexBufferView()));
+		recorder.IASetPrimitiveTopology(ri->PrimitiveType);
 
 		CD3DX12_GPU_DESCRIPTOR_HANDLE tex(m_srvDescriptorHeap->GetGPUDescriptorHandleForHeapStart());
 		tex.Offset(ri->Mat->DiffuseSrvHeapIndex, m_cbvSrvDescriptorSize);
 
-		D3D12_GPU_VIRTUAL_ADDRESS objCBAddress = objectCB->GetGPUVirtualAddress() + ri->objCBIndex * objCBByteSize;
 		D3D12_GPU_VIRTUAL_ADDRESS matCBAddress = matCB->GetGPUVirtualAddress() + ri->Mat->MatCBIndex * matCBByteSize;
 
-		cmdList->SetGraphicsRootDescriptorTable(0, tex);
-		cmdList->SetGraphicsRootConstantBufferView(1, objCBAddress);
-		cmdList->SetGraphicsRootConstantBufferView(3, matCBAddress);
+		recorder.SetGraphicsRootDescriptorTable(0, tex.ptr);
+		recorder.SetGraphicsRootConstantBufferView(3, matCBAddress);
 
-		cmdList->DrawIndexedInstanced(ri->IndexCount, 1, ri->StartIndexLocation, ri->BaseVertexLocation, 0);
+		if (batch.Mergeable)
+		{
+			// Default.hlsl reads the world matrices from the instance buffer.
+			recorder.SetGraphicsRoot32BitConstant(5, batch.FirstInstance);
+		}
+		else
+		{
+			// The sprite shaders still read cbPerObject.
+			D3D12_GPU_VIRTUAL_ADDRESS objCBAddress = objectCB->GetGPUVirtualAddress() + ri->objCBIndex * objCBByteSize;
+			recorder.SetGraphicsRootConstantBufferView(1, objCBAddress);
+		}
+
+		recorder.DrawIndexedInstanced(ri->IndexCount, batch.InstanceCount, ri->StartIndexLocation, ri->BaseVertexLocation, 0);
 	}
 }
 
@@ -297,6 +517,11 @@ void ShapesApp::update(GameTimer& gameTimer) {
 	UpdateMainPassCB(gameTimer);
 	UpdateWaves(gameTimer);
 	UpdateParticles(gameTimer);
+
+	UpdateLods();
+	UpdateTextureStreaming();
+	BuildDrawList();
+	UpdateInstanceBuffer();
 }
 
 void ShapesApp::AnimateMaterials(const GameTimer& gameTimer) {
@@ -399,67 +624,17 @@ void ShapesApp::OnMouseMove(WPARAM btnState, int x, int y) {
 	m_lastMousePos.y = y;
 }
 
-void ShapesApp::LoadTextures() {
-	auto grassTex = std::make_unique<Texture>();
-	grassTex->Name = "grassTex";
-	grassTex->Filename = L"Textures/grass.dds";
-	ThrowIfFailed(DirectX::CreateDDSTextureFromFile12(
-		m_device.Get(), 
-		m_graphicsCommandList.Get(), 
-		grassTex->Filename.c_str(), 
-		grassTex->Resource, 
-		grassTex->UploadHeap
-	));
-
-	auto waterTex = std::make_unique<Texture>();
-	waterTex->Name = "waterTex";
-	waterTex->Filename = L"Textures/water1.dds";
-	ThrowIfFailed(DirectX::CreateDDSTextureFromFile12(
-		m_device.Get(),
-		m_graphicsCommandList.Get(),
-		waterTex->Filename.c_str(),
-		waterTex->Resource,
-		waterTex->UploadHeap
-	));
-
-	auto treeArrayTex = std::make_unique<Texture>();
-	treeArrayTex->Name = "treeArrayTex";
-	treeArrayTex->Filename = L"Textures/treeArray2.dds";
-	ThrowIfFailed(DirectX::CreateDDSTextureFromFile12(
-		m_device.Get(), 
-		m_graphicsCommandList.Get(), 
-		treeArrayTex->Filename.c_str(), 
-		treeArrayTex->Resource, 
-		treeArrayTex->UploadHeap
-	));
-
-	auto fenceTex = std::make_unique<Texture>();
-	fenceTex->Name = "fenceTex";
-	fenceTex->Filename = L"Textures/WireFence.dds";
-	ThrowIfFailed(DirectX::CreateDDSTextureFromFile12(
-		m_device.Get(),
-		m_graphicsCommandList.Get(),
-		fenceTex->Filename.c_str(),
-		fenceTex->Resource,
-		fenceTex->UploadHeap
-	));
-
-	auto testTree = std::make_unique<Texture>();
-	testTree->Name = "testTreeTex";
-	testTree->Filename = L"Textures/tree01S.dds";
-	ThrowIfFailed(DirectX::CreateDDSTextureFromFile12(
-		m_device.Get(),
-		m_graphicsCommandList.Get(),
-		testTree->Filename.c_str(),
-		testTree->Resource,
-		testTree->UploadHeap
-	));
-
-	m_textures[grassTex->Name] = std::move(grassTex);
-	m_textures[waterTex->Name] = std::move(waterTex);
-	m_textures[fenceTex->Name] = std::move(fenceTex);
-	m_textures[treeArrayTex->Name] = std::move(treeArrayTex);
-	m_textures[testTree->Name] = std::move(testTree);
+void ShapesApp::LoadTextures(CommandListSet& uploadLists, ThreadPool* pool) {
+	const std::vector<TextureSource> textures =
+	{
+		{ "grassTex", L"Textures/grass.dds" },
+		{ "waterTex", L"Textures/water1.dds" },
+		{ "treeArrayTex", L"Textures/treeArray2.dds" },
+		{ "fenceTex", L"Textures/WireFence.dds" },
+		{ "testTreeTex", L"Textures/tree01S.dds" }
+	};
+	// Only the mip tails are uploaded here; UpdateTextureStreaming loads the rest.
+	m_textureStreamer->Add(textures, uploadLists, pool);
 }
 
 void ShapesApp::BuildRootSignature() {
@@ -468,18 +643,21 @@ void ShapesApp::BuildRootSignature() {
 	texTable.Init(D3D12_DESCRIPTOR_RANGE_TYPE_SRV, 1, 0);
 
 	// Root parameter can be a table, a root descriptor or a root constant
-	CD3DX12_ROOT_PARAMETER slotRootParameter[4];
+	CD3DX12_ROOT_PARAMETER slotRootParameter[6];
 
 	// Order from most frequent to least frequent for performance
 	slotRootParameter[0].InitAsDescriptorTable(1, &texTable, D3D12_SHADER_VISIBILITY_PIXEL);
 	slotRootParameter[1].InitAsConstantBufferView(0);
 	slotRootParameter[2].InitAsConstantBufferView(1);
 	slotRootParameter[3].InitAsConstantBufferView(2);
+	// Instance buffer and the offset of the current batch in it.
+	slotRootParameter[4].InitAsShaderResourceView(0, 1, D3D12_SHADER_VISIBILITY_VERTEX);
+	slotRootParameter[5].InitAsConstants(1, 3, 0, D3D12_SHADER_VISIBILITY_VERTEX);
 
 	auto staticSamplers = GetStaticSamplers();
 
 	// A root signature is an array of root parameters.
-	CD3DX12_ROOT_SIGNATURE_DESC rootSigDesc(4, slotRootParameter, (UINT)staticSamplers.size(), staticSamplers.data(), D3D12_ROOT_SIGNATURE_FLAG_ALLOW_INPUT_ASSEMBLER_INPUT_LAYOUT);
+	CD3DX12_ROOT_SIGNATURE_DESC rootSigDesc(6, slotRootParameter, (UINT)staticSamplers.size(), staticSamplers.data(), D3D12_ROOT_SIGNATURE_FLAG_ALLOW_INPUT_ASSEMBLER_INPUT_LAYOUT);
 
 	// Create a root signature with a single slot which points to a descriptor range consisting of a single constant buffer
 	ComPtr<ID3DBlob> serializedRootSig = nullptr;
@@ -498,55 +676,15 @@ void ShapesApp::BuildRootSignature() {
 
 void ShapesApp::BuildDescriptorHeaps() {
 	D3D12_DESCRIPTOR_HEAP_DESC srvHeapDesc = {};
-	srvHeapDesc.NumDescriptors = 5;
+	srvHeapDesc.NumDescriptors = m_textureStreamer->DescriptorCount();
 	srvHeapDesc.Type = D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV;
 	srvHeapDesc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE;
 	ThrowIfFailed(m_device->CreateDescriptorHeap(&srvHeapDesc, IID_PPV_ARGS(&m_srvDescriptorHeap)));
 
-	CD3DX12_CPU_DESCRIPTOR_HANDLE hDescriptor(m_srvDescriptorHeap->GetCPUDescriptorHandleForHeapStart());
-
-	auto grassTex = m_textures["grassTex"]->Resource;
-	auto waterTex = m_textures["waterTex"]->Resource;
-	auto fenceTex = m_textures["fenceTex"]->Resource;
-	auto testTreeTex = m_textures["testTreeTex"]->Resource;
-	auto treeArrayTex = m_textures["treeArrayTex"]->Resource;
-
-	D3D12_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
-	srvDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
-	srvDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2D;
-	srvDesc.Texture2D.MostDetailedMip = 0;
-	srvDesc.Texture2D.MipLevels = -1;
-	m_device->CreateShaderResourceView(grassTex.Get(), &srvDesc, hDescriptor);
-
-	// next descriptor
-	hDescriptor.Offset(1, m_cbvSrvDescriptorSize);
-	srvDesc.Format = waterTex->GetDesc().Format;
-	m_device->CreateShaderResourceView(waterTex.Get(), &srvDesc, hDescriptor);
-
-	// next descriptor
-	hDescriptor.Offset(1, m_cbvSrvDescriptorSize);
-	srvDesc.Format = fenceTex->GetDesc().Format;
-	m_device->CreateShaderResourceView(fenceTex.Get(), &srvDesc, hDescriptor);
-
-	// next descriptor
-	hDescriptor.Offset(1, m_cbvSrvDescriptorSize);
-	srvDesc.Format = testTreeTex->GetDesc().Format;
-	m_device->CreateShaderResourceView(testTreeTex.Get(), &srvDesc, hDescriptor);
-
-	// next descriptor
-	hDescriptor.Offset(1, m_cbvSrvUavDescriptorSize);
-
-	auto desc = treeArrayTex->GetDesc();
-	srvDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2DARRAY;
-	srvDesc.Format = treeArrayTex->GetDesc().Format;
-	srvDesc.Texture2DArray.MostDetailedMip = 0;
-	srvDesc.Texture2DArray.MipLevels = -1;
-	srvDesc.Texture2DArray.FirstArraySlice = 0;
-	srvDesc.Texture2DArray.ArraySize = treeArrayTex->GetDesc().DepthOrArraySize;
-	m_device->CreateShaderResourceView(treeArrayTex.Get(), &srvDesc, hDescriptor);
+	m_textureStreamer->CreateDescriptors(m_srvDescriptorHeap.Get(), 0, m_cbvSrvDescriptorSize);
 }
 
-void ShapesApp::BuildShadersAndInputLayout() { 
+void ShapesApp::BuildShadersAndInputLayout(ThreadPool* pool) {
 	const D3D_SHADER_MACRO defines[] =
 	{
 		"FOG", "1",
@@ -560,17 +698,21 @@ void ShapesApp::BuildShadersAndInputLayout() {
 		NULL, NULL
 	};
 
-	m_shaders["standardVS"] = CompileShader(L"Shaders\\Default.hlsl", nullptr, "VS", "vs_5_0");
-	m_shaders["opaquePS"] = CompileShader(L"Shaders\\Default.hlsl", defines, "PS", "ps_5_0");
-	m_shaders["alphaTestedPS"] = CompileShader(L"Shaders\\Default.hlsl", alphaTestDefines, "PS", "ps_5_0");
+	const std::vector<ShaderSource> shaders =
+	{
+		{ "standardVS", L"Shaders\\Default.hlsl", nullptr, "VS", "vs_5_0" },
+		{ "opaquePS", L"Shaders\\Default.hlsl", defines, "PS", "ps_5_0" },
+		{ "alphaTestedPS", L"Shaders\\Default.hlsl", alphaTestDefines, "PS", "ps_5_0" },
 
-	m_shaders["treeSpriteVS"] = CompileShader(L"Shaders\\TreeSprite.hlsl", nullptr, "VS", "vs_5_0");
-	m_shaders["treeSpriteGS"] = CompileShader(L"Shaders\\TreeSprite.hlsl", nullptr, "GS", "gs_5_0");
-	m_shaders["treeSpritePS"] = CompileShader(L"Shaders\\TreeSprite.hlsl", alphaTestDefines, "PS", "ps_5_0");
+		{ "treeSpriteVS", L"Shaders\\TreeSprite.hlsl", nullptr, "VS", "vs_5_0" },
+		{ "treeSpriteGS", L"Shaders\\TreeSprite.hlsl", nullptr, "GS", "gs_5_0" },
+		{ "treeSpritePS", L"Shaders\\TreeSprite.hlsl", alphaTestDefines, "PS", "ps_5_0" },
 
-	m_shaders["testTreeSpriteVS"] = CompileShader(L"Shaders\\TestSprite.hlsl", nullptr, "VS", "vs_5_0");
-	m_shaders["testTreeSpriteGS"] = CompileShader(L"Shaders\\TestSprite.hlsl", nullptr, "GS", "gs_5_0");
-	m_shaders["testTreeSpritePS"] = CompileShader(L"Shaders\\TestSprite.hlsl", alphaTestDefines, "PS", "ps_5_0");
+		{ "testTreeSpriteVS", L"Shaders\\TestSprite.hlsl", nullptr, "VS", "vs_5_0" },
+		{ "testTreeSpriteGS", L"Shaders\\TestSprite.hlsl", nullptr, "GS", "gs_5_0" },
+		{ "testTreeSpritePS", L"Shaders\\TestSprite.hlsl", alphaTestDefines, "PS", "ps_5_0" }
+	};
+	CompileShaders(shaders, m_shaders, pool);
 
 	m_inputLayout = {
 		{"POSITION", 0 , DXGI_FORMAT_R32G32B32_FLOAT, 0, 0, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0},
@@ -587,71 +729,168 @@ void ShapesApp::BuildShadersAndInputLayout() {
 
 float ShapesApp::GetHillsHeight(float x, float z) const
 {
-	return 0.3f * (z * sinf(0.1f * x) + x * cosf(0.1f * z));
+	return HillsHeight(HillsTerrainDesc(), x, z);
 }
 
 XMFLOAT3 ShapesApp::GetHillsNormal(float x, float z) const {
-	XMFLOAT3 n(
-		-0.03f * z * cosf(0.1f * x) - 0.3f * cosf(0.1f * z),
-		1.0f,
-		-0.3f * sinf(0.1f * x) + 0.03f * x * sinf(0.1f * z)
-	);
+	return HillsNormal(HillsTerrainDesc(), x, z);
+}
 
-	XMVECTOR unitNormal = XMVector3Normalize(XMLoadFloat3(&n));
-	XMStoreFloat3(&n, unitNormal);
+void ShapesApp::BuildLandGeometry(ID3D12GraphicsCommandList* cmdList) {
+	const float landWidth = 160.0f;
+	const float landDepth = 160.0f;
+
+	// Heights of a coarse level between its vertices, the way the rasterizer
+	// interpolates them across the two triangles of a cell.
+	auto interpolatedHeight = [this, landWidth, landDepth](std::uint32_t m, std::uint32_t n, float x, float z) {
+		float dx = landWidth / (n - 1);
+		float dz = landDepth / (m - 1);
+		float fj = (x + 0.5f * landWidth) / dx;
+		float fi = (0.5f * landDepth - z) / dz;
+		std::uint32_t j = (std::uint32_t)MathHelper::Clamp(fj, 0.0f, (float)(n - 2));
+		std::uint32_t i = (std::uint32_t)MathHelper::Clamp(fi, 0.0f, (float)(m - 2));
+		float s = fj - j;
+		float t = fi - i;
+
+		float x0 = -0.5f * landWidth + j * dx;
+		float z0 = 0.5f * landDepth - i * dz;
+		float h00 = GetHillsHeight(x0, z0);
+		float h01 = GetHillsHeight(x0 + dx, z0);
+		float h10 = GetHillsHeight(x0, z0 - dz);
+		float h11 = GetHillsHeight(x0 + dx, z0 - dz);
+
+		if (s + t <= 1.0f)
+			return h00 + s * (h01 - h00) + t * (h10 - h00);
+		return h11 + (1.0f - s) * (h10 - h11) + (1.0f - t) * (h01 - h11);
+	};
 
-	return n;
-}
+	LodChain& lods = m_lodChains["grid"];
+	const std::uint32_t maxLandLods = 4;
 
-void ShapesApp::BuildLandGeometry() {
-	GeometryGenerator geoGen;
-	GeometryGenerator::MeshData grid = geoGen.CreateGrid(160.0f, 160.0f, 50, 50);
+	// Keep every other row and column so coarse vertices lie on fine ones
+	// whenever the cell count is even.
+	auto nextLevelSize = [](std::uint32_t size) { return std::max<std::uint32_t>((size - 1) / 2 + 1, 2u); };
 
-	std::vector<Vertex2> vertices(grid.Vertices.size());
+	// Size every level up front so the vertices are generated once, straight into
+	// the CPU copy of the vertex buffer.
+	std::uint32_t levelRows[maxLandLods];
+	std::uint32_t levelColumns[maxLandLods];
+	GeometryGenerator::MeshSize levelSizes[maxLandLods];
+	std::uint32_t levelCount = 0;
+	UINT totalVertexCount = 0;
 
-	for (size_t i = 0; i < grid.Vertices.size(); ++i)
+	for (std::uint32_t rows = 50, columns = 50; levelCount < maxLandLods; ++levelCount)
 	{
-		auto& p = grid.Vertices[i].Position;
-		vertices[i].Pos = p;
-		vertices[i].Pos.y = GetHillsHeight(p.x, p.z);
-		vertices[i].Normal = GetHillsNormal(p.x, p.z);
-		vertices[i].TexC = grid.Vertices[i].TexC;
-	}
+		levelRows[levelCount] = rows;
+		levelColumns[levelCount] = columns;
+		levelSizes[levelCount] = GeometryGenerator::GridSize(rows, columns);
+		totalVertexCount += levelSizes[levelCount].VertexCount;
 
-	const UINT vbByteSize = (UINT)vertices.size() * sizeof(Vertex2);
+		if (rows <= 2 && columns <= 2)
+		{
+			levelCount++;
+			break;
+		}
 
-	std::vector<std::uint16_t> indices = grid.GetIndices16();
-	const UINT ibByteSize = (UINT)indices.size() * sizeof(std::uint16_t);
+		rows = nextLevelSize(rows);
+		columns = nextLevelSize(columns);
+	}
 
 	auto geo = std::make_unique<MeshGeometry>();
 	geo->Name = "landGeo";
 
-	ThrowIfFailed(D3DCreateBlob(vbByteSize, &geo->VertexBufferCPU));
-	CopyMemory(geo->VertexBufferCPU->GetBufferPointer(), vertices.data(), vbByteSize);
+	ThrowIfFailed(D3DCreateBlob(totalVertexCount * sizeof(Vertex2), &geo->VertexBufferCPU));
+	Vertex2* vertices = (Vertex2*)geo->VertexBufferCPU->GetBufferPointer();
 
-	ThrowIfFailed(D3DCreateBlob(ibByteSize, &geo->IndexBufferCPU));
-	CopyMemory(geo->IndexBufferCPU->GetBufferPointer(), indices.data(), ibByteSize);
+	// The optimizer takes 32-bit indices. The index buffer builder narrows them
+	// once every level is done, with each level drawn from its own base vertex.
+	std::vector<std::uint32_t> levelIndices[maxLandLods];
+	std::vector<SubmeshGeometry> levelSubmeshes(levelCount);
+
+	TerrainVertexLayout vertexLayout;
+	vertexLayout.Stride = sizeof(Vertex2);
+	vertexLayout.PositionOffset = offsetof(Vertex2, Pos);
+	vertexLayout.NormalOffset = offsetof(Vertex2, Normal);
+	vertexLayout.TexCOffset = offsetof(Vertex2, TexC);
+
+	UINT vertexCount = 0;
+	UINT finestVertexCount = 0;
+
+	for (std::uint32_t level = 0; level < levelCount; ++level)
+	{
+		Vertex2* levelVertices = vertices + vertexCount;
+		std::vector<std::uint32_t>& indices = levelIndices[level];
+		indices.resize(levelSizes[level].IndexCount);
+
+		HillsTerrainDesc terrain;
+		terrain.Width = landWidth;
+		terrain.Depth = landDepth;
+		terrain.Rows = levelRows[level];
+		terrain.Columns = levelColumns[level];
+		GenerateHillsVertices(terrain, levelVertices, vertexLayout, &ThreadPool::Default());
+		GenerateGridIndices(terrain.Rows, terrain.Columns, DefaultGridStripWidth, indices.data(), &ThreadPool::Default());
+
+		std::size_t levelVertexCount = levelSizes[level].VertexCount;
+		OptimizeMesh(indices, levelVertices, levelVertexCount, sizeof(Vertex2), &levelVertices[0].Pos);
+
+		SubmeshGeometry& submesh = levelSubmeshes[level];
+		submesh.BaseVertexLocation = (INT)vertexCount;
+		BoundingBox::CreateFromPoints(submesh.Bounds, levelVertexCount, &levelVertices[0].Pos, sizeof(Vertex2));
+
+		if (level == 0)
+			finestVertexCount = (UINT)levelVertexCount;
+
+		// The grid is flat, so measure the error of the displaced surface at the
+		// vertices of the finest level.
+		float error = 0.0f;
+		if (level > 0)
+		{
+			for (UINT i = 0; i < finestVertexCount; ++i)
+			{
+				const XMFLOAT3& fine = vertices[i].Pos;
+				float h = interpolatedHeight(levelRows[level], levelColumns[level], fine.x, fine.z);
+				error = MathHelper::Max(error, fabsf(h - fine.y));
+			}
+		}
+
+		lods.Levels.push_back({ LodSubmeshName("grid", level), error });
+		vertexCount += (UINT)levelVertexCount;
+	}
 
-	geo->VertexBufferGPU = CreateDefaultBuffer(m_device.Get(), m_graphicsCommandList.Get(), vertices.data(), vbByteSize, geo->VertexBufferUploader);
-	geo->IndexBufferGPU = CreateDefaultBuffer(m_device.Get(), m_graphicsCommandList.Get(), indices.data(), ibByteSize, geo->IndexBufferUploader);
+	// Levels are selected whole, so they are never split.
+	IndexBufferBuilder indexBuffer;
+	for (std::uint32_t level = 0; level < levelCount; ++level)
+		indexBuffer.Add(lods.Levels[level].Submesh, levelIndices[level].data(), levelIndices[level].size(), levelSubmeshes[level].BaseVertexLocation);
+	indexBuffer.Build();
+
+	for (std::uint32_t level = 0; level < levelCount; ++level)
+	{
+		assert(indexBuffer.Ranges(lods.Levels[level].Submesh).size() == 1);
+		const IndexBufferRange& range = indexBuffer.Ranges(lods.Levels[level].Submesh)[0];
+		SubmeshGeometry& submesh = levelSubmeshes[level];
+		submesh.IndexCount = range.IndexCount;
+		submesh.StartIndexLocation = range.StartIndexLocation;
+		submesh.BaseVertexLocation = range.BaseVertexLocation;
+		geo->DrawArgs[lods.Levels[level].Submesh] = submesh;
+	}
+
+	const UINT vbByteSize = vertexCount * sizeof(Vertex2);
+	const UINT ibByteSize = indexBuffer.ByteSize();
+
+	ThrowIfFailed(D3DCreateBlob(ibByteSize, &geo->IndexBufferCPU));
+	CopyMemory(geo->IndexBufferCPU->GetBufferPointer(), indexBuffer.Data(), ibByteSize);
 
 	geo->VertexByteStride = sizeof(Vertex2);
 	geo->VertexBufferByteSize = vbByteSize;
-	geo->IndexFormat = DXGI_FORMAT_R16_UINT;
+	geo->IndexFormat = indexBuffer.Format();
 	geo->IndexBufferByteSize = ibByteSize;
 
-	SubmeshGeometry submesh;
-	submesh.IndexCount = (UINT)indices.size();
-	submesh.StartIndexLocation = 0;
-	submesh.BaseVertexLocation = 0;
-
-	geo->DrawArgs["grid"] = submesh;
+	m_geometryPool->Add(*geo, vertices, indexBuffer.Data(), cmdList);
 	m_geometries["landGeo"] = std::move(geo);
 }
 
-void ShapesApp::BuildWavesGeometryBuffers() {
-	std::vector<std::uint16_t> indices(3 * m_waves->TriangleCount()); // 3 indices per face
-	assert(m_waves->VertexCount() < 0x0000ffff);
+void ShapesApp::BuildWavesGeometryBuffers(ID3D12GraphicsCommandList* cmdList) {
+	std::vector<std::uint32_t> indices(3 * m_waves->TriangleCount()); // 3 indices per face
 
 	// Iterate over each quad.
 	int m = m_waves->RowCount();
@@ -673,8 +912,20 @@ void ShapesApp::BuildWavesGeometryBuffers() {
 		}
 	}
 
+	// The vertices are rewritten by index every frame and the water is blended,
+	// so only the triangle order may change.
+	std::size_t wavesVertexCount = m_waves->VertexCount();
+	OptimizeMesh(indices, nullptr, wavesVertexCount, 0, nullptr, MeshOptimize_VertexCache);
+
+	// One draw over the dynamic vertex buffer, so the grid is not split.
+	IndexBufferBuilder indexBuffer;
+	indexBuffer.Add("grid", indices.data(), indices.size());
+	indexBuffer.Build();
+	assert(indexBuffer.Ranges("grid").size() == 1);
+	const IndexBufferRange& range = indexBuffer.Ranges("grid")[0];
+
 	UINT vbByteSize = m_waves->VertexCount() * sizeof(Vertex2);
-	UINT ibByteSize = (UINT)indices.size() * sizeof(std::uint16_t);
+	UINT ibByteSize = indexBuffer.ByteSize();
 
 	auto geo = std::make_unique<MeshGeometry>();
 	geo->Name = "waterGeo";
@@ -684,54 +935,43 @@ void ShapesApp::BuildWavesGeometryBuffers() {
 	geo->VertexBufferGPU = nullptr;
 
 	ThrowIfFailed(D3DCreateBlob(ibByteSize, &geo->IndexBufferCPU));
-	CopyMemory(geo->IndexBufferCPU->GetBufferPointer(), indices.data(), ibByteSize);
+	CopyMemory(geo->IndexBufferCPU->GetBufferPointer(), indexBuffer.Data(), ibByteSize);
 
-	geo->IndexBufferGPU = CreateDefaultBuffer(m_device.Get(), m_graphicsCommandList.Get(), indices.data(), ibByteSize, geo->IndexBufferUploader);
+	geo->IndexBufferGPU = CreateDefaultBuffer(m_device.Get(), cmdList, indexBuffer.Data(), ibByteSize, geo->IndexBufferUploader);
 
 	geo->VertexByteStride = sizeof(Vertex2);
 	geo->VertexBufferByteSize = vbByteSize;
-	geo->IndexFormat = DXGI_FORMAT_R16_UINT;
+	geo->IndexFormat = indexBuffer.Format();
 	geo->IndexBufferByteSize = ibByteSize;
 
 	SubmeshGeometry submesh;
-	submesh.IndexCount = (UINT)indices.size();
-	submesh.StartIndexLocation = 0;
-	submesh.BaseVertexLocation = 0;
+	submesh.IndexCount = range.IndexCount;
+	submesh.StartIndexLocation = range.StartIndexLocation;
+	submesh.BaseVertexLocation = range.BaseVertexLocation;
+
+	submesh.Bounds = BoundingBox(XMFLOAT3(0.0f, 0.0f, 0.0f), XMFLOAT3(0.5f * m_waves->Width(), 1.0f, 0.5f * m_waves->Depth()));
 
 	geo->DrawArgs["grid"] = submesh;
 
 	m_geometries["waterGeo"] = std::move(geo);
 }
 
-void ShapesApp::BuildBoxGeometry() {
-	GeometryGenerator geoGen;
-	GeometryGenerator::MeshData box = geoGen.CreateBox(8.0f, 8.0f, 8.0f, 3);
+void ShapesApp::BuildBoxGeometry(ID3D12GraphicsCommandList* cmdList) {
+	// Built by the compiler, with its triangles already in vertex cache order,
+	// and uploaded straight from the executable.
+	static constexpr auto box = MakeBoxTable<Vertex2, 8>(8.0f, 8.0f, 8.0f);
 
-	std::vector<Vertex2> vertices(box.Vertices.size());
-	for (size_t i = 0; i < box.Vertices.size(); i++)
-	{
-		auto& p = box.Vertices[i].Position;
-		vertices[i].Pos = p;
-		vertices[i].Normal = box.Vertices[i].Normal;
-		vertices[i].TexC = box.Vertices[i].TexC;
-	}
-
-	const UINT vbByteSize = (UINT)vertices.size() * sizeof(Vertex2);
-
-	std::vector<std::uint16_t> indices = box.GetIndices16();
-	const UINT ibByteSize = (UINT)indices.size() * sizeof(std::uint16_t);
+	const UINT vbByteSize = box.VertexBufferByteSize();
+	const UINT ibByteSize = box.IndexBufferByteSize();
 
 	auto geo = std::make_unique<MeshGeometry>();
 	geo->Name = "boxGeo";
 
 	ThrowIfFailed(D3DCreateBlob(vbByteSize, &geo->VertexBufferCPU));
-	CopyMemory(geo->VertexBufferCPU->GetBufferPointer(), vertices.data(), vbByteSize);
+	CopyMemory(geo->VertexBufferCPU->GetBufferPointer(), box.Vertices.data(), vbByteSize);
 
 	ThrowIfFailed(D3DCreateBlob(ibByteSize, &geo->IndexBufferCPU));
-	CopyMemory(geo->IndexBufferCPU->GetBufferPointer(), indices.data(), ibByteSize);
-
-	geo->VertexBufferGPU = CreateDefaultBuffer(m_device.Get(), m_graphicsCommandList.Get(), vertices.data(), vbByteSize, geo->VertexBufferUploader);
-	geo->IndexBufferGPU = CreateDefaultBuffer(m_device.Get(), m_graphicsCommandList.Get(), indices.data(), ibByteSize, geo->IndexBufferUploader);
+	CopyMemory(geo->IndexBufferCPU->GetBufferPointer(), box.Indices.data(), ibByteSize);
 
 	geo->VertexByteStride = sizeof(Vertex2);
 	geo->VertexBufferByteSize = vbByteSize;
@@ -739,15 +979,17 @@ void ShapesApp::BuildBoxGeometry() {
 	geo->IndexBufferByteSize = ibByteSize;
 
 	SubmeshGeometry submesh;
-	submesh.IndexCount = (UINT)indices.size();
+	submesh.IndexCount = (UINT)box.Indices.size();
 	submesh.StartIndexLocation = 0;
 	submesh.BaseVertexLocation = 0;
+	submesh.Bounds = BoundingBox(XMFLOAT3(0.0f, 0.0f, 0.0f), XMFLOAT3(4.0f, 4.0f, 4.0f));
 
 	geo->DrawArgs["box"] = submesh;
+	m_geometryPool->Add(*geo, box.Vertices.data(), box.Indices.data(), cmdList);
 	m_geometries["boxGeo"] = std::move(geo);
 }
 
-void ShapesApp::BuildTreeSpritesGeometry() {
+void ShapesApp::BuildTreeSpritesGeometry(ID3D12GraphicsCommandList* cmdList) {
 	struct TreeSpriteVertex
 	{
 		XMFLOAT3 Pos;
@@ -787,9 +1029,6 @@ void ShapesApp::BuildTreeSpritesGeometry() {
 	ThrowIfFailed(D3DCreateBlob(ibByteSize, &geo->IndexBufferCPU));
 	CopyMemory(geo->IndexBufferCPU->GetBufferPointer(), indices.data(), ibByteSize);
 
-	geo->VertexBufferGPU = CreateDefaultBuffer(m_device.Get(), m_graphicsCommandList.Get(), vertices.data(), vbByteSize, geo->VertexBufferUploader);
-	geo->IndexBufferGPU = CreateDefaultBuffer(m_device.Get(),m_graphicsCommandList.Get(), indices.data(), ibByteSize,geo->IndexBufferUploader);
-	
 	geo->VertexByteStride = sizeof(TreeSpriteVertex);
 	geo->VertexBufferByteSize = vbByteSize;
 	geo->IndexFormat = DXGI_FORMAT_R16_UINT;
@@ -801,10 +1040,11 @@ void ShapesApp::BuildTreeSpritesGeometry() {
 	submesh.BaseVertexLocation = 0;
 
 	geo->DrawArgs["points"] = submesh;
+	m_geometryPool->Add(*geo, vertices.data(), indices.data(), cmdList);
 	m_geometries["treeSpriteGeo"] = std::move(geo);
 }
 
-void ShapesApp::BuildTestSpriteGeometry() {
+void ShapesApp::BuildTestSpriteGeometry(ID3D12GraphicsCommandList* cmdList) {
 	const int particleCount = 5;
 	const DirectX::XMFLOAT3 startPosition = { 0.0f, 0.0f, 0.0f };
 	const DirectX::XMFLOAT2 startSize = { 0.0f, 0.0f };
@@ -836,8 +1076,8 @@ void ShapesApp::BuildTestSpriteGeometry() {
 	ThrowIfFailed(D3DCreateBlob(ibByteSize, &geo->IndexBufferCPU));
 	CopyMemory(geo->IndexBufferCPU->GetBufferPointer(), indices.data(), ibByteSize);
 
-	geo->VertexBufferGPU = CreateDefaultBuffer(m_device.Get(), m_graphicsCommandList.Get(), vertices.data(), vbByteSize, geo->VertexBufferUploader);
-	geo->IndexBufferGPU = CreateDefaultBuffer(m_device.Get(), m_graphicsCommandList.Get(), indices.data(), ibByteSize, geo->IndexBufferUploader);
+	geo->VertexBufferGPU = CreateDefaultBuffer(m_device.Get(), cmdList, vertices.data(), vbByteSize, geo->VertexBufferUploader);
+	geo->IndexBufferGPU = CreateDefaultBuffer(m_device.Get(), cmdList, indices.data(), ibByteSize, geo->IndexBufferUploader);
 
 	geo->VertexByteStride = sizeof(TestSpriteVertex);
 	geo->VertexBufferByteSize = vbByteSize;
@@ -857,7 +1097,6 @@ void ShapesApp::BuildMaterials() {
 	auto grass = std::make_unique<Material>();
 	grass->Name = "grass";
 	grass->MatCBIndex = 0;
-	grass->DiffuseSrvHeapIndex = 0;
 	grass->DiffuseAlbedo = XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f);
 	grass->FresnelR0 = XMFLOAT3(0.01f, 0.01f, 0.01f);
 	grass->Roughness = 0.125f;
@@ -865,7 +1104,6 @@ void ShapesApp::BuildMaterials() {
 	auto water = std::make_unique<Material>();
 	water->Name = "water";
 	water->MatCBIndex = 1;
-	water->DiffuseSrvHeapIndex = 1;
 	water->DiffuseAlbedo = XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f);
 	water->FresnelR0 = XMFLOAT3(0.2f, 0.2f, 0.2f);
 	water->Roughness = 0.0f;
@@ -873,7 +1111,6 @@ void ShapesApp::BuildMaterials() {
 	auto wirefence = std::make_unique<Material>();
 	wirefence->Name = "wirefence";
 	wirefence->MatCBIndex = 2;
-	wirefence->DiffuseSrvHeapIndex = 2;
 	wirefence->DiffuseAlbedo = XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f);
 	wirefence->FresnelR0 = XMFLOAT3(0.1f, 0.1f, 0.1f);
 	wirefence->Roughness = 0.25f;
@@ -881,7 +1118,6 @@ void ShapesApp::BuildMaterials() {
 	auto treeSprites = std::make_unique<Material>();
 	treeSprites->Name = "treeSprites";
 	treeSprites->MatCBIndex = 3;
-	treeSprites->DiffuseSrvHeapIndex = 3;
 	treeSprites->DiffuseAlbedo = XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f);
 	treeSprites->FresnelR0 = XMFLOAT3(0.01f, 0.01f, 0.01f);
 	treeSprites->Roughness = 0.125f;
@@ -889,7 +1125,6 @@ void ShapesApp::BuildMaterials() {
 	auto testSprites = std::make_unique<Material>();
 	testSprites->Name = "testTreeTex";
 	testSprites->MatCBIndex = 4;
-	testSprites->DiffuseSrvHeapIndex = 4;
 	testSprites->DiffuseAlbedo = XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f);
 	testSprites->FresnelR0 = XMFLOAT3(0.01f, 0.01f, 0.01f);
 	testSprites->Roughness = 0.125f;
@@ -911,6 +1146,7 @@ void ShapesApp::BuildRenderItems() { auto wavesRenderItem = std::make_unique<Ren
 	wavesRenderItem->IndexCount = wavesRenderItem->Geo->DrawArgs["grid"].IndexCount;
 	wavesRenderItem->StartIndexLocation = wavesRenderItem->Geo->DrawArgs["grid"].StartIndexLocation;
 	wavesRenderItem->BaseVertexLocation = wavesRenderItem->Geo->DrawArgs["grid"].BaseVertexLocation;
+	wavesRenderItem->Bounds = wavesRenderItem->Geo->DrawArgs["grid"].Bounds;
 
 	m_wavesRenderItem = wavesRenderItem.get();
 
@@ -926,6 +1162,8 @@ void ShapesApp::BuildRenderItems() { auto wavesRenderItem = std::make_unique<Ren
 	gridRenderItem->IndexCount = gridRenderItem->Geo->DrawArgs["grid"].IndexCount;
 	gridRenderItem->StartIndexLocation = gridRenderItem->Geo->DrawArgs["grid"].StartIndexLocation;
 	gridRenderItem->BaseVertexLocation = gridRenderItem->Geo->DrawArgs["grid"].BaseVertexLocation;
+	gridRenderItem->Bounds = gridRenderItem->Geo->DrawArgs["grid"].Bounds;
+	gridRenderItem->Lods = &m_lodChains["grid"];
 
 	m_renderItemLayer[(int)RenderLayer::Opaque].push_back(gridRenderItem.get());
 
@@ -938,6 +1176,7 @@ void ShapesApp::BuildRenderItems() { auto wavesRenderItem = std::make_unique<Ren
 	boxRenderItem->IndexCount = boxRenderItem->Geo->DrawArgs["box"].IndexCount;
 	boxRenderItem->StartIndexLocation = boxRenderItem->Geo->DrawArgs["box"].StartIndexLocation;
 	boxRenderItem->BaseVertexLocation = boxRenderItem->Geo->DrawArgs["box"].BaseVertexLocation;
+	boxRenderItem->Bounds = boxRenderItem->Geo->DrawArgs["box"].Bounds;
 
 	m_renderItemLayer[(int)RenderLayer::AlphaTested].push_back(boxRenderItem.get());
 
@@ -972,17 +1211,40 @@ void ShapesApp::BuildRenderItems() { auto wavesRenderItem = std::make_unique<Ren
 	m_allRenderItems.push_back(std::move(boxRenderItem));
 	m_allRenderItems.push_back(std::move(treeSpritesRenderItem));
 	m_allRenderItems.push_back(std::move(testSpritesRenderItem));
+
+	// Give every pair of buffers a small id for the sort key, so the land and
+	// the box, which share pool arenas, sort as one geometry.
+	std::map<std::pair<ID3D12Resource*, ID3D12Resource*>, std::uint32_t> bufferIds;
+	for (auto& e : m_allRenderItems)
+	{
+		auto buffers = std::make_pair(e->Geo->VertexBufferGPU.Get(), e->Geo->IndexBufferGPU.Get());
+		m_geometrySortIds[e->Geo] = bufferIds.emplace(buffers, (std::uint32_t)bufferIds.size()).first->second;
+	}
 }
 
 void ShapesApp::BuildFrameResources() {
+	std::uint32_t workerCount = ThreadPool::Default().Concurrency();
+	if (workerCount > m_maxRecordingWorkers)
+		workerCount = m_maxRecordingWorkers;
+
 	for (int i = 0; i < gNumFrameResources; ++i)
 	{
 		m_frameResources.push_back(std::make_unique<FrameResource>(m_device.Get(),
-			1, (UINT)m_allRenderItems.size(), (UINT)m_materials.size(), m_waves->VertexCount()));
+			1, (UINT)m_allRenderItems.size(), (UINT)m_materials.size(), m_waves->VertexCount(), workerCount));
+	}
+
+	std::vector<CommandBackend*> backends;
+	for (std::uint32_t i = 0; i < workerCount; ++i)
+	{
+		m_workerBackends.push_back(std::make_unique<D3D12CommandBackend>());
+		backends.push_back(m_workerBackends.back().get());
 	}
+	m_parallelRecorder.SetBackends(backends);
 }
 
-void ShapesApp::BuildPSOs() { 
+void ShapesApp::BuildPSOs(ThreadPool* pool) {
+	std::vector<PipelineSource> pipelines;
+
 	// PSO for opaque objects.
 	D3D12_GRAPHICS_PIPELINE_STATE_DESC opaquePsoDesc;
 
@@ -1009,7 +1271,7 @@ void ShapesApp::BuildPSOs() {
 	opaquePsoDesc.SampleDesc.Count = m_4xMsaaState ? 4 : 1;
 	opaquePsoDesc.SampleDesc.Quality = m_4xMsaaState ? (m_4xMsaaQuality - 1) : 0;
 	opaquePsoDesc.DSVFormat = m_depthStencilFormat;
-	ThrowIfFailed(m_device->CreateGraphicsPipelineState(&opaquePsoDesc, IID_PPV_ARGS(&m_PSOs["opaque"])));
+	pipelines.push_back({ "opaque", opaquePsoDesc });
 
 	// PSO for transparent objects.
 	D3D12_GRAPHICS_PIPELINE_STATE_DESC transparentPsoDesc = opaquePsoDesc;
@@ -1027,7 +1289,7 @@ void ShapesApp::BuildPSOs() {
 	transparencyBlendDesc.RenderTargetWriteMask = D3D12_COLOR_WRITE_ENABLE_ALL;
 
 	transparentPsoDesc.BlendState.RenderTarget[0] = transparencyBlendDesc;
-	ThrowIfFailed(m_device->CreateGraphicsPipelineState(&transparentPsoDesc, IID_PPV_ARGS(&m_PSOs["transparent"])));
+	pipelines.push_back({ "transparent", transparentPsoDesc });
 
 	// PSO for alpha tested objects
 	D3D12_GRAPHICS_PIPELINE_STATE_DESC alphaTestedPsoDesc = opaquePsoDesc;
@@ -1036,7 +1298,7 @@ void ShapesApp::BuildPSOs() {
 		m_shaders["alphaTestedPS"]->GetBufferSize()
 	};
 	alphaTestedPsoDesc.RasterizerState.CullMode = D3D12_CULL_MODE_NONE;
-	ThrowIfFailed(m_device->CreateGraphicsPipelineState(&alphaTestedPsoDesc, IID_PPV_ARGS(&m_PSOs["alphaTested"])));
+	pipelines.push_back({ "alphaTested", alphaTestedPsoDesc });
 
 	// PSO for tree sprites
 	D3D12_GRAPHICS_PIPELINE_STATE_DESC treeSpritePsoDesc = opaquePsoDesc;
@@ -1058,7 +1320,7 @@ void ShapesApp::BuildPSOs() {
 	treeSpritePsoDesc.PrimitiveTopologyType = D3D12_PRIMITIVE_TOPOLOGY_TYPE_POINT;
 	treeSpritePsoDesc.InputLayout = { m_treeSpriteInputLayout.data(), (UINT)m_treeSpriteInputLayout.size() };
 	treeSpritePsoDesc.RasterizerState.CullMode = D3D12_CULL_MODE_NONE;
-	ThrowIfFailed(m_device->CreateGraphicsPipelineState(&treeSpritePsoDesc, IID_PPV_ARGS(&m_PSOs["treeSprites"])));
+	pipelines.push_back({ "treeSprites", treeSpritePsoDesc });
 
 	// PSO for test trees
 	D3D12_GRAPHICS_PIPELINE_STATE_DESC testSpritePsoDesc = treeSpritePsoDesc;
@@ -1077,5 +1339,25 @@ void ShapesApp::BuildPSOs() {
 		reinterpret_cast<BYTE*>(m_shaders["testTreeSpritePS"]->GetBufferPointer()),
 		m_shaders["testTreeSpritePS"]->GetBufferSize()
 	};
-	ThrowIfFailed(m_device->CreateGraphicsPipelineState(&testSpritePsoDesc, IID_PPV_ARGS(&m_PSOs["testSprites"])));
+	pipelines.push_back({ "testSprites", testSpritePsoDesc });
+
+	CreatePipelineStates(m_device.Get(), pipelines, m_PSOs, pool);
+
+	const std::array<std::pair<RenderLayer, const char*>, m_layerCount> layerPSOs =
+	{ {
+		{ RenderLayer::Opaque, "opaque" },
+		{ RenderLayer::Transparent, "transparent" },
+		{ RenderLayer::AlphaTested, "alphaTested" },
+		{ RenderLayer::AlphaTestedTreeSprites, "treeSprites" },
+		{ RenderLayer::AlphaTestedTestSprites, "testSprites" }
+	} };
+
+	for (int layer = 0; layer < m_layerCount; ++layer)
+	{
+		for (auto& e : layerPSOs)
+		{
+			if (e.first == m_layerDrawOrder[layer])
+				m_layerPSOs[layer] = m_PSOs[e.second].Get();
+		}
+	}
 }
\ No newline at end of file
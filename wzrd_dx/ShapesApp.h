@@ -9,6 +9,14 @@
 #include "Texture.h"
 #include "DDSTextureLoader.h"
 #include "Camera.h"
+#include "DrawSort.h"
+#include "D3D12CommandBackend.h"
+#include "InstanceBatcher.h"
+#include "ParallelCommandRecorder.h"
+#include "MeshLod.h"
+#include "GeometryPool.h"
+#include "ParallelStartup.h"
+#include "TextureStreamer.h"
 
 using Microsoft::WRL::ComPtr;
 
@@ -40,6 +48,13 @@ struct RenderItem
 	UINT IndexCount = 0;
 	UINT StartIndexLocation = 0;
 	int BaseVertexLocation = 0;
+
+	// Optional LOD chain, selected from the distance to Bounds (local space),
+	// which also picks the mip streamed for the texture of Mat. The draw
+	// arguments above follow the selected level.
+	BoundingBox Bounds;
+	const LodChain* Lods = nullptr;
+	std::uint32_t CurrentLod = 0;
 };
 
 class ShapesApp : public AbstractRenderer {
@@ -48,24 +63,29 @@ public:
 	void update(GameTimer& m_gameTimer);
 	void render();
 	virtual void resize(float aspectRatio);
-	void LoadTextures();
+	void LoadTextures(CommandListSet& uploadLists, ThreadPool* pool);
 	void BuildRootSignature();
-	void BuildShadersAndInputLayout();
-	void BuildLandGeometry();
-	void BuildBoxGeometry();
-	void BuildWavesGeometryBuffers();
+	void BuildShadersAndInputLayout(ThreadPool* pool);
+	void BuildLandGeometry(ID3D12GraphicsCommandList* cmdList);
+	void BuildBoxGeometry(ID3D12GraphicsCommandList* cmdList);
+	void BuildWavesGeometryBuffers(ID3D12GraphicsCommandList* cmdList);
 	void BuildDescriptorHeaps();
 	void BuildMaterials();
-	void BuildTreeSpritesGeometry();
-	void BuildTestSpriteGeometry();
+	void BuildTreeSpritesGeometry(ID3D12GraphicsCommandList* cmdList);
+	void BuildTestSpriteGeometry(ID3D12GraphicsCommandList* cmdList);
 	
 	float GetHillsHeight(float x, float y) const;
 	DirectX::XMFLOAT3 GetHillsNormal(float x, float z) const;
 
-	void DrawRenderItems(ID3D12GraphicsCommandList* cmdList, const std::vector<RenderItem*>& renderItems);
+	void UpdateLods();
+	void BindStreamedTextures();
+	void UpdateTextureStreaming();
+	void BuildDrawList();
+	void UpdateInstanceBuffer();
+	void DrawSortedRenderItems(CommandRecorder& recorder, std::uint32_t firstBatch, std::uint32_t lastBatch);
 	void BuildRenderItems();
 	void BuildFrameResources();
-	void BuildPSOs();
+	void BuildPSOs(ThreadPool* pool);
 
 	void OnMouseDown(WPARAM btnState, int x, int y);
 	void OnMouseUp(WPARAM btnState, int x, int y);
@@ -85,9 +105,13 @@ public:
 
 	std::unordered_map<std::string, ComPtr<ID3DBlob>> m_shaders;
 	std::unordered_map<std::string, std::unique_ptr<MeshGeometry>> m_geometries;
-	std::unordered_map<std::string, std::unique_ptr<Texture>> m_textures;
+	// Static meshes only: the waves and particles swap their vertex buffers every frame.
+	std::unique_ptr<GeometryPool> m_geometryPool;
+	std::unique_ptr<TextureStreamer> m_textureStreamer;
 	std::unordered_map<std::string, ComPtr<ID3D12PipelineState>> m_PSOs;
 	std::unordered_map<std::string, std::unique_ptr<Material>> m_materials;
+	// LOD chains by base submesh name.
+	std::unordered_map<std::string, LodChain> m_lodChains;
 
 	std::vector<std::unique_ptr<FrameResource>> m_frameResources;
 	
@@ -99,6 +123,9 @@ public:
 	std::vector<std::unique_ptr<RenderItem>> m_allRenderItems;
 
 	Camera m_camera;
+
+	const DrawStats& GetDrawStats() const { return m_drawStats; }
+	double GetRecordMilliseconds() const { return m_parallelRecorder.LastRecordMilliseconds(); }
 private:
 	int m_currentFrameResourceIndex = 0;
 	FrameResource* m_currentFrameResource = nullptr;
@@ -106,4 +133,46 @@ private:
 	UINT m_cbvSrvDescriptorSize = 0;
 	float m_sunTheta = 1.25f * XM_PI;
 	float m_sunPhi = XM_PIDIV4;
+
+	// Largest on-screen error, in pixels, a LOD may have.
+	float m_lodMaxPixelError = 1.0f;
+
+	// Texture each material samples.
+	std::unordered_map<Material*, TextureStreamer::TextureId> m_materialTextures;
+	// 0 lets the streamer size it from the textures: their tails plus the
+	// largest full chain and the level it replaces. That is below what they all
+	// take with every mip, so the ones out of view give their memory to the ones
+	// in view.
+	std::uint64_t m_textureBudgetBytes = 0;
+
+	// Layers in the order they are submitted. The position in this array is the
+	// layer field of the sort key, and each layer has a single PSO.
+	static const int m_layerCount = (int)RenderLayer::Count;
+	RenderLayer m_layerDrawOrder[m_layerCount] = {
+		RenderLayer::Opaque,
+		RenderLayer::AlphaTested,
+		RenderLayer::AlphaTestedTreeSprites,
+		RenderLayer::AlphaTestedTestSprites,
+		RenderLayer::Transparent
+	};
+	ID3D12PipelineState* m_layerPSOs[m_layerCount] = {};
+	// Layers drawn with Default.hlsl read their transforms from the instance
+	// buffer and can be batched. The sprite shaders still use cbPerObject.
+	bool m_layerInstanced[m_layerCount] = { true, true, false, false, true };
+
+	std::unordered_map<const MeshGeometry*, std::uint32_t> m_geometrySortIds;
+	SubmeshSortIds m_submeshSortIds;
+	std::vector<RenderItem*> m_drawItems;
+	std::vector<SortedDraw> m_drawList;
+	std::vector<SortedDraw> m_drawListScratch;
+	InstanceBatcher m_instanceBatcher;
+
+	// One backend per worker list in the frame resources.
+	static const std::uint32_t m_maxRecordingWorkers = 4;
+	std::vector<std::unique_ptr<D3D12CommandBackend>> m_workerBackends;
+	ParallelCommandRecorder m_parallelRecorder;
+	DrawStats m_drawStats;
+
+	// Runs the startup graph on one thread when false.
+	bool m_parallelStartup = true;
 };
\ No newline at end of file
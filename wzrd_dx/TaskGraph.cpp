@@ -0,0 +1,154 @@
+#include "TaskGraph.h"
+#include <cassert>
+#include <chrono>
+#include <exception>
+
+namespace {
+
+using Clock = std::chrono::high_resolution_clock;
+
+double MillisecondsSince(Clock::time_point start) {
+	return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+}
+
+struct TaskGraph::RunState {
+	std::vector<Task>* Tasks = nullptr;
+	ThreadPool* Pool = nullptr;
+	Clock::time_point Start;
+
+	std::mutex Mutex;
+	std::condition_variable TaskFinished;
+	// Unfinished dependencies per task.
+	std::vector<std::uint32_t> Waiting;
+	std::vector<bool> Skipped;
+	std::uint32_t Remaining = 0;
+	std::uint64_t FinishedCount = 0;
+	std::exception_ptr Error;
+};
+
+TaskGraph::TaskId TaskGraph::Add(const std::string& name, std::function<void()> fn, std::initializer_list<TaskId> dependencies) {
+	TaskId id = (TaskId)m_tasks.size();
+	for (TaskId dependency : dependencies)
+	{
+		assert(dependency < id);
+		m_tasks[dependency].Dependents.push_back(id);
+	}
+
+	Task task;
+	task.Name = name;
+	task.Fn = std::move(fn);
+	task.DependencyCount = (std::uint32_t)dependencies.size();
+	m_tasks.push_back(std::move(task));
+	return id;
+}
+
+void TaskGraph::RunTask(const std::shared_ptr<RunState>& state, TaskId id) {
+	Task& task = (*state->Tasks)[id];
+
+	bool skipped;
+	{
+		std::lock_guard<std::mutex> lock(state->Mutex);
+		skipped = state->Skipped[id];
+	}
+
+	double start = MillisecondsSince(state->Start);
+	bool failed = false;
+	if (!skipped)
+	{
+		try
+		{
+			task.Fn();
+		}
+		catch (...)
+		{
+			failed = true;
+			std::lock_guard<std::mutex> lock(state->Mutex);
+			if (!state->Error)
+				state->Error = std::current_exception();
+		}
+	}
+	double end = MillisecondsSince(state->Start);
+
+	std::vector<TaskId> ready;
+	{
+		std::lock_guard<std::mutex> lock(state->Mutex);
+		task.Timing.StartMilliseconds = start;
+		task.Timing.EndMilliseconds = end;
+		task.Timing.Ran = !skipped;
+
+		for (TaskId dependent : task.Dependents)
+		{
+			if (skipped || failed)
+				state->Skipped[dependent] = true;
+			if (--state->Waiting[dependent] == 0)
+				ready.push_back(dependent);
+		}
+
+		--state->Remaining;
+		++state->FinishedCount;
+		state->TaskFinished.notify_all();
+	}
+
+	// Serial runs go through the tasks in order, so nothing needs queueing.
+	if (state->Pool)
+	{
+		for (TaskId next : ready)
+			state->Pool->Submit([state, next] { RunTask(state, next); });
+	}
+}
+
+void TaskGraph::Run(ThreadPool* pool) {
+	auto state = std::make_shared<RunState>();
+	state->Tasks = &m_tasks;
+	state->Pool = pool;
+	state->Skipped.assign(m_tasks.size(), false);
+	state->Remaining = (std::uint32_t)m_tasks.size();
+	for (Task& task : m_tasks)
+	{
+		state->Waiting.push_back(task.DependencyCount);
+		task.Timing = TaskTiming();
+	}
+	state->Start = Clock::now();
+
+	if (!pool)
+	{
+		for (TaskId id = 0; id < (TaskId)m_tasks.size(); ++id)
+			RunTask(state, id);
+	}
+	else
+	{
+		for (TaskId id = 0; id < (TaskId)m_tasks.size(); ++id)
+		{
+			if (m_tasks[id].DependencyCount == 0)
+				pool->Submit([state, id] { RunTask(state, id); });
+		}
+
+		// Help with whatever is queued, and sleep until the next task finishes
+		// when there is nothing to pick up.
+		std::unique_lock<std::mutex> lock(state->Mutex);
+		while (state->Remaining > 0)
+		{
+			std::uint64_t finishedCount = state->FinishedCount;
+			lock.unlock();
+			bool ranTask = pool->RunPendingTask();
+			lock.lock();
+
+			if (!ranTask)
+				state->TaskFinished.wait(lock, [&] { return state->FinishedCount != finishedCount; });
+		}
+	}
+
+	m_lastRunMilliseconds = MillisecondsSince(state->Start);
+
+	if (state->Error)
+		std::rethrow_exception(state->Error);
+}
+
+double TaskGraph::LastWorkMilliseconds() const {
+	double total = 0.0;
+	for (const Task& task : m_tasks)
+		total += task.Timing.EndMilliseconds - task.Timing.StartMilliseconds;
+	return total;
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include "ThreadPool.h"
+#include <cstdint>
+#include <functional>
+#include <initializer_list>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Tasks with dependencies, run on a thread pool as soon as everything they
+// depend on has finished. Tasks that do not depend on each other may run at the
+// same time, so they must not touch the same data without a lock.
+class TaskGraph {
+public:
+	using TaskId = std::uint32_t;
+
+	// Start and end of a task in the last Run, relative to its start.
+	struct TaskTiming {
+		double StartMilliseconds = 0.0;
+		double EndMilliseconds = 0.0;
+		bool Ran = false;
+	};
+
+	// Dependencies must have been added before, so the order of the Add calls
+	// is always a valid serial order.
+	TaskId Add(const std::string& name, std::function<void()> fn, std::initializer_list<TaskId> dependencies = {});
+
+	// Runs every task once and returns when all are done. The calling thread runs
+	// queued tasks while it waits. A null pool runs the tasks one after another in
+	// the order they were added.
+	// When a task throws, the tasks that depend on it are skipped, the others
+	// still run, and the first exception is rethrown at the end.
+	void Run(ThreadPool* pool);
+
+	std::uint32_t TaskCount() const { return (std::uint32_t)m_tasks.size(); }
+	const std::string& TaskName(TaskId task) const { return m_tasks[task].Name; }
+	const TaskTiming& Timing(TaskId task) const { return m_tasks[task].Timing; }
+
+	// Wall time of the last Run, and the time its tasks took added up.
+	double LastRunMilliseconds() const { return m_lastRunMilliseconds; }
+	double LastWorkMilliseconds() const;
+
+private:
+	struct Task {
+		std::string Name;
+		std::function<void()> Fn;
+		std::vector<TaskId> Dependents;
+		std::uint32_t DependencyCount = 0;
+		TaskTiming Timing;
+	};
+
+	struct RunState;
+	static void RunTask(const std::shared_ptr<RunState>& state, TaskId task);
+
+	std::vector<Task> m_tasks;
+	double m_lastRunMilliseconds = 0.0;
+};
@@ -0,0 +1,193 @@
+#include "TerrainGenerator.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+using namespace DirectX;
+
+namespace {
+
+// Rows generated by one task. Enough work per task to hide the scheduling cost,
+// few enough that large grids split across every thread.
+const std::uint32_t RowsPerBand = 32;
+
+void ForEachTask(ThreadPool* pool, std::uint32_t count, const std::function<void(std::uint32_t)>& fn) {
+	if (pool && count > 1)
+	{
+		pool->ParallelFor(count, fn);
+		return;
+	}
+
+	for (std::uint32_t i = 0; i < count; ++i)
+		fn(i);
+}
+
+template<typename Index>
+void WriteGridIndices(std::uint32_t rows, std::uint32_t columns, std::uint32_t stripWidth, Index* indices, ThreadPool* pool) {
+	if (rows < 2 || columns < 2)
+		return;
+
+	std::uint32_t cellRows = rows - 1;
+	std::uint32_t cellColumns = columns - 1;
+	stripWidth = std::max<std::uint32_t>(stripWidth, 1);
+	std::uint32_t stripCount = (cellColumns + stripWidth - 1) / stripWidth;
+
+	// Every strip but the last is stripWidth cells wide, so a strip's first index
+	// follows from its number.
+	ForEachTask(pool, stripCount, [=](std::uint32_t s) {
+		std::uint32_t firstColumn = s * stripWidth;
+		std::uint32_t lastColumn = std::min<std::uint32_t>(firstColumn + stripWidth, cellColumns);
+		Index* out = indices + (std::size_t)6 * cellRows * firstColumn;
+
+		for (std::uint32_t i = 0; i < cellRows; ++i)
+		{
+			for (std::uint32_t j = firstColumn; j < lastColumn; ++j)
+			{
+				std::uint32_t v00 = i * columns + j;
+				std::uint32_t v10 = v00 + columns;
+
+				*out++ = (Index)v00;
+				*out++ = (Index)(v00 + 1);
+				*out++ = (Index)v10;
+
+				*out++ = (Index)v10;
+				*out++ = (Index)(v00 + 1);
+				*out++ = (Index)(v10 + 1);
+			}
+		}
+	});
+}
+
+}
+
+float HillsHeight(const HillsTerrainDesc& desc, float x, float z) {
+	return desc.Amplitude * (z * sinf(desc.Frequency * x) + x * cosf(desc.Frequency * z));
+}
+
+XMFLOAT3 HillsNormal(const HillsTerrainDesc& desc, float x, float z) {
+	float a = desc.Amplitude;
+	float f = desc.Frequency;
+	XMFLOAT3 n(
+		-a * f * z * cosf(f * x) - a * cosf(f * z),
+		1.0f,
+		-a * sinf(f * x) + a * f * x * sinf(f * z)
+	);
+
+	XMStoreFloat3(&n, XMVector3Normalize(XMLoadFloat3(&n)));
+	return n;
+}
+
+void GenerateHillsVertices(const HillsTerrainDesc& desc, void* vertices, const TerrainVertexLayout& layout, ThreadPool* pool) {
+	std::uint32_t m = desc.Rows;
+	std::uint32_t n = desc.Columns;
+	if (m < 2 || n < 2)
+		return;
+
+	float halfWidth = 0.5f * desc.Width;
+	float halfDepth = 0.5f * desc.Depth;
+	float dx = desc.Width / (n - 1);
+	float dz = desc.Depth / (m - 1);
+	float du = 1.0f / (n - 1);
+	float dv = 1.0f / (m - 1);
+	float a = desc.Amplitude;
+	float f = desc.Frequency;
+
+	// Per column x, u, sin(f x) and cos(f x), padded to whole vectors.
+	std::uint32_t paddedColumns = (n + 3) & ~3u;
+	std::vector<float> columnX(paddedColumns, 0.0f);
+	std::vector<float> columnU(paddedColumns, 0.0f);
+	std::vector<float> columnSin(paddedColumns);
+	std::vector<float> columnCos(paddedColumns);
+
+	for (std::uint32_t j = 0; j < n; ++j)
+	{
+		columnX[j] = -halfWidth + j * dx;
+		columnU[j] = j * du;
+	}
+
+	for (std::uint32_t j = 0; j < paddedColumns; j += 4)
+	{
+		XMVECTOR sinX, cosX;
+		XMVectorSinCos(&sinX, &cosX, XMVectorScale(XMLoadFloat4((const XMFLOAT4*)&columnX[j]), f));
+		XMStoreFloat4((XMFLOAT4*)&columnSin[j], sinX);
+		XMStoreFloat4((XMFLOAT4*)&columnCos[j], cosX);
+	}
+
+	std::uint8_t* base = (std::uint8_t*)vertices;
+	std::uint32_t bandCount = (m + RowsPerBand - 1) / RowsPerBand;
+
+	ForEachTask(pool, bandCount, [&](std::uint32_t band) {
+		std::uint32_t firstRow = band * RowsPerBand;
+		std::uint32_t lastRow = std::min<std::uint32_t>(firstRow + RowsPerBand, m);
+
+		for (std::uint32_t i = firstRow; i < lastRow; ++i)
+		{
+			float z = halfDepth - i * dz;
+			float v = i * dv;
+			float sinZ = sinf(f * z);
+			float cosZ = cosf(f * z);
+
+			// h  = a z sin(f x) + a cos(f z) x
+			// nx = -a f z cos(f x) - a cos(f z)
+			// nz = -a sin(f x) + a f sin(f z) x
+			XMVECTOR heightSin = XMVectorReplicate(a * z);
+			XMVECTOR heightX = XMVectorReplicate(a * cosZ);
+			XMVECTOR normalXCos = XMVectorReplicate(-a * f * z);
+			XMVECTOR normalX = XMVectorReplicate(-a * cosZ);
+			XMVECTOR normalZSin = XMVectorReplicate(-a);
+			XMVECTOR normalZX = XMVectorReplicate(a * f * sinZ);
+			XMVECTOR one = XMVectorSplatOne();
+
+			std::uint8_t* row = base + (std::size_t)i * n * layout.Stride;
+
+			for (std::uint32_t j = 0; j < n; j += 4)
+			{
+				XMVECTOR x = XMLoadFloat4((const XMFLOAT4*)&columnX[j]);
+				XMVECTOR sinX = XMLoadFloat4((const XMFLOAT4*)&columnSin[j]);
+				XMVECTOR cosX = XMLoadFloat4((const XMFLOAT4*)&columnCos[j]);
+
+				XMVECTOR h = XMVectorMultiplyAdd(heightSin, sinX, XMVectorMultiply(heightX, x));
+				XMVECTOR nx = XMVectorMultiplyAdd(normalXCos, cosX, normalX);
+				XMVECTOR nz = XMVectorMultiplyAdd(normalZSin, sinX, XMVectorMultiply(normalZX, x));
+
+				XMVECTOR lengthSq = XMVectorMultiplyAdd(nx, nx, XMVectorMultiplyAdd(nz, nz, one));
+				XMVECTOR invLength = XMVectorDivide(one, XMVectorSqrt(lengthSq));
+
+				XMFLOAT4A heights, normalsX, normalsY, normalsZ;
+				XMStoreFloat4A(&heights, h);
+				XMStoreFloat4A(&normalsX, XMVectorMultiply(nx, invLength));
+				XMStoreFloat4A(&normalsY, invLength);
+				XMStoreFloat4A(&normalsZ, XMVectorMultiply(nz, invLength));
+
+				const float* hs = &heights.x;
+				const float* nxs = &normalsX.x;
+				const float* nys = &normalsY.x;
+				const float* nzs = &normalsZ.x;
+
+				std::uint32_t count = std::min<std::uint32_t>(4, n - j);
+				for (std::uint32_t k = 0; k < count; ++k)
+				{
+					std::uint8_t* out = row + (std::size_t)(j + k) * layout.Stride;
+					*(XMFLOAT3*)(out + layout.PositionOffset) = XMFLOAT3(columnX[j + k], hs[k], z);
+					*(XMFLOAT3*)(out + layout.NormalOffset) = XMFLOAT3(nxs[k], nys[k], nzs[k]);
+					*(XMFLOAT2*)(out + layout.TexCOffset) = XMFLOAT2(columnU[j + k], v);
+				}
+			}
+		}
+	});
+}
+
+std::size_t GridIndexCount(std::uint32_t rows, std::uint32_t columns) {
+	if (rows < 2 || columns < 2)
+		return 0;
+	return (std::size_t)6 * (rows - 1) * (columns - 1);
+}
+
+void GenerateGridIndices(std::uint32_t rows, std::uint32_t columns, std::uint32_t stripWidth, std::uint16_t* indices, ThreadPool* pool) {
+	WriteGridIndices(rows, columns, stripWidth, indices, pool);
+}
+
+void GenerateGridIndices(std::uint32_t rows, std::uint32_t columns, std::uint32_t stripWidth, std::uint32_t* indices, ThreadPool* pool) {
+	WriteGridIndices(rows, columns, stripWidth, indices, pool);
+}
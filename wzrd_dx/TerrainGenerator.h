@@ -0,0 +1,51 @@
+#pragma once
+
+#include <DirectXMath.h>
+#include <cstddef>
+#include <cstdint>
+
+class ThreadPool;
+
+// Where the terrain generator writes each attribute in the caller's vertices.
+// Positions and normals are float3, texture coordinates float2.
+struct TerrainVertexLayout {
+	std::size_t Stride = 0;
+	std::size_t PositionOffset = 0;
+	std::size_t NormalOffset = 0;
+	std::size_t TexCOffset = 0;
+};
+
+// Grid of hills, y = Amplitude * (z * sin(Frequency * x) + x * cos(Frequency * z)),
+// laid out like GeometryGenerator::CreateGrid: Rows vertices from +z to -z,
+// Columns vertices from -x to +x, and the texture stretched over the grid.
+struct HillsTerrainDesc {
+	float Width = 160.0f;
+	float Depth = 160.0f;
+	std::uint32_t Rows = 50;
+	std::uint32_t Columns = 50;
+	float Amplitude = 0.3f;
+	float Frequency = 0.1f;
+};
+
+float HillsHeight(const HillsTerrainDesc& desc, float x, float z);
+DirectX::XMFLOAT3 HillsNormal(const HillsTerrainDesc& desc, float x, float z);
+
+// Writes the Rows x Columns vertices of the terrain, row by row. The height is
+// separable in x and z, so sin and cos are evaluated once per column and once
+// per row, and the vertices are then computed four columns at a time. With a
+// pool, bands of rows are generated in parallel.
+void GenerateHillsVertices(const HillsTerrainDesc& desc, void* vertices, const TerrainVertexLayout& layout, ThreadPool* pool = nullptr);
+
+// Cells per strip for GenerateGridIndices. Two rows of a strip fit in a
+// 16-entry post-transform cache.
+const std::uint32_t DefaultGridStripWidth = 7;
+
+std::size_t GridIndexCount(std::uint32_t rows, std::uint32_t columns);
+
+// Triangles of a rows x columns vertex grid with CreateGrid's winding, in
+// vertical strips of stripWidth cells that are each walked row by row. A row of
+// cells reuses the vertices the row above it brought into the cache, so each
+// vertex is transformed about once per strip it touches. With a pool, strips
+// are written in parallel.
+void GenerateGridIndices(std::uint32_t rows, std::uint32_t columns, std::uint32_t stripWidth, std::uint16_t* indices, ThreadPool* pool = nullptr);
+void GenerateGridIndices(std::uint32_t rows, std::uint32_t columns, std::uint32_t stripWidth, std::uint32_t* indices, ThreadPool* pool = nullptr);
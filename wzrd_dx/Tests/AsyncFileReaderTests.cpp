@@ -0,0 +1,267 @@
+#include "AsyncFileReader.h"
+#include "Check.h"
+#include "MappedFile.h"
+#include <algorithm>
+#include <condition_variable>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace {
+
+using ReadStatus = AsyncFileReader::ReadStatus;
+
+const char* const Paths[] = { "Textures/grass.dds", "Textures/treeArray2.dds", "Textures/water1.dds", "Textures/white1x1.dds" };
+
+// Holds the only worker of a pool until released, so reads submitted to it
+// stay queued.
+class PoolBlocker {
+public:
+	explicit PoolBlocker(ThreadPool& pool) {
+		pool.Submit([this] {
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_started = true;
+			m_changed.notify_all();
+			m_changed.wait(lock, [this] { return m_released; });
+		});
+
+		std::unique_lock<std::mutex> lock(m_mutex);
+		m_changed.wait(lock, [this] { return m_started; });
+	}
+
+	void Release() {
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_released = true;
+		m_changed.notify_all();
+	}
+
+private:
+	std::mutex m_mutex;
+	std::condition_variable m_changed;
+	bool m_started = false;
+	bool m_released = false;
+};
+
+// Every file read in 64 KB chunks, all queued and submitted in one batch, on
+// the pool and inline.
+void TestBatchedSubmit() {
+	ThreadPool pool(2);
+	for (ThreadPool* readPool : { &pool, (ThreadPool*)nullptr })
+	{
+		AsyncFileReader reader(AsyncFileReader::Backend::ThreadPool, readPool);
+		CHECK(reader.GetBackend() == AsyncFileReader::Backend::ThreadPool);
+
+		const std::uint32_t chunkSize = 64 * 1024;
+		std::vector<MappedFile> expected(sizeof(Paths) / sizeof(Paths[0]));
+		std::vector<std::vector<std::uint8_t>> buffers(expected.size());
+		std::uint32_t queued = 0;
+		std::uint32_t completed = 0;
+
+		for (std::size_t i = 0; i < expected.size(); ++i)
+		{
+			CHECK(expected[i].Open(std::string(Paths[i])));
+			AsyncFileReader::FileId file = reader.Open(std::string(Paths[i]));
+			CHECK(file != AsyncFileReader::InvalidFile);
+			if (file == AsyncFileReader::InvalidFile || !expected[i].IsOpen())
+				continue;
+			CHECK(reader.FileSize(file) == expected[i].Size());
+
+			buffers[i].resize((std::size_t)reader.FileSize(file));
+			for (std::uint64_t offset = 0; offset < reader.FileSize(file); offset += chunkSize)
+			{
+				std::uint32_t size = (std::uint32_t)std::min<std::uint64_t>(chunkSize, reader.FileSize(file) - offset);
+				AsyncFileReader::ReadRequest request;
+				request.File = file;
+				request.Offset = offset;
+				request.Size = size;
+				request.Buffer = buffers[i].data() + offset;
+				request.OnComplete = [&completed, size](const AsyncFileReader::ReadResult& result) {
+					CHECK(result.Status == ReadStatus::Done);
+					CHECK(result.BytesRead == size);
+					completed++;
+				};
+				reader.Queue(std::move(request));
+				queued++;
+			}
+		}
+
+		// Nothing is read before Submit.
+		CHECK(reader.InFlight() == 0);
+		CHECK(reader.Poll() == 0);
+
+		reader.Submit();
+		CHECK(reader.InFlight() == queued);
+		reader.WaitAll();
+		CHECK(reader.InFlight() == 0);
+		CHECK(completed == queued);
+
+		for (std::size_t i = 0; i < expected.size(); ++i)
+			CHECK(buffers[i].size() == expected[i].Size() && std::memcmp(buffers[i].data(), expected[i].Data(), expected[i].Size()) == 0);
+	}
+}
+
+// Reads that run past the end come back short, and reads that start there
+// come back empty, without failing.
+void TestShortReadsAtEnd() {
+	MappedFile expected;
+	CHECK(expected.Open(std::string("Textures/grass.dds")));
+	if (!expected.IsOpen())
+		return;
+
+	AsyncFileReader reader(AsyncFileReader::Backend::ThreadPool, nullptr);
+	AsyncFileReader::FileId file = reader.Open(std::string("Textures/grass.dds"));
+	CHECK(file != AsyncFileReader::InvalidFile);
+	if (file == AsyncFileReader::InvalidFile)
+		return;
+	const std::uint64_t size = reader.FileSize(file);
+
+	std::vector<std::uint8_t> buffer(100, 0xcd);
+	std::vector<AsyncFileReader::ReadResult> results(3);
+	const std::uint64_t offsets[] = { size - 10, size, size + 4096 };
+	for (std::size_t i = 0; i < 3; ++i)
+	{
+		AsyncFileReader::ReadRequest request;
+		request.File = file;
+		request.Offset = offsets[i];
+		request.Size = (std::uint32_t)buffer.size();
+		request.Buffer = buffer.data();
+		request.OnComplete = [&results, i](const AsyncFileReader::ReadResult& result) { results[i] = result; };
+		reader.Queue(std::move(request));
+	}
+	reader.Submit();
+	reader.WaitAll();
+
+	CHECK(results[0].Status == ReadStatus::Done && results[0].BytesRead == 10);
+	CHECK(std::memcmp(buffer.data(), expected.Data() + size - 10, 10) == 0);
+	CHECK(buffer[10] == 0xcd);
+	CHECK(results[1].Status == ReadStatus::Done && results[1].BytesRead == 0);
+	CHECK(results[2].Status == ReadStatus::Done && results[2].BytesRead == 0);
+
+	// An unbuffered read of whole sectors into an aligned buffer ends short at
+	// the end of the file, as ReadTextures relies on.
+	AsyncFileReader::FileId unbuffered = reader.Open(std::string("Textures/grass.dds"), true);
+	CHECK(unbuffered != AsyncFileReader::InvalidFile);
+	if (unbuffered == AsyncFileReader::InvalidFile)
+		return;
+	const std::uint64_t sectorSize = reader.SectorSize(unbuffered);
+	const std::uint64_t readSize = (size + sectorSize - 1) / sectorSize * sectorSize;
+	AlignedBuffer aligned((std::size_t)readSize, (std::size_t)sectorSize);
+	CHECK((std::uintptr_t)aligned.Data() % sectorSize == 0);
+
+	AsyncFileReader::ReadResult whole;
+	AsyncFileReader::ReadRequest request;
+	request.File = unbuffered;
+	request.Size = (std::uint32_t)readSize;
+	request.Buffer = aligned.Data();
+	request.OnComplete = [&whole](const AsyncFileReader::ReadResult& result) { whole = result; };
+	reader.Queue(std::move(request));
+	reader.Submit();
+	reader.WaitAll();
+	CHECK(whole.Status == ReadStatus::Done && whole.BytesRead == size);
+	CHECK(std::memcmp(aligned.Data(), expected.Data(), (std::size_t)size) == 0);
+}
+
+AsyncFileReader::ReadId QueueRead(AsyncFileReader& reader, AsyncFileReader::FileId file, std::vector<std::uint8_t>& buffer,
+	AsyncFileReader::ReadResult& result, std::uint32_t& callbacks)
+{
+	AsyncFileReader::ReadRequest request;
+	request.File = file;
+	request.Size = (std::uint32_t)buffer.size();
+	request.Buffer = buffer.data();
+	request.OnComplete = [&result, &callbacks](const AsyncFileReader::ReadResult& r) {
+		result = r;
+		callbacks++;
+	};
+	return reader.Queue(std::move(request));
+}
+
+void TestCancel() {
+	ThreadPool pool(1);
+	AsyncFileReader reader(AsyncFileReader::Backend::ThreadPool, &pool);
+	AsyncFileReader::FileId file = reader.Open(std::string("Textures/water1.dds"));
+	CHECK(file != AsyncFileReader::InvalidFile);
+	if (file == AsyncFileReader::InvalidFile)
+		return;
+
+	std::vector<std::uint8_t> buffer(1024, 0xcd);
+	AsyncFileReader::ReadResult result;
+	std::uint32_t callbacks = 0;
+
+	// Before Submit: completes as cancelled without touching the buffer, and
+	// the next Submit does not issue it.
+	AsyncFileReader::ReadId read = QueueRead(reader, file, buffer, result, callbacks);
+	reader.Cancel(read);
+	CHECK(reader.InFlight() == 1);
+	reader.Submit();
+	reader.WaitAll();
+	CHECK(callbacks == 1);
+	CHECK(result.Id == read && result.Status == ReadStatus::Cancelled && result.BytesRead == 0);
+	CHECK(buffer[0] == 0xcd);
+
+	// After Submit, while the read waits for a pool thread.
+	{
+		PoolBlocker blocker(pool);
+		read = QueueRead(reader, file, buffer, result, callbacks);
+		reader.Submit();
+		reader.Cancel(read);
+		blocker.Release();
+		reader.WaitAll();
+	}
+	CHECK(callbacks == 2);
+	CHECK(result.Id == read && result.Status == ReadStatus::Cancelled);
+	CHECK(buffer[0] == 0xcd);
+
+	// After the read finished but before its callback ran: too late, it
+	// completes as done. Without a pool Submit reads on the spot.
+	{
+		AsyncFileReader inlineReader(AsyncFileReader::Backend::ThreadPool, nullptr);
+		AsyncFileReader::FileId inlineFile = inlineReader.Open(std::string("Textures/water1.dds"));
+		read = QueueRead(inlineReader, inlineFile, buffer, result, callbacks);
+		inlineReader.Submit();
+		inlineReader.Cancel(read);
+		CHECK(callbacks == 2);
+		inlineReader.WaitAll();
+
+		// Reads whose callbacks have run are unknown and ignored.
+		inlineReader.Cancel(read);
+	}
+	CHECK(callbacks == 3);
+	CHECK(result.Id == read && result.Status == ReadStatus::Done && result.BytesRead == buffer.size());
+	CHECK(buffer[0] == 'D');
+
+	// CancelAll reaches queued and submitted reads alike.
+	std::vector<std::vector<std::uint8_t>> buffers(4, std::vector<std::uint8_t>(1024, 0xcd));
+	std::vector<AsyncFileReader::ReadResult> results(4);
+	std::uint32_t cancelledCallbacks = 0;
+	{
+		PoolBlocker blocker(pool);
+		QueueRead(reader, file, buffers[0], results[0], cancelledCallbacks);
+		QueueRead(reader, file, buffers[1], results[1], cancelledCallbacks);
+		reader.Submit();
+		QueueRead(reader, file, buffers[2], results[2], cancelledCallbacks);
+		QueueRead(reader, file, buffers[3], results[3], cancelledCallbacks);
+		reader.CancelAll();
+		blocker.Release();
+		reader.Submit();
+		reader.WaitAll();
+	}
+	CHECK(cancelledCallbacks == 4);
+	for (std::size_t i = 0; i < 4; ++i)
+		CHECK(results[i].Status == ReadStatus::Cancelled && buffers[i][0] == 0xcd);
+}
+
+void TestOpenMissingFile() {
+	AsyncFileReader reader(AsyncFileReader::Backend::ThreadPool, nullptr);
+	CHECK(reader.Open(std::string("Textures/missing.dds")) == AsyncFileReader::InvalidFile);
+}
+
+}
+
+int main() {
+	TestBatchedSubmit();
+	TestShortReadsAtEnd();
+	TestCancel();
+	TestOpenMissingFile();
+	return TestResult("AsyncFileReaderTests");
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <cstdio>
+
+// Minimal checks for the headless tests. A failed check prints where it failed
+// and the test exits with a non-zero status from TestResult.
+inline int& TestFailures() {
+	static int failures = 0;
+	return failures;
+}
+
+#define CHECK(condition) \
+	do \
+	{ \
+		if (!(condition)) \
+		{ \
+			std::printf("%s(%d): CHECK(%s) failed\n", __FILE__, __LINE__, #condition); \
+			++TestFailures(); \
+		} \
+	} while (0)
+
+inline int TestResult(const char* name) {
+	if (TestFailures() == 0)
+		std::printf("%s: passed\n", name);
+	else
+		std::printf("%s: %d checks failed\n", name, TestFailures());
+	return TestFailures() == 0 ? 0 : 1;
+}
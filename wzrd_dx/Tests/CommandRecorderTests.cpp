@@ -0,0 +1,165 @@
+#include "Check.h"
+#include "CommandRecorder.h"
+
+namespace {
+
+using CommandType = RecordingCommandBackend::CommandType;
+
+// Stand-ins for API objects; the recorder only compares their addresses.
+int g_rootSignatureA, g_rootSignatureB;
+int g_pipelineA, g_pipelineB;
+
+VertexBufferBinding MakeVertexBuffer(std::uint64_t location) {
+	VertexBufferBinding view;
+	view.BufferLocation = location;
+	view.SizeInBytes = 1024;
+	view.StrideInBytes = 32;
+	return view;
+}
+
+IndexBufferBinding MakeIndexBuffer(std::uint64_t location) {
+	IndexBufferBinding view;
+	view.BufferLocation = location;
+	view.SizeInBytes = 512;
+	view.Format = 57;
+	return view;
+}
+
+void TestRepeatedStateIsDropped() {
+	RecordingCommandBackend backend;
+	CommandRecorder recorder(&backend);
+
+	// Ten draws that bind the same state each time.
+	for (int i = 0; i < 10; ++i)
+	{
+		recorder.SetGraphicsRootSignature(&g_rootSignatureA);
+		recorder.SetPipelineState(&g_pipelineA);
+		recorder.IASetVertexBuffer(MakeVertexBuffer(0x1000));
+		recorder.IASetIndexBuffer(MakeIndexBuffer(0x2000));
+		recorder.IASetPrimitiveTopology(4);
+		recorder.SetGraphicsRootDescriptorTable(0, 0x100);
+		recorder.SetGraphicsRootConstantBufferView(1, 0x3000);
+		recorder.SetGraphicsRootShaderResourceView(4, 0x4000);
+		recorder.SetGraphicsRoot32BitConstant(5, 7);
+		recorder.DrawIndexedInstanced(36, 1, 0, 0, 0);
+	}
+
+	CHECK(backend.CountOf(CommandType::SetGraphicsRootSignature) == 1);
+	CHECK(backend.CountOf(CommandType::SetPipelineState) == 1);
+	CHECK(backend.CountOf(CommandType::IASetVertexBuffer) == 1);
+	CHECK(backend.CountOf(CommandType::IASetIndexBuffer) == 1);
+	CHECK(backend.CountOf(CommandType::IASetPrimitiveTopology) == 1);
+	CHECK(backend.CountOf(CommandType::SetGraphicsRootDescriptorTable) == 1);
+	CHECK(backend.CountOf(CommandType::SetGraphicsRootConstantBufferView) == 1);
+	CHECK(backend.CountOf(CommandType::SetGraphicsRootShaderResourceView) == 1);
+	CHECK(backend.CountOf(CommandType::SetGraphicsRoot32BitConstant) == 1);
+	CHECK(backend.CountOf(CommandType::DrawIndexedInstanced) == 10);
+
+	CHECK(recorder.Stats().DrawCalls == 10);
+	CHECK(recorder.Stats().StateChangesIssued == 9);
+	CHECK(recorder.Stats().StateChangesAvoided == 81);
+}
+
+void TestChangedStateIsForwarded() {
+	RecordingCommandBackend backend;
+	CommandRecorder recorder(&backend);
+
+	recorder.SetPipelineState(&g_pipelineA);
+	recorder.SetPipelineState(&g_pipelineB);
+	recorder.SetPipelineState(&g_pipelineB);
+	CHECK(backend.CountOf(CommandType::SetPipelineState) == 2);
+
+	// Any field of a view that differs makes it a new binding.
+	VertexBufferBinding vertexBuffer = MakeVertexBuffer(0x1000);
+	recorder.IASetVertexBuffer(vertexBuffer);
+	vertexBuffer.StrideInBytes = 16;
+	recorder.IASetVertexBuffer(vertexBuffer);
+	CHECK(backend.CountOf(CommandType::IASetVertexBuffer) == 2);
+
+	IndexBufferBinding indexBuffer = MakeIndexBuffer(0x2000);
+	recorder.IASetIndexBuffer(indexBuffer);
+	indexBuffer.Format = 42;
+	recorder.IASetIndexBuffer(indexBuffer);
+	CHECK(backend.CountOf(CommandType::IASetIndexBuffer) == 2);
+
+	// Root parameters are tracked per slot and per binding type.
+	recorder.SetGraphicsRootDescriptorTable(0, 0x100);
+	recorder.SetGraphicsRootDescriptorTable(0, 0x200);
+	recorder.SetGraphicsRootDescriptorTable(2, 0x200);
+	recorder.SetGraphicsRootConstantBufferView(2, 0x200);
+	CHECK(backend.CountOf(CommandType::SetGraphicsRootDescriptorTable) == 3);
+	CHECK(backend.CountOf(CommandType::SetGraphicsRootConstantBufferView) == 1);
+
+	recorder.SetGraphicsRoot32BitConstant(5, 7, 0);
+	recorder.SetGraphicsRoot32BitConstant(5, 7, 1);
+	CHECK(backend.CountOf(CommandType::SetGraphicsRoot32BitConstant) == 2);
+}
+
+void TestRootSignatureChangeClearsRootArguments() {
+	RecordingCommandBackend backend;
+	CommandRecorder recorder(&backend);
+
+	recorder.SetGraphicsRootSignature(&g_rootSignatureA);
+	recorder.SetGraphicsRootDescriptorTable(0, 0x100);
+	recorder.SetGraphicsRootSignature(&g_rootSignatureB);
+	recorder.SetGraphicsRootDescriptorTable(0, 0x100);
+	CHECK(backend.CountOf(CommandType::SetGraphicsRootSignature) == 2);
+	CHECK(backend.CountOf(CommandType::SetGraphicsRootDescriptorTable) == 2);
+
+	// The pipeline state survives a root signature change.
+	recorder.SetPipelineState(&g_pipelineA);
+	recorder.SetGraphicsRootSignature(&g_rootSignatureA);
+	recorder.SetPipelineState(&g_pipelineA);
+	CHECK(backend.CountOf(CommandType::SetPipelineState) == 1);
+}
+
+void TestInvalidateForgetsState() {
+	RecordingCommandBackend backend;
+	CommandRecorder recorder(&backend);
+
+	recorder.SetGraphicsRootSignature(&g_rootSignatureA);
+	recorder.IASetVertexBuffer(MakeVertexBuffer(0x1000));
+	recorder.IASetPrimitiveTopology(4);
+
+	// A reset command list with g_pipelineA as its initial state.
+	recorder.Invalidate(&g_pipelineA);
+	recorder.SetGraphicsRootSignature(&g_rootSignatureA);
+	recorder.IASetVertexBuffer(MakeVertexBuffer(0x1000));
+	recorder.IASetPrimitiveTopology(4);
+	recorder.SetPipelineState(&g_pipelineA);
+
+	CHECK(backend.CountOf(CommandType::SetGraphicsRootSignature) == 2);
+	CHECK(backend.CountOf(CommandType::IASetVertexBuffer) == 2);
+	CHECK(backend.CountOf(CommandType::IASetPrimitiveTopology) == 2);
+	CHECK(backend.CountOf(CommandType::SetPipelineState) == 0);
+}
+
+void TestForwardedArguments() {
+	RecordingCommandBackend backend;
+	CommandRecorder recorder(&backend);
+
+	recorder.SetGraphicsRoot32BitConstant(5, 11, 2);
+	recorder.DrawIndexedInstanced(36, 4, 12, -3, 8);
+
+	const auto& commands = backend.Commands();
+	CHECK(commands.size() == 2);
+	CHECK(commands[0].RootParameterIndex == 5);
+	CHECK(commands[0].Value == 11);
+	CHECK(commands[0].DestOffset == 2);
+	CHECK(commands[1].IndexCount == 36);
+	CHECK(commands[1].InstanceCount == 4);
+	CHECK(commands[1].StartIndexLocation == 12);
+	CHECK(commands[1].BaseVertexLocation == -3);
+	CHECK(commands[1].StartInstanceLocation == 8);
+}
+
+}
+
+int main() {
+	TestRepeatedStateIsDropped();
+	TestChangedStateIsForwarded();
+	TestRootSignatureChangeClearsRootArguments();
+	TestInvalidateForgetsState();
+	TestForwardedArguments();
+	return TestResult("CommandRecorderTests");
+}
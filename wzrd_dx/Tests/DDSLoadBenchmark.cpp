@@ -0,0 +1,158 @@
+#include "AsyncFileReader.h"
+#include "DDSParser.h"
+#include "MappedFile.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#ifdef _WIN32
+#include <windows.h>
+#include <psapi.h>
+#pragma comment(lib, "psapi.lib")
+#else
+#include <sys/resource.h>
+#endif
+
+namespace {
+
+const char* const TexturePaths[] = {
+	"Textures/bricks3.dds", "Textures/checkboard.dds", "Textures/grass.dds", "Textures/ice.dds", "Textures/tree01S.dds",
+	"Textures/treeArray2.dds", "Textures/water1.dds", "Textures/white1x1.dds", "Textures/WireFence.dds", "Textures/WoodCrate01.dds",
+};
+const std::uint32_t TextureCount = sizeof(TexturePaths) / sizeof(TexturePaths[0]);
+
+double NowMilliseconds() {
+	return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+template<typename Run>
+double BestMilliseconds(int repeats, Run run) {
+	double best = 1e30;
+	for (int r = 0; r < repeats; ++r)
+	{
+		double start = NowMilliseconds();
+		run();
+		best = std::min(best, NowMilliseconds() - start);
+	}
+	return best;
+}
+
+// Peak resident set of the process so far.
+std::size_t PeakResidentBytes() {
+#ifdef _WIN32
+	PROCESS_MEMORY_COUNTERS counters;
+	return GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)) ? counters.PeakWorkingSetSize : 0;
+#else
+	struct rusage usage;
+	getrusage(RUSAGE_SELF, &usage);
+#ifdef __APPLE__
+	return (std::size_t)usage.ru_maxrss;
+#else
+	return (std::size_t)usage.ru_maxrss * 1024;
+#endif
+#endif
+}
+
+// Stands in for the upload heap CreateDDSTextureFromMemory12 fills: every
+// subresource copied out of the file's bytes.
+bool Upload(const std::uint8_t* data, std::size_t size, std::vector<std::uint8_t>& upload) {
+	DDSTexture texture;
+	if (!ParseDDS(data, size, texture))
+		return false;
+	upload.clear();
+	for (const DDSSubresource& subresource : texture.Subresources)
+		upload.insert(upload.end(), subresource.Data, subresource.Data + subresource.SlicePitch * subresource.Depth);
+	return true;
+}
+
+// TextureFileAccess::Map: each file mapped and uploaded from the mapping.
+bool MapTextures(std::vector<std::vector<std::uint8_t>>& uploads, ThreadPool* pool) {
+	std::vector<char> loaded(TextureCount, 0);
+	ParallelFor(pool, TextureCount, [&](std::uint32_t i) {
+		MappedFile file;
+		loaded[i] = file.Open(std::string(TexturePaths[i])) && Upload(file.Data(), file.Size(), uploads[i]);
+	});
+	return std::count(loaded.begin(), loaded.end(), 1) == TextureCount;
+}
+
+// TextureFileAccess::Read: one batch of unbuffered reads into aligned buffers,
+// then the uploads from them.
+bool ReadTextures(std::vector<std::vector<std::uint8_t>>& uploads, ThreadPool* pool) {
+	AsyncFileReader reader(AsyncFileReader::Backend::CompletionPort, pool);
+	std::vector<AlignedBuffer> data(TextureCount);
+	std::vector<std::size_t> sizes(TextureCount);
+	std::vector<AsyncFileReader::ReadResult> results(TextureCount);
+
+	for (std::uint32_t i = 0; i < TextureCount; ++i)
+	{
+		AsyncFileReader::FileId file = reader.Open(std::string(TexturePaths[i]), true);
+		if (file == AsyncFileReader::InvalidFile)
+			return false;
+
+		const std::uint64_t sectorSize = reader.SectorSize(file);
+		const std::uint64_t readSize = (reader.FileSize(file) + sectorSize - 1) / sectorSize * sectorSize;
+		data[i] = AlignedBuffer((std::size_t)readSize, (std::size_t)sectorSize);
+		sizes[i] = (std::size_t)reader.FileSize(file);
+
+		AsyncFileReader::ReadRequest request;
+		request.File = file;
+		request.Size = (std::uint32_t)readSize;
+		request.Buffer = data[i].Data();
+		request.OnComplete = [&results, i](const AsyncFileReader::ReadResult& result) { results[i] = result; };
+		reader.Queue(std::move(request));
+	}
+	reader.Submit();
+	reader.WaitAll();
+
+	std::vector<char> loaded(TextureCount, 0);
+	ParallelFor(pool, TextureCount, [&](std::uint32_t i) {
+		loaded[i] = results[i].Status == AsyncFileReader::ReadStatus::Done && results[i].BytesRead >= sizes[i] &&
+			Upload(data[i].Data(), sizes[i], uploads[i]);
+	});
+	return std::count(loaded.begin(), loaded.end(), 1) == TextureCount;
+}
+
+}
+
+// Loads Textures/*.dds the two ways LoadTextures can, mapped or read, parses
+// them and copies their pixels as the uploads do, and prints the best time and
+// the peak resident set of the first load. The peak only grows, so each way is
+// measured in its own process: the first argument picks "map" or "read", the
+// second sets the number of pool threads. Run from the app directory.
+int main(int argc, char** argv) {
+	const std::string access = argc > 1 ? argv[1] : "map";
+	if (access != "map" && access != "read")
+	{
+		std::printf("usage: DDSLoadBenchmark [map|read] [threads]\n");
+		return 1;
+	}
+	ThreadPool pool(argc > 2 ? (std::uint32_t)std::atoi(argv[2]) : 0);
+	auto load = access == "map" ? MapTextures : ReadTextures;
+
+	// The uploads live until every texture is loaded, as the upload heaps do.
+	// Startup loads once, so the resident set is taken after the first load;
+	// the repeats only time it.
+	std::vector<std::vector<std::uint8_t>> uploads(TextureCount);
+	std::size_t startResident = PeakResidentBytes();
+	double first = NowMilliseconds();
+	bool loaded = load(uploads, &pool);
+	first = NowMilliseconds() - first;
+	std::size_t resident = PeakResidentBytes() - startResident;
+	double best = BestMilliseconds(20, [&] { loaded = load(uploads, &pool) && loaded; });
+	if (!loaded)
+	{
+		std::printf("%s: loading failed; run from the app directory\n", access.c_str());
+		return 1;
+	}
+
+	std::size_t bytes = 0;
+	for (const std::vector<std::uint8_t>& upload : uploads)
+		bytes += upload.size();
+	std::printf("%-4s %u threads: %u textures, %zu pixel bytes, first %.2f ms, best %.2f ms, peak resident +%zu KB\n",
+		access.c_str(), pool.Concurrency(), TextureCount, bytes, first, best, resident / 1024);
+	return 0;
+}
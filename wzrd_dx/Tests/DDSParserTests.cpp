@@ -0,0 +1,234 @@
+#include "Check.h"
+#include "DDSParser.h"
+#include "MappedFile.h"
+#include <algorithm>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace {
+
+// What the textures the apps ship with hold.
+struct ShippedTexture {
+	const char* Path;
+	DXGI_FORMAT Format;
+	std::uint32_t Width;
+	std::uint32_t Height;
+	std::uint32_t MipCount;
+	std::uint32_t ArraySize;
+};
+
+const ShippedTexture ShippedTextures[] = {
+	{ "Textures/bricks3.dds", DXGI_FORMAT_BC1_UNORM, 512, 512, 1, 1 },
+	{ "Textures/checkboard.dds", DXGI_FORMAT_BC1_UNORM, 512, 512, 1, 1 },
+	{ "Textures/grass.dds", DXGI_FORMAT_BC3_UNORM, 512, 512, 10, 1 },
+	{ "Textures/ice.dds", DXGI_FORMAT_BC1_UNORM, 512, 512, 1, 1 },
+	{ "Textures/tree01S.dds", DXGI_FORMAT_BC2_UNORM, 208, 256, 1, 1 },
+	{ "Textures/treeArray2.dds", DXGI_FORMAT_R8G8B8A8_UNORM, 208, 256, 1, 3 },
+	{ "Textures/water1.dds", DXGI_FORMAT_BC1_UNORM, 256, 256, 9, 1 },
+	{ "Textures/white1x1.dds", DXGI_FORMAT_B8G8R8A8_UNORM, 1, 1, 1, 1 },
+	{ "Textures/WireFence.dds", DXGI_FORMAT_BC3_UNORM, 512, 512, 10, 1 },
+	{ "Textures/WoodCrate01.dds", DXGI_FORMAT_BC3_UNORM, 512, 512, 10, 1 },
+};
+
+// Offset of the end of the last subresource, which is the size of the file
+// when nothing trails the pixels.
+std::size_t PixelDataEnd(const DDSTexture& texture, const std::uint8_t* data) {
+	const DDSSubresource& last = texture.Subresources.back();
+	return (std::size_t)(last.Data - data) + last.SlicePitch * last.Depth;
+}
+
+void TestShippedTextures() {
+	for (const ShippedTexture& shipped : ShippedTextures)
+	{
+		MappedFile file;
+		CHECK(file.Open(std::string(shipped.Path)));
+		if (!file.IsOpen())
+		{
+			std::printf("%s: could not be opened\n", shipped.Path);
+			continue;
+		}
+
+		const std::uint8_t* data = (const std::uint8_t*)file.Data();
+		DDSTexture texture;
+		DDSError error = DDSError::None;
+		CHECK(ParseDDS(data, file.Size(), texture, &error));
+		CHECK(error == DDSError::None);
+		if (error != DDSError::None)
+		{
+			std::printf("%s: failed to parse\n", shipped.Path);
+			continue;
+		}
+
+		CHECK(texture.Dimension == DDSDimension::Texture2D);
+		CHECK(texture.Format == shipped.Format);
+		CHECK(texture.Width == shipped.Width);
+		CHECK(texture.Height == shipped.Height);
+		CHECK(texture.Depth == 1);
+		CHECK(texture.MipCount == shipped.MipCount);
+		CHECK(texture.ArraySize == shipped.ArraySize);
+		CHECK(!texture.IsCubeMap);
+		CHECK(texture.Subresources.size() == shipped.MipCount * shipped.ArraySize);
+
+		// Subresources follow each other without gaps and end with the file.
+		const std::uint8_t* next = texture.Subresources[0].Data;
+		for (const DDSSubresource& subresource : texture.Subresources)
+		{
+			CHECK(subresource.Data == next);
+			next = subresource.Data + subresource.SlicePitch * subresource.Depth;
+		}
+		CHECK(PixelDataEnd(texture, data) == file.Size());
+
+		// Each mip halves the previous one, down to 1.
+		for (std::uint32_t mip = 1; mip < texture.MipCount; ++mip)
+		{
+			const DDSSubresource& larger = texture.Subresource(0, mip - 1);
+			const DDSSubresource& smaller = texture.Subresource(0, mip);
+			CHECK(smaller.Width == std::max<std::uint32_t>(larger.Width / 2, 1));
+			CHECK(smaller.Height == std::max<std::uint32_t>(larger.Height / 2, 1));
+		}
+
+		// A file cut short by one byte must not lay out the last subresource.
+		DDSTexture truncated;
+		CHECK(!ParseDDS(data, file.Size() - 1, truncated, &error));
+		CHECK(error == DDSError::Truncated);
+	}
+}
+
+void TestFirstMipWithin() {
+	MappedFile file;
+	CHECK(file.Open(std::string("Textures/grass.dds")));
+	if (!file.IsOpen())
+		return;
+
+	DDSTexture texture;
+	CHECK(ParseDDS((const std::uint8_t*)file.Data(), file.Size(), texture));
+	CHECK(FirstDDSMipWithin(texture, 0) == 0);
+	CHECK(FirstDDSMipWithin(texture, 512) == 0);
+	CHECK(FirstDDSMipWithin(texture, 511) == 1);
+	CHECK(FirstDDSMipWithin(texture, 64) == 3);
+	CHECK(FirstDDSMipWithin(texture, 1) == 9);
+}
+
+// The budget ShapesApp's TextureStreamer computes for its textures, with the
+// default 64 texel tails.
+void TestStreamingBudget() {
+	const char* const paths[] = { "Textures/grass.dds", "Textures/water1.dds", "Textures/treeArray2.dds",
+		"Textures/WireFence.dds", "Textures/tree01S.dds" };
+	const std::size_t count = sizeof(paths) / sizeof(paths[0]);
+	std::vector<MappedFile> files(count);
+	std::vector<DDSTexture> textures(count);
+	std::vector<const DDSTexture*> pointers;
+	for (std::size_t i = 0; i < count; ++i)
+	{
+		CHECK(files[i].Open(std::string(paths[i])));
+		if (!files[i].IsOpen() || !ParseDDS(files[i].Data(), files[i].Size(), textures[i]))
+			return;
+		pointers.push_back(&textures[i]);
+	}
+	const DDSTexture& grass = textures[0];
+	const DDSTexture& treeArray = textures[2];
+	const DDSTexture& fence = textures[3];
+	const DDSTexture& tree = textures[4];
+
+	// The single mip textures are loaded whole, so their tails are all of them.
+	CHECK(DDSTailMip(grass, 64) == 3);
+	CHECK(DDSTailMip(treeArray, 64) == 0);
+	CHECK(DDSTailMip(tree, 64) == 0);
+	CHECK(DDSBytesFrom(treeArray, 0) == 638976);
+	CHECK(DDSBytesFrom(tree, 0) == 53248);
+
+	std::uint64_t tails = 0;
+	std::uint64_t full = 0;
+	for (const DDSTexture& texture : textures)
+	{
+		tails += DDSBytesFrom(texture, DDSTailMip(texture, 64));
+		full += DDSBytesFrom(texture, 0);
+	}
+	CHECK(tails == 705944);
+	CHECK(DDSBytesFrom(grass, 0) == 349552);
+	CHECK(DDSBytesFrom(grass, 1) == 87408);
+
+	// The largest chain is grass's, with its mip 1 level still resident while
+	// mip 0 loads; a fixed 1 MB left grass stuck at mip 1.
+	const std::uint64_t budget = DDSStreamingBudget(pointers, 64);
+	CHECK(budget == tails + DDSBytesFrom(grass, 0) + DDSBytesFrom(grass, 1));
+	CHECK(tails + DDSBytesFrom(grass, 0) > 1024 * 1024);
+	for (const DDSTexture& texture : textures)
+	{
+		if (DDSTailMip(texture, 64) > 0)
+			CHECK(tails + DDSBytesFrom(texture, 0) + DDSBytesFrom(texture, 1) <= budget);
+	}
+
+	// Still below everything at mip 0: grass and the fence at full resolution
+	// together evict one another.
+	CHECK(budget < full);
+	CHECK(tails + DDSBytesFrom(grass, 0) + DDSBytesFrom(fence, 0) > budget);
+}
+
+void TestSurfaceInfo() {
+	std::size_t numBytes, rowBytes, numRows;
+
+	// 4x4 blocks of 8 bytes.
+	GetDDSSurfaceInfo(512, 512, DXGI_FORMAT_BC1_UNORM, &numBytes, &rowBytes, &numRows);
+	CHECK(rowBytes == 1024);
+	CHECK(numRows == 128);
+	CHECK(numBytes == 131072);
+
+	// Sides smaller than a block still take a whole one.
+	GetDDSSurfaceInfo(2, 1, DXGI_FORMAT_BC3_UNORM, &numBytes, &rowBytes, &numRows);
+	CHECK(rowBytes == 16);
+	CHECK(numRows == 1);
+	CHECK(numBytes == 16);
+
+	GetDDSSurfaceInfo(208, 256, DXGI_FORMAT_R8G8B8A8_UNORM, &numBytes, &rowBytes, &numRows);
+	CHECK(rowBytes == 832);
+	CHECK(numRows == 256);
+	CHECK(numBytes == 832 * 256);
+
+	CHECK(DDSBitsPerPixel(DXGI_FORMAT_R8G8B8A8_UNORM) == 32);
+	CHECK(DDSBitsPerPixel(DXGI_FORMAT_BC1_UNORM) == 4);
+	CHECK(DDSBitsPerPixel(DXGI_FORMAT_UNKNOWN) == 0);
+}
+
+void TestRejectsInvalidFiles() {
+	MappedFile file;
+	CHECK(file.Open(std::string("Textures/white1x1.dds")));
+	if (!file.IsOpen())
+		return;
+
+	std::vector<std::uint8_t> bytes((const std::uint8_t*)file.Data(), (const std::uint8_t*)file.Data() + file.Size());
+	DDSTexture texture;
+	DDSError error = DDSError::None;
+
+	// Shorter than the headers.
+	CHECK(!ParseDDS(bytes.data(), 100, texture, &error));
+	CHECK(error == DDSError::NotDDS);
+
+	std::vector<std::uint8_t> badMagic = bytes;
+	badMagic[0] = 'X';
+	CHECK(!ParseDDS(badMagic.data(), badMagic.size(), texture, &error));
+	CHECK(error == DDSError::NotDDS);
+
+	std::vector<std::uint8_t> badHeaderSize = bytes;
+	std::uint32_t headerSize = 0;
+	std::memcpy(&badHeaderSize[4], &headerSize, sizeof(headerSize));
+	CHECK(!ParseDDS(badHeaderSize.data(), badHeaderSize.size(), texture, &error));
+	CHECK(error == DDSError::NotDDS);
+
+	// The untouched bytes still parse.
+	CHECK(ParseDDS(bytes.data(), bytes.size(), texture, &error));
+	CHECK(texture.Subresources.size() == 1);
+	CHECK(texture.Subresources[0].Data == bytes.data() + bytes.size() - 4);
+}
+
+}
+
+int main() {
+	TestShippedTextures();
+	TestFirstMipWithin();
+	TestStreamingBudget();
+	TestSurfaceInfo();
+	TestRejectsInvalidFiles();
+	return TestResult("DDSParserTests");
+}
@@ -0,0 +1,248 @@
+#include "Check.h"
+#include "FrameGraph.h"
+#include <string>
+#include <vector>
+
+namespace {
+
+// What Execute did, in order: "pass:<name>" for a pass and one entry per barrier.
+struct ExecutionLog {
+	std::vector<std::string> Events;
+	std::vector<FrameGraphBarrier> Barriers;
+	std::uint32_t BarrierCalls = 0;
+};
+
+std::function<void()> LogPass(ExecutionLog& log, const std::string& name) {
+	return [&log, name] { log.Events.push_back("pass:" + name); };
+}
+
+void Execute(const FrameGraph& graph, ExecutionLog& log) {
+	graph.Execute([&](const FrameGraphBarrier* barriers, std::uint32_t count) {
+		log.BarrierCalls++;
+		for (std::uint32_t i = 0; i < count; ++i)
+		{
+			log.Barriers.push_back(barriers[i]);
+			log.Events.push_back("barrier:" + graph.GetResourceName(barriers[i].Resource));
+		}
+	});
+}
+
+bool IsTransition(const FrameGraphBarrier& barrier, FrameGraphResource resource, std::uint32_t before, std::uint32_t after) {
+	return barrier.BarrierType == FrameGraphBarrier::Type::Transition && barrier.Resource == resource &&
+		barrier.StateBefore == before && barrier.StateAfter == after;
+}
+
+void TestUnusedPassesAreCulled() {
+	ExecutionLog log;
+	FrameGraph graph;
+	FrameGraphResource backBuffer = graph.ImportResource("backBuffer", ResourceState_RenderTarget, ResourceState_RenderTarget);
+	FrameGraphResource used = graph.CreateTransient("used", 1024, 256);
+	FrameGraphResource unused = graph.CreateTransient("unused", 1024, 256);
+	FrameGraphResource chain = graph.CreateTransient("chain", 1024, 256);
+
+	std::uint32_t produce = graph.AddPass("produce", [&](FrameGraph::PassBuilder& p) {
+		p.Write(used, ResourceState_RenderTarget);
+	}, LogPass(log, "produce"));
+	// Only feeds a pass that is culled itself.
+	std::uint32_t chainStart = graph.AddPass("chainStart", [&](FrameGraph::PassBuilder& p) {
+		p.Write(chain, ResourceState_RenderTarget);
+	}, LogPass(log, "chainStart"));
+	std::uint32_t chainEnd = graph.AddPass("chainEnd", [&](FrameGraph::PassBuilder& p) {
+		p.Read(chain, ResourceState_ShaderResource);
+		p.Write(unused, ResourceState_RenderTarget);
+	}, LogPass(log, "chainEnd"));
+	std::uint32_t sideEffect = graph.AddPass("sideEffect", [&](FrameGraph::PassBuilder& p) {
+		p.Write(unused, ResourceState_RenderTarget);
+		p.SideEffect();
+	}, LogPass(log, "sideEffect"));
+	std::uint32_t composite = graph.AddPass("composite", [&](FrameGraph::PassBuilder& p) {
+		p.Read(used, ResourceState_ShaderResource);
+		p.Write(backBuffer, ResourceState_RenderTarget);
+	}, LogPass(log, "composite"));
+
+	graph.Compile();
+	CHECK(!graph.IsPassCulled(produce));
+	CHECK(graph.IsPassCulled(chainStart));
+	CHECK(graph.IsPassCulled(chainEnd));
+	CHECK(!graph.IsPassCulled(sideEffect));
+	CHECK(!graph.IsPassCulled(composite));
+	CHECK(graph.Stats().PassCount == 5);
+	CHECK(graph.Stats().CulledPassCount == 2);
+
+	Execute(graph, log);
+	const std::vector<std::string> expected = {
+		"pass:produce", "pass:sideEffect", "barrier:used", "pass:composite",
+	};
+	CHECK(log.Events == expected);
+}
+
+void TestOverwrittenOutputIsCulled() {
+	FrameGraph graph;
+	FrameGraphResource backBuffer = graph.ImportResource("backBuffer", ResourceState_Present, ResourceState_Present);
+	FrameGraphResource target = graph.CreateTransient("target", 1024, 256);
+
+	// The second pass writes target without reading it, so the first is dead.
+	std::uint32_t first = graph.AddPass("first", [&](FrameGraph::PassBuilder& p) {
+		p.Write(target, ResourceState_RenderTarget);
+	}, nullptr);
+	std::uint32_t second = graph.AddPass("second", [&](FrameGraph::PassBuilder& p) {
+		p.Write(target, ResourceState_RenderTarget);
+	}, nullptr);
+	graph.AddPass("present", [&](FrameGraph::PassBuilder& p) {
+		p.Read(target, ResourceState_ShaderResource);
+		p.Write(backBuffer, ResourceState_RenderTarget);
+	}, nullptr);
+
+	graph.Compile();
+	CHECK(graph.IsPassCulled(first));
+	CHECK(!graph.IsPassCulled(second));
+}
+
+void TestBarriers() {
+	ExecutionLog log;
+	FrameGraph graph;
+	FrameGraphResource backBuffer = graph.ImportResource("backBuffer", ResourceState_Present, ResourceState_Present);
+	FrameGraphResource depth = graph.ImportResource("depth", ResourceState_DepthWrite, ResourceState_DepthWrite);
+	FrameGraphResource shadowMap = graph.CreateTransient("shadowMap", 4 << 20, 65536);
+
+	graph.AddPass("shadow", [&](FrameGraph::PassBuilder& p) {
+		p.Write(shadowMap, ResourceState_DepthWrite);
+	}, LogPass(log, "shadow"));
+	graph.AddPass("opaque", [&](FrameGraph::PassBuilder& p) {
+		p.Read(shadowMap, ResourceState_ShaderResource);
+		p.Write(backBuffer, ResourceState_RenderTarget);
+		p.Write(depth, ResourceState_DepthWrite);
+	}, LogPass(log, "opaque"));
+	// Two passes reading depth in different read states share one transition.
+	graph.AddPass("fog", [&](FrameGraph::PassBuilder& p) {
+		p.Read(depth, ResourceState_DepthRead);
+		p.Read(backBuffer, ResourceState_RenderTarget);
+		p.Write(backBuffer, ResourceState_RenderTarget);
+	}, LogPass(log, "fog"));
+	graph.AddPass("outline", [&](FrameGraph::PassBuilder& p) {
+		p.Read(depth, ResourceState_ShaderResource);
+		p.Read(backBuffer, ResourceState_RenderTarget);
+		p.Write(backBuffer, ResourceState_RenderTarget);
+	}, LogPass(log, "outline"));
+
+	graph.Compile();
+	Execute(graph, log);
+
+	const std::vector<std::string> expectedEvents = {
+		"pass:shadow",
+		"barrier:shadowMap", "barrier:backBuffer", "pass:opaque",
+		"barrier:depth", "pass:fog",
+		"pass:outline",
+		"barrier:backBuffer", "barrier:depth",
+	};
+	CHECK(log.Events == expectedEvents);
+
+	CHECK(log.Barriers.size() == 5);
+	if (log.Barriers.size() == 5)
+	{
+		CHECK(IsTransition(log.Barriers[0], shadowMap, ResourceState_DepthWrite, ResourceState_ShaderResource));
+		CHECK(IsTransition(log.Barriers[1], backBuffer, ResourceState_Present, ResourceState_RenderTarget));
+		CHECK(IsTransition(log.Barriers[2], depth, ResourceState_DepthWrite, ResourceState_DepthRead | ResourceState_ShaderResource));
+		CHECK(IsTransition(log.Barriers[3], backBuffer, ResourceState_RenderTarget, ResourceState_Present));
+		CHECK(IsTransition(log.Barriers[4], depth, ResourceState_DepthRead | ResourceState_ShaderResource, ResourceState_DepthWrite));
+	}
+
+	// Barriers of one pass go out in one call.
+	CHECK(log.BarrierCalls == 3);
+	CHECK(graph.Stats().BarrierCount == 5);
+	CHECK(graph.Stats().BarrierBatchCount == 3);
+}
+
+void TestTransientsAlias() {
+	ExecutionLog log;
+	FrameGraph graph;
+	FrameGraphResource backBuffer = graph.ImportResource("backBuffer", ResourceState_RenderTarget, ResourceState_RenderTarget);
+	FrameGraphResource shadowMap = graph.CreateTransient("shadowMap", 4 << 20, 65536);
+	FrameGraphResource bloomA = graph.CreateTransient("bloomA", 8 << 20, 65536);
+	FrameGraphResource bloomB = graph.CreateTransient("bloomB", 8 << 20, 65536);
+
+	graph.AddPass("shadow", [&](FrameGraph::PassBuilder& p) {
+		p.Write(shadowMap, ResourceState_DepthWrite);
+	}, LogPass(log, "shadow"));
+	graph.AddPass("opaque", [&](FrameGraph::PassBuilder& p) {
+		p.Read(shadowMap, ResourceState_ShaderResource);
+		p.Write(backBuffer, ResourceState_RenderTarget);
+	}, LogPass(log, "opaque"));
+	graph.AddPass("bright", [&](FrameGraph::PassBuilder& p) {
+		p.Read(backBuffer, ResourceState_RenderTarget);
+		p.Write(bloomA, ResourceState_RenderTarget);
+	}, LogPass(log, "bright"));
+	graph.AddPass("blur", [&](FrameGraph::PassBuilder& p) {
+		p.Read(bloomA, ResourceState_ShaderResource);
+		p.Write(bloomB, ResourceState_RenderTarget);
+	}, LogPass(log, "blur"));
+	graph.AddPass("composite", [&](FrameGraph::PassBuilder& p) {
+		p.Read(bloomB, ResourceState_ShaderResource);
+		p.Read(backBuffer, ResourceState_RenderTarget);
+		p.Write(backBuffer, ResourceState_RenderTarget);
+	}, LogPass(log, "composite"));
+
+	graph.Compile();
+
+	// The shadow map is dead before bloomA is written, so they share memory.
+	// bloomA and bloomB are alive together in the blur pass.
+	CHECK(graph.GetHeapOffset(bloomA) == 0);
+	CHECK(graph.GetHeapOffset(shadowMap) == 0);
+	CHECK(graph.GetHeapOffset(bloomB) == 8 << 20);
+	CHECK(graph.Stats().TransientBytes == 20 << 20);
+	CHECK(graph.Stats().AliasedTransientBytes == 16 << 20);
+
+	Execute(graph, log);
+
+	std::uint32_t aliasingCount = 0;
+	for (const FrameGraphBarrier& barrier : log.Barriers)
+	{
+		if (barrier.BarrierType != FrameGraphBarrier::Type::Aliasing)
+			continue;
+		aliasingCount++;
+		CHECK(barrier.Resource == bloomA);
+		CHECK(barrier.AliasBefore == shadowMap);
+	}
+	CHECK(aliasingCount == 1);
+
+	// The aliasing barrier comes right before the first pass that uses bloomA.
+	const std::vector<std::string> expectedEvents = {
+		"pass:shadow",
+		"barrier:shadowMap", "pass:opaque",
+		"barrier:bloomA", "pass:bright",
+		"barrier:bloomA", "pass:blur",
+		"barrier:bloomB", "pass:composite",
+	};
+	CHECK(log.Events == expectedEvents);
+}
+
+void TestCompileTwice() {
+	FrameGraph graph;
+	FrameGraphResource backBuffer = graph.ImportResource("backBuffer", ResourceState_Present, ResourceState_Present);
+	FrameGraphResource target = graph.CreateTransient("target", 1024, 256);
+	graph.AddPass("draw", [&](FrameGraph::PassBuilder& p) {
+		p.Write(target, ResourceState_RenderTarget);
+	}, nullptr);
+	graph.AddPass("present", [&](FrameGraph::PassBuilder& p) {
+		p.Read(target, ResourceState_ShaderResource);
+		p.Write(backBuffer, ResourceState_RenderTarget);
+	}, nullptr);
+
+	graph.Compile();
+	FrameGraphStats first = graph.Stats();
+	graph.Compile();
+	CHECK(graph.Stats().BarrierCount == first.BarrierCount);
+	CHECK(graph.Stats().BarrierBatchCount == first.BarrierBatchCount);
+	CHECK(graph.Stats().AliasedTransientBytes == first.AliasedTransientBytes);
+}
+
+}
+
+int main() {
+	TestUnusedPassesAreCulled();
+	TestOverwrittenOutputIsCulled();
+	TestBarriers();
+	TestTransientsAlias();
+	TestCompileTwice();
+	return TestResult("FrameGraphTests");
+}
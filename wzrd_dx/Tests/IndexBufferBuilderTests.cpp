@@ -0,0 +1,151 @@
+#include "Check.h"
+#include "IndexBufferBuilder.h"
+#include <vector>
+
+namespace {
+
+// The vertices the draws of a submesh fetch, relative to baseVertex as in Add.
+std::vector<std::uint32_t> DrawnIndices(const IndexBufferBuilder& builder, const std::string& name, std::int32_t baseVertex) {
+	std::vector<std::uint32_t> drawn;
+	for (const IndexBufferRange& range : builder.Ranges(name))
+	{
+		for (std::uint32_t i = 0; i < range.IndexCount; ++i)
+		{
+			std::uint32_t index = builder.IndexSize() == 2 ?
+				((const std::uint16_t*)builder.Data())[range.StartIndexLocation + i] :
+				((const std::uint32_t*)builder.Data())[range.StartIndexLocation + i];
+			drawn.push_back(index + range.BaseVertexLocation - baseVertex);
+		}
+	}
+	return drawn;
+}
+
+// Triangle list of a size x size vertex grid, rows one after another.
+std::vector<std::uint32_t> GridIndices(std::uint32_t size) {
+	std::vector<std::uint32_t> indices;
+	for (std::uint32_t i = 0; i + 1 < size; ++i)
+	{
+		for (std::uint32_t j = 0; j + 1 < size; ++j)
+		{
+			std::uint32_t v = i * size + j;
+			indices.insert(indices.end(), { v, v + 1, v + size, v + size, v + 1, v + size + 1 });
+		}
+	}
+	return indices;
+}
+
+void TestSmallSubmeshesShareR16() {
+	std::vector<std::uint32_t> floor = { 0, 1, 2, 0, 2, 3 };
+	std::vector<std::uint32_t> mirror = { 16, 17, 18, 16, 18, 19 };
+
+	IndexBufferBuilder builder;
+	builder.Add("floor", floor.data(), floor.size());
+	builder.Add("mirror", mirror.data(), mirror.size());
+	builder.Build();
+
+	CHECK(builder.Format() == DXGI_FORMAT_R16_UINT);
+	CHECK(builder.IndexCount() == 12);
+	CHECK(builder.ByteSize() == 24);
+	CHECK(builder.Ranges("floor").size() == 1);
+	CHECK(builder.Ranges("mirror").size() == 1);
+	// Rebased on the smallest vertex it uses.
+	CHECK(builder.Ranges("mirror")[0].BaseVertexLocation == 16);
+	CHECK(builder.Ranges("mirror")[0].StartIndexLocation == 6);
+	CHECK(DrawnIndices(builder, "floor", 0) == floor);
+	CHECK(DrawnIndices(builder, "mirror", 0) == mirror);
+	CHECK(builder.Ranges("unknown").empty());
+}
+
+void TestSplittableSubmeshIsSplit() {
+	// 400 x 400 vertices span far more than 16 bits.
+	std::vector<std::uint32_t> grid = GridIndices(400);
+	const std::int32_t baseVertex = 100;
+
+	IndexBufferBuilder builder;
+	builder.Add("grid", grid.data(), grid.size(), baseVertex, true);
+	builder.Build();
+
+	const std::vector<IndexBufferRange>& ranges = builder.Ranges("grid");
+	CHECK(builder.Format() == DXGI_FORMAT_R16_UINT);
+	CHECK(builder.ByteSize() == grid.size() * 2);
+	CHECK(ranges.size() >= 3);
+
+	std::uint32_t next = 0;
+	for (const IndexBufferRange& range : ranges)
+	{
+		// Consecutive, made of whole triangles, and each within 16 bits.
+		CHECK(range.StartIndexLocation == next);
+		CHECK(range.IndexCount % 3 == 0);
+		CHECK(range.BaseVertexLocation >= baseVertex);
+		next += range.IndexCount;
+	}
+	CHECK(next == grid.size());
+	CHECK(DrawnIndices(builder, "grid", baseVertex) == grid);
+}
+
+void TestWholeSubmeshFallsBackToR32() {
+	std::vector<std::uint32_t> grid = GridIndices(400);
+	std::vector<std::uint32_t> triangle = { 0, 1, 2 };
+
+	IndexBufferBuilder builder;
+	builder.Add("grid", grid.data(), grid.size());
+	builder.Add("triangle", triangle.data(), triangle.size(), 7);
+	builder.Build();
+
+	CHECK(builder.Format() == DXGI_FORMAT_R32_UINT);
+	CHECK(builder.ByteSize() == (grid.size() + triangle.size()) * 4);
+	CHECK(builder.Ranges("grid").size() == 1);
+	CHECK(builder.Ranges("triangle").size() == 1);
+	CHECK(builder.Ranges("triangle")[0].BaseVertexLocation == 7);
+	CHECK(DrawnIndices(builder, "grid", 0) == grid);
+	CHECK(DrawnIndices(builder, "triangle", 7) == triangle);
+}
+
+void TestWideTriangleFallsBackToR32() {
+	// No split can bring the first triangle within 16 bits.
+	std::vector<std::uint32_t> indices = { 0, 70000, 5, 1, 2, 3 };
+
+	IndexBufferBuilder builder;
+	builder.Add("wide", indices.data(), indices.size(), 0, true);
+	builder.Build();
+
+	CHECK(builder.Format() == DXGI_FORMAT_R32_UINT);
+	CHECK(builder.Ranges("wide").size() == 1);
+	CHECK(DrawnIndices(builder, "wide", 0) == indices);
+}
+
+void TestSplittableNeedsWholeTriangles() {
+	// Not a triangle list, so it is kept whole even though it was marked splittable.
+	std::vector<std::uint32_t> indices = { 0, 70000, 1, 2 };
+
+	IndexBufferBuilder builder;
+	builder.Add("strip", indices.data(), indices.size(), 0, true);
+	builder.Build();
+
+	CHECK(builder.Format() == DXGI_FORMAT_R32_UINT);
+	CHECK(builder.Ranges("strip").size() == 1);
+	CHECK(DrawnIndices(builder, "strip", 0) == indices);
+}
+
+void TestEmptySubmesh() {
+	IndexBufferBuilder builder;
+	builder.Add("empty", nullptr, 0);
+	builder.Build();
+
+	CHECK(builder.Format() == DXGI_FORMAT_R16_UINT);
+	CHECK(builder.ByteSize() == 0);
+	CHECK(builder.Ranges("empty").size() == 1);
+	CHECK(builder.Ranges("empty")[0].IndexCount == 0);
+}
+
+}
+
+int main() {
+	TestSmallSubmeshesShareR16();
+	TestSplittableSubmeshIsSplit();
+	TestWholeSubmeshFallsBackToR32();
+	TestWideTriangleFallsBackToR32();
+	TestSplittableNeedsWholeTriangles();
+	TestEmptySubmesh();
+	return TestResult("IndexBufferBuilderTests");
+}
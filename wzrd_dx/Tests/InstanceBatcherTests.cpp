@@ -0,0 +1,188 @@
+#include "Check.h"
+#include "DrawSort.h"
+#include "InstanceBatcher.h"
+
+namespace {
+
+// Stand-ins for API objects; the batcher only compares their addresses.
+int g_geometry;
+int g_materialA, g_materialB;
+int g_pipeline;
+
+InstanceBatchKey MakeKey(const void* material, std::uint32_t startIndexLocation) {
+	InstanceBatchKey key;
+	key.Geometry = &g_geometry;
+	key.Material = material;
+	key.PipelineState = &g_pipeline;
+	key.Topology = 4;
+	key.IndexCount = 36;
+	key.StartIndexLocation = startIndexLocation;
+	return key;
+}
+
+void TestInterleavedItemsShareBatches() {
+	const InstanceBatchKey a = MakeKey(&g_materialA, 0);
+	const InstanceBatchKey b = MakeKey(&g_materialB, 0);
+
+	InstanceBatcher batcher;
+	for (std::uint32_t i = 0; i < 8; ++i)
+		batcher.Add(i % 2 == 0 ? a : b, i);
+	batcher.Finish();
+
+	const auto& batches = batcher.Batches();
+	CHECK(batches.size() == 2);
+	CHECK(batches[0].Key == a);
+	CHECK(batches[0].FirstInstance == 0);
+	CHECK(batches[0].InstanceCount == 4);
+	CHECK(batches[1].Key == b);
+	CHECK(batches[1].FirstInstance == 4);
+	CHECK(batches[1].InstanceCount == 4);
+
+	// Instances of a batch are contiguous and keep the order they were added in.
+	const std::uint32_t expected[] = { 0, 2, 4, 6, 1, 3, 5, 7 };
+	CHECK(batcher.InstanceCount() == 8);
+	for (std::uint32_t i = 0; i < 8; ++i)
+		CHECK(batcher.InstanceItems()[i] == expected[i]);
+}
+
+void TestSubmeshesAreSeparateBatches() {
+	InstanceBatcher batcher;
+	for (std::uint32_t i = 0; i < 6; ++i)
+		batcher.Add(MakeKey(&g_materialA, (i % 3) * 36), i);
+	batcher.Finish();
+
+	CHECK(batcher.Batches().size() == 3);
+	for (const InstanceBatch& batch : batcher.Batches())
+		CHECK(batch.InstanceCount == 2);
+}
+
+void TestAdjacentKeepsOrder() {
+	const InstanceBatchKey a = MakeKey(&g_materialA, 0);
+	const InstanceBatchKey b = MakeKey(&g_materialB, 0);
+
+	InstanceBatcher batcher;
+	batcher.Add(a, 0, InstanceMerge::Adjacent);
+	batcher.Add(b, 1, InstanceMerge::Adjacent);
+	batcher.Add(a, 2, InstanceMerge::Adjacent);
+	batcher.Add(a, 3, InstanceMerge::Adjacent);
+	batcher.Add(b, 4, InstanceMerge::Adjacent);
+	batcher.Finish();
+
+	const auto& batches = batcher.Batches();
+	CHECK(batches.size() == 4);
+	CHECK(batches[2].InstanceCount == 2);
+	for (std::uint32_t i = 0; i < 5; ++i)
+		CHECK(batcher.InstanceItems()[i] == i);
+}
+
+void TestNeverIsABarrier() {
+	const InstanceBatchKey a = MakeKey(&g_materialA, 0);
+
+	InstanceBatcher batcher;
+	batcher.Add(a, 0);
+	batcher.Add(a, 1);
+	batcher.Add(a, 2, InstanceMerge::Never);
+	batcher.Add(a, 3, InstanceMerge::Never);
+	batcher.Add(a, 4);
+	batcher.Add(a, 5);
+	batcher.Finish();
+
+	// Items after the barrier do not join the batch before it.
+	const auto& batches = batcher.Batches();
+	CHECK(batches.size() == 4);
+	CHECK(batches[0].InstanceCount == 2);
+	CHECK(batches[1].InstanceCount == 1 && !batches[1].Mergeable);
+	CHECK(batches[2].InstanceCount == 1 && !batches[2].Mergeable);
+	CHECK(batches[3].InstanceCount == 2);
+}
+
+void TestClearResets() {
+	InstanceBatcher batcher;
+	batcher.Add(MakeKey(&g_materialA, 0), 0);
+	batcher.Finish();
+	batcher.Clear();
+	batcher.Add(MakeKey(&g_materialA, 0), 0);
+	batcher.Finish();
+
+	CHECK(batcher.Batches().size() == 1);
+	CHECK(batcher.InstanceCount() == 1);
+}
+
+void TestSortedKeysGroupSubmeshes() {
+	// Two submeshes and two materials at interleaved depths, the way a scene of
+	// mixed shapes comes out of the cull.
+	struct Item {
+		std::uint32_t Submesh;
+		std::uint32_t Material;
+		float Depth;
+	};
+	std::vector<Item> items;
+	for (std::uint32_t i = 0; i < 40; ++i)
+		items.push_back({ i % 2, (i / 2) % 2, 1.0f + (float)((i * 7) % 40) });
+
+	std::vector<SortedDraw> draws;
+	for (std::uint32_t i = 0; i < (std::uint32_t)items.size(); ++i)
+	{
+		SortedDraw draw;
+		draw.ItemIndex = i;
+		draw.Key = DrawKey::MakeOpaque(0, 0, 0, items[i].Submesh, items[i].Material, items[i].Depth, 100.0f);
+		draws.push_back(draw);
+	}
+	std::vector<SortedDraw> scratch;
+	RadixSortDraws(draws, scratch);
+
+	// Each submesh and material pair is one run, front to back inside it.
+	std::uint32_t runs = 1;
+	for (std::size_t i = 1; i < draws.size(); ++i)
+	{
+		const Item& prev = items[draws[i - 1].ItemIndex];
+		const Item& item = items[draws[i].ItemIndex];
+		if (prev.Submesh != item.Submesh || prev.Material != item.Material)
+			++runs;
+		else
+			CHECK(prev.Depth <= item.Depth);
+	}
+	CHECK(runs == 4);
+
+	InstanceBatcher batcher;
+	for (std::uint32_t i = 0; i < (std::uint32_t)draws.size(); ++i)
+	{
+		const Item& item = items[draws[i].ItemIndex];
+		batcher.Add(MakeKey(item.Material ? &g_materialB : &g_materialA, item.Submesh * 36), i);
+	}
+	batcher.Finish();
+	CHECK(batcher.Batches().size() == 4);
+	for (const InstanceBatch& batch : batcher.Batches())
+		CHECK(batch.InstanceCount == 10);
+}
+
+void TestSubmeshSortIds() {
+	SubmeshSortIds ids;
+	CHECK(ids.Get(0, 0) == 0);
+	CHECK(ids.Get(36, 0) == 1);
+	CHECK(ids.Get(0, 24) == 2);
+	CHECK(ids.Get(36, 0) == 1);
+	CHECK(ids.Get(0, 0) == 0);
+}
+
+void TestQuantizeDepth() {
+	CHECK(DrawKey::QuantizeDepth(-1.0f, 100.0f) == 0);
+	CHECK(DrawKey::QuantizeDepth(200.0f, 100.0f) == (1u << DrawKey::DepthBits) - 1u);
+	CHECK(DrawKey::QuantizeDepth(200.0f, 100.0f, DrawKey::OpaqueDepthBits) == (1u << DrawKey::OpaqueDepthBits) - 1u);
+	CHECK(DrawKey::QuantizeDepth(10.0f, 100.0f, DrawKey::OpaqueDepthBits) <
+		DrawKey::QuantizeDepth(20.0f, 100.0f, DrawKey::OpaqueDepthBits));
+}
+
+}
+
+int main() {
+	TestInterleavedItemsShareBatches();
+	TestSubmeshesAreSeparateBatches();
+	TestAdjacentKeepsOrder();
+	TestNeverIsABarrier();
+	TestClearResets();
+	TestSortedKeysGroupSubmeshes();
+	TestSubmeshSortIds();
+	TestQuantizeDepth();
+	return TestResult("InstanceBatcherTests");
+}
@@ -0,0 +1,255 @@
+#include "IndexBufferBuilder.h"
+#include "MeshCache.h"
+#include "MeshLod.h"
+#include "MeshOptimizer.h"
+#include "MeshSimplifier.h"
+#include "Meshlets.h"
+#include "ModelLoader.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+using namespace DirectX;
+
+namespace {
+
+// Vertex3 of MirrorApp.
+struct Vertex {
+	XMFLOAT3 Pos;
+	XMFLOAT3 Normal;
+	XMFLOAT2 TexC;
+};
+
+double NowMilliseconds() {
+	return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+template<typename Run>
+double BestMilliseconds(int repeats, Run run) {
+	double best = 1e30;
+	for (int r = 0; r < repeats; ++r)
+	{
+		double start = NowMilliseconds();
+		run();
+		best = std::min(best, NowMilliseconds() - start);
+	}
+	return best;
+}
+
+// What MirrorApp::BuildSkullGeometry uploads and stores.
+struct SkullMesh {
+	std::vector<Vertex> Vertices;
+	std::vector<std::uint8_t> Indices;
+	DXGI_FORMAT IndexFormat = DXGI_FORMAT_UNKNOWN;
+	std::vector<std::string> LevelNames;
+	std::vector<float> LevelErrors;
+	std::vector<IndexBufferRange> LevelRanges;
+	std::vector<MeshletMesh> LevelMeshlets;
+	BoundingBox Bounds;
+};
+
+// The cold path of BuildSkullGeometry without the device: parse, optimize,
+// simplify three coarser levels, split every level into meshlets and pack the
+// index buffer. The vertices stay at full precision.
+bool BuildSkull(const std::string& modelPath, SkullMesh& mesh, ThreadPool* pool) {
+	TextModel skull;
+	if (!LoadTextModel(modelPath, skull, pool))
+		return false;
+
+	mesh.Vertices.resize(skull.Vertices.size());
+	for (std::size_t i = 0; i < mesh.Vertices.size(); ++i)
+	{
+		mesh.Vertices[i].Pos = skull.Vertices[i].Position;
+		mesh.Vertices[i].Normal = skull.Vertices[i].Normal;
+		mesh.Vertices[i].TexC = { 0.0f, 0.0f };
+	}
+	std::vector<std::uint32_t> indices = std::move(skull.Indices);
+
+	std::size_t vertexCount = mesh.Vertices.size();
+	OptimizeMesh(indices, mesh.Vertices.data(), vertexCount, sizeof(Vertex), &mesh.Vertices[0].Pos);
+	mesh.Vertices.resize(vertexCount);
+	BoundingBox::CreateFromPoints(mesh.Bounds, mesh.Vertices.size(), &mesh.Vertices[0].Pos, sizeof(Vertex));
+
+	const std::uint32_t levelCount = 4;
+	std::vector<std::uint32_t> starts(1, 0);
+	std::vector<std::uint32_t> counts(1, (std::uint32_t)indices.size());
+	mesh.LevelErrors.assign(1, 0.0f);
+
+	SimplifyOptions options;
+	options.KeepOriginalVertices = true;
+	options.TargetTriangleCount = indices.size() / 3;
+	std::vector<std::uint32_t> lodIndices = indices;
+	float error = 0.0f;
+	for (std::uint32_t level = 1; level < levelCount; ++level)
+	{
+		options.TargetTriangleCount /= 4;
+		SimplifyResult simplified = SimplifyMesh(&mesh.Vertices[0].Pos, &mesh.Vertices[0].Normal, sizeof(Vertex), mesh.Vertices.size(),
+			lodIndices.data(), lodIndices.size(), options);
+		lodIndices = std::move(simplified.Indices);
+		error += simplified.Error;
+		OptimizeVertexCache(lodIndices.data(), lodIndices.size(), mesh.Vertices.size());
+
+		starts.push_back((std::uint32_t)indices.size());
+		counts.push_back((std::uint32_t)lodIndices.size());
+		mesh.LevelErrors.push_back(error);
+		indices.insert(indices.end(), lodIndices.begin(), lodIndices.end());
+	}
+
+	IndexBufferBuilder indexBuffer;
+	for (std::uint32_t level = 0; level < levelCount; ++level)
+	{
+		MeshletMesh meshlets = BuildMeshlets(&indices[starts[level]], counts[level], &mesh.Vertices[0].Pos, sizeof(Vertex), mesh.Vertices.size());
+		std::copy(meshlets.Indices.begin(), meshlets.Indices.end(), indices.begin() + starts[level]);
+		mesh.LevelMeshlets.push_back(std::move(meshlets));
+		mesh.LevelNames.push_back(LodSubmeshName("skull", level));
+		indexBuffer.Add(mesh.LevelNames.back(), &indices[starts[level]], counts[level]);
+	}
+	indexBuffer.Build();
+
+	for (const std::string& name : mesh.LevelNames)
+		mesh.LevelRanges.push_back(indexBuffer.Ranges(name)[0]);
+	mesh.Indices.assign((const std::uint8_t*)indexBuffer.Data(), (const std::uint8_t*)indexBuffer.Data() + indexBuffer.ByteSize());
+	mesh.IndexFormat = indexBuffer.Format();
+	return true;
+}
+
+bool WriteSkull(const std::string& path, const SkullMesh& mesh, const MeshCacheSource& source, bool compress) {
+	MeshCacheContents contents;
+	contents.AddAttribute("POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0);
+	contents.AddAttribute("NORMAL", 0, DXGI_FORMAT_R32G32B32_FLOAT, 12);
+	contents.AddAttribute("TEXCOORD", 0, DXGI_FORMAT_R32G32_FLOAT, 24);
+
+	contents.Vertices = mesh.Vertices.data();
+	contents.VertexStride = sizeof(Vertex);
+	contents.VertexCount = (std::uint32_t)mesh.Vertices.size();
+	contents.Indices = mesh.Indices.data();
+	contents.IndexFormat = mesh.IndexFormat;
+	contents.IndexCount = (std::uint32_t)(mesh.Indices.size() / (mesh.IndexFormat == DXGI_FORMAT_R16_UINT ? 2 : 4));
+	contents.Compress = compress;
+
+	for (std::size_t level = 0; level < mesh.LevelNames.size(); ++level)
+	{
+		const std::string& name = mesh.LevelNames[level];
+		const IndexBufferRange& range = mesh.LevelRanges[level];
+		contents.AddSubmesh(name, range.IndexCount, range.StartIndexLocation, range.BaseVertexLocation,
+			mesh.Bounds.Center, mesh.Bounds.Extents, mesh.LevelErrors[level]);
+
+		const MeshletMesh& meshlets = mesh.LevelMeshlets[level];
+		contents.AddBlob(name + ".meshlets", meshlets.Meshlets.data(), meshlets.Meshlets.size() * sizeof(Meshlet));
+		contents.AddBlob(name + ".vertices", meshlets.Vertices.data(), meshlets.Vertices.size() * sizeof(std::uint32_t));
+		contents.AddBlob(name + ".triangles", meshlets.Triangles.data(), meshlets.Triangles.size());
+	}
+	return WriteMeshCache(path, contents, source);
+}
+
+bool SameBlob(const MeshCache& cache, const std::string& name, const void* data, std::size_t size) {
+	std::size_t blobSize = 0;
+	const void* blob = cache.FindBlob(name, blobSize);
+	return blob && blobSize == size && (size == 0 || std::memcmp(blob, data, size) == 0);
+}
+
+// Whether the cache holds exactly what the cold path built.
+bool MatchesCold(const MeshCache& cache, const SkullMesh& mesh, const std::vector<std::uint8_t>& vertices, const std::vector<std::uint8_t>& indices) {
+	if (vertices.size() != mesh.Vertices.size() * sizeof(Vertex) || std::memcmp(vertices.data(), mesh.Vertices.data(), vertices.size()) != 0)
+		return false;
+	if (indices != mesh.Indices || cache.Header().IndexFormat != (std::uint32_t)mesh.IndexFormat)
+		return false;
+
+	for (std::size_t level = 0; level < mesh.LevelNames.size(); ++level)
+	{
+		const std::string& name = mesh.LevelNames[level];
+		const MeshCacheSubmesh* submesh = cache.FindSubmesh(name);
+		const IndexBufferRange& range = mesh.LevelRanges[level];
+		if (!submesh || submesh->IndexCount != range.IndexCount || submesh->StartIndexLocation != range.StartIndexLocation ||
+			submesh->BaseVertexLocation != range.BaseVertexLocation || submesh->GeometricError != mesh.LevelErrors[level])
+			return false;
+
+		const MeshletMesh& meshlets = mesh.LevelMeshlets[level];
+		if (!SameBlob(cache, name + ".meshlets", meshlets.Meshlets.data(), meshlets.Meshlets.size() * sizeof(Meshlet)) ||
+			!SameBlob(cache, name + ".vertices", meshlets.Vertices.data(), meshlets.Vertices.size() * sizeof(std::uint32_t)) ||
+			!SameBlob(cache, name + ".triangles", meshlets.Triangles.data(), meshlets.Triangles.size()))
+			return false;
+	}
+	return true;
+}
+
+}
+
+// Times MirrorApp's skull cold, from Models/skull.txt to a written mesh cache,
+// against warm, opening the cache and reading the buffers back, for a raw and a
+// compressed cache. Fails if a warm load differs from the cold build by a byte.
+// The first argument sets the number of pool threads.
+int main(int argc, char** argv) {
+	ThreadPool pool(argc > 1 ? (std::uint32_t)std::atoi(argv[1]) : 0);
+	std::printf("pool: %u threads\n", pool.Concurrency());
+
+	const std::string modelPath = "Models/skull.txt";
+	const std::string cachePath = "Models/skull.benchmark.mesh";
+	const MeshCacheSource source = GetMeshCacheSource(modelPath);
+
+	SkullMesh reference;
+	if (!BuildSkull(modelPath, reference, &pool))
+	{
+		std::printf("%s not found; run from the app directory\n", modelPath.c_str());
+		return 1;
+	}
+	std::printf("skull: %zu vertices, %zu index bytes, %zu levels\n", reference.Vertices.size(), reference.Indices.size(), reference.LevelNames.size());
+
+	int result = 0;
+	for (bool compress : { false, true })
+	{
+		const char* name = compress ? "compressed" : "raw";
+		bool written = true;
+		double coldMs = BestMilliseconds(3, [&] {
+			SkullMesh mesh;
+			written = BuildSkull(modelPath, mesh, &pool) && WriteSkull(cachePath, mesh, source, compress) && written;
+		});
+		if (!written)
+		{
+			std::printf("%s: the cache could not be written\n", name);
+			result = 1;
+			continue;
+		}
+
+		std::vector<std::uint8_t> vertices;
+		std::vector<std::uint8_t> indices;
+		bool read = true;
+		double warmMs = BestMilliseconds(20, [&] {
+			MeshCache cache;
+			bool opened = cache.Open(cachePath, source);
+			if (opened)
+			{
+				vertices.resize(cache.VertexBufferSize());
+				indices.resize(cache.IndexBufferSize());
+				opened = cache.ReadVertices(vertices.data(), &pool) && cache.ReadIndices(indices.data(), &pool);
+			}
+			read = opened && read;
+		});
+
+		// The raw cache skips the vertex copy and uploads from the mapping, as
+		// LoadSkullCache does. The indices are read either way for the meshlets.
+		double mappedMs = BestMilliseconds(20, [&] {
+			MeshCache cache;
+			if (cache.Open(cachePath, source) && !cache.MappedVertices())
+				cache.ReadVertices(vertices.data(), &pool);
+			cache.ReadIndices(indices.data(), &pool);
+		});
+
+		MeshCache cache;
+		if (!read || !cache.Open(cachePath, source) || !MatchesCold(cache, reference, vertices, indices))
+		{
+			std::printf("%s: the warm load differs from the cold build\n", name);
+			result = 1;
+		}
+		std::printf("%-10s %7llu bytes  cold %7.2f ms  warm %6.3f ms  warm as LoadSkullCache %6.3f ms\n", name,
+			cache.IsOpen() ? (unsigned long long)cache.Header().FileSize : 0ull, coldMs, warmMs, mappedMs);
+	}
+
+	std::remove(cachePath.c_str());
+	return result;
+}
@@ -0,0 +1,127 @@
+#include "MeshCodec.h"
+#include "MeshOptimizer.h"
+#include "ModelLoader.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+namespace {
+
+// Same layout as Vertex3, which the skull used before it was quantized.
+struct BenchmarkVertex {
+	DirectX::XMFLOAT3 Pos;
+	DirectX::XMFLOAT3 Normal;
+	DirectX::XMFLOAT2 TexC;
+};
+
+double NowMilliseconds() {
+	return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+template<typename Run>
+double BestMilliseconds(int repeats, Run run) {
+	double best = 1e30;
+	for (int r = 0; r < repeats; ++r)
+	{
+		double start = NowMilliseconds();
+		run();
+		best = std::min(best, NowMilliseconds() - start);
+	}
+	return best;
+}
+
+double GigabytesPerSecond(std::size_t bytes, double milliseconds) {
+	return (double)bytes / (milliseconds * 1e6);
+}
+
+}
+
+// Builds the skull the way MirrorApp does before writing its cache, encodes the
+// vertices and indices, checks that decoding gives back the same bytes, serial
+// and on the pool, and prints the sizes and the best decode throughput of
+// several runs. The first argument sets the number of pool threads.
+int main(int argc, char** argv) {
+	ThreadPool pool(argc > 1 ? (std::uint32_t)std::atoi(argv[1]) : 0);
+	std::printf("pool: %u threads\n", pool.Concurrency());
+
+	TextModel skull;
+	if (!LoadTextModel("Models/skull.txt", skull))
+	{
+		std::printf("Models/skull.txt: failed to load\n");
+		return 1;
+	}
+
+	std::vector<BenchmarkVertex> vertices(skull.Vertices.size());
+	for (std::size_t i = 0; i < vertices.size(); ++i)
+	{
+		vertices[i].Pos = skull.Vertices[i].Position;
+		vertices[i].Normal = skull.Vertices[i].Normal;
+		vertices[i].TexC = { 0.0f, 0.0f };
+	}
+	std::vector<std::uint32_t> indices = std::move(skull.Indices);
+
+	std::size_t vertexCount = vertices.size();
+	OptimizeMesh(indices, vertices.data(), vertexCount, sizeof(BenchmarkVertex), &vertices[0].Pos);
+	vertices.resize(vertexCount);
+
+	const std::size_t vertexBytes = vertices.size() * sizeof(BenchmarkVertex);
+	const std::size_t indexBytes = indices.size() * sizeof(std::uint32_t);
+
+	std::vector<std::uint8_t> encodedVertices = EncodeVertexBuffer(vertices.data(), vertices.size(), sizeof(BenchmarkVertex));
+	std::vector<std::uint8_t> encodedIndices = EncodeIndexBuffer(indices.data(), indices.size(), sizeof(std::uint32_t));
+
+	int result = 0;
+	std::vector<BenchmarkVertex> decodedVertices(vertices.size());
+	std::vector<std::uint32_t> decodedIndices(indices.size());
+	for (ThreadPool* decodePool : { (ThreadPool*)nullptr, &pool })
+	{
+		std::memset(decodedVertices.data(), 0, vertexBytes);
+		std::memset(decodedIndices.data(), 0, indexBytes);
+		bool decoded =
+			DecodeVertexBuffer(decodedVertices.data(), vertices.size(), sizeof(BenchmarkVertex), encodedVertices.data(), encodedVertices.size(), decodePool) &&
+			DecodeIndexBuffer(decodedIndices.data(), indices.size(), sizeof(std::uint32_t), encodedIndices.data(), encodedIndices.size(), decodePool);
+		if (!decoded || std::memcmp(decodedVertices.data(), vertices.data(), vertexBytes) != 0 || decodedIndices != indices)
+		{
+			std::printf("%s decode did not round-trip\n", decodePool ? "pool" : "serial");
+			result = 1;
+		}
+	}
+
+	// A damaged buffer must be rejected, not decoded into garbage.
+	if (DecodeVertexBuffer(decodedVertices.data(), vertices.size(), sizeof(BenchmarkVertex), encodedVertices.data(), encodedVertices.size() / 2) ||
+		DecodeIndexBuffer(decodedIndices.data(), indices.size(), sizeof(std::uint32_t), encodedIndices.data(), encodedIndices.size() / 2))
+	{
+		std::printf("truncated data decoded\n");
+		result = 1;
+	}
+
+	const int repeats = 20;
+	double copyVerticesMs = BestMilliseconds(repeats, [&] { std::memcpy(decodedVertices.data(), vertices.data(), vertexBytes); });
+	double serialVerticesMs = BestMilliseconds(repeats, [&] {
+		DecodeVertexBuffer(decodedVertices.data(), vertices.size(), sizeof(BenchmarkVertex), encodedVertices.data(), encodedVertices.size());
+	});
+	double poolVerticesMs = BestMilliseconds(repeats, [&] {
+		DecodeVertexBuffer(decodedVertices.data(), vertices.size(), sizeof(BenchmarkVertex), encodedVertices.data(), encodedVertices.size(), &pool);
+	});
+	double copyIndicesMs = BestMilliseconds(repeats, [&] { std::memcpy(decodedIndices.data(), indices.data(), indexBytes); });
+	double serialIndicesMs = BestMilliseconds(repeats, [&] {
+		DecodeIndexBuffer(decodedIndices.data(), indices.size(), sizeof(std::uint32_t), encodedIndices.data(), encodedIndices.size());
+	});
+	double poolIndicesMs = BestMilliseconds(repeats, [&] {
+		DecodeIndexBuffer(decodedIndices.data(), indices.size(), sizeof(std::uint32_t), encodedIndices.data(), encodedIndices.size(), &pool);
+	});
+
+	std::printf("vertices %6zu: %7zu -> %7zu bytes (%3.0f%%)  copy %5.2f GB/s  serial %5.2f GB/s  pool %5.2f GB/s\n",
+		vertices.size(), vertexBytes, encodedVertices.size(), 100.0 * encodedVertices.size() / vertexBytes,
+		GigabytesPerSecond(vertexBytes, copyVerticesMs), GigabytesPerSecond(vertexBytes, serialVerticesMs),
+		GigabytesPerSecond(vertexBytes, poolVerticesMs));
+	std::printf("indices  %6zu: %7zu -> %7zu bytes (%3.0f%%)  copy %5.2f GB/s  serial %5.2f GB/s  pool %5.2f GB/s\n",
+		indices.size(), indexBytes, encodedIndices.size(), 100.0 * encodedIndices.size() / indexBytes,
+		GigabytesPerSecond(indexBytes, copyIndicesMs), GigabytesPerSecond(indexBytes, serialIndicesMs),
+		GigabytesPerSecond(indexBytes, poolIndicesMs));
+	return result;
+}
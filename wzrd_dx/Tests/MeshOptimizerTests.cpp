@@ -0,0 +1,189 @@
+#include "Check.h"
+#include "MeshOptimizer.h"
+#include "ModelLoader.h"
+#include "TerrainGenerator.h"
+#include "TestMeshes.h"
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <random>
+
+using namespace DirectX;
+
+namespace {
+
+using Triangle = std::array<std::uint32_t, 3>;
+
+// Triangles rotated to start at their smallest index, which keeps the winding,
+// then sorted, so two lists compare equal when one reorders the other.
+std::vector<Triangle> CanonicalTriangles(const std::vector<std::uint32_t>& indices) {
+	std::vector<Triangle> triangles;
+	for (std::size_t t = 0; t + 2 < indices.size(); t += 3)
+	{
+		Triangle triangle = { indices[t], indices[t + 1], indices[t + 2] };
+		std::rotate(triangle.begin(), std::min_element(triangle.begin(), triangle.end()), triangle.end());
+		triangles.push_back(triangle);
+	}
+	std::sort(triangles.begin(), triangles.end());
+	return triangles;
+}
+
+// Same, with every index replaced by the position it refers to, for passes
+// that also renumber the vertices.
+std::vector<std::array<float, 9>> CanonicalTriangles(const std::vector<std::uint32_t>& indices, const XMFLOAT3* positions, std::size_t stride) {
+	std::vector<std::array<float, 9>> triangles;
+	for (std::size_t t = 0; t + 2 < indices.size(); t += 3)
+	{
+		std::array<std::array<float, 3>, 3> corners;
+		for (int e = 0; e < 3; ++e)
+		{
+			const XMFLOAT3& p = *(const XMFLOAT3*)((const std::uint8_t*)positions + indices[t + e] * stride);
+			corners[e] = { p.x, p.y, p.z };
+		}
+		std::rotate(corners.begin(), std::min_element(corners.begin(), corners.end()), corners.end());
+
+		std::array<float, 9> triangle;
+		for (int e = 0; e < 3; ++e)
+			std::copy(corners[e].begin(), corners[e].end(), triangle.begin() + e * 3);
+		triangles.push_back(triangle);
+	}
+	std::sort(triangles.begin(), triangles.end());
+	return triangles;
+}
+
+// Sphere with its triangles shuffled, so the passes have something to fix.
+TestMesh ShuffledSphere() {
+	TestMesh sphere = MakeSphere(64, 33);
+	std::vector<Triangle> triangles;
+	for (std::size_t t = 0; t < sphere.Indices.size(); t += 3)
+		triangles.push_back({ sphere.Indices[t], sphere.Indices[t + 1], sphere.Indices[t + 2] });
+	std::shuffle(triangles.begin(), triangles.end(), std::mt19937(7));
+
+	sphere.Indices.clear();
+	for (const Triangle& triangle : triangles)
+		sphere.Indices.insert(sphere.Indices.end(), triangle.begin(), triangle.end());
+	return sphere;
+}
+
+void TestVertexCacheKeepsTriangles() {
+	TestMesh sphere = ShuffledSphere();
+	std::vector<std::uint32_t> indices = sphere.Indices;
+
+	OptimizeVertexCache(indices.data(), indices.size(), sphere.Positions.size());
+
+	CHECK(CanonicalTriangles(indices) == CanonicalTriangles(sphere.Indices));
+	CHECK(AnalyzeVertexCache(indices.data(), indices.size(), sphere.Positions.size()).Acmr <
+		AnalyzeVertexCache(sphere.Indices.data(), sphere.Indices.size(), sphere.Positions.size()).Acmr);
+}
+
+void TestOverdrawKeepsTriangles() {
+	TestMesh sphere = ShuffledSphere();
+	std::vector<std::uint32_t> indices = sphere.Indices;
+	OptimizeVertexCache(indices.data(), indices.size(), sphere.Positions.size());
+	float cacheAcmr = AnalyzeVertexCache(indices.data(), indices.size(), sphere.Positions.size()).Acmr;
+
+	const float threshold = 1.05f;
+	OptimizeOverdraw(indices.data(), indices.size(), sphere.Positions.data(), sizeof(XMFLOAT3), sphere.Positions.size(), threshold);
+
+	CHECK(CanonicalTriangles(indices) == CanonicalTriangles(sphere.Indices));
+	CHECK(AnalyzeVertexCache(indices.data(), indices.size(), sphere.Positions.size()).Acmr <= cacheAcmr * threshold);
+}
+
+void TestAnalyzeVertexCache() {
+	// Every vertex of a lone triangle misses once.
+	std::vector<std::uint32_t> triangle = { 0, 1, 2 };
+	VertexCacheStats stats = AnalyzeVertexCache(triangle.data(), triangle.size(), 3);
+	CHECK(stats.Acmr == 3.0f);
+	CHECK(stats.Atvr == 1.0f);
+
+	// The second triangle of a quad reuses two vertices.
+	std::vector<std::uint32_t> quad = { 0, 1, 2, 2, 1, 3 };
+	stats = AnalyzeVertexCache(quad.data(), quad.size(), 4);
+	CHECK(stats.Acmr == 2.0f);
+	CHECK(stats.Atvr == 1.0f);
+}
+
+void PrintReport(const char* name, const MeshOptimizationReport& report) {
+	std::printf("%-16s ACMR %.3f -> %.3f  ATVR %.3f -> %.3f\n", name,
+		report.Before.Acmr, report.After.Acmr, report.Before.Atvr, report.After.Atvr);
+}
+
+// OptimizeMesh on the skull as MirrorApp builds it: every pass, and the vertices
+// renumbered with the same triangles in space.
+void TestSkullReport() {
+	TextModel skull;
+	CHECK(LoadTextModel("Models/skull.txt", skull));
+	if (skull.Vertices.empty())
+		return;
+
+	std::vector<ModelVertex> vertices = skull.Vertices;
+	std::vector<std::uint32_t> indices = skull.Indices;
+	std::size_t vertexCount = vertices.size();
+	MeshOptimizationReport report = OptimizeMesh(indices, vertices.data(), vertexCount, sizeof(ModelVertex), &vertices[0].Position);
+	vertices.resize(vertexCount);
+	PrintReport("skull", report);
+
+	CHECK(report.After.Acmr <= report.Before.Acmr);
+	CHECK(report.After.Atvr <= report.Before.Atvr);
+	CHECK(indices.size() == skull.Indices.size());
+	CHECK(CanonicalTriangles(indices, &vertices[0].Position, sizeof(ModelVertex)) ==
+		CanonicalTriangles(skull.Indices, &skull.Vertices[0].Position, sizeof(ModelVertex)));
+}
+
+// The finest land level of ShapesApp, which already comes in cache friendly
+// strips, and the waves grid, which is row-major and only reordered.
+void TestTerrainReport() {
+	struct Vertex {
+		XMFLOAT3 Pos;
+		XMFLOAT3 Normal;
+		XMFLOAT2 TexC;
+	};
+
+	TerrainVertexLayout layout;
+	layout.Stride = sizeof(Vertex);
+	layout.PositionOffset = offsetof(Vertex, Pos);
+	layout.NormalOffset = offsetof(Vertex, Normal);
+	layout.TexCOffset = offsetof(Vertex, TexC);
+
+	HillsTerrainDesc terrain;
+	std::vector<Vertex> vertices((std::size_t)terrain.Rows * terrain.Columns);
+	std::vector<std::uint32_t> indices(GridIndexCount(terrain.Rows, terrain.Columns));
+	GenerateHillsVertices(terrain, vertices.data(), layout);
+	GenerateGridIndices(terrain.Rows, terrain.Columns, DefaultGridStripWidth, indices.data());
+
+	std::size_t vertexCount = vertices.size();
+	MeshOptimizationReport report = OptimizeMesh(indices, vertices.data(), vertexCount, sizeof(Vertex), &vertices[0].Pos);
+	PrintReport("terrain", report);
+	CHECK(report.After.Acmr <= report.Before.Acmr);
+	CHECK(vertexCount == vertices.size());
+
+	const std::uint32_t rows = 128;
+	const std::uint32_t columns = 128;
+	std::vector<std::uint32_t> waves;
+	for (std::uint32_t i = 0; i + 1 < rows; ++i)
+	{
+		for (std::uint32_t j = 0; j + 1 < columns; ++j)
+		{
+			std::uint32_t v = i * columns + j;
+			waves.insert(waves.end(), { v, v + 1, v + columns, v + columns, v + 1, v + columns + 1 });
+		}
+	}
+	std::vector<std::uint32_t> wavesIndices = waves;
+	std::size_t wavesVertexCount = rows * columns;
+	report = OptimizeMesh(wavesIndices, nullptr, wavesVertexCount, 0, nullptr, MeshOptimize_VertexCache);
+	PrintReport("waves", report);
+	CHECK(report.After.Acmr < report.Before.Acmr);
+	CHECK(wavesVertexCount == rows * columns);
+	CHECK(CanonicalTriangles(wavesIndices) == CanonicalTriangles(waves));
+}
+
+}
+
+int main() {
+	TestAnalyzeVertexCache();
+	TestVertexCacheKeepsTriangles();
+	TestOverdrawKeepsTriangles();
+	TestSkullReport();
+	TestTerrainReport();
+	return TestResult("MeshOptimizerTests");
+}
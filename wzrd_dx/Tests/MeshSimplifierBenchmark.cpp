@@ -0,0 +1,40 @@
+#include "MeshSimplifier.h"
+#include "TestMeshes.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+
+namespace {
+
+double NowMilliseconds() {
+	return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+}
+
+// Simplifies a sphere of about a million triangles to a tenth, with free and
+// with original vertices, and prints the time and error. The first argument
+// sets the number of slices; the sphere has half as many stacks.
+int main(int argc, char** argv) {
+	std::uint32_t slices = argc > 1 ? (std::uint32_t)std::atoi(argv[1]) : 1000;
+	TestMesh sphere = MakeSphere(slices, slices / 2 + 1);
+	std::size_t triangleCount = sphere.Indices.size() / 3;
+	std::printf("sphere: %zu vertices, %zu triangles\n", sphere.Positions.size(), triangleCount);
+
+	for (bool keepOriginalVertices : { false, true })
+	{
+		SimplifyOptions options;
+		options.TargetTriangleCount = triangleCount / 10;
+		options.KeepOriginalVertices = keepOriginalVertices;
+
+		double start = NowMilliseconds();
+		SimplifyResult result = SimplifyMesh(sphere.Positions.data(), sphere.Normals.data(), sizeof(DirectX::XMFLOAT3),
+			sphere.Positions.size(), sphere.Indices.data(), sphere.Indices.size(), options);
+		double milliseconds = NowMilliseconds() - start;
+
+		std::printf("%-24s %7zu triangles (%4.1f%%) in %7.0f ms, error %.2g\n",
+			keepOriginalVertices ? "original vertices" : "optimal vertices", result.Indices.size() / 3,
+			100.0 * result.Indices.size() / sphere.Indices.size(), milliseconds, result.Error);
+	}
+	return 0;
+}
@@ -0,0 +1,141 @@
+#include "Check.h"
+#include "MeshSimplifier.h"
+#include "TestMeshes.h"
+#include <set>
+
+using namespace DirectX;
+
+namespace {
+
+float Dot(const XMFLOAT3& a, const XMFLOAT3& b) {
+	return a.x * b.x + a.y * b.y + a.z * b.z;
+}
+
+// Outward direction of the surface at p: +y for the heightfield, p itself for
+// the sphere.
+using Outward = XMFLOAT3 (*)(const XMFLOAT3& p);
+XMFLOAT3 Up(const XMFLOAT3&) { return XMFLOAT3(0.0f, 1.0f, 0.0f); }
+XMFLOAT3 FromCenter(const XMFLOAT3& p) { return p; }
+
+// Triangles whose winding points into the surface. Slivers standing on the
+// locked border of the heightfield face sideways, which is not a flip.
+std::size_t FlippedTriangles(const XMFLOAT3* positions, const std::vector<std::uint32_t>& indices, Outward outward) {
+	std::size_t flipped = 0;
+	for (std::size_t t = 0; t < indices.size() / 3; ++t)
+	{
+		const XMFLOAT3& p = positions[indices[t * 3]];
+		const XMFLOAT3& q = positions[indices[t * 3 + 1]];
+		const XMFLOAT3& r = positions[indices[t * 3 + 2]];
+		XMFLOAT3 centroid((p.x + q.x + r.x) / 3.0f, (p.y + q.y + r.y) / 3.0f, (p.z + q.z + r.z) / 3.0f);
+		if (Dot(TriangleNormal(positions, indices.data(), t), outward(centroid)) < 0.0f)
+			flipped++;
+	}
+	return flipped;
+}
+
+std::vector<XMFLOAT3> Positions(const SimplifyResult& result) {
+	std::vector<XMFLOAT3> positions;
+	for (const SimplifiedVertex& vertex : result.Vertices)
+		positions.push_back(vertex.Position);
+	return positions;
+}
+
+SimplifyResult Simplify(const TestMesh& mesh, const SimplifyOptions& options) {
+	return SimplifyMesh(mesh.Positions.data(), mesh.Normals.data(), sizeof(XMFLOAT3), mesh.Positions.size(),
+		mesh.Indices.data(), mesh.Indices.size(), options);
+}
+
+void TestReachesTargetCount() {
+	TestMesh sphere = MakeSphere(48, 25);
+	CHECK(FlippedTriangles(sphere.Positions.data(), sphere.Indices, FromCenter) == 0);
+
+	SimplifyOptions options;
+	options.TargetTriangleCount = sphere.Indices.size() / 3 / 10;
+	SimplifyResult result = Simplify(sphere, options);
+
+	std::size_t triangleCount = result.Indices.size() / 3;
+	CHECK(result.Indices.size() % 3 == 0);
+	CHECK(triangleCount <= options.TargetTriangleCount);
+	// Each collapse removes two triangles of a closed mesh.
+	CHECK(triangleCount + 2 >= options.TargetTriangleCount);
+	CHECK(result.Error > 0.0f);
+
+	for (std::uint32_t index : result.Indices)
+		CHECK(index < result.Vertices.size());
+	for (const SimplifiedVertex& vertex : result.Vertices)
+		CHECK(vertex.Source < sphere.Positions.size());
+
+	std::vector<XMFLOAT3> positions = Positions(result);
+	CHECK(FlippedTriangles(positions.data(), result.Indices, FromCenter) == 0);
+}
+
+void TestTargetError() {
+	TestMesh sphere = MakeSphere(48, 25);
+
+	SimplifyOptions options;
+	options.TargetError = 0.01f;
+	SimplifyResult result = Simplify(sphere, options);
+
+	CHECK(result.Error <= options.TargetError);
+	CHECK(result.Indices.size() < sphere.Indices.size());
+	CHECK(result.Indices.size() > sphere.Indices.size() / 100);
+}
+
+void TestLockedBorderStaysInPlace() {
+	const std::uint32_t size = 33;
+	TestMesh field = MakeHeightfield(size);
+	CHECK(FlippedTriangles(field.Positions.data(), field.Indices, Up) == 0);
+
+	SimplifyOptions options;
+	options.TargetTriangleCount = 256;
+	options.LockBoundary = true;
+	SimplifyResult result = Simplify(field, options);
+
+	CHECK(result.Indices.size() / 3 <= options.TargetTriangleCount);
+	std::vector<XMFLOAT3> positions = Positions(result);
+	CHECK(FlippedTriangles(positions.data(), result.Indices, Up) == 0);
+
+	// Every border vertex is still there, exactly where it was.
+	std::set<std::uint32_t> borderKept;
+	for (const SimplifiedVertex& vertex : result.Vertices)
+	{
+		std::uint32_t i = vertex.Source / size;
+		std::uint32_t j = vertex.Source % size;
+		if (i != 0 && j != 0 && i != size - 1 && j != size - 1)
+			continue;
+
+		const XMFLOAT3& original = field.Positions[vertex.Source];
+		CHECK(vertex.Position.x == original.x && vertex.Position.y == original.y && vertex.Position.z == original.z);
+		borderKept.insert(vertex.Source);
+	}
+	CHECK(borderKept.size() == 4 * (size - 1));
+}
+
+void TestKeepOriginalVertices() {
+	TestMesh sphere = MakeSphere(48, 25);
+
+	SimplifyOptions options;
+	options.TargetTriangleCount = sphere.Indices.size() / 3 / 4;
+	options.KeepOriginalVertices = true;
+	SimplifyResult result = Simplify(sphere, options);
+
+	CHECK(result.Vertices.empty());
+	CHECK(result.Indices.size() / 3 <= options.TargetTriangleCount);
+	for (std::size_t t = 0; t < result.Indices.size() / 3; ++t)
+	{
+		const std::uint32_t* v = &result.Indices[t * 3];
+		CHECK(v[0] < sphere.Positions.size() && v[1] < sphere.Positions.size() && v[2] < sphere.Positions.size());
+		CHECK(v[0] != v[1] && v[1] != v[2] && v[2] != v[0]);
+	}
+	CHECK(FlippedTriangles(sphere.Positions.data(), result.Indices, FromCenter) == 0);
+}
+
+}
+
+int main() {
+	TestReachesTargetCount();
+	TestTargetError();
+	TestLockedBorderStaysInPlace();
+	TestKeepOriginalVertices();
+	return TestResult("MeshSimplifierTests");
+}
@@ -0,0 +1,101 @@
+#include "ModelLoader.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+
+namespace {
+
+double NowMilliseconds() {
+	return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// The istream parse MirrorApp::BuildSkullGeometry used before ModelLoader.
+bool LoadWithIfstream(const char* path, TextModel& model) {
+	std::ifstream fin(path);
+	if (!fin)
+		return false;
+
+	std::uint32_t vcount = 0;
+	std::uint32_t tcount = 0;
+	std::string ignore;
+
+	fin >> ignore >> vcount;
+	fin >> ignore >> tcount;
+	fin >> ignore >> ignore >> ignore >> ignore;
+
+	model.Vertices.resize(vcount);
+	for (std::uint32_t i = 0; i < vcount; ++i)
+	{
+		ModelVertex& v = model.Vertices[i];
+		fin >> v.Position.x >> v.Position.y >> v.Position.z;
+		fin >> v.Normal.x >> v.Normal.y >> v.Normal.z;
+	}
+
+	fin >> ignore;
+	fin >> ignore;
+	fin >> ignore;
+
+	model.Indices.resize(3 * tcount);
+	for (std::uint32_t i = 0; i < tcount; ++i)
+		fin >> model.Indices[i * 3 + 0] >> model.Indices[i * 3 + 1] >> model.Indices[i * 3 + 2];
+
+	return (bool)fin;
+}
+
+bool SameModel(const TextModel& a, const TextModel& b) {
+	return a.Vertices.size() == b.Vertices.size() && a.Indices == b.Indices &&
+		memcmp(a.Vertices.data(), b.Vertices.data(), a.Vertices.size() * sizeof(ModelVertex)) == 0;
+}
+
+template<typename Load>
+double BestMilliseconds(int repeats, Load load) {
+	double best = 1e30;
+	for (int r = 0; r < repeats; ++r)
+	{
+		double start = NowMilliseconds();
+		load();
+		best = std::min(best, NowMilliseconds() - start);
+	}
+	return best;
+}
+
+}
+
+// Loads the shipped text models with the old istream parse and with
+// LoadTextModel, serial and on the pool, prints the best of several runs and
+// checks that all of them read the same numbers. The first argument sets the
+// number of pool threads.
+int main(int argc, char** argv) {
+	ThreadPool pool(argc > 1 ? (std::uint32_t)std::atoi(argv[1]) : 0);
+	std::printf("pool: %u threads\n", pool.Concurrency());
+
+	int result = 0;
+	for (const char* path : { "Models/skull.txt", "Models/car.txt" })
+	{
+		TextModel streamed, mapped, parallel;
+		if (!LoadWithIfstream(path, streamed) || !LoadTextModel(path, mapped) || !LoadTextModel(path, parallel, &pool))
+		{
+			std::printf("%s: failed to load\n", path);
+			result = 1;
+			continue;
+		}
+		if (!SameModel(streamed, mapped) || !SameModel(streamed, parallel))
+		{
+			std::printf("%s: LoadTextModel read different numbers than ifstream\n", path);
+			result = 1;
+		}
+
+		const int repeats = 10;
+		double streamMs = BestMilliseconds(repeats, [&] { TextModel m; LoadWithIfstream(path, m); });
+		double mappedMs = BestMilliseconds(repeats, [&] { TextModel m; LoadTextModel(path, m); });
+		double poolMs = BestMilliseconds(repeats, [&] { TextModel m; LoadTextModel(path, m, &pool); });
+
+		std::printf("%-16s %6zu vertices  ifstream %7.2f ms  mapped %6.2f ms (%.1fx)  pool %6.2f ms (%.1fx)\n", path,
+			streamed.Vertices.size(), streamMs, mappedMs, streamMs / mappedMs, poolMs, streamMs / poolMs);
+	}
+	return result;
+}
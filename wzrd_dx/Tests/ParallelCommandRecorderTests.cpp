@@ -0,0 +1,165 @@
+#include "Check.h"
+#include "ParallelCommandRecorder.h"
+#include <atomic>
+#include <stdexcept>
+
+namespace {
+
+using CommandType = RecordingCommandBackend::CommandType;
+
+int g_pipelines[4];
+
+// Draws sorted by state the way the apps submit them: the pipeline changes
+// every 64 draws and the texture every 8.
+void RecordDraws(CommandRecorder& recorder, std::uint32_t first, std::uint32_t last) {
+	for (std::uint32_t i = first; i < last; ++i)
+	{
+		recorder.SetPipelineState(&g_pipelines[(i / 64) % 4]);
+		recorder.SetGraphicsRootDescriptorTable(0, 0x100 * (i / 8));
+		recorder.DrawIndexedInstanced(36, 1, 0, 0, i);
+	}
+}
+
+// Records count draws on workerCount backends and returns the commands of all
+// of them in submission order.
+std::vector<RecordingCommandBackend::Command> RecordOn(ThreadPool& pool, std::uint32_t workerCount, std::uint32_t count,
+	DrawStats* stats = nullptr)
+{
+	std::vector<RecordingCommandBackend> backends(workerCount);
+	std::vector<CommandBackend*> backendPointers;
+	for (auto& backend : backends)
+		backendPointers.push_back(&backend);
+
+	ParallelCommandRecorder recorder(&pool);
+	recorder.SetBackends(backendPointers);
+	recorder.Record(count, [](std::uint32_t, CommandRecorder& workerRecorder, std::uint32_t first, std::uint32_t last) {
+		RecordDraws(workerRecorder, first, last);
+	});
+	if (stats)
+		*stats = recorder.Stats();
+
+	std::vector<RecordingCommandBackend::Command> commands;
+	for (const auto& backend : backends)
+		commands.insert(commands.end(), backend.Commands().begin(), backend.Commands().end());
+	return commands;
+}
+
+std::vector<std::uint32_t> DrawOrder(const std::vector<RecordingCommandBackend::Command>& commands) {
+	std::vector<std::uint32_t> order;
+	for (const auto& command : commands)
+	{
+		if (command.Type == CommandType::DrawIndexedInstanced)
+			order.push_back(command.StartInstanceLocation);
+	}
+	return order;
+}
+
+void TestParallelForRunsEveryIndexOnce() {
+	ThreadPool pool(3);
+	std::vector<std::atomic<std::uint32_t>> runs(1000);
+	for (auto& run : runs)
+		run = 0;
+
+	pool.ParallelFor((std::uint32_t)runs.size(), [&](std::uint32_t i) { ++runs[i]; });
+	for (const auto& run : runs)
+		CHECK(run == 1);
+}
+
+void TestNestedParallelForCompletes() {
+	ThreadPool pool(2);
+	std::atomic<std::uint32_t> total(0);
+	pool.ParallelFor(8, [&](std::uint32_t) {
+		pool.ParallelFor(8, [&](std::uint32_t) { ++total; });
+	});
+	CHECK(total == 64);
+}
+
+void TestParallelForRethrows() {
+	ThreadPool pool(2);
+	bool caught = false;
+	try
+	{
+		pool.ParallelFor(16, [](std::uint32_t i) {
+			if (i == 11)
+				throw std::runtime_error("task failed");
+		});
+	}
+	catch (const std::runtime_error&)
+	{
+		caught = true;
+	}
+	CHECK(caught);
+}
+
+void TestMergedListsMatchOneList() {
+	ThreadPool pool(3);
+	const std::uint32_t count = 1001;
+
+	DrawStats singleStats;
+	auto single = RecordOn(pool, 1, count, &singleStats);
+	CHECK(singleStats.DrawCalls == count);
+
+	// Every worker count draws the same items in the same order once its lists
+	// are submitted one after the other.
+	for (std::uint32_t workerCount = 2; workerCount <= 7; ++workerCount)
+	{
+		DrawStats stats;
+		auto merged = RecordOn(pool, workerCount, count, &stats);
+
+		std::vector<std::uint32_t> order = DrawOrder(merged);
+		CHECK(order == DrawOrder(single));
+		CHECK(stats.DrawCalls == count);
+
+		// Each list binds its own initial state, so splitting costs at most one
+		// pipeline and one table per extra worker.
+		CHECK(stats.StateChangesIssued >= singleStats.StateChangesIssued);
+		CHECK(stats.StateChangesIssued <= singleStats.StateChangesIssued + 2 * (workerCount - 1));
+	}
+}
+
+void TestEachListStartsWithItsState() {
+	ThreadPool pool(3);
+	const std::uint32_t workerCount = 4;
+	std::vector<RecordingCommandBackend> backends(workerCount);
+	std::vector<CommandBackend*> backendPointers;
+	for (auto& backend : backends)
+		backendPointers.push_back(&backend);
+
+	ParallelCommandRecorder recorder(&pool);
+	recorder.SetBackends(backendPointers);
+	recorder.Record(10, [](std::uint32_t, CommandRecorder& workerRecorder, std::uint32_t first, std::uint32_t last) {
+		RecordDraws(workerRecorder, first, last);
+	});
+
+	// Ranges are 3, 3, 2, 2 draws long, and a list never relies on state bound
+	// by another one.
+	const std::uint32_t drawCounts[] = { 3, 3, 2, 2 };
+	for (std::uint32_t worker = 0; worker < workerCount; ++worker)
+	{
+		const auto& commands = backends[worker].Commands();
+		CHECK(backends[worker].CountOf(CommandType::DrawIndexedInstanced) == drawCounts[worker]);
+		CHECK(commands.size() >= 2);
+		CHECK(commands[0].Type == CommandType::SetPipelineState);
+		CHECK(commands[1].Type == CommandType::SetGraphicsRootDescriptorTable);
+	}
+}
+
+void TestFewerDrawsThanWorkers() {
+	ThreadPool pool(3);
+	auto merged = RecordOn(pool, 6, 4);
+	const std::vector<std::uint32_t> expected = { 0, 1, 2, 3 };
+	CHECK(DrawOrder(merged) == expected);
+	CHECK(DrawOrder(RecordOn(pool, 3, 0)).empty());
+}
+
+}
+
+int main() {
+	TestParallelForRunsEveryIndexOnce();
+	TestNestedParallelForCompletes();
+	TestParallelForRethrows();
+	TestMergedListsMatchOneList();
+	TestEachListStartsWithItsState();
+	TestFewerDrawsThanWorkers();
+	return TestResult("ParallelCommandRecorderTests");
+}
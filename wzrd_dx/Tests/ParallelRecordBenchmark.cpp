@@ -0,0 +1,83 @@
+#include "ParallelCommandRecorder.h"
+#include <algorithm>
+#include <cstdio>
+#include <thread>
+
+namespace {
+
+// Stands in for a command list: every forwarded call costs a fixed amount of
+// work, about what a driver spends validating and encoding it.
+class CostlyCommandBackend : public CommandBackend {
+public:
+	void SetGraphicsRootSignature(const void*) override { Work(); }
+	void SetPipelineState(const void*) override { Work(); }
+	void SetGraphicsRootDescriptorTable(std::uint32_t, std::uint64_t) override { Work(); }
+	void SetGraphicsRootConstantBufferView(std::uint32_t, std::uint64_t) override { Work(); }
+	void SetGraphicsRootShaderResourceView(std::uint32_t, std::uint64_t) override { Work(); }
+	void SetGraphicsRoot32BitConstant(std::uint32_t, std::uint32_t, std::uint32_t) override { Work(); }
+	void IASetVertexBuffer(const VertexBufferBinding&) override { Work(); }
+	void IASetIndexBuffer(const IndexBufferBinding&) override { Work(); }
+	void IASetPrimitiveTopology(std::uint32_t) override { Work(); }
+	void DrawIndexedInstanced(std::uint32_t, std::uint32_t, std::uint32_t, std::int32_t, std::uint32_t) override { Work(); }
+
+	std::uint64_t Result() const { return m_state; }
+
+private:
+	void Work() {
+		for (int i = 0; i < 200; ++i)
+			m_state = m_state * 6364136223846793005ull + 1442695040888963407ull;
+	}
+
+	volatile std::uint64_t m_state = 1;
+};
+
+int g_pipelines[4];
+
+double BestRecordMilliseconds(ThreadPool& pool, std::uint32_t workerCount, std::uint32_t drawCount, int repeats) {
+	std::vector<CostlyCommandBackend> backends(workerCount);
+	std::vector<CommandBackend*> backendPointers;
+	for (auto& backend : backends)
+		backendPointers.push_back(&backend);
+
+	ParallelCommandRecorder recorder(&pool);
+	recorder.SetBackends(backendPointers);
+
+	double best = 1e30;
+	for (int r = 0; r < repeats; ++r)
+	{
+		recorder.Record(drawCount, [](std::uint32_t, CommandRecorder& workerRecorder, std::uint32_t first, std::uint32_t last) {
+			for (std::uint32_t i = first; i < last; ++i)
+			{
+				workerRecorder.SetPipelineState(&g_pipelines[(i / 256) % 4]);
+				workerRecorder.SetGraphicsRootDescriptorTable(0, 0x100 * (i / 8));
+				workerRecorder.SetGraphicsRoot32BitConstant(5, i);
+				workerRecorder.DrawIndexedInstanced(36, 1, 0, 0, 0);
+			}
+		});
+		best = std::min(best, recorder.LastRecordMilliseconds());
+	}
+	return best;
+}
+
+}
+
+// Records the same sorted draw list with 1 to N workers and prints the best
+// time of each, to check how recording scales with the worker count.
+int main() {
+	const std::uint32_t drawCount = 20000;
+	const std::uint32_t hardwareThreads = std::max(1u, std::thread::hardware_concurrency());
+	const std::uint32_t maxWorkers = std::max(8u, hardwareThreads);
+
+	ThreadPool pool(maxWorkers - 1);
+	std::printf("%u draws, %u hardware threads\n", drawCount, hardwareThreads);
+
+	double single = 0.0;
+	for (std::uint32_t workerCount = 1; workerCount <= maxWorkers; workerCount *= 2)
+	{
+		double ms = BestRecordMilliseconds(pool, workerCount, drawCount, 10);
+		if (workerCount == 1)
+			single = ms;
+		std::printf("%2u workers: %8.3f ms  %5.2fx\n", workerCount, ms, single / ms);
+	}
+	return 0;
+}
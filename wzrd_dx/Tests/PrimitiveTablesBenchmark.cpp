@@ -0,0 +1,139 @@
+#include "GeometryGenerator.h"
+#include "MeshOptimizer.h"
+#include "PrimitiveTables.h"
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+using namespace DirectX;
+
+namespace {
+
+// Vertex2 of ShapesApp.
+struct Vertex {
+	XMFLOAT3 Pos;
+	XMFLOAT3 Normal;
+	XMFLOAT2 TexC;
+};
+
+using Triangle = std::array<std::uint32_t, 3>;
+
+double NowMilliseconds() {
+	return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+template<typename Run>
+double BestMilliseconds(int repeats, Run run) {
+	double best = 1e30;
+	for (int r = 0; r < repeats; ++r)
+	{
+		double start = NowMilliseconds();
+		run();
+		best = std::min(best, NowMilliseconds() - start);
+	}
+	return best;
+}
+
+// Triangles rotated to start at their smallest index, which keeps the winding,
+// then sorted.
+template<typename Index>
+std::vector<Triangle> CanonicalTriangles(const Index* indices, std::size_t indexCount) {
+	std::vector<Triangle> triangles;
+	for (std::size_t t = 0; t + 2 < indexCount; t += 3)
+	{
+		Triangle triangle = { indices[t], indices[t + 1], indices[t + 2] };
+		std::rotate(triangle.begin(), std::min_element(triangle.begin(), triangle.end()), triangle.end());
+		triangles.push_back(triangle);
+	}
+	std::sort(triangles.begin(), triangles.end());
+	return triangles;
+}
+
+// The box of ShapesApp, as BuildBoxGeometry built it before the table:
+// WriteBox into the vertex blob, 32-bit indices through OptimizeMesh, then the
+// copy down to 16 bits.
+std::size_t BuildGenerated(std::vector<Vertex>& vertices, std::vector<std::uint32_t>& indices, std::vector<std::uint16_t>& indices16) {
+	GeometryGenerator geoGen;
+	Vertex* out = vertices.data();
+	geoGen.WriteBox(8.0f, 8.0f, 8.0f, 3, [out](std::uint32_t i, const GeometryGenerator::Vertex& v) {
+		out[i].Pos = v.Position;
+		out[i].Normal = v.Normal;
+		out[i].TexC = v.TexC;
+	}, indices.data());
+
+	std::size_t vertexCount = vertices.size();
+	OptimizeMesh(indices, out, vertexCount, sizeof(Vertex), &out[0].Pos);
+	for (std::size_t i = 0; i < indices.size(); ++i)
+		indices16[i] = (std::uint16_t)indices[i];
+	return vertexCount;
+}
+
+}
+
+// Times the ShapesApp box built at startup with WriteBox and OptimizeMesh
+// against copying the MakeBoxTable<Vertex2, 8> the compiler built, checks that
+// the table holds the vertices and triangles of WriteBox, and prints the ACMR
+// of both orders. The first argument sets the number of runs.
+int main(int argc, char** argv) {
+	const int repeats = argc > 1 ? std::atoi(argv[1]) : 20;
+	static constexpr auto box = MakeBoxTable<Vertex, 8>(8.0f, 8.0f, 8.0f);
+	const GeometryGenerator::MeshSize size = GeometryGenerator::BoxSize(3);
+
+	int result = 0;
+	if (size.VertexCount != box.Vertices.size() || size.IndexCount != box.Indices.size())
+	{
+		std::printf("table is %zu vertices and %zu indices, WriteBox %u and %u\n",
+			box.Vertices.size(), box.Indices.size(), size.VertexCount, size.IndexCount);
+		return 1;
+	}
+
+	// The unoptimized WriteBox output is what the table must reproduce.
+	GeometryGenerator geoGen;
+	std::vector<Vertex> written(size.VertexCount);
+	std::vector<std::uint32_t> writtenIndices(size.IndexCount);
+	Vertex* out = written.data();
+	geoGen.WriteBox(8.0f, 8.0f, 8.0f, 3, [out](std::uint32_t i, const GeometryGenerator::Vertex& v) {
+		out[i].Pos = v.Position;
+		out[i].Normal = v.Normal;
+		out[i].TexC = v.TexC;
+	}, writtenIndices.data());
+
+	if (std::memcmp(written.data(), box.Vertices.data(), box.VertexBufferByteSize()) != 0)
+	{
+		std::printf("table vertices differ from WriteBox\n");
+		result = 1;
+	}
+	if (CanonicalTriangles(writtenIndices.data(), writtenIndices.size()) != CanonicalTriangles(box.Indices.data(), box.Indices.size()))
+	{
+		std::printf("table triangles differ from WriteBox\n");
+		result = 1;
+	}
+
+	std::vector<Vertex> vertices(size.VertexCount);
+	std::vector<std::uint32_t> indices(size.IndexCount);
+	std::vector<std::uint16_t> indices16(size.IndexCount);
+	std::size_t vertexCount = 0;
+	double generatedMs = BestMilliseconds(repeats, [&] {
+		indices.resize(size.IndexCount);
+		vertexCount = BuildGenerated(vertices, indices, indices16);
+	});
+
+	std::vector<Vertex> tableVertices(box.Vertices.size());
+	std::vector<std::uint16_t> tableIndices(box.Indices.size());
+	double tableMs = BestMilliseconds(repeats, [&] {
+		std::memcpy(tableVertices.data(), box.Vertices.data(), box.VertexBufferByteSize());
+		std::memcpy(tableIndices.data(), box.Indices.data(), box.IndexBufferByteSize());
+	});
+
+	std::vector<std::uint32_t> tableIndices32(box.Indices.data(), box.Indices.data() + box.Indices.size());
+	std::printf("box: %u vertices, %u triangles, best of %d runs\n", size.VertexCount, size.IndexCount / 3, repeats);
+	std::printf("WriteBox + OptimizeMesh %8.1f us  ACMR %.3f  (%zu vertices kept)\n", generatedMs * 1000.0,
+		AnalyzeVertexCache(indices.data(), indices.size(), vertexCount).Acmr, vertexCount);
+	std::printf("MakeBoxTable copy       %8.1f us  ACMR %.3f\n", tableMs * 1000.0,
+		AnalyzeVertexCache(tableIndices32.data(), tableIndices32.size(), box.Vertices.size()).Acmr);
+	return result;
+}
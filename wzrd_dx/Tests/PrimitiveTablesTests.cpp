@@ -0,0 +1,92 @@
+#include "Check.h"
+#include "PrimitiveTables.h"
+#include <cmath>
+
+using namespace DirectX;
+
+namespace {
+
+// Vertex2 of ShapesApp and the colour cube vertex of BoxApp.
+struct Vertex {
+	XMFLOAT3 Pos;
+	XMFLOAT3 Normal;
+	XMFLOAT2 TexC;
+};
+
+struct ColorVertex {
+	XMFLOAT3 Pos;
+	XMFLOAT4 Color;
+};
+
+// The table ShapesApp builds, evaluated within the constexpr budget set for
+// this test in CMakeLists.txt.
+static constexpr auto box = MakeBoxTable<Vertex, 8>(8.0f, 8.0f, 8.0f);
+static constexpr auto cube = MakeColorCubeTable<ColorVertex>();
+
+static_assert(box.Vertices.size() == 6 * 9 * 9, "box vertex count");
+static_assert(box.Indices.size() == 36 * 8 * 8, "box index count");
+static_assert(box.VertexBufferByteSize() == 6 * 9 * 9 * sizeof(Vertex), "box vertex buffer size");
+
+XMFLOAT3 Subtract(const XMFLOAT3& a, const XMFLOAT3& b) { return XMFLOAT3(a.x - b.x, a.y - b.y, a.z - b.z); }
+
+float Dot(const XMFLOAT3& a, const XMFLOAT3& b) { return a.x * b.x + a.y * b.y + a.z * b.z; }
+
+XMFLOAT3 Cross(const XMFLOAT3& a, const XMFLOAT3& b) {
+	return XMFLOAT3(a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x);
+}
+
+void TestBoxVertices() {
+	for (std::size_t i = 0; i < box.Vertices.size(); ++i)
+	{
+		const Vertex& v = box.Vertices[i];
+
+		// Every vertex lies on the face its normal points out of.
+		float onFace = Dot(v.Pos, v.Normal);
+		CHECK(std::fabs(onFace - 4.0f) < 1e-5f);
+		CHECK(std::fabs(v.Pos.x) <= 4.0f && std::fabs(v.Pos.y) <= 4.0f && std::fabs(v.Pos.z) <= 4.0f);
+		CHECK(v.TexC.x >= 0.0f && v.TexC.x <= 1.0f && v.TexC.y >= 0.0f && v.TexC.y <= 1.0f);
+	}
+}
+
+void TestBoxTriangles() {
+	std::size_t degenerate = 0;
+	std::size_t inward = 0;
+	for (std::size_t t = 0; t < box.Indices.size(); t += 3)
+	{
+		std::uint16_t i0 = box.Indices[t + 0];
+		std::uint16_t i1 = box.Indices[t + 1];
+		std::uint16_t i2 = box.Indices[t + 2];
+		CHECK(i0 < box.Vertices.size() && i1 < box.Vertices.size() && i2 < box.Vertices.size());
+
+		const Vertex& a = box.Vertices[i0];
+		const Vertex& b = box.Vertices[i1];
+		const Vertex& c = box.Vertices[i2];
+
+		// Same winding as CreateBox: with D3D's left-handed coordinates the
+		// cross product of the edges points out of the face.
+		XMFLOAT3 n = Cross(Subtract(b.Pos, a.Pos), Subtract(c.Pos, a.Pos));
+		float facing = Dot(n, a.Normal);
+		if (facing == 0.0f)
+			degenerate++;
+		else if (facing < 0.0f)
+			inward++;
+	}
+	CHECK(degenerate == 0);
+	CHECK(inward == 0);
+}
+
+void TestColorCube() {
+	for (std::size_t i = 0; i < cube.Indices.size(); ++i)
+		CHECK(cube.Indices[i] < 8);
+	for (std::size_t i = 0; i < cube.Vertices.size(); ++i)
+		CHECK(std::fabs(cube.Vertices[i].Pos.x) == 1.0f && cube.Vertices[i].Color.w == 1.0f);
+}
+
+}
+
+int main() {
+	TestBoxVertices();
+	TestBoxTriangles();
+	TestColorCube();
+	return TestResult("PrimitiveTablesTests");
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+// The part of DirectXCollision the portable modules use.
+#include <DirectXMath.h>
+#include <algorithm>
+#include <cfloat>
+#include <cstddef>
+#include <cstdint>
+
+namespace DirectX {
+
+struct BoundingBox {
+	XMFLOAT3 Center = { 0.0f, 0.0f, 0.0f };
+	XMFLOAT3 Extents = { 1.0f, 1.0f, 1.0f };
+
+	BoundingBox() = default;
+	BoundingBox(const XMFLOAT3& center, const XMFLOAT3& extents) : Center(center), Extents(extents) {}
+
+	// Box around the eight transformed corners.
+	void Transform(BoundingBox& out, FXMMATRIX m) const {
+		float minP[3] = { FLT_MAX, FLT_MAX, FLT_MAX };
+		float maxP[3] = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+		for (int i = 0; i < 8; ++i)
+		{
+			XMFLOAT3 corner(Center.x + (i & 1 ? Extents.x : -Extents.x), Center.y + (i & 2 ? Extents.y : -Extents.y),
+				Center.z + (i & 4 ? Extents.z : -Extents.z));
+			XMFLOAT3 p;
+			XMStoreFloat3(&p, XMVector3TransformCoord(XMLoadFloat3(&corner), m));
+			const float c[3] = { p.x, p.y, p.z };
+			for (int k = 0; k < 3; ++k)
+			{
+				minP[k] = std::min(minP[k], c[k]);
+				maxP[k] = std::max(maxP[k], c[k]);
+			}
+		}
+		out.Center = XMFLOAT3(0.5f * (minP[0] + maxP[0]), 0.5f * (minP[1] + maxP[1]), 0.5f * (minP[2] + maxP[2]));
+		out.Extents = XMFLOAT3(0.5f * (maxP[0] - minP[0]), 0.5f * (maxP[1] - minP[1]), 0.5f * (maxP[2] - minP[2]));
+	}
+
+	static void CreateFromPoints(BoundingBox& out, std::size_t count, const XMFLOAT3* points, std::size_t stride) {
+		float minP[3] = { FLT_MAX, FLT_MAX, FLT_MAX };
+		float maxP[3] = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+		for (std::size_t i = 0; i < count; ++i)
+		{
+			const XMFLOAT3& p = *(const XMFLOAT3*)((const std::uint8_t*)points + i * stride);
+			const float c[3] = { p.x, p.y, p.z };
+			for (int k = 0; k < 3; ++k)
+			{
+				minP[k] = std::min(minP[k], c[k]);
+				maxP[k] = std::max(maxP[k], c[k]);
+			}
+		}
+		out.Center = XMFLOAT3(0.5f * (minP[0] + maxP[0]), 0.5f * (minP[1] + maxP[1]), 0.5f * (minP[2] + maxP[2]));
+		out.Extents = XMFLOAT3(0.5f * (maxP[0] - minP[0]), 0.5f * (maxP[1] - minP[1]), 0.5f * (maxP[2] - minP[2]));
+	}
+};
+
+}
@@ -0,0 +1,168 @@
+#pragma once
+
+// The part of DirectXMath the portable modules use, on SSE2. XMVectorSinCos
+// uses the same range reduction and polynomials as the real one, so the
+// terrain comes out the same as on Windows.
+#include <cmath>
+#include <cstdint>
+#include <emmintrin.h>
+
+#define XM_CALLCONV
+
+namespace DirectX {
+
+constexpr float XM_PI = 3.141592654f;
+constexpr float XM_2PI = 6.283185307f;
+
+struct XMFLOAT2 {
+	float x, y;
+	XMFLOAT2() = default;
+	constexpr XMFLOAT2(float _x, float _y) : x(_x), y(_y) {}
+};
+
+struct XMFLOAT3 {
+	float x, y, z;
+	XMFLOAT3() = default;
+	constexpr XMFLOAT3(float _x, float _y, float _z) : x(_x), y(_y), z(_z) {}
+};
+
+struct XMFLOAT4 {
+	float x, y, z, w;
+	XMFLOAT4() = default;
+	constexpr XMFLOAT4(float _x, float _y, float _z, float _w) : x(_x), y(_y), z(_z), w(_w) {}
+};
+
+struct alignas(16) XMFLOAT4A : public XMFLOAT4 {
+	using XMFLOAT4::XMFLOAT4;
+	XMFLOAT4A() = default;
+};
+
+typedef __m128 XMVECTOR;
+typedef const XMVECTOR FXMVECTOR;
+
+// Row vectors, as in DirectXMath. The arithmetic operators on XMVECTOR come
+// from the compiler's vector extensions.
+struct XMMATRIX {
+	XMVECTOR r[4];
+};
+typedef const XMMATRIX& FXMMATRIX;
+
+inline XMVECTOR XMVectorZero() { return _mm_setzero_ps(); }
+inline XMVECTOR XMVectorSplatOne() { return _mm_set1_ps(1.0f); }
+inline XMVECTOR XMVectorReplicate(float value) { return _mm_set1_ps(value); }
+inline XMVECTOR XMVectorSet(float x, float y, float z, float w) { return _mm_set_ps(w, z, y, x); }
+inline float XMVectorGetX(FXMVECTOR v) { return _mm_cvtss_f32(v); }
+
+inline XMVECTOR XMLoadFloat2(const XMFLOAT2* source) { return _mm_set_ps(0.0f, 0.0f, source->y, source->x); }
+inline XMVECTOR XMLoadFloat3(const XMFLOAT3* source) { return _mm_set_ps(0.0f, source->z, source->y, source->x); }
+inline XMVECTOR XMLoadFloat4(const XMFLOAT4* source) { return _mm_loadu_ps(&source->x); }
+
+inline void XMStoreFloat2(XMFLOAT2* destination, FXMVECTOR v) {
+	float t[4];
+	_mm_storeu_ps(t, v);
+	destination->x = t[0];
+	destination->y = t[1];
+}
+inline void XMStoreFloat3(XMFLOAT3* destination, FXMVECTOR v) {
+	float t[4];
+	_mm_storeu_ps(t, v);
+	destination->x = t[0];
+	destination->y = t[1];
+	destination->z = t[2];
+}
+inline void XMStoreFloat4(XMFLOAT4* destination, FXMVECTOR v) { _mm_storeu_ps(&destination->x, v); }
+inline void XMStoreFloat4A(XMFLOAT4A* destination, FXMVECTOR v) { _mm_store_ps(&destination->x, v); }
+
+inline XMVECTOR XMVectorMultiply(FXMVECTOR a, FXMVECTOR b) { return _mm_mul_ps(a, b); }
+inline XMVECTOR XMVectorMultiplyAdd(FXMVECTOR a, FXMVECTOR b, FXMVECTOR c) { return _mm_add_ps(_mm_mul_ps(a, b), c); }
+inline XMVECTOR XMVectorDivide(FXMVECTOR a, FXMVECTOR b) { return _mm_div_ps(a, b); }
+inline XMVECTOR XMVectorScale(FXMVECTOR v, float scale) { return _mm_mul_ps(v, _mm_set1_ps(scale)); }
+inline XMVECTOR XMVectorSqrt(FXMVECTOR v) { return _mm_sqrt_ps(v); }
+
+inline XMVECTOR XMVector3Dot(FXMVECTOR a, FXMVECTOR b) {
+	float t[4];
+	_mm_storeu_ps(t, _mm_mul_ps(a, b));
+	return _mm_set1_ps(t[0] + t[1] + t[2]);
+}
+inline XMVECTOR XMVector3LengthSq(FXMVECTOR v) { return XMVector3Dot(v, v); }
+inline XMVECTOR XMVector3Length(FXMVECTOR v) { return _mm_sqrt_ps(XMVector3Dot(v, v)); }
+inline XMVECTOR XMVector3Normalize(FXMVECTOR v) {
+	float length = XMVectorGetX(XMVector3Length(v));
+	return length > 0.0f ? _mm_div_ps(v, _mm_set1_ps(length)) : v;
+}
+inline XMVECTOR XMVector3Cross(FXMVECTOR a, FXMVECTOR b) {
+	XMVECTOR a1 = _mm_shuffle_ps(a, a, _MM_SHUFFLE(3, 0, 2, 1));
+	XMVECTOR b1 = _mm_shuffle_ps(b, b, _MM_SHUFFLE(3, 1, 0, 2));
+	XMVECTOR a2 = _mm_shuffle_ps(a, a, _MM_SHUFFLE(3, 1, 0, 2));
+	XMVECTOR b2 = _mm_shuffle_ps(b, b, _MM_SHUFFLE(3, 0, 2, 1));
+	return _mm_sub_ps(_mm_mul_ps(a1, b1), _mm_mul_ps(a2, b2));
+}
+
+inline XMVECTOR XMVector4Dot(FXMVECTOR a, FXMVECTOR b) {
+	float t[4];
+	_mm_storeu_ps(t, _mm_mul_ps(a, b));
+	return _mm_set1_ps(t[0] + t[1] + t[2] + t[3]);
+}
+
+inline XMMATRIX XMMatrixTranspose(FXMMATRIX m) {
+	XMMATRIX t = m;
+	_MM_TRANSPOSE4_PS(t.r[0], t.r[1], t.r[2], t.r[3]);
+	return t;
+}
+
+inline XMVECTOR XMVector3TransformNormal(FXMVECTOR v, FXMMATRIX m) {
+	float t[4];
+	_mm_storeu_ps(t, v);
+	return _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(t[0]), m.r[0]), _mm_mul_ps(_mm_set1_ps(t[1]), m.r[1])),
+		_mm_mul_ps(_mm_set1_ps(t[2]), m.r[2]));
+}
+inline XMVECTOR XMVector3TransformCoord(FXMVECTOR v, FXMMATRIX m) {
+	XMVECTOR r = _mm_add_ps(XMVector3TransformNormal(v, m), m.r[3]);
+	return _mm_div_ps(r, _mm_shuffle_ps(r, r, _MM_SHUFFLE(3, 3, 3, 3)));
+}
+
+// Planes are (a, b, c, d) with a x + b y + c z + d = 0.
+inline XMVECTOR XMPlaneNormalize(FXMVECTOR p) {
+	float length = XMVectorGetX(XMVector3Length(p));
+	return length > 0.0f ? _mm_div_ps(p, _mm_set1_ps(length)) : p;
+}
+inline XMVECTOR XMPlaneDotCoord(FXMVECTOR p, FXMVECTOR v) {
+	return XMVector4Dot(p, _mm_or_ps(_mm_and_ps(v, _mm_castsi128_ps(_mm_set_epi32(0, -1, -1, -1))), _mm_set_ps(1.0f, 0.0f, 0.0f, 0.0f)));
+}
+
+inline void XMVectorSinCos(XMVECTOR* sin, XMVECTOR* cos, FXMVECTOR v) {
+	// Map v to [-pi, pi], then to [-pi/2, pi/2] with sin(y) = sin(pi - y).
+	XMVECTOR quotient = _mm_mul_ps(v, _mm_set1_ps(0.159154943f));
+	quotient = _mm_cvtepi32_ps(_mm_cvtps_epi32(quotient));
+	XMVECTOR x = _mm_sub_ps(v, _mm_mul_ps(quotient, _mm_set1_ps(6.283185307f)));
+
+	XMVECTOR sign = _mm_and_ps(x, _mm_castsi128_ps(_mm_set1_epi32((int)0x80000000)));
+	XMVECTOR c = _mm_or_ps(_mm_set1_ps(3.141592654f), sign);
+	XMVECTOR absX = _mm_andnot_ps(sign, x);
+	XMVECTOR reflected = _mm_sub_ps(c, x);
+	XMVECTOR inRange = _mm_cmple_ps(absX, _mm_set1_ps(1.570796327f));
+	x = _mm_or_ps(_mm_and_ps(inRange, x), _mm_andnot_ps(inRange, reflected));
+	XMVECTOR cosSign = _mm_or_ps(_mm_and_ps(inRange, _mm_set1_ps(1.0f)), _mm_andnot_ps(inRange, _mm_set1_ps(-1.0f)));
+
+	XMVECTOR x2 = _mm_mul_ps(x, x);
+
+	// 11-degree minimax approximation of sin.
+	XMVECTOR r = _mm_set1_ps(-2.3889859e-08f);
+	r = _mm_add_ps(_mm_mul_ps(r, x2), _mm_set1_ps(2.7525562e-06f));
+	r = _mm_add_ps(_mm_mul_ps(r, x2), _mm_set1_ps(-0.00019840874f));
+	r = _mm_add_ps(_mm_mul_ps(r, x2), _mm_set1_ps(0.0083333310f));
+	r = _mm_add_ps(_mm_mul_ps(r, x2), _mm_set1_ps(-0.16666667f));
+	r = _mm_add_ps(_mm_mul_ps(r, x2), _mm_set1_ps(1.0f));
+	*sin = _mm_mul_ps(r, x);
+
+	// 10-degree minimax approximation of cos.
+	r = _mm_set1_ps(-2.6051615e-07f);
+	r = _mm_add_ps(_mm_mul_ps(r, x2), _mm_set1_ps(2.4760495e-05f));
+	r = _mm_add_ps(_mm_mul_ps(r, x2), _mm_set1_ps(-0.0013888378f));
+	r = _mm_add_ps(_mm_mul_ps(r, x2), _mm_set1_ps(0.041666638f));
+	r = _mm_add_ps(_mm_mul_ps(r, x2), _mm_set1_ps(-0.5f));
+	r = _mm_add_ps(_mm_mul_ps(r, x2), _mm_set1_ps(1.0f));
+	*cos = _mm_mul_ps(r, cosSign);
+}
+
+}
@@ -0,0 +1,165 @@
+#include "DDSParser.h"
+#include "MappedFile.h"
+#include "MeshOptimizer.h"
+#include "Meshlets.h"
+#include "ModelLoader.h"
+#include "TaskGraph.h"
+#include "TerrainGenerator.h"
+#include "ThreadPool.h"
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+using namespace DirectX;
+
+namespace {
+
+// Vertex2 of ShapesApp.
+struct Vertex {
+	XMFLOAT3 Pos;
+	XMFLOAT3 Normal;
+	XMFLOAT2 TexC;
+};
+
+const char* const TexturePaths[] = {
+	"Textures/bricks3.dds", "Textures/checkboard.dds", "Textures/grass.dds", "Textures/ice.dds", "Textures/tree01S.dds",
+	"Textures/treeArray2.dds", "Textures/water1.dds", "Textures/white1x1.dds", "Textures/WireFence.dds", "Textures/WoodCrate01.dds",
+};
+
+// What the stages of the startup graph produce, minus the device.
+struct Scene {
+	std::vector<std::vector<std::uint8_t>> Textures;
+	TextModel Skull;
+	MeshletMesh SkullMeshlets;
+	std::vector<Vertex> Land;
+	std::vector<std::uint32_t> LandIndices;
+	std::vector<std::uint32_t> WavesIndices;
+	std::size_t Bytes = 0;
+};
+
+// The shape of the apps' startup graph, with the stages that only need the CPU:
+// textures parsed and copied as for an upload, the skull parsed, optimized and
+// split into meshlets, the land and waves grids, and a last stage that needs
+// all of them, like the render items.
+void AddStartupTasks(TaskGraph& graph, Scene& scene, ThreadPool* pool) {
+	auto textures = graph.Add("textures", [&scene] {
+		for (const char* path : TexturePaths)
+		{
+			MappedFile file;
+			DDSTexture texture;
+			if (!file.Open(std::string(path)) || !ParseDDS((const std::uint8_t*)file.Data(), file.Size(), texture))
+				continue;
+			std::vector<std::uint8_t> pixels;
+			for (const DDSSubresource& subresource : texture.Subresources)
+				pixels.insert(pixels.end(), subresource.Data, subresource.Data + subresource.SlicePitch * subresource.Depth);
+			scene.Textures.push_back(std::move(pixels));
+		}
+	});
+
+	auto skull = graph.Add("skull", [&scene, pool] { LoadTextModel("Models/skull.txt", scene.Skull, pool); });
+	auto skullOptimize = graph.Add("skull optimize", [&scene] {
+		if (scene.Skull.Vertices.empty())
+			return;
+		std::size_t vertexCount = scene.Skull.Vertices.size();
+		OptimizeMesh(scene.Skull.Indices, scene.Skull.Vertices.data(), vertexCount, sizeof(ModelVertex), &scene.Skull.Vertices[0].Position);
+		scene.Skull.Vertices.resize(vertexCount);
+	}, { skull });
+	auto skullMeshlets = graph.Add("skull meshlets", [&scene] {
+		if (scene.Skull.Vertices.empty())
+			return;
+		scene.SkullMeshlets = BuildMeshlets(scene.Skull.Indices.data(), scene.Skull.Indices.size(),
+			&scene.Skull.Vertices[0].Position, sizeof(ModelVertex), scene.Skull.Vertices.size());
+	}, { skullOptimize });
+
+	auto land = graph.Add("land", [&scene, pool] {
+		TerrainVertexLayout layout;
+		layout.Stride = sizeof(Vertex);
+		layout.PositionOffset = offsetof(Vertex, Pos);
+		layout.NormalOffset = offsetof(Vertex, Normal);
+		layout.TexCOffset = offsetof(Vertex, TexC);
+
+		HillsTerrainDesc desc;
+		desc.Rows = 257;
+		desc.Columns = 257;
+		scene.Land.resize((std::size_t)desc.Rows * desc.Columns);
+		scene.LandIndices.resize(GridIndexCount(desc.Rows, desc.Columns));
+		GenerateHillsVertices(desc, scene.Land.data(), layout, pool);
+		GenerateGridIndices(desc.Rows, desc.Columns, DefaultGridStripWidth, scene.LandIndices.data(), pool);
+	});
+
+	auto waves = graph.Add("waves", [&scene] {
+		const std::uint32_t size = 128;
+		for (std::uint32_t i = 0; i + 1 < size; ++i)
+		{
+			for (std::uint32_t j = 0; j + 1 < size; ++j)
+			{
+				std::uint32_t v = i * size + j;
+				scene.WavesIndices.insert(scene.WavesIndices.end(), { v, v + 1, v + size, v + size, v + 1, v + size + 1 });
+			}
+		}
+		std::size_t vertexCount = size * size;
+		OptimizeMesh(scene.WavesIndices, nullptr, vertexCount, 0, nullptr, MeshOptimize_VertexCache);
+	});
+
+	graph.Add("scene", [&scene] {
+		for (const std::vector<std::uint8_t>& pixels : scene.Textures)
+			scene.Bytes += pixels.size();
+		scene.Bytes += scene.SkullMeshlets.Indices.size() * sizeof(std::uint32_t) + scene.Land.size() * sizeof(Vertex) +
+			scene.LandIndices.size() * sizeof(std::uint32_t) + scene.WavesIndices.size() * sizeof(std::uint32_t);
+	}, { textures, skullMeshlets, land, waves });
+}
+
+// Start and end of every task, and whether each started after everything it
+// depends on had ended.
+bool PrintTimings(const TaskGraph& graph, const std::vector<std::vector<TaskGraph::TaskId>>& dependencies) {
+	bool ordered = true;
+	for (TaskGraph::TaskId task = 0; task < graph.TaskCount(); ++task)
+	{
+		const TaskGraph::TaskTiming& timing = graph.Timing(task);
+		std::printf("  %-16s %8.2f -> %8.2f ms%s\n", graph.TaskName(task).c_str(), timing.StartMilliseconds, timing.EndMilliseconds,
+			timing.Ran ? "" : "  (skipped)");
+		for (TaskGraph::TaskId dependency : dependencies[task])
+		{
+			if (graph.Timing(dependency).EndMilliseconds > timing.StartMilliseconds)
+			{
+				std::printf("  %s started before %s ended\n", graph.TaskName(task).c_str(), graph.TaskName(dependency).c_str());
+				ordered = false;
+			}
+		}
+	}
+	std::printf("  run %.2f ms, work %.2f ms\n", graph.LastRunMilliseconds(), graph.LastWorkMilliseconds());
+	return ordered;
+}
+
+}
+
+// Runs the CPU side of the apps' startup graph one task after another and on
+// the pool, and prints when each stage started and ended. Fails if a stage
+// started before one it depends on had ended. The first argument sets the
+// number of pool threads. Run from the app directory.
+int main(int argc, char** argv) {
+	ThreadPool pool(argc > 1 ? (std::uint32_t)std::atoi(argv[1]) : 0);
+	std::printf("pool: %u threads\n", pool.Concurrency());
+
+	// Task ids in Add order, as AddStartupTasks declares them.
+	const std::vector<std::vector<TaskGraph::TaskId>> dependencies = { {}, {}, { 1 }, { 2 }, {}, {}, { 0, 3, 4, 5 } };
+
+	int result = 0;
+	for (ThreadPool* runPool : { (ThreadPool*)nullptr, &pool })
+	{
+		Scene scene;
+		TaskGraph graph;
+		AddStartupTasks(graph, scene, runPool);
+		graph.Run(runPool);
+
+		std::printf("%s: %zu textures, %zu skull meshlets, %zu bytes\n", runPool ? "pool" : "serial",
+			scene.Textures.size(), scene.SkullMeshlets.Meshlets.size(), scene.Bytes);
+		if (!PrintTimings(graph, dependencies) || scene.Textures.size() != sizeof(TexturePaths) / sizeof(TexturePaths[0]) ||
+			scene.SkullMeshlets.Meshlets.empty())
+			result = 1;
+	}
+	return result;
+}
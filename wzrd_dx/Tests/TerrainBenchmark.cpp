@@ -0,0 +1,146 @@
+#include "MeshOptimizer.h"
+#include "TerrainGenerator.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+using namespace DirectX;
+
+namespace {
+
+// Vertex2 of ShapesApp.
+struct Vertex {
+	XMFLOAT3 Pos;
+	XMFLOAT3 Normal;
+	XMFLOAT2 TexC;
+};
+
+double NowMilliseconds() {
+	return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// The path BuildLandGeometry took before TerrainGenerator: CreateGrid's
+// vertices and row-major indices, then the scalar height and normal per vertex.
+void GenerateScalar(const HillsTerrainDesc& desc, std::vector<Vertex>& vertices, std::vector<std::uint32_t>& indices) {
+	const std::uint32_t m = desc.Rows;
+	const std::uint32_t n = desc.Columns;
+	const float halfWidth = 0.5f * desc.Width;
+	const float halfDepth = 0.5f * desc.Depth;
+	const float dx = desc.Width / (n - 1);
+	const float dz = desc.Depth / (m - 1);
+	const float du = 1.0f / (n - 1);
+	const float dv = 1.0f / (m - 1);
+
+	vertices.resize((std::size_t)m * n);
+	for (std::uint32_t i = 0; i < m; ++i)
+	{
+		float z = halfDepth - i * dz;
+		for (std::uint32_t j = 0; j < n; ++j)
+		{
+			float x = -halfWidth + j * dx;
+			Vertex& v = vertices[(std::size_t)i * n + j];
+			v.Pos = XMFLOAT3(x, HillsHeight(desc, x, z), z);
+			v.Normal = HillsNormal(desc, x, z);
+			v.TexC = XMFLOAT2(j * du, i * dv);
+		}
+	}
+
+	indices.resize((std::size_t)(m - 1) * (n - 1) * 6);
+	std::size_t k = 0;
+	for (std::uint32_t i = 0; i < m - 1; ++i)
+	{
+		for (std::uint32_t j = 0; j < n - 1; ++j)
+		{
+			indices[k + 0] = i * n + j;
+			indices[k + 1] = i * n + j + 1;
+			indices[k + 2] = (i + 1) * n + j;
+			indices[k + 3] = (i + 1) * n + j;
+			indices[k + 4] = i * n + j + 1;
+			indices[k + 5] = (i + 1) * n + j + 1;
+			k += 6;
+		}
+	}
+}
+
+}
+
+// Times the scalar terrain path against TerrainGenerator, serial and on the
+// pool, checks that both produce the same surface, and prints the ACMR of both
+// index orders. The first argument sets the number of pool threads.
+int main(int argc, char** argv) {
+	TerrainVertexLayout layout;
+	layout.Stride = sizeof(Vertex);
+	layout.PositionOffset = offsetof(Vertex, Pos);
+	layout.NormalOffset = offsetof(Vertex, Normal);
+	layout.TexCOffset = offsetof(Vertex, TexC);
+
+	ThreadPool pool(argc > 1 ? (std::uint32_t)std::atoi(argv[1]) : 0);
+	std::printf("pool: %u threads\n", pool.Concurrency());
+
+	int result = 0;
+	for (std::uint32_t size : { 50u, 257u, 1025u, 4097u })
+	{
+		HillsTerrainDesc desc;
+		desc.Rows = size;
+		desc.Columns = size;
+
+		std::vector<Vertex> scalarVertices;
+		std::vector<std::uint32_t> scalarIndices;
+		double start = NowMilliseconds();
+		GenerateScalar(desc, scalarVertices, scalarIndices);
+		double scalarMs = NowMilliseconds() - start;
+
+		std::vector<Vertex> vertices((std::size_t)size * size);
+		std::vector<std::uint32_t> indices(GridIndexCount(size, size));
+		start = NowMilliseconds();
+		GenerateHillsVertices(desc, vertices.data(), layout);
+		GenerateGridIndices(size, size, DefaultGridStripWidth, indices.data());
+		double serialMs = NowMilliseconds() - start;
+
+		start = NowMilliseconds();
+		GenerateHillsVertices(desc, vertices.data(), layout, &pool);
+		GenerateGridIndices(size, size, DefaultGridStripWidth, indices.data(), &pool);
+		double poolMs = NowMilliseconds() - start;
+
+		// Positions and texture coordinates must match exactly, heights and
+		// normals up to the difference between scalar and vector trig.
+		float heightError = 0.0f;
+		float normalError = 0.0f;
+		for (std::size_t i = 0; i < vertices.size(); ++i)
+		{
+			const Vertex& a = scalarVertices[i];
+			const Vertex& b = vertices[i];
+			if (a.Pos.x != b.Pos.x || a.Pos.z != b.Pos.z || a.TexC.x != b.TexC.x || a.TexC.y != b.TexC.y)
+			{
+				std::printf("%u: vertex %zu is not where the scalar path put it\n", size, i);
+				result = 1;
+				break;
+			}
+			heightError = std::max(heightError, std::fabs(a.Pos.y - b.Pos.y) / (1.0f + std::fabs(a.Pos.y)));
+			normalError = std::max(normalError, std::fabs(a.Normal.x - b.Normal.x) + std::fabs(a.Normal.y - b.Normal.y) +
+				std::fabs(a.Normal.z - b.Normal.z));
+		}
+
+		float scalarAcmr = AnalyzeVertexCache(scalarIndices.data(), scalarIndices.size(), scalarVertices.size()).Acmr;
+		float acmr = AnalyzeVertexCache(indices.data(), indices.size(), vertices.size()).Acmr;
+
+		std::printf("%4ux%-4u scalar %8.2f ms  serial %8.2f ms  pool %8.2f ms  height error %.2g  normal error %.2g  ACMR %.3f -> %.3f\n",
+			size, size, scalarMs, serialMs, poolMs, heightError, normalError, scalarAcmr, acmr);
+	}
+
+	// ACMR of the strip widths around the default, for 16 and 32 entry caches.
+	const std::uint32_t size = 257;
+	std::vector<std::uint32_t> indices(GridIndexCount(size, size));
+	for (std::uint32_t stripWidth : { 4u, 5u, 6u, 7u, 8u, 10u, 15u, 31u })
+	{
+		GenerateGridIndices(size, size, stripWidth, indices.data());
+		std::printf("strip width %2u: ACMR %.3f (16 entries), %.3f (32 entries)\n", stripWidth,
+			AnalyzeVertexCache(indices.data(), indices.size(), size * size, 16).Acmr,
+			AnalyzeVertexCache(indices.data(), indices.size(), size * size, 32).Acmr);
+	}
+	return result;
+}
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <DirectXMath.h>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+// Procedural meshes for the headless tests and benchmarks.
+struct TestMesh {
+	std::vector<DirectX::XMFLOAT3> Positions;
+	std::vector<DirectX::XMFLOAT3> Normals;
+	std::vector<std::uint32_t> Indices;
+};
+
+// Closed unit sphere of 2 * slices * (stacks - 1) triangles, with one vertex
+// per pole and no seam. Triangles wind clockwise seen from outside, as in
+// GeometryGenerator.
+inline TestMesh MakeSphere(std::uint32_t slices, std::uint32_t stacks) {
+	const float pi = 3.14159265f;
+	TestMesh mesh;
+	auto addVertex = [&](float x, float y, float z) {
+		mesh.Positions.push_back(DirectX::XMFLOAT3(x, y, z));
+		mesh.Normals.push_back(DirectX::XMFLOAT3(x, y, z));
+	};
+
+	addVertex(0.0f, 1.0f, 0.0f);
+	for (std::uint32_t i = 1; i < stacks; ++i)
+	{
+		float phi = i * pi / stacks;
+		for (std::uint32_t j = 0; j < slices; ++j)
+		{
+			float theta = j * 2.0f * pi / slices;
+			addVertex(sinf(phi) * cosf(theta), cosf(phi), sinf(phi) * sinf(theta));
+		}
+	}
+	addVertex(0.0f, -1.0f, 0.0f);
+
+	const std::uint32_t south = (std::uint32_t)mesh.Positions.size() - 1;
+	auto ring = [slices](std::uint32_t i, std::uint32_t j) { return 1 + (i - 1) * slices + j % slices; };
+	for (std::uint32_t j = 0; j < slices; ++j)
+		mesh.Indices.insert(mesh.Indices.end(), { 0, ring(1, j + 1), ring(1, j) });
+	for (std::uint32_t i = 1; i + 1 < stacks; ++i)
+	{
+		for (std::uint32_t j = 0; j < slices; ++j)
+		{
+			mesh.Indices.insert(mesh.Indices.end(), { ring(i, j), ring(i, j + 1), ring(i + 1, j) });
+			mesh.Indices.insert(mesh.Indices.end(), { ring(i + 1, j), ring(i, j + 1), ring(i + 1, j + 1) });
+		}
+	}
+	for (std::uint32_t j = 0; j < slices; ++j)
+		mesh.Indices.insert(mesh.Indices.end(), { south, ring(stacks - 1, j), ring(stacks - 1, j + 1) });
+	return mesh;
+}
+
+// Open size x size vertex grid over [0, 1] x [0, 1] in xz, lifted into gentle
+// hills, rows one after another. Triangles face +y.
+inline TestMesh MakeHeightfield(std::uint32_t size) {
+	TestMesh mesh;
+	for (std::uint32_t i = 0; i < size; ++i)
+	{
+		for (std::uint32_t j = 0; j < size; ++j)
+		{
+			float x = (float)j / (size - 1);
+			float z = (float)i / (size - 1);
+			float y = 0.1f * sinf(6.0f * x) * cosf(5.0f * z);
+			mesh.Positions.push_back(DirectX::XMFLOAT3(x, y, z));
+
+			float nx = -0.6f * cosf(6.0f * x) * cosf(5.0f * z);
+			float nz = 0.5f * sinf(6.0f * x) * sinf(5.0f * z);
+			float length = sqrtf(nx * nx + 1.0f + nz * nz);
+			mesh.Normals.push_back(DirectX::XMFLOAT3(nx / length, 1.0f / length, nz / length));
+		}
+	}
+
+	for (std::uint32_t i = 0; i + 1 < size; ++i)
+	{
+		for (std::uint32_t j = 0; j + 1 < size; ++j)
+		{
+			std::uint32_t v = i * size + j;
+			mesh.Indices.insert(mesh.Indices.end(), { v, v + size, v + 1 });
+			mesh.Indices.insert(mesh.Indices.end(), { v + 1, v + size, v + size + 1 });
+		}
+	}
+	return mesh;
+}
+
+// Cross product of the edges of triangle t, whose direction tells its winding.
+inline DirectX::XMFLOAT3 TriangleNormal(const DirectX::XMFLOAT3* positions, const std::uint32_t* indices, std::size_t t) {
+	const DirectX::XMFLOAT3& p = positions[indices[t * 3 + 0]];
+	const DirectX::XMFLOAT3& q = positions[indices[t * 3 + 1]];
+	const DirectX::XMFLOAT3& r = positions[indices[t * 3 + 2]];
+	float e1[3] = { q.x - p.x, q.y - p.y, q.z - p.z };
+	float e2[3] = { r.x - p.x, r.y - p.y, r.z - p.z };
+	return DirectX::XMFLOAT3(e1[1] * e2[2] - e1[2] * e2[1], e1[2] * e2[0] - e1[0] * e2[2], e1[0] * e2[1] - e1[1] * e2[0]);
+}
@@ -0,0 +1,405 @@
+#include "TextureStreamer.h"
+#include "DDSTextureLoader.h"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+// Loads recording on the pool or waiting for the GPU at once. Each holds its
+// level twice, in the upload heap and in the texture.
+const std::uint32_t MaxLoadsInFlight = 2;
+
+// Marks a slot switched this frame, before the fence that frees it is signaled.
+const std::uint64_t PendingFence = ~0ull;
+
+void CreateTextureSrv(ID3D12Device* device, ID3D12Resource* resource, bool cubeMap, D3D12_CPU_DESCRIPTOR_HANDLE handle) {
+	D3D12_RESOURCE_DESC desc = resource->GetDesc();
+
+	D3D12_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
+	srvDesc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
+	srvDesc.Format = desc.Format;
+	if (desc.Dimension == D3D12_RESOURCE_DIMENSION_TEXTURE3D)
+	{
+		srvDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE3D;
+		srvDesc.Texture3D.MipLevels = -1;
+	}
+	else if (cubeMap)
+	{
+		srvDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURECUBE;
+		srvDesc.TextureCube.MipLevels = -1;
+	}
+	else if (desc.DepthOrArraySize > 1)
+	{
+		srvDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2DARRAY;
+		srvDesc.Texture2DArray.MipLevels = -1;
+		srvDesc.Texture2DArray.ArraySize = desc.DepthOrArraySize;
+	}
+	else
+	{
+		srvDesc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2D;
+		srvDesc.Texture2D.MipLevels = -1;
+	}
+	device->CreateShaderResourceView(resource, &srvDesc, handle);
+}
+
+// Largest side of mip, which as a load's maxsize makes it the first mip loaded.
+std::size_t MipSize(const DDSTexture& dds, std::uint32_t mip) {
+	const DDSSubresource& top = dds.Subresource(0, mip);
+	return std::max<std::size_t>({ top.Width, top.Height, top.Depth });
+}
+
+}
+
+TextureStreamer::TextureStreamer(ID3D12Device* device, ID3D12CommandQueue* queue, ThreadPool* pool,
+	std::uint64_t budgetBytes, std::uint32_t tailMaxSize) :
+	m_device(device),
+	m_queue(queue),
+	m_pool(pool),
+	m_budgetBytes(budgetBytes),
+	m_budgetFromTextures(budgetBytes == 0),
+	m_tailMaxSize(tailMaxSize)
+{
+	ThrowIfFailed(m_device->CreateFence(0, D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(m_fence.GetAddressOf())));
+}
+
+TextureStreamer::~TextureStreamer() {
+	// The pool tasks write to the loads, so they must all have returned.
+	for (;;)
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			if (m_recording == 0)
+				break;
+		}
+		if (!m_pool || !m_pool->RunPendingTask())
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_loadRecorded.wait(lock, [&] { return m_recording == 0; });
+		}
+	}
+	WaitForFence(m_fenceValue);
+}
+
+void TextureStreamer::Add(const std::vector<TextureSource>& sources, CommandListSet& lists, ThreadPool* pool) {
+	const TextureId first = TextureCount();
+	for (const TextureSource& source : sources)
+	{
+		auto entry = std::make_unique<Entry>();
+		entry->Name = source.Name;
+		m_ids[source.Name] = TextureCount();
+		m_textures.push_back(std::move(entry));
+	}
+
+	ParallelFor(pool, (std::uint32_t)sources.size(), [&](std::uint32_t i) {
+		Entry& entry = *m_textures[first + i];
+		if (!entry.File.Open(sources[i].Filename))
+			ThrowIfFailed(HRESULT_FROM_WIN32(ERROR_OPEN_FAILED));
+		if (!ParseDDS(entry.File.Data(), entry.File.Size(), entry.Dds))
+			ThrowIfFailed(HRESULT_FROM_WIN32(ERROR_INVALID_DATA));
+
+		// Textures with a single mip, or none small enough, are loaded whole and
+		// never streamed.
+		entry.TailMip = DDSTailMip(entry.Dds, m_tailMaxSize);
+		entry.TailBytes = DDSBytesFrom(entry.Dds, entry.TailMip);
+		entry.WantedMip = entry.TailMip;
+
+		const std::size_t maxsize = entry.TailMip > 0 ? MipSize(entry.Dds, entry.TailMip) : 0;
+		ThrowIfFailed(DirectX::CreateDDSTextureFromMemory12(m_device, lists.Open(), entry.File.Data(), entry.File.Size(),
+			entry.Tail, entry.TailUpload, maxsize));
+	});
+
+	if (m_budgetFromTextures)
+	{
+		std::vector<const DDSTexture*> textures;
+		for (auto& entry : m_textures)
+			textures.push_back(&entry->Dds);
+		m_budgetBytes = DDSStreamingBudget(textures, m_tailMaxSize);
+	}
+}
+
+void TextureStreamer::DisposeUploaders() {
+	for (auto& entry : m_textures)
+		entry->TailUpload = nullptr;
+}
+
+void TextureStreamer::CreateDescriptors(ID3D12DescriptorHeap* heap, UINT firstDescriptor, UINT descriptorSize) {
+	m_heap = heap;
+	m_firstDescriptor = firstDescriptor;
+	m_descriptorSize = descriptorSize;
+
+	CD3DX12_CPU_DESCRIPTOR_HANDLE handle(heap->GetCPUDescriptorHandleForHeapStart(), firstDescriptor, descriptorSize);
+	for (auto& entry : m_textures)
+	{
+		// Both slots start on the tail.
+		for (int slot = 0; slot < 2; ++slot)
+		{
+			CreateTextureSrv(m_device, entry->Tail.Get(), entry->Dds.IsCubeMap, handle);
+			handle.Offset(1, descriptorSize);
+		}
+	}
+}
+
+UINT TextureStreamer::DescriptorIndex(TextureId texture) const {
+	return m_firstDescriptor + 2 * texture + m_textures[texture]->CurrentSlot;
+}
+
+void TextureStreamer::Request(TextureId texture, std::uint32_t mip) {
+	Entry& entry = *m_textures[texture];
+	entry.WantedMip = std::min<std::uint32_t>(entry.WantedMip, mip);
+}
+
+void TextureStreamer::Update() {
+	const std::uint64_t completed = m_fence->GetCompletedValue();
+
+	// Everything the pool finished recording since the last frame goes to the
+	// queue in one submission.
+	std::vector<Load*> recorded;
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		recorded.swap(m_recorded);
+	}
+
+	std::vector<ID3D12CommandList*> lists;
+	for (Load* load : recorded)
+	{
+		if (!load->Failed)
+			lists.push_back(load->CommandList.Get());
+	}
+	if (!lists.empty())
+	{
+		m_queue->ExecuteCommandLists((UINT)lists.size(), lists.data());
+		const std::uint64_t fence = Signal();
+		for (Load* load : recorded)
+			load->Fence = fence;
+	}
+
+	// A failed load leaves its texture on what it has, and is not retried.
+	for (Load* load : recorded)
+	{
+		if (!load->Failed)
+			continue;
+		Entry& entry = *m_textures[load->Texture];
+		entry.LoadFailed = true;
+		entry.Loading = nullptr;
+		m_pendingBytes -= load->Bytes;
+		m_loads.erase(std::find_if(m_loads.begin(), m_loads.end(),
+			[&](const std::unique_ptr<Load>& other) { return other.get() == load; }));
+	}
+
+	// Uploads the GPU has finished take the place of what their textures showed,
+	// once the idle SRV is no longer read.
+	for (auto load = m_loads.begin(); load != m_loads.end();)
+	{
+		Load& finished = **load;
+		Entry& entry = *m_textures[finished.Texture];
+		if (finished.Fence == 0 || finished.Fence > completed || entry.IdleSlotFence > completed)
+		{
+			++load;
+			continue;
+		}
+
+		Switch(finished.Texture, finished.Resource.Get());
+		entry.Streamed = finished.Resource;
+		entry.StreamedMip = finished.Mip;
+		entry.StreamedBytes = finished.Bytes;
+		entry.Loading = nullptr;
+		m_pendingBytes -= finished.Bytes;
+		++m_loadCount;
+		load = m_loads.erase(load);
+	}
+
+	// Start loads for the textures seen finer than they are resident, evicting
+	// the least recently used ones when the budget is full.
+	for (TextureId id = 0; id < TextureCount(); ++id)
+	{
+		Entry& entry = *m_textures[id];
+		if (entry.WantedMip < entry.TailMip)
+			entry.LastUsedFrame = m_frame;
+	}
+
+	for (TextureId id = 0; id < TextureCount() && m_loads.size() < MaxLoadsInFlight; ++id)
+	{
+		Entry& entry = *m_textures[id];
+		if (entry.Loading || entry.LoadFailed || entry.WantedMip >= entry.ResidentMip())
+			continue;
+
+		// The level being replaced stays resident until the switch.
+		auto fits = [&](std::uint32_t mip) {
+			return ResidentBytes() + m_pendingBytes + DDSBytesFrom(entry.Dds, mip) <= m_budgetBytes;
+		};
+
+		std::uint32_t mip = entry.WantedMip;
+		while (!fits(mip) && EvictOne(id))
+		{
+		}
+		while (mip < entry.ResidentMip() && !fits(mip))
+			++mip;
+		if (mip < entry.ResidentMip())
+			StartLoad(id, mip);
+	}
+
+	// One fence covers every slot switched this frame and the levels they showed.
+	bool switched = false;
+	for (auto& entry : m_textures)
+		switched |= entry->IdleSlotFence == PendingFence;
+	if (switched)
+	{
+		const std::uint64_t fence = Signal();
+		for (auto& entry : m_textures)
+		{
+			if (entry->IdleSlotFence == PendingFence)
+				entry->IdleSlotFence = fence;
+		}
+		for (Retired& retired : m_retired)
+		{
+			if (retired.Fence == PendingFence)
+				retired.Fence = fence;
+		}
+	}
+
+	m_retired.erase(std::remove_if(m_retired.begin(), m_retired.end(),
+		[&](const Retired& retired) { return retired.Fence <= completed; }), m_retired.end());
+
+	for (auto& entry : m_textures)
+		entry->WantedMip = entry->TailMip;
+	++m_frame;
+}
+
+TextureStreamer::Stats TextureStreamer::GetStats() const {
+	Stats stats;
+	stats.TextureCount = TextureCount();
+	for (auto& entry : m_textures)
+	{
+		stats.TailBytes += entry->TailBytes;
+		if (entry->Streamed)
+			stats.StreamedBytes += entry->StreamedBytes;
+		stats.FullBytes += DDSBytesFrom(entry->Dds, 0);
+	}
+	stats.BudgetBytes = m_budgetBytes;
+	stats.Loads = m_loadCount;
+	stats.Evictions = m_evictionCount;
+	return stats;
+}
+
+std::uint64_t TextureStreamer::ResidentBytes() const {
+	// Retired levels are left out: they go as soon as the GPU is past them.
+	std::uint64_t bytes = 0;
+	for (auto& entry : m_textures)
+	{
+		bytes += entry->TailBytes;
+		if (entry->Streamed)
+			bytes += entry->StreamedBytes;
+	}
+	return bytes;
+}
+
+void TextureStreamer::StartLoad(TextureId texture, std::uint32_t mip) {
+	auto load = std::make_unique<Load>();
+	load->Texture = texture;
+	load->Mip = mip;
+	load->Bytes = DDSBytesFrom(m_textures[texture]->Dds, mip);
+	m_textures[texture]->Loading = load.get();
+	m_pendingBytes += load->Bytes;
+
+	Load* started = load.get();
+	m_loads.push_back(std::move(load));
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		++m_recording;
+	}
+
+	if (m_pool)
+		m_pool->Submit([this, started] { LoadOnPool(started); });
+	else
+		LoadOnPool(started);
+}
+
+void TextureStreamer::LoadOnPool(Load* load) {
+	// Only the mapped file and the parsed header are read here; they do not
+	// change once the texture has been added.
+	const Entry& entry = *m_textures[load->Texture];
+	try
+	{
+		ThrowIfFailed(m_device->CreateCommandAllocator(D3D12_COMMAND_LIST_TYPE_DIRECT,
+			IID_PPV_ARGS(load->Allocator.GetAddressOf())));
+		ThrowIfFailed(m_device->CreateCommandList(0, D3D12_COMMAND_LIST_TYPE_DIRECT, load->Allocator.Get(), nullptr,
+			IID_PPV_ARGS(load->CommandList.GetAddressOf())));
+		ThrowIfFailed(DirectX::CreateDDSTextureFromMemory12(m_device, load->CommandList.Get(), entry.File.Data(),
+			entry.File.Size(), load->Resource, load->Upload, MipSize(entry.Dds, load->Mip)));
+		ThrowIfFailed(load->CommandList->Close());
+	}
+	catch (...)
+	{
+		load->Failed = true;
+	}
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_recorded.push_back(load);
+	--m_recording;
+	m_loadRecorded.notify_all();
+}
+
+void TextureStreamer::Switch(TextureId texture, ID3D12Resource* resource) {
+	Entry& entry = *m_textures[texture];
+	if (entry.Streamed)
+		m_retired.push_back({ entry.Streamed, PendingFence });
+
+	entry.CurrentSlot ^= 1;
+	CD3DX12_CPU_DESCRIPTOR_HANDLE handle(m_heap->GetCPUDescriptorHandleForHeapStart(), DescriptorIndex(texture),
+		m_descriptorSize);
+	CreateTextureSrv(m_device, resource, entry.Dds.IsCubeMap, handle);
+	entry.IdleSlotFence = PendingFence;
+}
+
+bool TextureStreamer::EvictOne(TextureId keep) {
+	// Only textures not needed this frame, whose idle SRV is free to rewrite.
+	const std::uint64_t completed = m_fence->GetCompletedValue();
+	Entry* victim = nullptr;
+	TextureId victimId = 0;
+	for (TextureId id = 0; id < TextureCount(); ++id)
+	{
+		Entry& entry = *m_textures[id];
+		if (id == keep || !entry.Streamed || entry.Loading || entry.LastUsedFrame == m_frame ||
+			entry.IdleSlotFence > completed)
+			continue;
+		if (!victim || entry.LastUsedFrame < victim->LastUsedFrame)
+		{
+			victim = &entry;
+			victimId = id;
+		}
+	}
+	if (!victim)
+		return false;
+
+	Switch(victimId, victim->Tail.Get());
+	victim->Streamed = nullptr;
+	victim->StreamedBytes = 0;
+	++m_evictionCount;
+	return true;
+}
+
+std::uint64_t TextureStreamer::Signal() {
+	ThrowIfFailed(m_queue->Signal(m_fence.Get(), ++m_fenceValue));
+	return m_fenceValue;
+}
+
+void TextureStreamer::WaitForFence(std::uint64_t value) {
+	if (m_fence->GetCompletedValue() >= value)
+		return;
+
+	HANDLE eventHandle = CreateEventEx(nullptr, false, false, EVENT_ALL_ACCESS);
+	ThrowIfFailed(m_fence->SetEventOnCompletion(value, eventHandle));
+	WaitForSingleObject(eventHandle, INFINITE);
+	CloseHandle(eventHandle);
+}
+
+std::uint32_t RequiredTextureMip(std::uint32_t textureSize, float uvScale, float worldSize, float distance, float errorScale) {
+	if (worldSize <= 0.0f || distance <= 0.0f || errorScale <= 0.0f)
+		return 0;
+
+	// Texels per world unit over pixels per world unit at that distance.
+	float texelsPerPixel = textureSize * uvScale / worldSize * distance / errorScale;
+	if (texelsPerPixel <= 1.0f)
+		return 0;
+	return (std::uint32_t)std::floor(std::log2(texelsPerPixel));
+}
@@ -0,0 +1,170 @@
+#pragma once
+
+#include "DDSParser.h"
+#include "MappedFile.h"
+#include "ParallelStartup.h"
+#include "ThreadPool.h"
+#include "Utilities.h"
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Streams the mip levels of DDS textures by how finely they are seen. Startup
+// uploads only the mip tail of each texture. Each frame the app requests the
+// finest mip it needs per texture, and Update loads finer levels on the thread
+// pool, straight from the mapped file, as long as they fit the memory budget.
+// When they do not, the least recently used textures fall back to their tails.
+//
+// Each texture owns two SRVs in the app's heap. A new level is written to the
+// one the GPU is not reading, and the materials switch to it.
+class TextureStreamer {
+public:
+	using TextureId = std::uint32_t;
+
+	struct Stats {
+		std::uint32_t TextureCount = 0;
+		std::uint64_t TailBytes = 0;
+		std::uint64_t StreamedBytes = 0;
+		std::uint64_t FullBytes = 0;
+		std::uint64_t BudgetBytes = 0;
+		std::uint32_t Loads = 0;
+		std::uint32_t Evictions = 0;
+	};
+
+	// Tails hold the mips no larger than tailMaxSize. budgetBytes bounds the tails
+	// and the streamed levels together; 0 makes it DDSStreamingBudget of the
+	// textures added, the least with which each can still reach mip 0.
+	TextureStreamer(ID3D12Device* device, ID3D12CommandQueue* queue, ThreadPool* pool, std::uint64_t budgetBytes = 0,
+		std::uint32_t tailMaxSize = 64);
+	TextureStreamer(const TextureStreamer& rhs) = delete;
+	TextureStreamer& operator=(const TextureStreamer& rhs) = delete;
+	// Waits for the loads in flight and the GPU work that uses them.
+	~TextureStreamer();
+
+	// Maps the files and records the uploads of their tails on lists from lists,
+	// in parallel on pool when it is not null. Ids follow the order of sources.
+	void Add(const std::vector<TextureSource>& sources, CommandListSet& lists, ThreadPool* pool);
+	// Releases the tail upload buffers once the startup lists have finished.
+	void DisposeUploaders();
+
+	TextureId Find(const std::string& name) const { return m_ids.at(name); }
+	std::uint32_t TextureCount() const { return (std::uint32_t)m_textures.size(); }
+	// Size of the finest level, the one mip 0 requests refer to.
+	std::uint32_t Width(TextureId texture) const { return m_textures[texture]->Dds.Width; }
+	std::uint32_t Height(TextureId texture) const { return m_textures[texture]->Dds.Height; }
+
+	// Writes the SRVs of every texture to heap from firstDescriptor on, using
+	// DescriptorCount slots.
+	void CreateDescriptors(ID3D12DescriptorHeap* heap, UINT firstDescriptor, UINT descriptorSize);
+	UINT DescriptorCount() const { return 2 * TextureCount(); }
+	// Heap index of the SRV to bind for texture this frame.
+	UINT DescriptorIndex(TextureId texture) const;
+
+	// Asks for mip or finer this frame. Requests are cleared by Update.
+	void Request(TextureId texture, std::uint32_t mip);
+	// Submits finished loads, switches the SRVs of the uploads the GPU has
+	// completed, and starts or evicts loads for this frame's requests. Call
+	// once a frame before recording, on the thread that renders.
+	void Update();
+
+	Stats GetStats() const;
+
+private:
+	struct Load;
+
+	struct Entry {
+		std::string Name;
+		MappedFile File;
+		DDSTexture Dds;
+		std::uint32_t TailMip = 0;
+		std::uint64_t TailBytes = 0;
+		ComPtr<ID3D12Resource> Tail;
+		ComPtr<ID3D12Resource> TailUpload;
+
+		// The streamed level, if one is resident, and its first mip.
+		ComPtr<ID3D12Resource> Streamed;
+		std::uint32_t StreamedMip = 0;
+		std::uint64_t StreamedBytes = 0;
+
+		// Finest mip requested this frame, and the last frame one finer than the
+		// tail was requested.
+		std::uint32_t WantedMip = 0;
+		std::uint64_t LastUsedFrame = 0;
+
+		// SRV the materials bind, and the fence value after which the other one
+		// is no longer read.
+		std::uint32_t CurrentSlot = 0;
+		std::uint64_t IdleSlotFence = 0;
+		Load* Loading = nullptr;
+		bool LoadFailed = false;
+
+		std::uint32_t ResidentMip() const { return Streamed ? StreamedMip : TailMip; }
+	};
+
+	struct Load {
+		TextureId Texture = 0;
+		std::uint32_t Mip = 0;
+		std::uint64_t Bytes = 0;
+		ComPtr<ID3D12CommandAllocator> Allocator;
+		ComPtr<ID3D12GraphicsCommandList> CommandList;
+		ComPtr<ID3D12Resource> Resource;
+		ComPtr<ID3D12Resource> Upload;
+		bool Failed = false;
+		// Fence value after which the upload has finished on the GPU.
+		std::uint64_t Fence = 0;
+	};
+
+	struct Retired {
+		ComPtr<ID3D12Resource> Resource;
+		std::uint64_t Fence = 0;
+	};
+
+	std::uint64_t ResidentBytes() const;
+	void StartLoad(TextureId texture, std::uint32_t mip);
+	void LoadOnPool(Load* load);
+	// Points the idle SRV of texture at resource and makes it the current one.
+	void Switch(TextureId texture, ID3D12Resource* resource);
+	bool EvictOne(TextureId keep);
+	std::uint64_t Signal();
+	void WaitForFence(std::uint64_t value);
+
+	ID3D12Device* m_device;
+	ID3D12CommandQueue* m_queue;
+	ThreadPool* m_pool;
+	std::uint64_t m_budgetBytes;
+	bool m_budgetFromTextures;
+	std::uint32_t m_tailMaxSize;
+
+	std::vector<std::unique_ptr<Entry>> m_textures;
+	std::unordered_map<std::string, TextureId> m_ids;
+
+	ID3D12DescriptorHeap* m_heap = nullptr;
+	UINT m_firstDescriptor = 0;
+	UINT m_descriptorSize = 0;
+
+	ComPtr<ID3D12Fence> m_fence;
+	std::uint64_t m_fenceValue = 0;
+	std::uint64_t m_frame = 1;
+
+	std::vector<std::unique_ptr<Load>> m_loads;
+	std::vector<Retired> m_retired;
+	std::uint64_t m_pendingBytes = 0;
+	std::uint32_t m_loadCount = 0;
+	std::uint32_t m_evictionCount = 0;
+
+	// Loads the pool threads have finished recording, waiting to be submitted.
+	std::mutex m_mutex;
+	std::condition_variable m_loadRecorded;
+	std::vector<Load*> m_recorded;
+	std::uint32_t m_recording = 0;
+};
+
+// Mip at which one texel of a textureSize texture covers about one pixel, for a
+// surface whose largest side is worldSize units with the texture repeated
+// uvScale times across it, seen from distance with errorScale pixels per world
+// unit at distance 1 (Camera::GetLodErrorScale).
+std::uint32_t RequiredTextureMip(std::uint32_t textureSize, float uvScale, float worldSize, float distance, float errorScale);
@@ -0,0 +1,142 @@
+#include "ThreadPool.h"
+#include <atomic>
+#include <exception>
+#include <memory>
+
+ThreadPool::ThreadPool(std::uint32_t threadCount) {
+	if (threadCount == 0)
+	{
+		std::uint32_t hardwareThreads = std::thread::hardware_concurrency();
+		threadCount = hardwareThreads > 1 ? hardwareThreads - 1 : 1;
+	}
+
+	for (std::uint32_t i = 0; i < threadCount; ++i)
+		m_threads.emplace_back(&ThreadPool::WorkerLoop, this);
+}
+
+ThreadPool::~ThreadPool() {
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_stop = true;
+	}
+	m_wake.notify_all();
+
+	for (auto& t : m_threads)
+		t.join();
+}
+
+ThreadPool& ThreadPool::Default() {
+	static ThreadPool pool;
+	return pool;
+}
+
+void ThreadPool::WorkerLoop() {
+	for (;;)
+	{
+		std::function<void()> task;
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_wake.wait(lock, [this] { return m_stop || !m_tasks.empty(); });
+			if (m_stop && m_tasks.empty())
+				return;
+
+			task = std::move(m_tasks.front());
+			m_tasks.pop_front();
+		}
+		task();
+	}
+}
+
+bool ThreadPool::RunPendingTask() {
+	std::function<void()> task;
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		if (m_tasks.empty())
+			return false;
+
+		task = std::move(m_tasks.front());
+		m_tasks.pop_front();
+	}
+	task();
+	return true;
+}
+
+void ThreadPool::Submit(std::function<void()> task) {
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_tasks.push_back(std::move(task));
+	}
+	m_wake.notify_one();
+}
+
+void ThreadPool::ParallelFor(std::uint32_t count, const std::function<void(std::uint32_t)>& fn) {
+	if (count == 0)
+		return;
+
+	if (count == 1)
+	{
+		fn(0);
+		return;
+	}
+
+	struct Group {
+		std::atomic<std::uint32_t> Remaining;
+		std::mutex Mutex;
+		std::condition_variable Done;
+		std::exception_ptr Error;
+	};
+
+	auto group = std::make_shared<Group>();
+	group->Remaining = count;
+
+	auto runIndex = [group, &fn](std::uint32_t i) {
+		try
+		{
+			fn(i);
+		}
+		catch (...)
+		{
+			std::lock_guard<std::mutex> lock(group->Mutex);
+			if (!group->Error)
+				group->Error = std::current_exception();
+		}
+
+		if (--group->Remaining == 0)
+		{
+			std::lock_guard<std::mutex> lock(group->Mutex);
+			group->Done.notify_all();
+		}
+	};
+
+	// Index 0 runs on the calling thread, the rest go through the queue.
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		for (std::uint32_t i = 1; i < count; ++i)
+			m_tasks.push_back([runIndex, i] { runIndex(i); });
+	}
+	m_wake.notify_all();
+
+	runIndex(0);
+
+	while (group->Remaining > 0)
+	{
+		if (RunPendingTask())
+			continue;
+
+		std::unique_lock<std::mutex> lock(group->Mutex);
+		group->Done.wait(lock, [&group] { return group->Remaining == 0; });
+	}
+
+	if (group->Error)
+		std::rethrow_exception(group->Error);
+}
+
+void ParallelFor(ThreadPool* pool, std::uint32_t count, const std::function<void(std::uint32_t)>& fn) {
+	if (pool)
+	{
+		pool->ParallelFor(count, fn);
+		return;
+	}
+	for (std::uint32_t i = 0; i < count; ++i)
+		fn(i);
+}
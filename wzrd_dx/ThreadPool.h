@@ -0,0 +1,48 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed set of worker threads fed from a single queue. The thread that waits on
+// a ParallelFor also runs queued tasks, so nested ParallelFor calls from inside
+// a task cannot deadlock the pool.
+class ThreadPool {
+public:
+	// threadCount = 0 uses one thread per hardware thread minus the caller.
+	explicit ThreadPool(std::uint32_t threadCount = 0);
+	ThreadPool(const ThreadPool& rhs) = delete;
+	ThreadPool& operator=(const ThreadPool& rhs) = delete;
+	~ThreadPool();
+
+	// Number of threads that can run tasks at once, including the caller.
+	std::uint32_t Concurrency() const { return (std::uint32_t)m_threads.size() + 1; }
+
+	// Runs fn(i) for every i in [0, count) and returns once all of them are done.
+	// The first exception thrown by a task is rethrown on the calling thread.
+	void ParallelFor(std::uint32_t count, const std::function<void(std::uint32_t)>& fn);
+
+	// Queues a task without waiting for it. The task must not throw.
+	void Submit(std::function<void()> task);
+	// Runs one queued task on the calling thread. Returns false if there was none.
+	bool RunPendingTask();
+
+	// Pool shared by the app for startup and per-frame work.
+	static ThreadPool& Default();
+
+private:
+	void WorkerLoop();
+
+	std::vector<std::thread> m_threads;
+	std::deque<std::function<void()>> m_tasks;
+	std::mutex m_mutex;
+	std::condition_variable m_wake;
+	bool m_stop = false;
+};
+
+// pool->ParallelFor, or a plain loop on the calling thread when pool is null.
+void ParallelFor(ThreadPool* pool, std::uint32_t count, const std::function<void(std::uint32_t)>& fn);
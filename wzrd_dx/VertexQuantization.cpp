@@ -0,0 +1,130 @@
+#include "VertexQuantization.h"
+#include <DirectXPackedVector.h>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+using namespace DirectX;
+using namespace DirectX::PackedVector;
+
+namespace {
+
+// +1 or -1 per component, +1 for zero so both sides of a fold agree.
+XMVECTOR XM_CALLCONV SignNotZero(FXMVECTOR v) {
+	return XMVectorSelect(XMVectorSplatOne(), XMVectorNegate(XMVectorSplatOne()), XMVectorLess(v, XMVectorZero()));
+}
+
+template <typename T>
+T* Element(T* base, std::size_t i, std::size_t stride) {
+	return (T*)((const std::uint8_t*)base + i * stride);
+}
+
+}
+
+PositionQuantization MakePositionQuantization(const XMFLOAT3& boundsMin, const XMFLOAT3& boundsMax) {
+	PositionQuantization quantization;
+	quantization.Offset = boundsMin;
+	XMStoreFloat3(&quantization.Scale, XMVectorMax(XMLoadFloat3(&boundsMax) - XMLoadFloat3(&boundsMin), XMVectorZero()));
+	return quantization;
+}
+
+XMVECTOR XM_CALLCONV OctEncode(FXMVECTOR normal) {
+	// Onto the octahedron. A zero vector stays zero and lands on +z.
+	XMVECTOR l1 = XMVector3Dot(XMVectorAbs(normal), XMVectorSplatOne());
+	l1 = XMVectorSelect(l1, XMVectorSplatOne(), XMVectorEqual(l1, XMVectorZero()));
+	XMVECTOR p = XMVectorDivide(normal, l1);
+
+	// The lower half folds over the diagonals: (1 - |y|, 1 - |x|) with the signs of x and y.
+	XMVECTOR folded = XMVectorMultiply(XMVectorSplatOne() - XMVectorAbs(XMVectorSwizzle<1, 0, 3, 2>(p)), SignNotZero(p));
+	XMVECTOR lower = XMVectorLess(XMVectorSplatZ(p), XMVectorZero());
+	return XMVectorAndInt(XMVectorSelect(p, folded, lower), XMVectorSelectControl(1, 1, 0, 0));
+}
+
+XMVECTOR XM_CALLCONV OctDecode(FXMVECTOR encoded) {
+	XMVECTOR e = XMVectorAndInt(encoded, XMVectorSelectControl(1, 1, 0, 0));
+	XMVECTOR a = XMVectorAbs(e);
+	XMVECTOR z = XMVectorSplatOne() - XMVectorSplatX(a) - XMVectorSplatY(a);
+
+	// Points of the lower half lie outside the diamond |x| + |y| <= 1; unfold them.
+	XMVECTOR t = XMVectorSaturate(XMVectorNegate(z));
+	XMVECTOR xy = XMVectorNegativeMultiplySubtract(t, SignNotZero(e), e);
+	return XMVector3Normalize(XMVectorSelect(xy, z, XMVectorSelectControl(0, 0, 1, 0)));
+}
+
+QuantizationError QuantizeVertices(QuantizedVertex* vertices, std::size_t count, const PositionQuantization& quantization,
+	const XMFLOAT3* positions, const XMFLOAT3* normals, const XMFLOAT2* texCoords, std::size_t stride)
+{
+	XMVECTOR scale = XMLoadFloat3(&quantization.Scale);
+	XMVECTOR offset = XMLoadFloat3(&quantization.Offset);
+	// Flat axes store 0 rather than dividing by a zero extent.
+	XMVECTOR invScale = XMVectorSelect(XMVectorReciprocal(scale), XMVectorZero(), XMVectorLessOrEqual(scale, XMVectorZero()));
+
+	// Squared distance, sine of the angle and texture coordinate difference.
+	XMVECTOR maxPosition = XMVectorZero();
+	XMVECTOR maxNormal = XMVectorZero();
+	XMVECTOR maxTexC = XMVectorZero();
+
+	for (std::size_t i = 0; i < count; ++i)
+	{
+		XMVECTOR p = XMLoadFloat3(Element(positions, i, stride));
+		XMVECTOR n = XMVector3Normalize(XMLoadFloat3(Element(normals, i, stride)));
+		XMVECTOR uv = texCoords ? XMLoadFloat2(Element(texCoords, i, stride)) : XMVectorZero();
+
+		XMUSHORTN4 position;
+		XMSHORTN2 normal;
+		XMHALF2 texC;
+		XMStoreUShortN4(&position, XMVectorMultiply(p - offset, invScale));
+		XMStoreShortN2(&normal, OctEncode(n));
+		XMStoreHalf2(&texC, uv);
+
+		QuantizedVertex& v = vertices[i];
+		std::memcpy(v.Position, &position, sizeof(v.Position));
+		std::memcpy(v.Normal, &normal, sizeof(v.Normal));
+		std::memcpy(v.TexC, &texC, sizeof(v.TexC));
+
+		// Decode as the input assembler and vertex shader do.
+		XMVECTOR dp = XMVectorMultiplyAdd(XMLoadUShortN4(&position), scale, offset) - p;
+		XMVECTOR dn = XMVector3Cross(OctDecode(XMLoadShortN2(&normal)), n);
+		XMVECTOR duv = XMVectorAbs(XMLoadHalf2(&texC) - uv);
+		maxPosition = XMVectorMax(maxPosition, XMVector3LengthSq(dp));
+		maxNormal = XMVectorMax(maxNormal, XMVector3LengthSq(dn));
+		maxTexC = XMVectorMax(maxTexC, XMVectorMax(duv, XMVectorSplatY(duv)));
+	}
+
+	// Normals within 90 degrees, so the sine gives the angle.
+	QuantizationError error;
+	error.Position = std::sqrt(XMVectorGetX(maxPosition));
+	error.NormalAngle = std::asin(std::min(std::sqrt(XMVectorGetX(maxNormal)), 1.0f));
+	error.TexC = XMVectorGetX(maxTexC);
+	return error;
+}
+
+void DequantizeVertices(const QuantizedVertex* vertices, std::size_t count, const PositionQuantization& quantization,
+	XMFLOAT3* positions, XMFLOAT3* normals, XMFLOAT2* texCoords, std::size_t stride)
+{
+	XMVECTOR scale = XMLoadFloat3(&quantization.Scale);
+	XMVECTOR offset = XMLoadFloat3(&quantization.Offset);
+
+	for (std::size_t i = 0; i < count; ++i)
+	{
+		const QuantizedVertex& v = vertices[i];
+		if (positions)
+		{
+			XMUSHORTN4 position;
+			std::memcpy(&position, v.Position, sizeof(position));
+			XMStoreFloat3(Element(positions, i, stride), XMVectorMultiplyAdd(XMLoadUShortN4(&position), scale, offset));
+		}
+		if (normals)
+		{
+			XMSHORTN2 normal;
+			std::memcpy(&normal, v.Normal, sizeof(normal));
+			XMStoreFloat3(Element(normals, i, stride), OctDecode(XMLoadShortN2(&normal)));
+		}
+		if (texCoords)
+		{
+			XMHALF2 texC;
+			std::memcpy(&texC, v.TexC, sizeof(texC));
+			XMStoreFloat2(Element(texCoords, i, stride), XMLoadHalf2(&texC));
+		}
+	}
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <DirectXMath.h>
+#include <cstddef>
+#include <cstdint>
+
+// Compact vertex for static meshes, 16 bytes instead of the 32 of Vertex3:
+//
+//	Position	R16G16B16A16_UNORM	position inside the mesh bounds, w unused
+//	Normal		R16G16_SNORM		octahedral encoding of the unit normal
+//	TexC		R16G16_FLOAT
+//
+// The input assembler expands each element to floats; the vertex shader scales
+// the position back with PositionQuantization and unfolds the normal.
+struct QuantizedVertex {
+	std::uint16_t Position[4];
+	std::int16_t Normal[2];
+	std::uint16_t TexC[2];
+};
+
+static_assert(sizeof(QuantizedVertex) == 16, "QuantizedVertex must stay 16 bytes");
+
+// Decodes a stored position: Offset + Scale * stored, with stored in [0, 1].
+struct PositionQuantization {
+	DirectX::XMFLOAT3 Scale = { 1.0f, 1.0f, 1.0f };
+	DirectX::XMFLOAT3 Offset = { 0.0f, 0.0f, 0.0f };
+};
+
+// Spreads the 16 bits of each axis over the bounds, so the position error is at
+// most half a step: (max - min) / 131070 per axis.
+PositionQuantization MakePositionQuantization(const DirectX::XMFLOAT3& boundsMin, const DirectX::XMFLOAT3& boundsMax);
+
+// Largest difference between the input and what the vertex shader decodes.
+struct QuantizationError {
+	// Distance, in mesh units.
+	float Position = 0.0f;
+	// Radians.
+	float NormalAngle = 0.0f;
+	// Per component.
+	float TexC = 0.0f;
+};
+
+// Maps a unit vector to x and y in [-1, 1] by projecting it onto the octahedron
+// |x| + |y| + |z| = 1 and folding the lower half over the upper one. Zero maps
+// to +z.
+DirectX::XMVECTOR XM_CALLCONV OctEncode(DirectX::FXMVECTOR normal);
+// The inverse of OctEncode, normalized, as in the vertex shader.
+DirectX::XMVECTOR XM_CALLCONV OctDecode(DirectX::FXMVECTOR encoded);
+
+// Quantizes count vertices read from strided streams. texCoords may be null, in
+// which case they are stored as zero. Returns the error of the result.
+QuantizationError QuantizeVertices(QuantizedVertex* vertices, std::size_t count, const PositionQuantization& quantization,
+	const DirectX::XMFLOAT3* positions, const DirectX::XMFLOAT3* normals, const DirectX::XMFLOAT2* texCoords, std::size_t stride);
+
+// Expands count vertices into strided streams, any of which may be null.
+void DequantizeVertices(const QuantizedVertex* vertices, std::size_t count, const PositionQuantization& quantization,
+	DirectX::XMFLOAT3* positions, DirectX::XMFLOAT3* normals, DirectX::XMFLOAT2* texCoords, std::size_t stride);